@@ -1,3 +1,5 @@
+#include "halo.h"
+
 __kernel void BatchNorm(__global float *restrict tensor,
                         int batch,
                         int channels,
@@ -5,35 +7,91 @@ __kernel void BatchNorm(__global float *restrict tensor,
                         float eps,
                         __constant float *weights,
                         __constant float *biases,
-                        float relu) {
+                        float relu,
+                        int across_batch) {
   // Index of the channel.
   int channel = get_global_id(0);
   if (channel >= channels) {
     return;
   }
-  const int offset = channel * channel_size;
+  // Images sharing the statistics: the whole batch, or the image of the
+  // second dimension.
+  const int first = across_batch ? 0 : get_global_id(1);
+  const int last = across_batch ? batch : first + 1;
+  const int image_stride = channels * channel_size;
+  const int count = (last - first) * channel_size;
+
   float mean = 0.f;
-  for (int i = 0; i < channel_size; i++) {
-    mean += tensor[offset + i];
+  for (int n = first; n < last; n++) {
+    const int offset = n * image_stride + channel * channel_size;
+    for (int i = 0; i < channel_size; i++) {
+      mean += tensor[offset + i];
+    }
   }
-  mean /= channel_size;
+  mean /= count;
   float var = 0.f;
-  for (int i = 0; i < channel_size; i++) {
-    float delta = tensor[offset + i] - mean;
-    var += delta * delta;
+  for (int n = first; n < last; n++) {
+    const int offset = n * image_stride + channel * channel_size;
+    for (int i = 0; i < channel_size; i++) {
+      float delta = tensor[offset + i] - mean;
+      var += delta * delta;
+    }
   }
-  var /= channel_size;
+  var /= count;
   var = sqrt(var + eps);
 
   float weight = weights[channel];
   float bias = biases[channel];
-  for (int i = 0; i < channel_size; i++) {
-    float activation = (weight * (tensor[offset + i] - mean) / var) + bias;
-    if (relu > 0.f) {
-      tensor[offset + i] = (activation > 0.f) ? relu * activation : 0.f;
-    } else {
-      tensor[offset + i] = activation;
+  for (int n = first; n < last; n++) {
+    const int offset = n * image_stride + channel * channel_size;
+    for (int i = 0; i < channel_size; i++) {
+      float activation = (weight * (tensor[offset + i] - mean) / var) + bias;
+      if (relu > 0.f) {
+        tensor[offset + i] = (activation > 0.f) ? relu * activation : 0.f;
+      } else {
+        tensor[offset + i] = activation;
+      }
     }
   }
 }
 
+// Normalize every element with the statistics found by Reduce: the Welford
+// states of the channels of each image, [batch, channels], or of the
+// channels over the batch, [channels]. A work item per element of the
+// interior of a tensor with a halo of halo, see halo.h, which stays zero.
+__kernel void BatchNormApply(__global float *restrict tensor,
+                             __global const float4 *restrict stats,
+                             int stats_offset,
+                             int size,
+                             int channels,
+                             int height,
+                             int width,
+                             int halo,
+                             float eps,
+                             __constant float *weights,
+                             __constant float *biases,
+                             float relu,
+                             int across_batch) {
+  const int idx = get_global_id(0);
+  if (idx >= size) {
+    return;
+  }
+  // Index of the channel of the image.
+  const int channel_size = height * width;
+  const int image_channel = idx / channel_size;
+  const int channel = image_channel % channels;
+  const int pixel = idx % channel_size;
+  const int t = HaloIndex(image_channel, pixel / width, pixel % width, height,
+                          width, halo);
+  const float4 state =
+      stats[stats_offset + (across_batch ? channel : image_channel)];
+  const float var = sqrt(state.z / state.x + eps);
+
+  const float activation =
+      (weights[channel] * (tensor[t] - state.y) / var) + biases[channel];
+  if (relu > 0.f) {
+    tensor[t] = (activation > 0.f) ? relu * activation : 0.f;
+  } else {
+    tensor[t] = activation;
+  }
+}
@@ -1,6 +1,12 @@
+#include "halo.h"
+#include "stride2.h"
+
+// The kernels write the interior of an output with a halo of out_halo, see
+// halo.h.
 __kernel void Convolute(__global float * restrict in_data,
                         __global float * restrict out_data,
                         __constant float * restrict kernel_data,
+                        int batch,
                         int in_height,
                         int in_width,
                         int in_size,
@@ -12,14 +18,17 @@ __kernel void Convolute(__global float * restrict in_data,
                         int kernel_size,
                         int batch_kernel_size,
                         int stride,
-                        int padding) {
+                        int padding,
+                        int out_halo) {
   // x coordinate of the output pixel.
   const int oj = get_global_id(0);
   // y coordinate of the output pixel.
   const int oi = get_global_id(1);
-  // Index of the output channel.
-  const int oc = get_global_id(2);
-  if ((oj >= out_width) || (oi >= out_height) || (oc >= out_channels)) {
+  // Image and output channel, folded so that small images fill the device
+  // with the whole batch.
+  const int n = get_global_id(2) / out_channels;
+  const int oc = get_global_id(2) % out_channels;
+  if ((oj >= out_width) || (oi >= out_height) || (n >= batch)) {
     return;
   }
 
@@ -27,7 +36,7 @@ __kernel void Convolute(__global float * restrict in_data,
   int kernel_idx = oc * batch_kernel_size;
   const int padded_in_height = in_height + 2 * padding;
   const int padded_in_width = in_width + 2 * padding;
-  int in_offset = 0;
+  int in_offset = n * in_channels * in_size;
   const int ii = oi * stride + kernel_radius;
   const int ij = oj * stride + kernel_radius;
 
@@ -46,6 +55,197 @@ __kernel void Convolute(__global float * restrict in_data,
     }
     in_offset += in_size;
   }
-  out_data[oc * out_size + oi * out_width + oj] = acc;
+  out_data[HaloIndex(n * out_channels + oc, oi, oj, out_height, out_width,
+                     out_halo)] = acc;
+}
+
+// Convolute on an input with a halo of padding, see halo.h: the window of
+// every output pixel lies inside the stored input, so the loops have no
+// bounds checks and 3 x 3 windows are unrolled.
+__kernel void ConvoluteHalo(__global float * restrict in_data,
+                            __global float * restrict out_data,
+                            __constant float * restrict kernel_data,
+                            int batch,
+                            int in_height,
+                            int in_width,
+                            int in_size,
+                            int out_height,
+                            int out_width,
+                            int out_size,
+                            int in_channels,
+                            int out_channels,
+                            int kernel_size,
+                            int batch_kernel_size,
+                            int stride,
+                            int padding,
+                            int out_halo) {
+  const int oj = get_global_id(0);
+  const int oi = get_global_id(1);
+  const int n = get_global_id(2) / out_channels;
+  const int oc = get_global_id(2) % out_channels;
+  if ((oj >= out_width) || (oi >= out_height) || (n >= batch)) {
+    return;
+  }
+
+  const int in_pitch = in_width + 2 * padding;
+  const int in_plane = (in_height + 2 * padding) * in_pitch;
+  const int window_size = kernel_size * kernel_size;
+  // Top left of the window in the stored input, border included.
+  __global const float *in = in_data + n * in_channels * in_plane +
+                             oi * stride * in_pitch + oj * stride;
+  __constant const float *weights = kernel_data + oc * batch_kernel_size;
+
+  float acc = 0.f;
+  for (int ic = 0; ic < in_channels; ic++) {
+    acc += Window(in, in_pitch, weights, kernel_size);
+    in += in_plane;
+    weights += window_size;
+  }
+  out_data[HaloIndex(n * out_channels + oc, oi, oj, out_height, out_width,
+                     out_halo)] = acc;
+}
+
+// Convolute on frames of uchar, HWC, applying the preprocessing
+// normalization on load: the first conv of a model reads the raw frames
+// and the normalized input is never written. The input is the centered
+// in_height x in_width window of each src_height x src_width frame.
+__kernel void ConvolutePreprocessed(__global const uchar * restrict in_data,
+                                    __global float * restrict out_data,
+                                    __constant float * restrict kernel_data,
+                                    int batch,
+                                    int in_height,
+                                    int in_width,
+                                    int in_size,
+                                    int out_height,
+                                    int out_width,
+                                    int out_size,
+                                    int in_channels,
+                                    int out_channels,
+                                    int kernel_size,
+                                    int batch_kernel_size,
+                                    int stride,
+                                    int padding,
+                                    int out_halo,
+                                    __constant float * restrict scale_shift,
+                                    int src_height,
+                                    int src_width) {
+  const int oj = get_global_id(0);
+  const int oi = get_global_id(1);
+  const int n = get_global_id(2) / out_channels;
+  const int oc = get_global_id(2) % out_channels;
+  if ((oj >= out_width) || (oi >= out_height) || (n >= batch)) {
+    return;
+  }
+
+  const int kernel_radius = kernel_size / 2;
+  const int padded_in_height = in_height + 2 * padding;
+  const int padded_in_width = in_width + 2 * padding;
+  const int src_row = src_width * in_channels;
+  // Top left of the window, moved by the padding so that r and c index it.
+  __global const uchar *image =
+      in_data + n * src_height * src_row +
+      ((src_height - in_height) / 2 - padding) * src_row +
+      ((src_width - in_width) / 2 - padding) * in_channels;
+  const int ii = oi * stride + kernel_radius;
+  const int ij = oj * stride + kernel_radius;
+
+  float acc = 0.f;
+  for (int ic = 0; ic < in_channels; ic++) {
+    const float scale = scale_shift[ic];
+    const float shift = scale_shift[in_channels + ic];
+    int kernel_idx = oc * batch_kernel_size + ic * kernel_size * kernel_size;
+    for (int r = ii - kernel_radius; r <= ii + kernel_radius; r++) {
+      for (int c = ij - kernel_radius; c <= ij + kernel_radius; c++) {
+        if ((r >= padding) && (r < padded_in_height - padding) &&
+            (c >= padding) && (c < padded_in_width - padding)) {
+          acc += (image[r * src_row + c * in_channels + ic] * scale + shift) *
+                 kernel_data[kernel_idx];
+        }
+        kernel_idx++;
+      }
+    }
+  }
+  out_data[HaloIndex(n * out_channels + oc, oi, oj, out_height, out_width,
+                     out_halo)] = acc;
 }
 
+// Convolute for stride 2 and odd kernel sizes, with a range sized from the
+// output. The output tile of a work-group reads an input window of
+// 2 * height + kernel_size - 2 rows by 2 * (width + kernel_size / 2)
+// columns per input channel, staged through local memory by
+// LoadStride2Tile. When all the output channels of the work-group are of
+// the same image, which is the case when out_channels is a multiple of its
+// depth, the window is loaded once for all of them. tile holds depth
+// windows.
+__kernel void ConvoluteStride2(__global float * restrict in_data,
+                               __global float * restrict out_data,
+                               __constant float * restrict kernel_data,
+                               int batch,
+                               int in_height,
+                               int in_width,
+                               int in_size,
+                               int out_height,
+                               int out_width,
+                               int out_size,
+                               int in_channels,
+                               int out_channels,
+                               int kernel_size,
+                               int batch_kernel_size,
+                               int stride,
+                               int padding,
+                               int out_halo,
+                               __local float *tile) {
+  const int oj = get_global_id(0);
+  const int oi = get_global_id(1);
+  const int n = get_global_id(2) / out_channels;
+  const int oc = get_global_id(2) % out_channels;
+  const int lx = get_local_id(0);
+  const int ly = get_local_id(1);
+  const int lz = get_local_id(2);
+  const int wg_width = get_local_size(0);
+  const int wg_height = get_local_size(1);
+  const int wg_depth = get_local_size(2);
+
+  const int rows = 2 * wg_height + kernel_size - 2;
+  const int half = wg_width + kernel_size / 2;
+  const int top = get_group_id(1) * wg_height * 2 - padding;
+  const int left = get_group_id(0) * wg_width * 2 - padding;
+  // Whether the work-group is a single image.
+  const int first_z = get_group_id(2) * wg_depth;
+  const int last_z = min(first_z + wg_depth, batch * out_channels) - 1;
+  const int shared = (first_z / out_channels) == (last_z / out_channels);
+  // Image of the window the work item loads.
+  const int tile_n = shared ? first_z / out_channels : n;
+  const int plane_items = wg_width * wg_height;
+  __local float *own_tile = tile + (shared ? 0 : lz * rows * 2 * half);
+  const int load_first = shared ? lz * plane_items + ly * wg_width + lx
+                                : ly * wg_width + lx;
+  const int load_step = shared ? wg_depth * plane_items : plane_items;
+
+  const int out_pixel = (oj < out_width) && (oi < out_height) && (n < batch);
+  // Top left of the window of the work item in its half of the tile.
+  const int tile_offset = 2 * ly * 2 * half + lx;
+  int in_offset = tile_n * in_channels * in_size;
+  int kernel_idx = oc * batch_kernel_size;
+
+  float acc = 0.f;
+  for (int ic = 0; ic < in_channels; ic++) {
+    LoadStride2Tile(in_data + in_offset, own_tile, tile_n < batch, in_height,
+                    in_width, top, left, rows, half, load_first, load_step);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (out_pixel) {
+      for (int kr = 0; kr < kernel_size; kr++) {
+        __local const float *row = own_tile + tile_offset + kr * 2 * half;
+        for (int kc = 0; kc < kernel_size; kc++) {
+          acc += row[(kc & 1) * half + kc / 2] * kernel_data[kernel_idx++];
+        }
+      }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    in_offset += in_size;
+  }
+  if (out_pixel) {
+    out_data[HaloIndex(n * out_channels + oc, oi, oj, out_height, out_width,
+                       out_halo)] = acc;
+  }
+}
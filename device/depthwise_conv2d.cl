@@ -1,6 +1,12 @@
+#include "halo.h"
+#include "stride2.h"
+
+// The kernels write the interior of an output with a halo of out_halo, see
+// halo.h.
 __kernel void Convolute(__global float * restrict in_data,
                         __global float * restrict out_data,
                         __constant float * restrict kernel_data,
+                        const int batch,
                         const int in_height,
                         const int in_width,
                         const int in_size,
@@ -12,14 +18,16 @@ __kernel void Convolute(__global float * restrict in_data,
                         const int kernel_size,
                         const int batch_kernel_size,
                         const int stride,
-                        const int padding) {
+                        const int padding,
+                        const int out_halo) {
   // x coordinate of the output pixel.
   const int oj = get_global_id(0);
   // y coordinate of the output pixel.
   const int oi = get_global_id(1);
-  // Index of the input channel.
-  const int ic = get_global_id(2);
-  if ((oj >= out_width) || (oi >= out_height) || (ic >= in_channels)) {
+  // Image and input channel, folded like in the conv kernel.
+  const int n = get_global_id(2) / in_channels;
+  const int ic = get_global_id(2) % in_channels;
+  if ((oj >= out_width) || (oi >= out_height) || (n >= batch)) {
     return;
   }
 
@@ -27,8 +35,11 @@ __kernel void Convolute(__global float * restrict in_data,
   int kernel_idx = ic * batch_kernel_size;
   const int padded_in_height = in_height + 2 * padding;
   const int padded_in_width = in_width + 2 * padding;
-  const int in_offset = ic * in_size;
-  int out_offset = ic * channel_multiplier * out_size;
+  const int in_offset = (n * in_channels + ic) * in_size;
+  const int out_pitch = out_width + 2 * out_halo;
+  const int out_plane = (out_height + 2 * out_halo) * out_pitch;
+  int out_offset = HaloIndex((n * in_channels + ic) * channel_multiplier, oi,
+                             oj, out_height, out_width, out_halo);
   const int ii = oi * stride + kernel_radius;
   const int ij = oj * stride + kernel_radius;
 
@@ -45,8 +56,116 @@ __kernel void Convolute(__global float * restrict in_data,
         kernel_idx++;
       }
     }
-    out_data[out_offset + oi * out_width + oj] = acc;
-    out_offset += out_size;
+    out_data[out_offset] = acc;
+    out_offset += out_plane;
   }
 }
 
+// Convolute for stride 2 and odd kernel sizes, with a range sized from the
+// output. Each input channel of the work-group stages its input window of
+// 2 * height + kernel_size - 2 rows by 2 * (width + kernel_size / 2)
+// columns through local memory with LoadStride2Tile, then reads it for all
+// its channel_multiplier outputs. tile holds depth windows.
+__kernel void ConvoluteStride2(__global float * restrict in_data,
+                               __global float * restrict out_data,
+                               __constant float * restrict kernel_data,
+                               const int batch,
+                               const int in_height,
+                               const int in_width,
+                               const int in_size,
+                               const int out_height,
+                               const int out_width,
+                               const int out_size,
+                               const int in_channels,
+                               const int channel_multiplier,
+                               const int kernel_size,
+                               const int batch_kernel_size,
+                               const int stride,
+                               const int padding,
+                               const int out_halo,
+                               __local float *tile) {
+  const int oj = get_global_id(0);
+  const int oi = get_global_id(1);
+  const int n = get_global_id(2) / in_channels;
+  const int ic = get_global_id(2) % in_channels;
+  const int lx = get_local_id(0);
+  const int ly = get_local_id(1);
+  const int wg_width = get_local_size(0);
+  const int wg_height = get_local_size(1);
+
+  const int rows = 2 * wg_height + kernel_size - 2;
+  const int half = wg_width + kernel_size / 2;
+  __local float *own_tile = tile + get_local_id(2) * rows * 2 * half;
+  LoadStride2Tile(in_data + (n * in_channels + ic) * in_size, own_tile,
+                  n < batch, in_height, in_width,
+                  get_group_id(1) * wg_height * 2 - padding,
+                  get_group_id(0) * wg_width * 2 - padding, rows, half,
+                  ly * wg_width + lx, wg_width * wg_height);
+  barrier(CLK_LOCAL_MEM_FENCE);
+  if ((oj >= out_width) || (oi >= out_height) || (n >= batch)) {
+    return;
+  }
+
+  // Top left of the window of the work item in its half of the tile.
+  __local const float *window = own_tile + 2 * ly * 2 * half + lx;
+  int kernel_idx = ic * batch_kernel_size;
+  const int out_plane =
+      (out_height + 2 * out_halo) * (out_width + 2 * out_halo);
+  int out_offset = HaloIndex((n * in_channels + ic) * channel_multiplier, oi,
+                             oj, out_height, out_width, out_halo);
+  for (int oc = 0; oc < channel_multiplier; oc++) {
+    float acc = 0.f;
+    for (int kr = 0; kr < kernel_size; kr++) {
+      __local const float *row = window + kr * 2 * half;
+      for (int kc = 0; kc < kernel_size; kc++) {
+        acc += row[(kc & 1) * half + kc / 2] * kernel_data[kernel_idx++];
+      }
+    }
+    out_data[out_offset] = acc;
+    out_offset += out_plane;
+  }
+}
+
+// Convolute on an input with a halo of padding, see halo.h, with no bounds
+// checks in the loops and 3 x 3 windows unrolled.
+__kernel void ConvoluteHalo(__global float * restrict in_data,
+                            __global float * restrict out_data,
+                            __constant float * restrict kernel_data,
+                            const int batch,
+                            const int in_height,
+                            const int in_width,
+                            const int in_size,
+                            const int out_height,
+                            const int out_width,
+                            const int out_size,
+                            const int in_channels,
+                            const int channel_multiplier,
+                            const int kernel_size,
+                            const int batch_kernel_size,
+                            const int stride,
+                            const int padding,
+                            const int out_halo) {
+  const int oj = get_global_id(0);
+  const int oi = get_global_id(1);
+  const int n = get_global_id(2) / in_channels;
+  const int ic = get_global_id(2) % in_channels;
+  if ((oj >= out_width) || (oi >= out_height) || (n >= batch)) {
+    return;
+  }
+
+  const int in_pitch = in_width + 2 * padding;
+  const int in_plane = (in_height + 2 * padding) * in_pitch;
+  // Top left of the window in the stored input, border included.
+  __global const float *in = in_data + (n * in_channels + ic) * in_plane +
+                             oi * stride * in_pitch + oj * stride;
+  __constant const float *weights = kernel_data + ic * batch_kernel_size;
+  const int out_plane =
+      (out_height + 2 * out_halo) * (out_width + 2 * out_halo);
+  int out_offset = HaloIndex((n * in_channels + ic) * channel_multiplier, oi,
+                             oj, out_height, out_width, out_halo);
+  for (int oc = 0; oc < channel_multiplier; oc++) {
+    out_data[out_offset] = Window(in, in_pitch, weights, kernel_size);
+    weights += kernel_size * kernel_size;
+    out_offset += out_plane;
+  }
+}
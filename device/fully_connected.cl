@@ -0,0 +1,86 @@
+#include "reduce.h"
+
+// Side of the square tiles of FullyConnectedGemm.
+#define FC_TILE 16
+
+// Dense layer, out[n, o] = in_scale * dot(in[n], weights[o]) + biases[o],
+// with weights [out_features, in_features].
+
+// A work-group per output, each lane streaming a strided slice of the
+// weight row as float4, then a work-group sum. Meant for a batch of one,
+// where every weight is used once and the layer is bound by their loads.
+__kernel void FullyConnectedGemv(__global const float * restrict in_data,
+                                 __global const float * restrict weights,
+                                 __global const float * restrict biases,
+                                 __global float * restrict out_data,
+                                 int in_features,
+                                 int out_features,
+                                 float in_scale,
+                                 __local float4 *scratch) {
+  const int o = get_group_id(1);
+  const int n = get_group_id(2);
+  const int lid = get_local_id(0);
+  const int lanes = get_local_size(0);
+  __global const float *row = weights + o * in_features;
+  __global const float *in = in_data + n * in_features;
+
+  const int num_vectors = in_features / 4;
+  float4 acc = (float4)(0.f);
+  for (int k = lid; k < num_vectors; k += lanes) {
+    acc += vload4(k, row) * vload4(k, in);
+  }
+  float4 state = (float4)(acc.x + acc.y + acc.z + acc.w, 0.f, 0.f, 0.f);
+  for (int k = num_vectors * 4 + lid; k < in_features; k += lanes) {
+    state.x += row[k] * in[k];
+  }
+  state = WorkGroupReduce(state, REDUCE_SUM, lid, lanes, 0, 1, scratch);
+  if (lid == 0) {
+    out_data[n * out_features + o] = state.x * in_scale + biases[o];
+  }
+}
+
+// A work-group per FC_TILE x FC_TILE block of outputs, outputs along the
+// first dimension and images along the second. Tiles of the inputs and of
+// the weights go through local memory, read along in_features so the loads
+// are coalesced, and each weight is loaded once per FC_TILE images. The
+// tiles are FC_TILE x (FC_TILE + 1), padded against bank conflicts.
+__kernel void FullyConnectedGemm(__global const float * restrict in_data,
+                                 __global const float * restrict weights,
+                                 __global const float * restrict biases,
+                                 __global float * restrict out_data,
+                                 int batch,
+                                 int in_features,
+                                 int out_features,
+                                 float in_scale,
+                                 __local float *in_tile,
+                                 __local float *weight_tile) {
+  const int tx = get_local_id(0);
+  const int ty = get_local_id(1);
+  const int o = get_global_id(0);
+  const int n = get_global_id(1);
+  // Image and output rows this work item loads.
+  const int load_n = get_group_id(1) * FC_TILE + ty;
+  const int load_o = get_group_id(0) * FC_TILE + ty;
+  const int pitch = FC_TILE + 1;
+
+  float acc = 0.f;
+  for (int k0 = 0; k0 < in_features; k0 += FC_TILE) {
+    const int k = k0 + tx;
+    in_tile[ty * pitch + tx] = ((load_n < batch) && (k < in_features))
+                                   ? in_data[load_n * in_features + k]
+                                   : 0.f;
+    weight_tile[ty * pitch + tx] =
+        ((load_o < out_features) && (k < in_features))
+            ? weights[load_o * in_features + k]
+            : 0.f;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (int i = 0; i < FC_TILE; i++) {
+      acc += in_tile[ty * pitch + i] * weight_tile[tx * pitch + i];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if ((o < out_features) && (n < batch)) {
+    out_data[n * out_features + o] = acc * in_scale + biases[o];
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef DEVICE_HALO_H_
+#define DEVICE_HALO_H_
+
+// Tensors with a halo keep each height x width plane inside a zero border
+// of halo pixels, so a plane takes (height + 2 * halo) * (width + 2 * halo)
+// elements. A conv padding by the halo reads such an input with no bounds
+// checks; producers write the interior only and the border stays zero.
+
+// Index of pixel (y, x) of plane in the storage of its tensor.
+inline int HaloIndex(int plane, int y, int x, int height, int width,
+                     int halo) {
+  const int pitch = width + 2 * halo;
+  return (plane * (height + 2 * halo) + y + halo) * pitch + x + halo;
+}
+
+// Dot product of the 3 x 3 window at in, with rows pitch apart, and the
+// 3 x 3 weights at w, unrolled.
+inline float Window3x3(__global const float *in, int pitch,
+                      __constant const float *w) {
+  return in[0] * w[0] + in[1] * w[1] + in[2] * w[2] +
+         in[pitch] * w[3] + in[pitch + 1] * w[4] + in[pitch + 2] * w[5] +
+         in[2 * pitch] * w[6] + in[2 * pitch + 1] * w[7] +
+         in[2 * pitch + 2] * w[8];
+}
+
+// Same for any kernel_size.
+inline float Window(__global const float *in, int pitch,
+                    __constant const float *w, int kernel_size) {
+  if (kernel_size == 3) {
+    return Window3x3(in, pitch, w);
+  }
+  float acc = 0.f;
+  for (int r = 0; r < kernel_size; r++) {
+    for (int c = 0; c < kernel_size; c++) {
+      acc += in[r * pitch + c] * w[r * kernel_size + c];
+    }
+  }
+  return acc;
+}
+
+#endif  // DEVICE_HALO_H_
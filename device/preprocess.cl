@@ -0,0 +1,63 @@
+// Source coordinate of dst under a half-pixel-center resize, and its two
+// neighbours and weight.
+inline int GetBilinearTap(int dst, int src_size, int dst_size, int *hi,
+                          float *weight) {
+  const float f = max((dst + 0.5f) * src_size / dst_size - 0.5f, 0.f);
+  const int lo = min((int)f, src_size - 1);
+  *hi = min(lo + 1, src_size - 1);
+  *weight = f - lo;
+  return lo;
+}
+
+// Frames of uchar, HWC, to the normalized float NCHW input of a model, one
+// work item per output pixel of every image, all channels.
+// out = pixel * scale_shift[c] + scale_shift[channels + c].
+__kernel void Preprocess(__global const uchar * restrict in_data,
+                         __global float * restrict out_data,
+                         __constant float * restrict scale_shift,
+                         int batch,
+                         int channels,
+                         int src_height,
+                         int src_width,
+                         int dst_height,
+                         int dst_width,
+                         int bilinear) {
+  const int x = get_global_id(0);
+  const int y = get_global_id(1);
+  const int n = get_global_id(2);
+  if ((x >= dst_width) || (y >= dst_height) || (n >= batch)) {
+    return;
+  }
+
+  const int src_row = src_width * channels;
+  const int dst_size = dst_height * dst_width;
+  __global const uchar *image = in_data + n * src_height * src_row;
+  __global float *out =
+      out_data + n * channels * dst_size + y * dst_width + x;
+
+  if (!bilinear) {
+    // Center crop.
+    __global const uchar *pixel =
+        image + (y + (src_height - dst_height) / 2) * src_row +
+        (x + (src_width - dst_width) / 2) * channels;
+    for (int c = 0; c < channels; c++) {
+      out[c * dst_size] = pixel[c] * scale_shift[c] + scale_shift[channels + c];
+    }
+    return;
+  }
+
+  int y1, x1;
+  float wy, wx;
+  const int y0 = GetBilinearTap(y, src_height, dst_height, &y1, &wy);
+  const int x0 = GetBilinearTap(x, src_width, dst_width, &x1, &wx);
+  __global const uchar *p00 = image + y0 * src_row + x0 * channels;
+  __global const uchar *p01 = image + y0 * src_row + x1 * channels;
+  __global const uchar *p10 = image + y1 * src_row + x0 * channels;
+  __global const uchar *p11 = image + y1 * src_row + x1 * channels;
+  for (int c = 0; c < channels; c++) {
+    const float top = p00[c] + wx * (p01[c] - p00[c]);
+    const float bottom = p10[c] + wx * (p11[c] - p10[c]);
+    out[c * dst_size] = (top + wy * (bottom - top)) * scale_shift[c] +
+                        scale_shift[channels + c];
+  }
+}
@@ -0,0 +1,67 @@
+#include "reduce.h"
+
+// Reduce the middle dimension of a tensor viewed as [outer, reduce_size,
+// inner]. A work-group is a tile of columns, inner indices, by lanes that
+// split the reduced dimension between them, so that the loads of a row are
+// coalesced when inner is large and a long contiguous row is spread over
+// the whole work-group when inner is 1.
+//
+// The second dimension of the range is lanes by chunks: work-group c
+// reduces rows [c * chunk_size, (c + 1) * chunk_size) and writes a partial
+// state to [outer, chunks, inner], for a further pass over the chunks. The
+// input is values, or the states of an earlier pass with from_states; the
+// output is finished values, or states with to_states. Offsets are in
+// elements of the respective buffer. The input strides of the outer and the
+// reduced dimension allow views such as the interior of a tensor with a
+// halo; the inner dimension is contiguous.
+__kernel void Reduce(__global const float *in_data,
+                     __global const float4 *in_states,
+                     int in_offset,
+                     int in_outer_stride,
+                     int in_reduce_stride,
+                     __global float *out_data,
+                     __global float4 *out_states,
+                     int out_offset,
+                     int reduce_size,
+                     int inner,
+                     int chunk_size,
+                     int op,
+                     int from_states,
+                     int to_states,
+                     __local float4 *scratch) {
+  const int i = get_global_id(0);
+  const int o = get_global_id(2);
+  const int lane = get_local_id(1);
+  const int lanes = get_local_size(1);
+  const int chunk = get_group_id(1);
+  const int num_chunks = get_num_groups(1);
+
+  float4 state = ReduceIdentity(op);
+  if (i < inner) {
+    const int begin = chunk * chunk_size;
+    const int end = min(begin + chunk_size, reduce_size);
+    const int base = in_offset + o * in_outer_stride + i;
+    if (from_states) {
+      for (int r = begin + lane; r < end; r += lanes) {
+        state = ReduceCombine(state, in_states[base + r * in_reduce_stride],
+                              op);
+      }
+    } else {
+      for (int r = begin + lane; r < end; r += lanes) {
+        state = ReduceAccumulate(state, in_data[base + r * in_reduce_stride],
+                                 op);
+      }
+    }
+  }
+  state = WorkGroupReduce(state, op, lane, lanes, get_local_id(0),
+                          get_local_size(0), scratch);
+
+  if ((lane == 0) && (i < inner)) {
+    const int idx = out_offset + (o * num_chunks + chunk) * inner + i;
+    if (to_states) {
+      out_states[idx] = state;
+    } else {
+      out_data[idx] = ReduceFinish(state, op);
+    }
+  }
+}
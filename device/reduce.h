@@ -0,0 +1,155 @@
+#ifndef DEVICE_REDUCE_H_
+#define DEVICE_REDUCE_H_
+
+// Reductions shared by the kernels. A reduction runs on float4 states:
+// sum, max and min keep their value in x; mean and variance keep a Welford
+// state of count in x, mean in y and sum of squared differences in z, which
+// combine without the cancellation of sum and sum of squares.
+
+#if defined(cl_khr_subgroups)
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#define REDUCE_SUB_GROUPS 1
+#elif defined(cl_intel_subgroups)
+#define REDUCE_SUB_GROUPS 1
+#endif
+
+// Values of Reduction on the host.
+#define REDUCE_SUM 0
+#define REDUCE_MAX 1
+#define REDUCE_MIN 2
+#define REDUCE_MEAN 3
+#define REDUCE_VARIANCE 4
+
+inline float4 ReduceIdentity(int op) {
+  if (op == REDUCE_MAX) {
+    return (float4)(-INFINITY, 0.f, 0.f, 0.f);
+  }
+  if (op == REDUCE_MIN) {
+    return (float4)(INFINITY, 0.f, 0.f, 0.f);
+  }
+  return (float4)(0.f);
+}
+
+inline float4 ReduceAccumulate(float4 state, float value, int op) {
+  switch (op) {
+    case REDUCE_SUM:
+      state.x += value;
+      break;
+    case REDUCE_MAX:
+      state.x = fmax(state.x, value);
+      break;
+    case REDUCE_MIN:
+      state.x = fmin(state.x, value);
+      break;
+    default: {
+      state.x += 1.f;
+      const float delta = value - state.y;
+      state.y += delta / state.x;
+      state.z += delta * (value - state.y);
+    }
+  }
+  return state;
+}
+
+inline float4 ReduceCombine(float4 a, float4 b, int op) {
+  switch (op) {
+    case REDUCE_SUM:
+      a.x += b.x;
+      return a;
+    case REDUCE_MAX:
+      a.x = fmax(a.x, b.x);
+      return a;
+    case REDUCE_MIN:
+      a.x = fmin(a.x, b.x);
+      return a;
+    default: {
+      const float count = a.x + b.x;
+      if (count == 0.f) {
+        return a;
+      }
+      const float delta = b.y - a.y;
+      return (float4)(count, a.y + delta * b.x / count,
+                      a.z + b.z + delta * delta * a.x * b.x / count, 0.f);
+    }
+  }
+}
+
+// Population variance.
+inline float ReduceFinish(float4 state, int op) {
+  if (op == REDUCE_MEAN) {
+    return state.y;
+  }
+  if (op == REDUCE_VARIANCE) {
+    return (state.x > 0.f) ? state.z / state.x : 0.f;
+  }
+  return state.x;
+}
+
+#ifdef REDUCE_SUB_GROUPS
+// Combine the states of a sub-group with its built-in reductions; Welford
+// states go through the sums of counts, of weighted means, then of squared
+// differences to the common mean.
+inline float4 SubGroupReduce(float4 state, int op) {
+  switch (op) {
+    case REDUCE_SUM:
+      return (float4)(sub_group_reduce_add(state.x), 0.f, 0.f, 0.f);
+    case REDUCE_MAX:
+      return (float4)(sub_group_reduce_max(state.x), 0.f, 0.f, 0.f);
+    case REDUCE_MIN:
+      return (float4)(sub_group_reduce_min(state.x), 0.f, 0.f, 0.f);
+    default: {
+      const float count = sub_group_reduce_add(state.x);
+      const float weighted_mean = sub_group_reduce_add(state.x * state.y);
+      const float mean = (count > 0.f) ? weighted_mean / count : 0.f;
+      const float delta = state.y - mean;
+      return (float4)(count, mean,
+                      sub_group_reduce_add(state.z + state.x * delta * delta),
+                      0.f);
+    }
+  }
+}
+#endif
+
+// Combine the states of the lanes of a work-group column, where lane and
+// column index the lanes, a power of two, and the columns. scratch holds
+// lanes * columns states. Every work item gets the result of its column.
+// All work items of the work-group must call it.
+inline float4 WorkGroupReduce(float4 state, int op, int lane, int lanes,
+                              int column, int columns,
+                              __local float4 *scratch) {
+#ifdef REDUCE_SUB_GROUPS
+  if (columns == 1) {
+    state = SubGroupReduce(state, op);
+    if (get_sub_group_local_id() == 0) {
+      scratch[get_sub_group_id()] = state;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lane == 0) {
+      for (int i = 1; i < get_num_sub_groups(); i++) {
+        state = ReduceCombine(state, scratch[i], op);
+      }
+      scratch[0] = state;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    state = scratch[0];
+    // scratch may be reused right after.
+    barrier(CLK_LOCAL_MEM_FENCE);
+    return state;
+  }
+#endif
+  scratch[lane * columns + column] = state;
+  for (int stride = lanes / 2; stride > 0; stride /= 2) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lane < stride) {
+      scratch[lane * columns + column] =
+          ReduceCombine(scratch[lane * columns + column],
+                        scratch[(lane + stride) * columns + column], op);
+    }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+  state = scratch[column];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  return state;
+}
+
+#endif  // DEVICE_REDUCE_H_
@@ -0,0 +1,29 @@
+// Calibration kernels for the roofline peaks.
+
+// Peak arithmetic throughput: independent multiply-add chains kept in
+// registers, 32 flops per iteration. The result is stored so the compiler
+// can't drop the loop.
+__kernel void PeakFlops(__global float *restrict out_data,
+                        float a,
+                        float b,
+                        int iterations) {
+  const int idx = get_global_id(0);
+  float4 x0 = (float4)(idx, idx + 1, idx + 2, idx + 3);
+  float4 x1 = x0 + 1.f;
+  float4 x2 = x0 + 2.f;
+  float4 x3 = x0 + 3.f;
+  for (int i = 0; i < iterations; i++) {
+    x0 = mad(x0, a, b);
+    x1 = mad(x1, a, b);
+    x2 = mad(x2, a, b);
+    x3 = mad(x3, a, b);
+  }
+  out_data[idx] = dot(x0 + x1 + x2 + x3, (float4)(1.f));
+}
+
+// Peak memory bandwidth: a vectorized copy.
+__kernel void PeakBandwidth(__global const float4 *restrict in_data,
+                            __global float4 *restrict out_data) {
+  const int idx = get_global_id(0);
+  out_data[idx] = in_data[idx];
+}
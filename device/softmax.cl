@@ -0,0 +1,128 @@
+#include "reduce.h"
+
+// Largest k of TopK.
+#define TOPK_MAX_K 16
+
+// Max and sum of exp(x - max) of a row, for a numerically stable softmax.
+inline float2 SoftmaxStats(__global const float *row, int classes,
+                           __local float4 *scratch) {
+  const int lid = get_local_id(0);
+  const int wg_size = get_local_size(0);
+  float4 max_state = ReduceIdentity(REDUCE_MAX);
+  for (int i = lid; i < classes; i += wg_size) {
+    max_state = ReduceAccumulate(max_state, row[i], REDUCE_MAX);
+  }
+  const float max_value =
+      WorkGroupReduce(max_state, REDUCE_MAX, lid, wg_size, 0, 1, scratch).x;
+  float4 sum_state = ReduceIdentity(REDUCE_SUM);
+  for (int i = lid; i < classes; i += wg_size) {
+    sum_state = ReduceAccumulate(sum_state, exp(row[i] - max_value),
+                                 REDUCE_SUM);
+  }
+  sum_state = WorkGroupReduce(sum_state, REDUCE_SUM, lid, wg_size, 0, 1,
+                              scratch);
+  return (float2)(max_value, sum_state.x);
+}
+
+// Softmax of every image of the batch in place, a work-group per image.
+__kernel void Softmax(__global float * restrict tensor,
+                      int classes,
+                      __local float4 *scratch) {
+  __global float *row = tensor + get_group_id(1) * classes;
+  const float2 stats = SoftmaxStats(row, classes, scratch);
+  const float inv_sum = 1.f / stats.y;
+  for (int i = get_local_id(0); i < classes; i += get_local_size(0)) {
+    row[i] = exp(row[i] - stats.x) * inv_sum;
+  }
+}
+
+// Whether (score, id) ranks before (other_score, other_id). Ties go to the
+// lower id.
+inline bool RanksBefore(float score, int id, float other_score,
+                        int other_id) {
+  return (score > other_score) || ((score == other_score) && (id < other_id));
+}
+
+// The k best of every image of the batch, best first, a work-group per
+// image. Each work item keeps the best k of a strided slice of the row,
+// then the lists are merged pairwise in local memory, log2 of the
+// work-group size rounds. With softmax the scores are the probabilities,
+// found from the logits without writing the whole softmax.
+__kernel void TopK(__global const float * restrict in_data,
+                   __global float * restrict scores,
+                   __global int * restrict ids,
+                   int classes,
+                   int k,
+                   int softmax,
+                   __local float *local_scores,
+                   __local int *local_ids,
+                   __local float4 *scratch) {
+  const int n = get_group_id(1);
+  const int lid = get_local_id(0);
+  const int wg_size = get_local_size(0);
+  __global const float *row = in_data + n * classes;
+  float2 stats = (float2)(0.f, 1.f);
+  if (softmax) {
+    stats = SoftmaxStats(row, classes, scratch);
+  }
+
+  float best_scores[TOPK_MAX_K];
+  int best_ids[TOPK_MAX_K];
+  for (int j = 0; j < k; j++) {
+    best_scores[j] = -INFINITY;
+    best_ids[j] = INT_MAX;
+  }
+  for (int i = lid; i < classes; i += wg_size) {
+    const float score = row[i];
+    if (!RanksBefore(score, i, best_scores[k - 1], best_ids[k - 1])) {
+      continue;
+    }
+    int j = k - 1;
+    for (; (j > 0) &&
+           RanksBefore(score, i, best_scores[j - 1], best_ids[j - 1]);
+         j--) {
+      best_scores[j] = best_scores[j - 1];
+      best_ids[j] = best_ids[j - 1];
+    }
+    best_scores[j] = score;
+    best_ids[j] = i;
+  }
+  for (int j = 0; j < k; j++) {
+    local_scores[lid * k + j] = best_scores[j];
+    local_ids[lid * k + j] = best_ids[j];
+  }
+
+  for (int stride = wg_size / 2; stride > 0; stride /= 2) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid < stride) {
+      // Merge the list of lid + stride into the one of lid, which is still
+      // in best_scores and best_ids.
+      __local const float *other_scores = local_scores + (lid + stride) * k;
+      __local const int *other_ids = local_ids + (lid + stride) * k;
+      int a = 0;
+      int b = 0;
+      for (int j = 0; j < k; j++) {
+        if (RanksBefore(best_scores[a], best_ids[a], other_scores[b],
+                        other_ids[b])) {
+          local_scores[lid * k + j] = best_scores[a];
+          local_ids[lid * k + j] = best_ids[a++];
+        } else {
+          local_scores[lid * k + j] = other_scores[b];
+          local_ids[lid * k + j] = other_ids[b++];
+        }
+      }
+      for (int j = 0; j < k; j++) {
+        best_scores[j] = local_scores[lid * k + j];
+        best_ids[j] = local_ids[lid * k + j];
+      }
+    }
+  }
+
+  if (lid == 0) {
+    for (int j = 0; j < k; j++) {
+      scores[n * k + j] =
+          softmax ? exp(best_scores[j] - stats.x) / stats.y : best_scores[j];
+      ids[n * k + j] = best_ids[j];
+    }
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef DEVICE_STRIDE2_H_
+#define DEVICE_STRIDE2_H_
+
+// Input tiles of the stride 2 convolutions.
+
+// Copy the rows x 2 * half window of an input plane whose top left is
+// (top, left) into tile, zero outside the plane, with the even columns of
+// each row in its first half and the odd ones in its second. Work items
+// first, first + step, ... load consecutive columns, so the global loads
+// are coalesced, and a stride 2 window read back from a half is contiguous.
+inline void LoadStride2Tile(__global const float *plane,
+                            __local float *tile,
+                            int valid,
+                            int in_height,
+                            int in_width,
+                            int top,
+                            int left,
+                            int rows,
+                            int half,
+                            int first,
+                            int step) {
+  const int cols = 2 * half;
+  for (int i = first; i < rows * cols; i += step) {
+    const int r = i / cols;
+    const int c = i % cols;
+    const int y = top + r;
+    const int x = left + c;
+    tile[r * cols + (c & 1) * half + c / 2] =
+        (valid && (y >= 0) && (y < in_height) && (x >= 0) && (x < in_width))
+            ? plane[y * in_width + x]
+            : 0.f;
+  }
+}
+
+#endif  // DEVICE_STRIDE2_H_
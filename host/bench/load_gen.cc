@@ -0,0 +1,198 @@
+// Serving load generator: drives an InferenceSession running the RunModel
+// network from several client threads with synthetic inputs, and reports
+// the latency percentiles and sustained throughput of each load level.
+//
+// Usage: load_gen [--platform NAME] [--cpu] [--size H,W]
+//                 [--duration S] [--warmup S] [--clients N,N,...]
+//                 [--rates R,R,...] [--open-clients N] [--csv PATH]
+//                 [--contexts N] [--max-batch N] [--max-wait-us US]
+//                 [--latency-target-us US]
+// Closed loop runs once per client count. Open loop then runs at each rate,
+// in requests per second; without --rates the rates are fractions of the
+// best closed-loop throughput, up to past saturation. --contexts lets the
+// session run that many requests at once. With --max-batch the requests go
+// through a BatchingServer instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "batching_server.h"
+#include "load_generator.h"
+#include "memory_activation.h"
+#include "model.h"
+#include "network.h"
+#include "session.h"
+#include "workspace.h"
+
+namespace {
+
+// Offered load relative to the closed-loop capacity.
+const double kDefaultLoadFractions[] = {0.25, 0.5, 0.75, 0.9, 1.0, 1.1};
+
+template <typename T>
+std::vector<T> ParseList(const char *arg) {
+  std::vector<T> values;
+  std::istringstream is(arg);
+  std::string item;
+  while (std::getline(is, item, ',')) {
+    std::istringstream item_is(item);
+    T value;
+    ASSERT(static_cast<bool>(item_is >> value),
+           std::string("Expected a comma-separated list, got ") + arg);
+    values.push_back(value);
+  }
+  return values;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string platform = "Intel(R) OpenCL HD Graphics";
+  bool cpu = false;
+  std::vector<int> size{64, 64};
+  LoadOptions options;
+  std::vector<int> clients{1, 2, 4, 8};
+  std::vector<double> rates;
+  int open_clients = 0;
+  std::string csv_path;
+  int num_contexts = 1;
+  BatchingOptions batching;
+  batching.max_batch_size = 0;
+  for (int i = 1; i < argc; i++) {
+    const bool has_value = i + 1 < argc;
+    if ((strcmp(argv[i], "--platform") == 0) && has_value) {
+      platform = argv[++i];
+    } else if (strcmp(argv[i], "--cpu") == 0) {
+      cpu = true;
+    } else if ((strcmp(argv[i], "--size") == 0) && has_value) {
+      size = ParseList<int>(argv[++i]);
+      ASSERT(size.size() == 2, "Expected --size H,W");
+    } else if ((strcmp(argv[i], "--duration") == 0) && has_value) {
+      options.duration = atof(argv[++i]);
+    } else if ((strcmp(argv[i], "--warmup") == 0) && has_value) {
+      options.warmup = atof(argv[++i]);
+    } else if ((strcmp(argv[i], "--clients") == 0) && has_value) {
+      clients = ParseList<int>(argv[++i]);
+    } else if ((strcmp(argv[i], "--rates") == 0) && has_value) {
+      rates = ParseList<double>(argv[++i]);
+    } else if ((strcmp(argv[i], "--open-clients") == 0) && has_value) {
+      open_clients = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--csv") == 0) && has_value) {
+      csv_path = argv[++i];
+    } else if ((strcmp(argv[i], "--contexts") == 0) && has_value) {
+      num_contexts = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--max-batch") == 0) && has_value) {
+      batching.max_batch_size = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--max-wait-us") == 0) && has_value) {
+      batching.max_wait_us = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--latency-target-us") == 0) && has_value) {
+      batching.latency_target_us = atoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown argument " << argv[i] << '\n';
+      return 1;
+    }
+  }
+
+  // The session and its synthetic parameters.
+  std::unique_ptr<Workspace> ws;
+  if (!cpu) {
+    ws.reset(new Workspace(platform));
+  }
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  std::vector<float> kernel_data(max_channels * max_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> weight_data(max_channels);
+  std::vector<float> bias_data(max_channels);
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weight_data.begin(), weight_data.end(),
+                RandomGenerator(1.f / 10000.f, 1.f));
+  std::generate(bias_data.begin(), bias_data.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+  auto make_network = [&]() {
+    std::unique_ptr<Network> network(new Network(ws.get()));
+    AddModelLayers(*network, ws.get(), kernel_data, weight_data, bias_data);
+    return network;
+  };
+  const std::vector<int> in_shape{1, 3, size[0], size[1]};
+  std::unique_ptr<InferenceSession> session;
+  std::unique_ptr<BatchingServer> server;
+  if (batching.max_batch_size > 0) {
+    server.reset(new BatchingServer(make_network, in_shape, batching));
+  } else {
+    session.reset(
+        new InferenceSession(make_network(), in_shape, num_contexts));
+  }
+  const std::size_t in_size =
+      server ? server->GetInSize() : session->GetInSize();
+  const std::size_t out_size =
+      server ? server->GetOutSize() : session->GetOutSize();
+
+  // One input and output per client, so clients never share buffers.
+  const int max_clients =
+      std::max(*std::max_element(clients.begin(), clients.end()),
+               open_clients);
+  std::vector<std::vector<float>> inputs(max_clients);
+  std::vector<std::vector<float>> outputs(max_clients);
+  for (int i = 0; i < max_clients; i++) {
+    inputs[i].resize(in_size);
+    std::generate(inputs[i].begin(), inputs[i].end(),
+                  RandomGenerator(1.f / 500.f, -1.f));
+    outputs[i].resize(out_size);
+  }
+  auto request = [&](int client) {
+    if (server) {
+      server->Run(inputs[client], outputs[client]);
+    } else {
+      session->Run(inputs[client], outputs[client]);
+    }
+  };
+
+  std::vector<LoadResult> results;
+  double capacity = 0.0;
+  for (int num_clients : clients) {
+    options.mode = LoadMode::kClosedLoop;
+    options.num_clients = num_clients;
+    results.push_back(RunLoad(options, request));
+    capacity = std::max(capacity, results.back().throughput);
+    std::cout << "Closed loop, " << num_clients << " client(s): "
+              << results.back().throughput << "/s\n";
+  }
+  if (rates.empty()) {
+    for (double fraction : kDefaultLoadFractions) {
+      rates.push_back(fraction * capacity);
+    }
+  }
+  // Enough clients that arrivals rarely wait for a free one below
+  // saturation.
+  options.mode = LoadMode::kOpenLoop;
+  options.num_clients = (open_clients > 0) ? open_clients : max_clients;
+  for (double rate : rates) {
+    options.rate = rate;
+    results.push_back(RunLoad(options, request));
+    std::cout << "Open loop, " << rate << "/s offered: "
+              << results.back().throughput << "/s\n";
+  }
+
+  if (server) {
+    std::cout << "Mean batch size "
+              << static_cast<double>(server->GetNumRequests()) /
+                     server->GetNumBatches()
+              << '\n';
+  }
+  std::cout << '\n';
+  PrintLoadCurve(std::cout, results);
+  if (!csv_path.empty()) {
+    WriteLoadCurveCsv(csv_path, results);
+  }
+  return 0;
+}
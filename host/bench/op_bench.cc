@@ -0,0 +1,427 @@
+// Operator benchmark: times the device and host convolutions, depthwise
+// convolutions, batch norms and the RunModel network over a matrix of
+// shapes, and reports min, median and p99 with a correctness check against
+// the host engine.
+//
+// Usage: op_bench [--warmup N] [--repetitions N] [--json PATH]
+//                 [--platform NAME] [--cpu] [--suite conv,dwconv,bn,model]
+//                 [--shape H,W,IN,OUT,K,STRIDE,PADDING]...
+//                 [--baseline-dir DIR [--update-baseline]]
+//                 [--alpha P] [--min-change FRACTION]
+// --shape replaces the default conv matrix and may be repeated. --cpu also
+// times the host engine, with wall-clock time.
+//
+// With --baseline-dir the results are compared with DIR/<device>.json and
+// the exit status is non-zero if any benchmark regressed, i.e. its median
+// went up by more than --min-change and Welch's t-test on the samples is
+// significant at --alpha. --update-baseline writes the results there
+// instead.
+
+#include <CL/cl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "batchnorm.h"
+#include "benchmark.h"
+#include "conv2d.h"
+#include "depthwise_conv2d.h"
+#include "memory_activation.h"
+#include "model.h"
+#include "network.h"
+#include "operator.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+namespace {
+
+struct ConvShape {
+  int in_height;
+  int in_width;
+  int in_channels;
+  int out_channels;
+  int kernel_size;
+  int stride;
+  int padding;
+};
+
+struct BenchmarkConfig {
+  Workspace *ws;
+  BenchmarkOptions options;
+  bool run_cpu;
+  std::vector<BenchmarkResult> results;
+};
+
+std::vector<ConvShape> GetDefaultConvShapes() {
+  std::vector<ConvShape> shapes;
+  // The cases of the conv2d unit tests, with 3x3 and 5x5 kernels.
+  const int cases[][4] = {{128, 128, 64, 64},
+                          {128, 128, 32, 32},
+                          {65, 69, 3, 16},
+                          {71, 92, 15, 18}};
+  for (int kernel_size : {3, 5}) {
+    for (const auto &c : cases) {
+      shapes.push_back(
+          {c[0], c[1], c[2], c[3], kernel_size, 1, kernel_size / 2});
+    }
+  }
+  // Strided.
+  shapes.push_back({128, 128, 64, 64, 3, 2, 1});
+  shapes.push_back({71, 92, 15, 18, 5, 2, 2});
+  // MobileNetV2: the stem and pointwise layers of each resolution.
+  shapes.push_back({224, 224, 3, 32, 3, 2, 1});
+  shapes.push_back({112, 112, 32, 16, 1, 1, 0});
+  shapes.push_back({56, 56, 24, 144, 1, 1, 0});
+  shapes.push_back({28, 28, 32, 192, 1, 1, 0});
+  shapes.push_back({14, 14, 64, 384, 1, 1, 0});
+  shapes.push_back({7, 7, 160, 960, 1, 1, 0});
+  shapes.push_back({7, 7, 320, 1280, 1, 1, 0});
+  return shapes;
+}
+
+// MobileNetV2 depthwise layers, with channels as both in and out.
+std::vector<ConvShape> GetDefaultDepthwiseShapes() {
+  return {{112, 112, 32, 32, 3, 1, 1},   {112, 112, 96, 96, 3, 2, 1},
+          {56, 56, 144, 144, 3, 1, 1},   {56, 56, 144, 144, 3, 2, 1},
+          {28, 28, 192, 192, 3, 1, 1},   {14, 14, 384, 384, 3, 1, 1},
+          {14, 14, 576, 576, 3, 2, 1},   {7, 7, 960, 960, 3, 1, 1},
+          {71, 92, 15, 15, 5, 1, 2}};
+}
+
+// Height, width and channels of the batch norms.
+std::vector<std::vector<int>> GetDefaultBatchNormShapes() {
+  return {{128, 128, 64}, {112, 112, 32}, {56, 56, 144}, {14, 14, 384},
+          {7, 7, 960},    {65, 69, 3}};
+}
+
+std::vector<std::vector<int>> GetDefaultModelShapes() {
+  return {{64, 64}, {128, 128}};
+}
+
+ConvShape ParseShape(const char *arg) {
+  ConvShape shape;
+  ASSERT(sscanf(arg, "%d,%d,%d,%d,%d,%d,%d", &shape.in_height,
+                &shape.in_width, &shape.in_channels, &shape.out_channels,
+                &shape.kernel_size, &shape.stride, &shape.padding) == 7,
+         std::string("Expected H,W,IN,OUT,K,STRIDE,PADDING, got ") + arg);
+  return shape;
+}
+
+std::string GetDeviceName(Workspace &ws) {
+  char name[256] = {0};
+  clGetDeviceInfo(ws.GetDeviceID(), CL_DEVICE_NAME, sizeof(name) - 1, name,
+                  nullptr);
+  return name;
+}
+
+std::vector<float> CreateRandomData(std::size_t size, float scale,
+                                    float offset) {
+  std::vector<float> data(size);
+  std::generate(data.begin(), data.end(), RandomGenerator(scale, offset));
+  return data;
+}
+
+std::vector<Backend> GetBackends(const BenchmarkConfig &config) {
+  if (config.run_cpu) {
+    return {Backend::kOpenCL, Backend::kCpu};
+  }
+  return {Backend::kOpenCL};
+}
+
+void AddResult(BenchmarkConfig &config, const BenchmarkResult &result) {
+  config.results.push_back(result);
+  PrintBenchmarkResult(std::cout, result);
+}
+
+void RunConvBenchmarks(BenchmarkConfig &config,
+                       const std::vector<ConvShape> &shapes,
+                       bool depthwise) {
+  for (const ConvShape &shape : shapes) {
+    const int multiplier = shape.out_channels / shape.in_channels;
+    ASSERT(!depthwise || (shape.out_channels == multiplier * shape.in_channels),
+           "Depthwise output channels must be a multiple of the input");
+    const int kernel_depth = depthwise ? 1 : shape.in_channels;
+    const std::vector<float> in_data = CreateRandomData(
+        shape.in_channels * shape.in_height * shape.in_width, 1.f / 500.f,
+        -1.f);
+    const std::vector<float> kernel_data = CreateRandomData(
+        shape.out_channels * kernel_depth * shape.kernel_size *
+            shape.kernel_size,
+        1.f / 500.f, -1.f);
+    const std::vector<int> in_shape{1, shape.in_channels, shape.in_height,
+                                    shape.in_width};
+    const std::vector<int> out_shape =
+        InferConvShape(in_shape, shape.out_channels, shape.kernel_size,
+                       shape.stride, shape.padding);
+    std::vector<float> expected(out_shape[1] * out_shape[2] * out_shape[3]);
+    if (depthwise) {
+      RunDepthwiseConv2DCpu(in_data.data(), expected.data(),
+                            kernel_data.data(), shape.in_height,
+                            shape.in_width, shape.in_channels, multiplier,
+                            shape.kernel_size, shape.stride, shape.padding);
+    } else {
+      RunConv2DCpu(in_data.data(), expected.data(), kernel_data.data(),
+                   shape.in_height, shape.in_width, shape.in_channels,
+                   shape.out_channels, shape.kernel_size, shape.stride,
+                   shape.padding);
+    }
+
+    for (Backend backend : GetBackends(config)) {
+      std::unique_ptr<Operator> op =
+          depthwise ? CreateDepthwiseConv2D(backend, config.ws,
+                                            shape.in_channels, multiplier,
+                                            shape.kernel_size, shape.stride,
+                                            shape.padding, kernel_data)
+                    : CreateConv2D(backend, config.ws, shape.in_channels,
+                                   shape.out_channels, shape.kernel_size,
+                                   shape.stride, shape.padding, kernel_data);
+      std::ostringstream name;
+      name << (depthwise ? "dwconv " : "conv ") << shape.in_height << 'x'
+           << shape.in_width << ' ' << shape.in_channels << "->"
+           << shape.out_channels << " k" << shape.kernel_size << " s"
+           << shape.stride << " p" << shape.padding << ' '
+           << GetBackendName(backend);
+      AddResult(config,
+                RunOperatorBenchmark(
+                    name.str(),
+                    {{"in_height", shape.in_height},
+                     {"in_width", shape.in_width},
+                     {"in_channels", shape.in_channels},
+                     {"out_channels", shape.out_channels},
+                     {"kernel_size", shape.kernel_size},
+                     {"stride", shape.stride},
+                     {"padding", shape.padding},
+                     {"device", (backend == Backend::kOpenCL) ? 1 : 0}},
+                    *op, config.ws, in_shape, in_data, expected,
+                    config.options));
+    }
+  }
+}
+
+void RunBatchNormBenchmarks(BenchmarkConfig &config) {
+  const float eps = 1e-5f;
+  const float relu = 1.f;
+  for (const std::vector<int> &shape : GetDefaultBatchNormShapes()) {
+    const int channels = shape[2];
+    const std::vector<int> in_shape{1, channels, shape[0], shape[1]};
+    const std::vector<float> in_data =
+        CreateRandomData(channels * shape[0] * shape[1], 1.f / 500.f, -1.f);
+    const std::vector<float> weights =
+        CreateRandomData(channels, 1.f / 10000.f, 1.f);
+    const std::vector<float> biases =
+        CreateRandomData(channels, 1.f / 10000.f, 0.f);
+    std::vector<float> expected(in_data);
+    RunBatchNormCpu(expected, 1, channels, shape[0] * shape[1], eps, weights,
+                    biases, relu);
+
+    for (Backend backend : GetBackends(config)) {
+      std::unique_ptr<Operator> op = CreateBatchNorm(
+          backend, config.ws, channels, eps, relu, weights, biases);
+      std::ostringstream name;
+      name << "bn " << shape[0] << 'x' << shape[1] << ' ' << channels << ' '
+           << GetBackendName(backend);
+      AddResult(config,
+                RunOperatorBenchmark(
+                    name.str(),
+                    {{"in_height", shape[0]},
+                     {"in_width", shape[1]},
+                     {"channels", channels},
+                     {"device", (backend == Backend::kOpenCL) ? 1 : 0}},
+                    *op, config.ws, in_shape, in_data, expected,
+                    config.options));
+    }
+  }
+}
+
+void RunModelBenchmarks(BenchmarkConfig &config) {
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  const std::vector<float> kernel_data = CreateRandomData(
+      max_channels * max_channels * kernel_size * kernel_size, 1.f / 500.f,
+      -1.f);
+  const std::vector<float> weight_data =
+      CreateRandomData(max_channels, 1.f / 10000.f, 1.f);
+  const std::vector<float> bias_data =
+      CreateRandomData(max_channels, 1.f / 10000.f, 0.f);
+
+  for (const std::vector<int> &shape : GetDefaultModelShapes()) {
+    const std::vector<int> in_shape{1, 3, shape[0], shape[1]};
+    const int tensor_size = max_channels * shape[0] * shape[1];
+    const std::vector<float> in_data =
+        CreateRandomData(tensor_size, 1.f / 500.f, -1.f);
+    std::vector<float> expected(tensor_size);
+    {
+      std::vector<float> scratch(in_data);
+      std::vector<int> tensor_shape(in_shape);
+      RunModelCpu(tensor_shape, scratch, expected, kernel_data, weight_data,
+                  bias_data);
+    }
+    // The work of the layers, from the operator cost models.
+    Network network;
+    AddModelLayers(network, nullptr, kernel_data, weight_data, bias_data);
+    network.Prepare(in_shape);
+    double flops = 0.0;
+    for (int i = 0; i < network.GetNumOperators(); i++) {
+      flops += network.GetOperator(i).GetCost(network.GetInShape(i)).flops;
+    }
+    const std::vector<int> &out_shape = network.GetOutShape();
+    const std::size_t out_size = out_shape[1] * out_shape[2] * out_shape[3];
+
+    for (Backend backend : GetBackends(config)) {
+      const bool device = backend == Backend::kOpenCL;
+      std::ostringstream name;
+      name << "model " << shape[0] << 'x' << shape[1] << ' '
+           << GetBackendName(backend);
+      BenchmarkResult result;
+      result.name = name.str();
+      result.params = {{"in_height", shape[0]},
+                       {"in_width", shape[1]},
+                       {"device", device ? 1 : 0}};
+      result.flops = flops;
+      std::vector<float> out_data(tensor_size);
+      if (device) {
+        // The persistent model, replaying its execution plan.
+        Model model(*config.ws, in_shape, kernel_data, weight_data,
+                    bias_data);
+        model.Run(in_data, out_data);
+        Profiler &profiler = *config.ws->GetProfiler();
+        result.samples = RunBenchmark(config.options, [&]() {
+          return MeasureKernelTime(profiler, [&]() {
+            model.Run();
+            config.ws->FinishCommandQueue();
+          });
+        });
+      } else {
+        network.Run(in_data, out_data);
+        result.samples = RunBenchmark(config.options, [&]() {
+          return MeasureWallTime([&]() { network.Run(); });
+        });
+      }
+      result.stats = ComputeBenchmarkStats(result.samples);
+      result.max_error =
+          GetMaxError(expected.data(), out_data.data(), out_size);
+      result.correct = result.max_error <= config.options.tolerance;
+      AddResult(config, result);
+    }
+  }
+}
+
+bool HasSuite(const std::string &suites, const std::string &suite) {
+  std::istringstream is(suites);
+  std::string name;
+  while (std::getline(is, name, ',')) {
+    if (name == suite) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BenchmarkConfig config;
+  config.run_cpu = false;
+  CompareOptions compare_options;
+  std::string json_path;
+  std::string baseline_dir;
+  bool update_baseline = false;
+  std::string platform = "Intel(R) OpenCL HD Graphics";
+  std::string suites = "conv,dwconv,bn,model";
+  std::vector<ConvShape> shapes;
+  for (int i = 1; i < argc; i++) {
+    const bool has_value = i + 1 < argc;
+    if ((strcmp(argv[i], "--warmup") == 0) && has_value) {
+      config.options.warmup = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--repetitions") == 0) && has_value) {
+      config.options.repetitions = atoi(argv[++i]);
+    } else if ((strcmp(argv[i], "--json") == 0) && has_value) {
+      json_path = argv[++i];
+    } else if ((strcmp(argv[i], "--platform") == 0) && has_value) {
+      platform = argv[++i];
+    } else if ((strcmp(argv[i], "--suite") == 0) && has_value) {
+      suites = argv[++i];
+    } else if ((strcmp(argv[i], "--shape") == 0) && has_value) {
+      shapes.push_back(ParseShape(argv[++i]));
+    } else if ((strcmp(argv[i], "--baseline-dir") == 0) && has_value) {
+      baseline_dir = argv[++i];
+    } else if ((strcmp(argv[i], "--alpha") == 0) && has_value) {
+      compare_options.alpha = atof(argv[++i]);
+    } else if ((strcmp(argv[i], "--min-change") == 0) && has_value) {
+      compare_options.min_change = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--update-baseline") == 0) {
+      update_baseline = true;
+    } else if (strcmp(argv[i], "--cpu") == 0) {
+      config.run_cpu = true;
+    } else {
+      std::cerr << "Unknown argument " << argv[i] << '\n';
+      return 1;
+    }
+  }
+  if (shapes.empty()) {
+    shapes = GetDefaultConvShapes();
+  }
+
+  // Profiling, so that device runs are timed by their kernel events.
+  Workspace ws(platform, true);
+  config.ws = &ws;
+  PrintBenchmarkHeader(std::cout);
+  if (HasSuite(suites, "conv")) {
+    RunConvBenchmarks(config, shapes, false);
+  }
+  if (HasSuite(suites, "dwconv")) {
+    RunConvBenchmarks(config, GetDefaultDepthwiseShapes(), true);
+  }
+  if (HasSuite(suites, "bn")) {
+    RunBatchNormBenchmarks(config);
+  }
+  if (HasSuite(suites, "model")) {
+    RunModelBenchmarks(config);
+  }
+
+  const std::string device_name = GetDeviceName(ws);
+  const std::vector<std::pair<std::string, std::string>> context{
+      {"device", device_name},
+      {"warmup", std::to_string(config.options.warmup)},
+      {"repetitions", std::to_string(config.options.repetitions)}};
+  if (!json_path.empty()) {
+    WriteBenchmarkJson(json_path, context, config.results);
+  }
+  bool ok = std::all_of(config.results.begin(), config.results.end(),
+                        [](const BenchmarkResult &r) { return r.correct; });
+
+  if (!baseline_dir.empty()) {
+    const std::string baseline_path =
+        GetBaselinePath(baseline_dir, device_name);
+    if (update_baseline) {
+      WriteBenchmarkJson(baseline_path, context, config.results);
+      std::cout << "Wrote the baseline " << baseline_path << '\n';
+    } else {
+      std::vector<std::pair<std::string, std::string>> baseline_context;
+      std::vector<BenchmarkResult> baseline;
+      if (!ReadBenchmarkJson(baseline_path, &baseline_context, &baseline)) {
+        std::cerr << "No baseline " << baseline_path
+                  << ", create it with --update-baseline\n";
+        return 1;
+      }
+      std::cout << '\n';
+      const std::vector<BenchmarkComparison> diff =
+          CompareBenchmarks(baseline, config.results, compare_options);
+      PrintBenchmarkComparison(std::cout, diff);
+      ok = ok && std::none_of(diff.begin(), diff.end(),
+                              [](const BenchmarkComparison &c) {
+                                return c.verdict ==
+                                       BenchmarkVerdict::kRegressed;
+                              });
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#ifndef HOST_INCLUDE_BATCHING_SERVER_H_
+#define HOST_INCLUDE_BATCHING_SERVER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mpsc_queue.h"
+#include "network.h"
+#include "session.h"
+
+struct BatchingOptions {
+  // Most requests run together.
+  int max_batch_size = 8;
+  // Longest the oldest queued request waits for the batch to fill, in us.
+  int max_wait_us = 2000;
+  // If positive, the latency a request should see, in us: batches are
+  // capped at the largest size whose measured run time fits, and the
+  // wait is cut so that wait plus run time stays within it.
+  int latency_target_us = 0;
+  // Batch sizes a network is prepared for. A batch runs on the smallest
+  // one that fits it, padded. Empty means the powers of two up to
+  // max_batch_size, and max_batch_size itself.
+  std::vector<int> batch_sizes;
+};
+
+// Serves single images from any number of threads. Requests go into a
+// lock-free queue; a dispatcher thread takes up to max_batch_size of them,
+// waiting for more until the oldest one has waited max_wait_us, runs them
+// as one batch and completes their futures.
+//
+// The images of a batch must not affect each other's results, e.g. batch
+// norm has to use per-image statistics: a partial batch is padded with
+// stale images.
+class BatchingServer {
+ public:
+  // make_network builds the network to serve, without preparing it; it is
+  // called once per batch size. in_shape is the shape of one request.
+  BatchingServer(const std::function<std::unique_ptr<Network>()> &make_network,
+                 const std::vector<int> &in_shape,
+                 const BatchingOptions &options = BatchingOptions());
+  // Runs the queued requests, then stops the dispatcher.
+  virtual ~BatchingServer();
+
+  // Disable copy.
+  BatchingServer(const BatchingServer &) = delete;
+  BatchingServer(BatchingServer &&) = delete;
+  BatchingServer &operator=(const BatchingServer &) = delete;
+  BatchingServer &operator=(BatchingServer &&) = delete;
+
+  // Queue one image of GetInSize() floats. The future holds the output, or
+  // the exception the batch threw. Thread-safe and lock-free.
+  std::future<std::vector<float>> Submit(std::vector<float> in_data);
+  // Submit and wait.
+  void Run(const std::vector<float> &in_data, std::vector<float> &out_data);
+
+  // Shapes of one request.
+  const std::vector<int> &GetInShape() const;
+  std::vector<int> GetOutShape() const;
+  std::size_t GetInSize() const;
+  std::size_t GetOutSize() const;
+
+  const std::vector<int> &GetBatchSizes() const;
+  // Batches run and requests they held, e.g. for the mean batch size.
+  std::int64_t GetNumBatches() const;
+  std::int64_t GetNumRequests() const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Request {
+    std::vector<float> in_data;
+    std::promise<std::vector<float>> promise;
+    Clock::time_point arrival;
+  };
+
+  // A network prepared for one batch size.
+  struct Slot {
+    int batch_size;
+    std::unique_ptr<InferenceSession> session;
+    std::vector<float> in_data;
+    std::vector<float> out_data;
+    // Moving average of the run time, in us; 0 until measured.
+    double run_us;
+  };
+
+  std::vector<int> in_shape_;
+  BatchingOptions options_;
+  std::vector<int> batch_sizes_;
+  std::vector<Slot> slots_;
+
+  MpscQueue<std::unique_ptr<Request>> queue_;
+  // Only for the dispatcher to sleep on: producers take the mutex only if
+  // it is asleep.
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> sleeping_;
+  std::atomic<bool> stop_;
+  std::atomic<std::int64_t> num_batches_;
+  std::atomic<std::int64_t> num_requests_;
+  std::thread dispatcher_;
+
+  void DispatchLoop();
+  // Sleep until a request may be queued, the deadline passes or the server
+  // stops.
+  void WaitForRequest(Clock::time_point deadline);
+  // Largest batch to form.
+  int GetBatchLimit();
+  // Latest time to run a batch of up to size requests whose oldest request
+  // arrived at arrival.
+  Clock::time_point GetDeadline(Clock::time_point arrival, int size);
+  Slot &GetSlot(int size);
+  void RunBatch(std::vector<std::unique_ptr<Request>> &batch);
+};
+
+#endif  // HOST_INCLUDE_BATCHING_SERVER_H_
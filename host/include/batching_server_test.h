@@ -0,0 +1,20 @@
+#ifndef HOST_INCLUDE_BATCHING_SERVER_TEST_H_
+#define HOST_INCLUDE_BATCHING_SERVER_TEST_H_
+
+#include "batching_server.h"
+#include "mpsc_queue.h"
+#include "test_utils.h"
+
+// Push from num_producers threads while one thread pops, and check every
+// item arrives once and in order per producer.
+void RunMpscQueueUnitTest(int num_producers, int items_per_producer);
+
+// Serve an all-CPU RunModel network to num_clients threads and compare
+// every result with the network run on the image alone.
+void RunBatchingServerUnitTest(int num_clients,
+                               int requests_per_client,
+                               const BatchingOptions &options);
+
+void RunBatchingServerTests();
+
+#endif  // HOST_INCLUDE_BATCHING_SERVER_TEST_H_
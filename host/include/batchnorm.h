@@ -7,6 +7,16 @@
 #include <vector>
 
 #include "memory_activation.h"
+#include "thread_pool.h"
+
+// Images the statistics of a channel are computed over.
+enum class BatchNormStats {
+  // Each image is normalized by its own statistics, so its result doesn't
+  // depend on the rest of the batch.
+  kPerImage,
+  // One mean and variance per channel over the whole batch.
+  kAcrossBatch
+};
 
 void RunBatchNormRef(std::vector<float> &tensor,
                      int batch,
@@ -15,13 +25,49 @@ void RunBatchNormRef(std::vector<float> &tensor,
                      float eps,
                      const std::vector<float> &weights,
                      const std::vector<float> &biases,
-                     float relu);
+                     float relu,
+                     BatchNormStats stats = BatchNormStats::kPerImage);
 
 void RunBatchNormRef(std::vector<float> &tensor,
                      const std::vector<int> &tensor_shape,
                      float eps,
                      const std::vector<float> &weights,
                      const std::vector<float> &biases,
-                     float relu);
+                     float relu,
+                     BatchNormStats stats = BatchNormStats::kPerImage);
+
+// Host engine: channels are spread over the thread pool (the default pool if
+// null) and the statistics and normalization run SIMD kernels picked for the
+// CPU at runtime. The Ref versions above are kept as the oracle.
+void RunBatchNormCpu(float *tensor,
+                     int batch,
+                     int channels,
+                     int channel_size,
+                     float eps,
+                     const float *weights,
+                     const float *biases,
+                     float relu,
+                     BatchNormStats stats = BatchNormStats::kPerImage,
+                     ThreadPool *pool = nullptr);
+
+void RunBatchNormCpu(std::vector<float> &tensor,
+                     int batch,
+                     int channels,
+                     int channel_size,
+                     float eps,
+                     const std::vector<float> &weights,
+                     const std::vector<float> &biases,
+                     float relu,
+                     BatchNormStats stats = BatchNormStats::kPerImage,
+                     ThreadPool *pool = nullptr);
+
+void RunBatchNormCpu(std::vector<float> &tensor,
+                     const std::vector<int> &tensor_shape,
+                     float eps,
+                     const std::vector<float> &weights,
+                     const std::vector<float> &biases,
+                     float relu,
+                     BatchNormStats stats = BatchNormStats::kPerImage,
+                     ThreadPool *pool = nullptr);
 
 #endif  // HOST_INCLUDE_BATCHNORM_H_
@@ -3,9 +3,14 @@
 
 #include <CL/cl.h>
 
+#include <cstddef>
 #include <memory>
 #include <vector>
 
+#include "batchnorm.h"
+#include "execution_plan.h"
+#include "profiler.h"
+
 class BatchNormOp {
  public:
   BatchNormOp(int num_features, float eps, float relu,
@@ -18,6 +23,27 @@ class BatchNormOp {
   void SetTensorBuffer(cl_mem *buf);
   void SetWeightBuffer(cl_mem *buf);
   void SetBiasBuffer(cl_mem *buf);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+  // Per image by default.
+  void SetStats(BatchNormStats stats);
+  // Find the statistics with the parallel Reduce kernel of device/reduce.cl
+  // into stats_buf, GetStatsSize bytes, using scratch_buf, GetScratchSize
+  // bytes, then normalize with apply_kernel, BatchNormApply, a work item per
+  // element. Otherwise the kernel of the constructor, BatchNorm, does it all
+  // with a work item per channel.
+  void SetReduction(cl_kernel *reduce_kernel, cl_kernel *apply_kernel,
+                    cl_mem *stats_buf, cl_mem *scratch_buf);
+  // Width of the zero border of the tensor, see Tensor::GetHalo; only the
+  // interior is read and normalized. Needs SetReduction.
+  void SetHalo(int halo);
+
+  static std::size_t GetStatsSize(const std::vector<int> &shape,
+                                  BatchNormStats stats, int halo = 0);
+  static std::size_t GetScratchSize(const std::vector<int> &shape,
+                                    BatchNormStats stats, int halo = 0);
 
   void Run(const std::vector<int> &shape, bool blocking);
   void Run(const std::vector<int> &shape, bool blocking, float *out_data);
@@ -26,6 +52,8 @@ class BatchNormOp {
   int num_features_;
   float eps_;
   float relu_;
+  BatchNormStats stats_;
+  int halo_;
 
   cl_kernel *kernel_;
   cl_command_queue *command_queue_;
@@ -33,6 +61,17 @@ class BatchNormOp {
   cl_mem *tensor_buf_;
   cl_mem *weights_buf_;
   cl_mem *biases_buf_;
+
+  cl_kernel *reduce_kernel_;
+  cl_kernel *apply_kernel_;
+  cl_mem *stats_buf_;
+  cl_mem *scratch_buf_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
+
+  void RunSerial(const std::vector<int> &shape);
+  void RunReduction(const std::vector<int> &shape);
 };
 
 #endif  // HOST_INCLUDE_BATCHNORM_OP_H_
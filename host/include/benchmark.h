@@ -0,0 +1,147 @@
+#ifndef HOST_INCLUDE_BENCHMARK_H_
+#define HOST_INCLUDE_BENCHMARK_H_
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "operator.h"
+#include "profiler.h"
+#include "workspace.h"
+
+struct BenchmarkOptions {
+  // Untimed runs first, for kernel builds, first-touch and caches.
+  int warmup = 3;
+  int repetitions = 20;
+  // Largest absolute error still counted as correct.
+  float tolerance = 1e-3f;
+};
+
+// Order statistics of the samples, in us. p99 is the nearest-rank
+// percentile, so with fewer than 100 samples it is the maximum.
+struct BenchmarkStats {
+  int count;
+  double min;
+  double median;
+  double p99;
+  double mean;
+  double stddev;
+};
+
+BenchmarkStats ComputeBenchmarkStats(std::vector<double> samples);
+
+struct BenchmarkResult {
+  std::string name;
+  // Shape and configuration, written to the JSON report as numbers.
+  std::vector<std::pair<std::string, double>> params;
+  // Device kernel time for OpenCL operators, wall time for CPU ones.
+  std::vector<double> samples;
+  BenchmarkStats stats;
+  double flops;
+  bool correct;
+  float max_error;
+};
+
+// GFLOP/s at the median time.
+double GetBenchmarkGflops(const BenchmarkResult &result);
+
+// The us returned by each of options.repetitions calls of fn, after the
+// warm-up calls.
+std::vector<double> RunBenchmark(const BenchmarkOptions &options,
+                                 const std::function<double()> &fn);
+
+// Sum of the device times of the kernels enqueued by fn, in us. Clears the
+// profiler, so it can't be used while other commands are being tracked.
+double MeasureKernelTime(Profiler &profiler, const std::function<void()> &fn);
+// Wall time of fn in us.
+double MeasureWallTime(const std::function<void()> &fn);
+
+// Time op on in_data and compare its output with expected. OpenCL operators
+// need ws with profiling enabled, and are timed by their kernel events so
+// that launch overhead and transfers are left out. In-place operators run
+// on the input tensor, so repetitions start from the previous output.
+BenchmarkResult RunOperatorBenchmark(
+    const std::string &name,
+    const std::vector<std::pair<std::string, double>> &params,
+    Operator &op,
+    Workspace *ws,
+    const std::vector<int> &in_shape,
+    const std::vector<float> &in_data,
+    const std::vector<float> &expected,
+    const BenchmarkOptions &options);
+
+void PrintBenchmarkHeader(std::ostream &os);
+void PrintBenchmarkResult(std::ostream &os, const BenchmarkResult &result);
+// All results with their samples, plus context such as the device name.
+void WriteBenchmarkJson(
+    const std::string &path,
+    const std::vector<std::pair<std::string, std::string>> &context,
+    const std::vector<BenchmarkResult> &results);
+// Read a file written by WriteBenchmarkJson. Returns false if it doesn't
+// exist and throws if it is malformed.
+bool ReadBenchmarkJson(
+    const std::string &path,
+    std::vector<std::pair<std::string, std::string>> *context,
+    std::vector<BenchmarkResult> *results);
+// Baseline file of a device in dir, named after the device.
+std::string GetBaselinePath(const std::string &dir,
+                            const std::string &device_name);
+
+// Welch's t-test of whether the mean of b is larger than the mean of a,
+// without assuming equal variances. p_value is one-sided, so 1 - p_value
+// tests the opposite direction.
+struct WelchTest {
+  double t;
+  double dof;
+  double p_value;
+};
+
+WelchTest RunWelchTTest(const std::vector<double> &a,
+                        const std::vector<double> &b);
+
+enum class BenchmarkVerdict {
+  kUnchanged,
+  kRegressed,
+  kImproved,
+  // Only in the current results.
+  kNew,
+  // Only in the baseline.
+  kMissing
+};
+
+const char *GetBenchmarkVerdictName(BenchmarkVerdict verdict);
+
+struct CompareOptions {
+  // Significance level of the one-sided tests.
+  double alpha = 0.01;
+  // Median change below which significant shifts are still unchanged, as
+  // event timers make even tiny shifts significant.
+  double min_change = 0.02;
+};
+
+struct BenchmarkComparison {
+  std::string name;
+  double baseline_median;
+  double current_median;
+  // Relative change of the median, positive when slower.
+  double change;
+  WelchTest test;
+  BenchmarkVerdict verdict;
+};
+
+// Match results by name. A benchmark regressed when its median went up by
+// more than min_change and the samples say it is slower at level alpha.
+// The test runs on the log of the samples, which evens out the long tail
+// of latencies and compares ratios rather than differences.
+std::vector<BenchmarkComparison> CompareBenchmarks(
+    const std::vector<BenchmarkResult> &baseline,
+    const std::vector<BenchmarkResult> &current,
+    const CompareOptions &options = CompareOptions());
+
+// Diff table of the comparisons, with the regressions marked.
+void PrintBenchmarkComparison(std::ostream &os,
+                              const std::vector<BenchmarkComparison> &diff);
+
+#endif  // HOST_INCLUDE_BENCHMARK_H_
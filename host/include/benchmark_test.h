@@ -0,0 +1,13 @@
+#ifndef HOST_INCLUDE_BENCHMARK_TEST_H_
+#define HOST_INCLUDE_BENCHMARK_TEST_H_
+
+#include "benchmark.h"
+
+// Compare noisy samples with copies scaled by 1 + shift, after a round trip
+// through the JSON report, and check the verdict.
+void RunBenchmarkCompareUnitTest(double shift, double noise,
+                                 BenchmarkVerdict expected);
+
+void RunBenchmarkTests();
+
+#endif  // HOST_INCLUDE_BENCHMARK_TEST_H_
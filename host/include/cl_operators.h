@@ -0,0 +1,306 @@
+#ifndef HOST_INCLUDE_CL_OPERATORS_H_
+#define HOST_INCLUDE_CL_OPERATORS_H_
+
+#include <CL/cl.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "batchnorm_op.h"
+#include "conv2d_op.h"
+#include "depthwise_conv2d_op.h"
+#include "fully_connected_op.h"
+#include "global_avg_pool_op.h"
+#include "operator.h"
+#include "reduce_op.h"
+#include "softmax_op.h"
+
+// Operators on the OpenCL device, wrapping the kernel-level ops. Kernels
+// come from the workspace cache and parameters live in device tensors,
+// shared with the clones of the operator.
+// The ops keep pointers to members, so these can't be copied or moved.
+
+class ClConv2D : public Operator {
+ public:
+  ClConv2D(Workspace &ws, int in_channels, int out_channels, int kernel_size,
+           int stride, int padding, const std::vector<float> &kernel_data);
+
+  // Run on ws with the parameters of other.
+  ClConv2D(Workspace &ws, const ClConv2D &other);
+
+  // Disable copy.
+  ClConv2D(const ClConv2D &) = delete;
+  ClConv2D(ClConv2D &&) = delete;
+  ClConv2D &operator=(const ClConv2D &) = delete;
+  ClConv2D &operator=(ClConv2D &&) = delete;
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  // The padding, unless the layer runs on the stride 2 kernel.
+  int GetInputHalo() const override;
+  bool SupportsHalo() const override;
+  void Prepare(const std::vector<int> &in_shape) override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+  // Read the frames in frames_buf, normalized on load, instead of the input
+  // tensor, which is left alone; see Conv2DOp::SetPreprocess. A null
+  // frames_buf goes back to the input tensor. Clones read the input tensor.
+  void FusePreprocess(cl_mem *frames_buf, cl_mem *scale_shift_buf,
+                      int src_height, int src_width);
+  bool IsPreprocessFused() const;
+
+ private:
+  Workspace *ws_;
+  cl_kernel kernel_;
+  cl_kernel preprocess_kernel_;
+  // ConvoluteStride2 for stride 2 layers, null otherwise.
+  cl_kernel stride2_kernel_;
+  cl_kernel halo_kernel_;
+  cl_command_queue command_queue_;
+  int in_channels_;
+  int out_channels_;
+  int kernel_size_;
+  int stride_;
+  int padding_;
+  std::shared_ptr<Tensor> kernel_data_;
+  cl_mem *frames_buf_;
+  Conv2DOp op_;
+};
+
+class ClDepthwiseConv2D : public Operator {
+ public:
+  ClDepthwiseConv2D(Workspace &ws, int channels, int channel_multiplier,
+                    int kernel_size, int stride, int padding,
+                    const std::vector<float> &kernel_data);
+
+  // Run on ws with the parameters of other.
+  ClDepthwiseConv2D(Workspace &ws, const ClDepthwiseConv2D &other);
+
+  // Disable copy.
+  ClDepthwiseConv2D(const ClDepthwiseConv2D &) = delete;
+  ClDepthwiseConv2D(ClDepthwiseConv2D &&) = delete;
+  ClDepthwiseConv2D &operator=(const ClDepthwiseConv2D &) = delete;
+  ClDepthwiseConv2D &operator=(ClDepthwiseConv2D &&) = delete;
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  // The padding, unless the layer runs on the stride 2 kernel.
+  int GetInputHalo() const override;
+  bool SupportsHalo() const override;
+  void Prepare(const std::vector<int> &in_shape) override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  Workspace *ws_;
+  cl_kernel kernel_;
+  // ConvoluteStride2 for stride 2 layers, null otherwise.
+  cl_kernel stride2_kernel_;
+  cl_kernel halo_kernel_;
+  cl_command_queue command_queue_;
+  int channels_;
+  int channel_multiplier_;
+  int kernel_size_;
+  int stride_;
+  int padding_;
+  std::shared_ptr<Tensor> kernel_data_;
+  DepthwiseConv2DOp op_;
+};
+
+class ClBatchNorm : public Operator {
+ public:
+  ClBatchNorm(Workspace &ws, int num_features, float eps, float relu,
+              const std::vector<float> &weights,
+              const std::vector<float> &biases,
+              BatchNormStats stats = BatchNormStats::kPerImage);
+
+  // Run on ws with the parameters of other.
+  ClBatchNorm(Workspace &ws, const ClBatchNorm &other);
+
+  ~ClBatchNorm();
+
+  // Disable copy.
+  ClBatchNorm(const ClBatchNorm &) = delete;
+  ClBatchNorm(ClBatchNorm &&) = delete;
+  ClBatchNorm &operator=(const ClBatchNorm &) = delete;
+  ClBatchNorm &operator=(ClBatchNorm &&) = delete;
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  bool IsInPlace() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  std::size_t GetScratchSize(const std::vector<int> &in_shape) const override;
+  bool SupportsHalo() const override;
+  void Prepare(const std::vector<int> &in_shape) override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  Workspace *ws_;
+  cl_kernel kernel_;
+  cl_kernel reduce_kernel_;
+  cl_kernel apply_kernel_;
+  cl_command_queue command_queue_;
+  int num_features_;
+  float eps_;
+  float relu_;
+  BatchNormStats stats_;
+  std::shared_ptr<Tensor> weights_;
+  std::shared_ptr<Tensor> biases_;
+  // Statistics and partial states of the reductions, per workspace.
+  cl_mem stats_buf_;
+  cl_mem scratch_buf_;
+  std::size_t stats_capacity_;
+  std::size_t scratch_capacity_;
+  BatchNormOp op_;
+
+  void ReserveBuffers(const std::vector<int> &in_shape, int halo);
+};
+
+class ClSoftmax : public Operator {
+ public:
+  explicit ClSoftmax(Workspace &ws);
+
+  // Disable copy.
+  ClSoftmax(const ClSoftmax &) = delete;
+  ClSoftmax(ClSoftmax &&) = delete;
+  ClSoftmax &operator=(const ClSoftmax &) = delete;
+  ClSoftmax &operator=(ClSoftmax &&) = delete;
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  bool IsInPlace() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  Workspace *ws_;
+  cl_kernel kernel_;
+  cl_command_queue command_queue_;
+  SoftmaxOp op_;
+};
+
+class ClReduce : public Operator {
+ public:
+  ClReduce(Workspace &ws, Reduction reduction, int axis, int num_axes = 1);
+
+  ~ClReduce();
+
+  // Disable copy.
+  ClReduce(const ClReduce &) = delete;
+  ClReduce(ClReduce &&) = delete;
+  ClReduce &operator=(const ClReduce &) = delete;
+  ClReduce &operator=(ClReduce &&) = delete;
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  std::size_t GetScratchSize(const std::vector<int> &in_shape) const override;
+  void Prepare(const std::vector<int> &in_shape) override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  Workspace *ws_;
+  cl_kernel kernel_;
+  cl_command_queue command_queue_;
+  Reduction reduction_;
+  int axis_;
+  int num_axes_;
+  // Partial states of multi-pass reductions.
+  cl_mem scratch_buf_;
+  std::size_t scratch_capacity_;
+  ReduceOp op_;
+};
+
+class ClGlobalAvgPool : public Operator {
+ public:
+  explicit ClGlobalAvgPool(Workspace &ws);
+
+  ~ClGlobalAvgPool();
+
+  // Disable copy.
+  ClGlobalAvgPool(const ClGlobalAvgPool &) = delete;
+  ClGlobalAvgPool(ClGlobalAvgPool &&) = delete;
+  ClGlobalAvgPool &operator=(const ClGlobalAvgPool &) = delete;
+  ClGlobalAvgPool &operator=(ClGlobalAvgPool &&) = delete;
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  std::size_t GetScratchSize(const std::vector<int> &in_shape) const override;
+  void Prepare(const std::vector<int> &in_shape) override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  Workspace *ws_;
+  cl_kernel kernel_;
+  cl_command_queue command_queue_;
+  cl_mem scratch_buf_;
+  std::size_t scratch_capacity_;
+  GlobalAvgPoolOp op_;
+};
+
+class ClFullyConnected : public Operator {
+ public:
+  ClFullyConnected(Workspace &ws, int in_features, int out_features,
+                   const std::vector<float> &weights,
+                   const std::vector<float> &biases,
+                   bool pool_input = false);
+
+  // Run on ws with the parameters of other.
+  ClFullyConnected(Workspace &ws, const ClFullyConnected &other);
+
+  ~ClFullyConnected();
+
+  // Disable copy.
+  ClFullyConnected(const ClFullyConnected &) = delete;
+  ClFullyConnected(ClFullyConnected &&) = delete;
+  ClFullyConnected &operator=(const ClFullyConnected &) = delete;
+  ClFullyConnected &operator=(ClFullyConnected &&) = delete;
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  std::size_t GetScratchSize(const std::vector<int> &in_shape) const override;
+  void Prepare(const std::vector<int> &in_shape) override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  Workspace *ws_;
+  cl_kernel gemv_kernel_;
+  cl_kernel gemm_kernel_;
+  cl_kernel reduce_kernel_;
+  cl_command_queue command_queue_;
+  int in_features_;
+  int out_features_;
+  bool pool_input_;
+  std::shared_ptr<Tensor> weights_;
+  std::shared_ptr<Tensor> biases_;
+  // With pool_input, the sums of the channels and the partial states of
+  // their reduction.
+  cl_mem pooled_buf_;
+  cl_mem scratch_buf_;
+  std::size_t pooled_capacity_;
+  std::size_t scratch_capacity_;
+  GlobalAvgPoolOp pool_op_;
+  FullyConnectedOp op_;
+
+  void ReserveBuffers(const std::vector<int> &in_shape);
+};
+
+#endif  // HOST_INCLUDE_CL_OPERATORS_H_
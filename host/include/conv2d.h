@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "memory_activation.h"
+#include "thread_pool.h"
 
 void RunConv2DRef(const float *in_data,
                   float *out_data,
@@ -47,5 +48,61 @@ void RunConv2DRef(const std::vector<float> &in_data,
                   int stride,
                   int padding);
 
+// Algorithms of the host engine.
+enum class Conv2DAlgorithm {
+  // Im2col for layers deep enough to keep the GEMM busy, direct otherwise.
+  kAuto,
+  // Output rows of blocks of output channels are spread over the thread
+  // pool, padding is resolved per row and the inner loops run SIMD row
+  // kernels picked for the CPU at runtime.
+  kDirect,
+  // The input is unrolled into a (in_channels * kernel_size^2) x
+  // (out_height * out_width) matrix and multiplied with the kernels by the
+  // packed-panel RunSgemm. 1x1 convolutions without stride or padding use
+  // the input as is.
+  kIm2col
+};
+
+const char *GetConv2DAlgorithmName(Conv2DAlgorithm algorithm);
+
+// Host engine, on the thread pool given or the default one if null. The
+// Ref versions above are kept as the oracle.
+void RunConv2DCpu(const float *in_data,
+                  float *out_data,
+                  const float *kernel_data,
+                  int in_height,
+                  int in_width,
+                  int in_channels,
+                  int out_channels,
+                  int kernel_size,
+                  int stride,
+                  int padding,
+                  Conv2DAlgorithm algorithm = Conv2DAlgorithm::kAuto,
+                  ThreadPool *pool = nullptr);
+
+void RunConv2DCpu(const std::vector<float> &in_data,
+                  std::vector<float> &out_data,
+                  const std::vector<float> &kernel_data,
+                  int in_height,
+                  int in_width,
+                  int in_channels,
+                  int out_channels,
+                  int kernel_size,
+                  int stride,
+                  int padding,
+                  Conv2DAlgorithm algorithm = Conv2DAlgorithm::kAuto,
+                  ThreadPool *pool = nullptr);
+
+void RunConv2DCpu(const std::vector<float> &in_data,
+                  std::vector<float> &out_data,
+                  const std::vector<float> &kernel_data,
+                  std::vector<int> &tensor_shape,
+                  int out_channels,
+                  int kernel_size,
+                  int stride,
+                  int padding,
+                  Conv2DAlgorithm algorithm = Conv2DAlgorithm::kAuto,
+                  ThreadPool *pool = nullptr);
+
 #endif  // HOST_INCLUDE_CONV2D_H_
 
@@ -5,6 +5,9 @@
 
 #include <vector>
 
+#include "execution_plan.h"
+#include "profiler.h"
+
 class Conv2DOp {
  public:
   Conv2DOp(int in_channels, int out_channels, int kernel_size, int stride,
@@ -15,6 +18,27 @@ class Conv2DOp {
   void SetInBuffer(cl_mem *buf);
   void SetOutBuffer(cl_mem *buf);
   void SetKernelBuffer(cl_mem *buf);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+  // Read the input from frames of uchar, HWC, of src_height x src_width,
+  // normalized on load by the scale_shift of GetPreprocessScaleShift, with
+  // ConvolutePreprocessed as kernel. The input shape is the centered window
+  // of each frame. A null kernel goes back to float input.
+  void SetPreprocess(cl_kernel *kernel, cl_mem *scale_shift_buf,
+                     int src_height, int src_width);
+  // Run stride 2 layers of odd kernel size with kernel, ConvoluteStride2,
+  // which stages deinterleaved input tiles in local memory. A null kernel
+  // goes back to Convolute. Not used with SetPreprocess.
+  void SetStride2Kernel(cl_kernel *kernel);
+  // Run inputs with a halo with kernel, ConvoluteHalo, which reads the
+  // windows without bounds checks; see Tensor::GetHalo.
+  void SetHaloKernel(cl_kernel *kernel);
+  // Width of the zero border of the input and the output tensors. An input
+  // halo must be the padding and needs SetHaloKernel; the output is written
+  // in its interior by every kernel.
+  void SetHalo(int in_halo, int out_halo);
 
   void Run(std::vector<int> &shape, bool blocking);
   void Run(std::vector<int> &shape, bool blocking, float *out_data);
@@ -34,6 +58,19 @@ class Conv2DOp {
   cl_mem *in_buf_;
   cl_mem *out_buf_;
   cl_mem *kernel_buf_;
+
+  cl_kernel *preprocess_kernel_;
+  cl_mem *scale_shift_buf_;
+  int src_height_;
+  int src_width_;
+
+  cl_kernel *stride2_kernel_;
+  cl_kernel *halo_kernel_;
+  int in_halo_;
+  int out_halo_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
 };
 
 #endif  // HOST_INCLUDE_CONV_2D_OP_H_
@@ -0,0 +1,92 @@
+#ifndef HOST_INCLUDE_CONV_SELECTOR_H_
+#define HOST_INCLUDE_CONV_SELECTOR_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "conv2d.h"
+#include "operator.h"
+#include "thread_pool.h"
+#include "workspace.h"
+
+// Shape of a conv layer, for batch 1. Depthwise layers have out_channels a
+// multiple of in_channels.
+struct ConvLayer {
+  int in_channels;
+  int out_channels;
+  int kernel_size;
+  int stride;
+  int padding;
+  int in_height;
+  int in_width;
+  bool depthwise;
+};
+
+// Where and how a conv layer runs. The device has only the direct
+// algorithm.
+struct ConvImpl {
+  Backend backend;
+  Conv2DAlgorithm algorithm;
+};
+
+// Throughputs of the cost model, in GFLOP/s and GB/s, and fixed costs, in
+// us. The defaults come from the device properties and the host ISA.
+struct ConvCostModel {
+  double device_gflops;
+  double device_bandwidth;
+  double device_launch_us;
+  double cpu_direct_gflops;
+  double cpu_im2col_gflops;
+  double cpu_bandwidth;
+  double cpu_launch_us;
+  // Moving a tensor between the backends.
+  double transfer_bandwidth;
+  double transfer_us;
+};
+
+// Picks the backend and algorithm of each conv layer of a network. Costs
+// come from the tuning cache, else from trial runs if enabled, else from
+// the analytical cost model. Trial results are kept in the cache, keyed by
+// the device and host, so a session reusing the cache file needs no trials.
+class ConvSelector {
+ public:
+  // ws may be null to choose among host implementations only.
+  explicit ConvSelector(Workspace *ws, ThreadPool *pool = nullptr);
+
+  // Timed runs per candidate, after a warm-up run. 0, the default, uses the
+  // cost model only.
+  void SetTrialRuns(int num_runs);
+  ConvCostModel &GetCostModel();
+
+  std::vector<ConvImpl> GetCandidates(const ConvLayer &layer) const;
+  // Estimated time of a layer in us.
+  double EstimateCost(const ConvLayer &layer, const ConvImpl &impl) const;
+  // Estimated time to move size floats between the backends.
+  double EstimateTransferCost(std::size_t size) const;
+  double GetCost(const ConvLayer &layer, const ConvImpl &impl);
+
+  // Cheapest implementations for a chain of layers, counting a transfer of
+  // the input wherever consecutive layers run on different backends.
+  std::vector<ConvImpl> Select(const std::vector<ConvLayer> &layers);
+
+  // The cache file has a line "device layer impl cost_us" per measured
+  // candidate. Entries of other devices are kept but not used.
+  bool LoadCache(const std::string &path);
+  void SaveCache(const std::string &path) const;
+  const std::string &GetDeviceKey() const;
+
+ private:
+  Workspace *ws_;
+  ThreadPool *pool_;
+  int num_trial_runs_;
+  ConvCostModel cost_model_;
+  std::string device_key_;
+  std::map<std::string, double> cache_;
+
+  double RunTrial(const ConvLayer &layer, const ConvImpl &impl);
+  std::string GetCacheKey(const ConvLayer &layer, const ConvImpl &impl) const;
+};
+
+#endif  // HOST_INCLUDE_CONV_SELECTOR_H_
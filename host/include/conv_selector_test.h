@@ -0,0 +1,21 @@
+#ifndef HOST_INCLUDE_CONV_SELECTOR_TEST_H_
+#define HOST_INCLUDE_CONV_SELECTOR_TEST_H_
+
+#include <string>
+
+#include "conv_selector.h"
+#include "workspace.h"
+
+// Select the implementations of the RunModel layers, check the network
+// built from them against RunModelRef, and check a selector loading the
+// tuning cache makes the same choices. ws may be null to select among host
+// implementations only.
+void RunConvSelectorUnitTest(Workspace *ws,
+                             const int in_height,
+                             const int in_width,
+                             const int num_trial_runs,
+                             const std::string &cache_path);
+
+void RunConvSelectorTests(Workspace &ws);
+
+#endif  // HOST_INCLUDE_CONV_SELECTOR_TEST_H_
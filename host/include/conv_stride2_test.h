@@ -0,0 +1,31 @@
+#ifndef HOST_INCLUDE_CONV_STRIDE2_TEST_H_
+#define HOST_INCLUDE_CONV_STRIDE2_TEST_H_
+
+#include <vector>
+
+#include "cl_operators.h"
+#include "conv2d.h"
+#include "depthwise_conv2d.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+// The device conv operator on a batch, compared with RunConv2DRef. Stride 2
+// layers run ConvoluteStride2.
+void RunConv2DStrideUnitTest(Workspace &ws,
+                             const std::vector<int> &shape,
+                             int out_channels,
+                             int kernel_size,
+                             int stride,
+                             int padding);
+
+// Same for the device depthwise conv operator and RunDepthwiseConv2DRef.
+void RunDepthwiseConv2DStrideUnitTest(Workspace &ws,
+                                      const std::vector<int> &shape,
+                                      int channel_multiplier,
+                                      int kernel_size,
+                                      int stride,
+                                      int padding);
+
+void RunConvStride2Tests(Workspace &ws);
+
+#endif  // HOST_INCLUDE_CONV_STRIDE2_TEST_H_
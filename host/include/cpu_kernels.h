@@ -0,0 +1,39 @@
+#ifndef HOST_INCLUDE_CPU_KERNELS_H_
+#define HOST_INCLUDE_CPU_KERNELS_H_
+
+// Vector instruction sets the host kernels are built for.
+enum class CpuIsa { kScalar, kAvx2, kAvx512 };
+
+// Best instruction set supported by this CPU, capped by SetCpuIsa.
+CpuIsa GetCpuIsa();
+// Cap the instruction set used by the host kernels, e.g. to compare them
+// against each other. Levels the CPU doesn't support are ignored.
+void SetCpuIsa(CpuIsa isa);
+const char *GetCpuIsaName(CpuIsa isa);
+
+// Range [begin, end) of output positions o in [0, out_size) whose input
+// position o * stride + offset lies inside [0, in_size). Lets the ops skip
+// padding per row instead of testing it per element.
+void GetValidOutputRange(int in_size, int out_size, int stride, int offset,
+                         int *begin, int *end);
+
+// Row kernels the host ops are built from. Each one is dispatched to the
+// variant for GetCpuIsa().
+
+// out[b * out_stride + j] += weights[b * weight_stride] * in[j * in_stride]
+// for b < num_rows and j < n: one input row accumulated into several output
+// rows at once, so the input is loaded once per block of output channels.
+void AccumulateRows(const float *in, int in_stride, int n,
+                    const float *weights, int weight_stride, int num_rows,
+                    float *out, int out_stride);
+
+// Sum of data[0, n).
+float SumRow(const float *data, int n);
+
+// Sum of (data[i] - mean)^2 over [0, n).
+float SumSquaredDiffRow(const float *data, int n, float mean);
+
+// data[i] = scale * data[i] + shift, then scaled ReLU if relu > 0.
+void ScaleShiftRow(float *data, int n, float scale, float shift, float relu);
+
+#endif  // HOST_INCLUDE_CPU_KERNELS_H_
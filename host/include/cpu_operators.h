@@ -0,0 +1,169 @@
+#ifndef HOST_INCLUDE_CPU_OPERATORS_H_
+#define HOST_INCLUDE_CPU_OPERATORS_H_
+
+#include <memory>
+#include <vector>
+
+#include "conv2d.h"
+#include "operator.h"
+#include "reduce.h"
+#include "softmax.h"
+#include "thread_pool.h"
+
+// Operators on the multithreaded SIMD host engine. Images of a batch are
+// processed one after the other. Clones share the parameters.
+
+class CpuConv2D : public Operator {
+ public:
+  CpuConv2D(int in_channels, int out_channels, int kernel_size, int stride,
+            int padding, const std::vector<float> &kernel_data,
+            Conv2DAlgorithm algorithm = Conv2DAlgorithm::kAuto,
+            ThreadPool *pool = nullptr);
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  std::size_t GetScratchSize(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+  void SetAlgorithm(Conv2DAlgorithm algorithm);
+  Conv2DAlgorithm GetAlgorithm() const;
+
+ private:
+  int in_channels_;
+  int out_channels_;
+  int kernel_size_;
+  int stride_;
+  int padding_;
+  std::shared_ptr<const std::vector<float>> kernel_data_;
+  Conv2DAlgorithm algorithm_;
+  ThreadPool *pool_;
+};
+
+class CpuDepthwiseConv2D : public Operator {
+ public:
+  CpuDepthwiseConv2D(int channels, int channel_multiplier, int kernel_size,
+                     int stride, int padding,
+                     const std::vector<float> &kernel_data,
+                     ThreadPool *pool = nullptr);
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  int channels_;
+  int channel_multiplier_;
+  int kernel_size_;
+  int stride_;
+  int padding_;
+  std::shared_ptr<const std::vector<float>> kernel_data_;
+  ThreadPool *pool_;
+};
+
+class CpuBatchNorm : public Operator {
+ public:
+  CpuBatchNorm(int num_features, float eps, float relu,
+               const std::vector<float> &weights,
+               const std::vector<float> &biases,
+               BatchNormStats stats = BatchNormStats::kPerImage,
+               ThreadPool *pool = nullptr);
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  bool IsInPlace() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  int num_features_;
+  float eps_;
+  float relu_;
+  std::shared_ptr<const std::vector<float>> weights_;
+  std::shared_ptr<const std::vector<float>> biases_;
+  BatchNormStats stats_;
+  ThreadPool *pool_;
+};
+
+class CpuSoftmax : public Operator {
+ public:
+  explicit CpuSoftmax(ThreadPool *pool = nullptr);
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  bool IsInPlace() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  ThreadPool *pool_;
+};
+
+class CpuReduce : public Operator {
+ public:
+  CpuReduce(Reduction reduction, int axis, int num_axes = 1,
+            ThreadPool *pool = nullptr);
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  Reduction reduction_;
+  int axis_;
+  int num_axes_;
+  ThreadPool *pool_;
+};
+
+class CpuGlobalAvgPool : public Operator {
+ public:
+  explicit CpuGlobalAvgPool(ThreadPool *pool = nullptr);
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  ThreadPool *pool_;
+};
+
+class CpuFullyConnected : public Operator {
+ public:
+  CpuFullyConnected(int in_features, int out_features,
+                    const std::vector<float> &weights,
+                    const std::vector<float> &biases,
+                    bool pool_input = false, ThreadPool *pool = nullptr);
+
+  Backend GetBackend() const override;
+  const char *GetName() const override;
+  std::vector<int> InferShape(const std::vector<int> &in_shape) const override;
+  OpCost GetCost(const std::vector<int> &in_shape) const override;
+  void Run(Tensor &input, Tensor &output) override;
+  std::unique_ptr<Operator> Clone(Workspace *ws) const override;
+
+ private:
+  int in_features_;
+  int out_features_;
+  bool pool_input_;
+  // [in_features, out_features], for RunFullyConnectedCpu.
+  std::shared_ptr<const std::vector<float>> weights_t_;
+  std::shared_ptr<const std::vector<float>> biases_;
+  ThreadPool *pool_;
+};
+
+#endif  // HOST_INCLUDE_CPU_OPERATORS_H_
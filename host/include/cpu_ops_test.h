@@ -0,0 +1,57 @@
+#ifndef HOST_INCLUDE_CPU_OPS_TEST_H_
+#define HOST_INCLUDE_CPU_OPS_TEST_H_
+
+#include <chrono>
+#include <ctime>
+#include <ratio>
+#include <vector>
+
+#include "batchnorm.h"
+#include "conv2d.h"
+#include "cpu_kernels.h"
+#include "depthwise_conv2d.h"
+#include "gemm.h"
+#include "test_utils.h"
+#include "thread_pool.h"
+
+using namespace std::chrono;
+
+// Compare the host engine against the Ref oracles, once for every
+// instruction set the CPU supports. pool defaults to ThreadPool::GetDefault.
+void RunConv2DCpuUnitTest(const int in_height,
+                          const int in_width,
+                          const int in_channels,
+                          const int out_channels,
+                          const int kernel_size,
+                          const int stride,
+                          const int padding,
+                          bool enable_timing = false,
+                          ThreadPool *pool = nullptr);
+
+void RunDepthwiseConv2DCpuUnitTest(const int in_height,
+                                   const int in_width,
+                                   const int in_channels,
+                                   const int channel_multiplier,
+                                   const int kernel_size,
+                                   const int stride,
+                                   const int padding,
+                                   bool enable_timing = false);
+
+void RunSgemmUnitTest(const int m,
+                      const int n,
+                      const int k,
+                      bool accumulate,
+                      bool enable_timing = false);
+
+void RunBatchNormCpuUnitTest(const std::vector<int> &tensor_shape,
+                             float relu,
+                             BatchNormStats stats,
+                             bool enable_timing = false);
+
+void RunCpuOpsTests(bool enable_timing = false);
+
+// Time RunConv2DRef against both host conv algorithms on the shapes of the
+// conv tests.
+void RunConv2DCpuBenchmarks();
+
+#endif  // HOST_INCLUDE_CPU_OPS_TEST_H_
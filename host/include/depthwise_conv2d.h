@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "memory_activation.h"
+#include "thread_pool.h"
 
 void RunDepthwiseConv2DRef(const float *in_data,
                            float *out_data,
@@ -38,5 +39,33 @@ void RunDepthwiseConv2DRef(const std::vector<float> &in_data,
                            int stride,
                            int padding);
 
+// Host engine: rows of each input channel are spread over the thread pool
+// (the default pool if null), with all channel_multiplier outputs of a
+// channel accumulated from one pass over its input rows. The Ref versions
+// above are kept as the oracle.
+void RunDepthwiseConv2DCpu(const float *in_data,
+                           float *out_data,
+                           const float *kernel_data,
+                           int in_height,
+                           int in_width,
+                           int in_channels,
+                           int channel_multiplier,
+                           int kernel_size,
+                           int stride,
+                           int padding,
+                           ThreadPool *pool = nullptr);
+
+void RunDepthwiseConv2DCpu(const std::vector<float> &in_data,
+                           std::vector<float> &out_data,
+                           const std::vector<float> &kernel_data,
+                           int in_height,
+                           int in_width,
+                           int in_channels,
+                           int channel_multiplier,
+                           int kernel_size,
+                           int stride,
+                           int padding,
+                           ThreadPool *pool = nullptr);
+
 #endif  // HOST_INCLUDE_DEPTHWISE_CONV2D_H_
 
@@ -5,6 +5,9 @@
 
 #include <vector>
 
+#include "execution_plan.h"
+#include "profiler.h"
+
 class DepthwiseConv2DOp {
  public:
   DepthwiseConv2DOp(int channels, int kernel_size, int stride, int padding,
@@ -15,6 +18,21 @@ class DepthwiseConv2DOp {
   void SetInBuffer(cl_mem *buf);
   void SetOutBuffer(cl_mem *buf);
   void SetKernelBuffer(cl_mem *buf);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+  // Run stride 2 layers of odd kernel size with kernel, ConvoluteStride2,
+  // which stages deinterleaved input tiles in local memory. A null kernel
+  // goes back to Convolute.
+  void SetStride2Kernel(cl_kernel *kernel);
+  // Run inputs with a halo with kernel, ConvoluteHalo, which reads the
+  // windows without bounds checks; see Tensor::GetHalo.
+  void SetHaloKernel(cl_kernel *kernel);
+  // Width of the zero border of the input and the output tensors. An input
+  // halo must be the padding and needs SetHaloKernel; the output is written
+  // in its interior by every kernel.
+  void SetHalo(int in_halo, int out_halo);
 
   void Run(std::vector<int> &shape, bool blocking);
   void Run(std::vector<int> &shape, bool blocking, float *out_data);
@@ -33,6 +51,14 @@ class DepthwiseConv2DOp {
   cl_mem *in_buf_;
   cl_mem *out_buf_;
   cl_mem *kernel_buf_;
+
+  cl_kernel *stride2_kernel_;
+  cl_kernel *halo_kernel_;
+  int in_halo_;
+  int out_halo_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
 };
 
 #endif  // HOST_INCLUDE_DEPTHWISE_CONV_2D_OP_H_
@@ -0,0 +1,95 @@
+#ifndef HOST_INCLUDE_EXECUTION_PLAN_H_
+#define HOST_INCLUDE_EXECUTION_PLAN_H_
+
+#include <CL/cl.h>
+#include <CL/cl_ext.h>
+
+#include <vector>
+
+#include "kernel.h"
+#include "profiler.h"
+
+// Records the ordered kernel launches of one run of a network and replays
+// them later with minimal host work. Launches are replayed in recording
+// order on an in-order queue, which preserves their dependencies.
+//
+// When the device supports cl_khr_command_buffer, the launches are recorded
+// into a command buffer and each replay is a single enqueue. Otherwise the
+// replay is a host loop that only re-sets the kernel arguments that differ
+// from the previous launch of the same kernel.
+class ExecutionPlan {
+ public:
+  ExecutionPlan(cl_platform_id platform, cl_device_id device,
+                cl_command_queue command_queue);
+  virtual ~ExecutionPlan();
+
+  // Disable copy.
+  ExecutionPlan(const ExecutionPlan &) = delete;
+  ExecutionPlan(ExecutionPlan &&) = delete;
+  ExecutionPlan &operator=(const ExecutionPlan &) = delete;
+  ExecutionPlan &operator=(ExecutionPlan &&) = delete;
+
+  void BeginRecording();
+  void EndRecording();
+  bool IsRecording() const;
+  bool IsRecorded() const;
+  // Drop all recorded launches.
+  void Reset();
+
+  // Capture a launch that was just enqueued. The arguments must be the ones
+  // currently set on the kernel. name labels the replayed launch when
+  // profiling.
+  void RecordKernel(cl_kernel kernel, const std::vector<KernelArg> &args,
+                    cl_uint work_dim, const std::size_t *global_size,
+                    const std::size_t *local_size,
+                    const char *name = "Kernel");
+
+  // Enqueue all recorded launches.
+  void Replay(bool blocking);
+  // Track the replayed commands. A command buffer replay is a single
+  // command.
+  void SetProfiler(Profiler *profiler);
+
+  std::size_t GetNumLaunches() const;
+  bool UsesCommandBuffer() const;
+
+ private:
+  struct Launch {
+    cl_kernel kernel;
+    const char *name;
+    std::vector<KernelArg> args;
+    // Indices of the arguments to set before this launch on replay.
+    std::vector<cl_uint> dirty_args;
+    cl_uint work_dim;
+    std::size_t global_size[3];
+    std::size_t local_size[3];
+  };
+
+  cl_platform_id platform_;
+  cl_device_id device_;
+  cl_command_queue command_queue_;
+
+  Profiler *profiler_;
+  bool recording_;
+  bool recorded_;
+  std::vector<Launch> launches_;
+
+  void ComputeDirtyArgs();
+  void ReplayHost();
+
+#ifdef cl_khr_command_buffer
+  bool command_buffer_supported_;
+  cl_command_buffer_khr command_buffer_;
+  cl_sync_point_khr last_sync_point_;
+  clCreateCommandBufferKHR_fn create_command_buffer_;
+  clFinalizeCommandBufferKHR_fn finalize_command_buffer_;
+  clReleaseCommandBufferKHR_fn release_command_buffer_;
+  clEnqueueCommandBufferKHR_fn enqueue_command_buffer_;
+  clCommandNDRangeKernelKHR_fn command_nd_range_kernel_;
+
+  void LoadCommandBufferFunctions();
+  void ReleaseCommandBuffer();
+#endif
+};
+
+#endif  // HOST_INCLUDE_EXECUTION_PLAN_H_
@@ -0,0 +1,45 @@
+#ifndef HOST_INCLUDE_FULLY_CONNECTED_H_
+#define HOST_INCLUDE_FULLY_CONNECTED_H_
+
+#include <vector>
+
+#include "thread_pool.h"
+
+// Dense layer over a batch of feature vectors:
+// out[n, o] = sum_k in[n, k] * weights[o, k] + biases[o], weights being
+// [out_features, in_features].
+void RunFullyConnectedRef(const float *in_data,
+                          float *out_data,
+                          const float *weights,
+                          const float *biases,
+                          int batch,
+                          int in_features,
+                          int out_features);
+
+void RunFullyConnectedRef(const std::vector<float> &in_data,
+                          std::vector<float> &out_data,
+                          const std::vector<float> &weights,
+                          const std::vector<float> &biases,
+                          int batch,
+                          int in_features,
+                          int out_features);
+
+// weights as [in_features, out_features], the layout RunFullyConnectedCpu
+// takes.
+std::vector<float> TransposeFullyConnectedWeights(
+    const std::vector<float> &weights,
+    int in_features,
+    int out_features);
+
+// Same as RunFullyConnectedRef with transposed weights, through RunSgemm on
+// the pool (the default pool if null).
+void RunFullyConnectedCpu(const float *in_data,
+                          float *out_data,
+                          const float *weights_t,
+                          const float *biases,
+                          int batch,
+                          int in_features,
+                          int out_features,
+                          ThreadPool *pool = nullptr);
+
+#endif  // HOST_INCLUDE_FULLY_CONNECTED_H_
@@ -0,0 +1,60 @@
+#ifndef HOST_INCLUDE_FULLY_CONNECTED_OP_H_
+#define HOST_INCLUDE_FULLY_CONNECTED_OP_H_
+
+#include <CL/cl.h>
+
+#include <vector>
+
+#include "execution_plan.h"
+#include "profiler.h"
+
+// Dense layer with fused bias, weights [out_features, in_features]. The
+// input is a batch of in_features values per image, whatever its shape.
+// A batch of one runs the GEMV kernel, larger batches the tiled GEMM.
+class FullyConnectedOp {
+ public:
+  FullyConnectedOp(int in_features, int out_features,
+                   cl_kernel *gemv_kernel, cl_kernel *gemm_kernel,
+                   cl_command_queue *command_queue,
+                   cl_mem *in_buf = nullptr,
+                   cl_mem *weights_buf = nullptr,
+                   cl_mem *biases_buf = nullptr,
+                   cl_mem *out_buf = nullptr);
+
+  void SetInBuffer(cl_mem *buf);
+  void SetWeightBuffer(cl_mem *buf);
+  void SetBiasBuffer(cl_mem *buf);
+  void SetOutBuffer(cl_mem *buf);
+  // Scale the inputs on load, e.g. by 1 / (height * width) for the sums of
+  // GlobalAvgPoolOp::SetSum. 1 by default.
+  void SetInScale(float scale);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+
+  void Run(const std::vector<int> &shape, bool blocking);
+  void Run(const std::vector<int> &shape, bool blocking, float *out_data);
+
+ private:
+  int in_features_;
+  int out_features_;
+  float in_scale_;
+
+  cl_kernel *gemv_kernel_;
+  cl_kernel *gemm_kernel_;
+  cl_command_queue *command_queue_;
+
+  cl_mem *in_buf_;
+  cl_mem *weights_buf_;
+  cl_mem *biases_buf_;
+  cl_mem *out_buf_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
+
+  void RunGemv(int batch);
+  void RunGemm(int batch);
+};
+
+#endif  // HOST_INCLUDE_FULLY_CONNECTED_OP_H_
@@ -0,0 +1,34 @@
+#ifndef HOST_INCLUDE_FULLY_CONNECTED_TEST_H_
+#define HOST_INCLUDE_FULLY_CONNECTED_TEST_H_
+
+#include <vector>
+
+#include "cl_operators.h"
+#include "cpu_operators.h"
+#include "fully_connected.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+// RunFullyConnectedRef against values worked out by hand.
+void RunFullyConnectedRefUnitTest();
+
+// A dense layer over random features on the device and the host engine,
+// compared with RunFullyConnectedRef. A batch of one runs the GEMV kernel,
+// larger batches the tiled GEMM.
+void RunFullyConnectedUnitTest(Workspace &ws,
+                               int batch,
+                               int in_features,
+                               int out_features);
+
+// The global average pooling operators, compared with RunReduceRef.
+void RunGlobalAvgPoolUnitTest(Workspace &ws, const std::vector<int> &shape);
+
+// The classifier head, global average pooling fused into the dense layer,
+// compared with the reference pooling then RunFullyConnectedRef.
+void RunPooledFullyConnectedUnitTest(Workspace &ws,
+                                     const std::vector<int> &shape,
+                                     int out_features);
+
+void RunFullyConnectedTests(Workspace &ws);
+
+#endif  // HOST_INCLUDE_FULLY_CONNECTED_TEST_H_
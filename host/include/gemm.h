@@ -0,0 +1,27 @@
+#ifndef HOST_INCLUDE_GEMM_H_
+#define HOST_INCLUDE_GEMM_H_
+
+#include "thread_pool.h"
+
+// Row-major single-precision GEMM on the host:
+// C[m x n] = A[m x k] * B[k x n], plus C if accumulate is set.
+//
+// C is computed in macro-tiles spread over the thread pool (the default
+// pool if null). For every slice of k each tile packs its panels of A and
+// B into contiguous buffers, which a register-blocked micro-kernel picked
+// for the CPU at runtime then streams through.
+void RunSgemm(int m, int n, int k,
+              const float *a, int lda,
+              const float *b, int ldb,
+              float *c, int ldc,
+              bool accumulate = false,
+              ThreadPool *pool = nullptr);
+
+// Naive triple loop, kept as the oracle.
+void RunSgemmRef(int m, int n, int k,
+                 const float *a, int lda,
+                 const float *b, int ldb,
+                 float *c, int ldc,
+                 bool accumulate = false);
+
+#endif  // HOST_INCLUDE_GEMM_H_
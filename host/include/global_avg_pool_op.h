@@ -0,0 +1,51 @@
+#ifndef HOST_INCLUDE_GLOBAL_AVG_POOL_OP_H_
+#define HOST_INCLUDE_GLOBAL_AVG_POOL_OP_H_
+
+#include <CL/cl.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "execution_plan.h"
+#include "profiler.h"
+
+// Mean of every channel of every image, [batch, channels, height, width]
+// to batch * channels floats, with the Reduce kernel of device/reduce.cl.
+class GlobalAvgPoolOp {
+ public:
+  GlobalAvgPoolOp(cl_kernel *reduce_kernel, cl_command_queue *command_queue,
+                  cl_mem *in_buf = nullptr, cl_mem *out_buf = nullptr,
+                  cl_mem *scratch_buf = nullptr);
+
+  void SetInBuffer(cl_mem *buf);
+  void SetOutBuffer(cl_mem *buf);
+  // GetScratchSize bytes.
+  void SetScratchBuffer(cl_mem *buf);
+  // Write the sums instead of the means, for a consumer that scales its
+  // input anyway, e.g. FullyConnectedOp::SetInScale.
+  void SetSum(bool sum);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+
+  static std::size_t GetScratchSize(const std::vector<int> &shape);
+
+  void Run(const std::vector<int> &shape, bool blocking);
+  void Run(const std::vector<int> &shape, bool blocking, float *out_data);
+
+ private:
+  bool sum_;
+
+  cl_kernel *reduce_kernel_;
+  cl_command_queue *command_queue_;
+
+  cl_mem *in_buf_;
+  cl_mem *out_buf_;
+  cl_mem *scratch_buf_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
+};
+
+#endif  // HOST_INCLUDE_GLOBAL_AVG_POOL_OP_H_
@@ -0,0 +1,22 @@
+#ifndef HOST_INCLUDE_HALO_TEST_H_
+#define HOST_INCLUDE_HALO_TEST_H_
+
+#include <vector>
+
+#include "batchnorm.h"
+#include "network.h"
+#include "operator.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+// A device network of convs, depthwise convs, a stride 2 conv and batch
+// norms on an input of shape, with halos between its layers, compared with
+// the same network without halos and on the CPU. Also checks that
+// GetTensorBytes accounts for the halos.
+void RunHaloUnitTest(Workspace &ws,
+                     const std::vector<int> &shape,
+                     BatchNormStats stats);
+
+void RunHaloTests(Workspace &ws);
+
+#endif  // HOST_INCLUDE_HALO_TEST_H_
@@ -0,0 +1,40 @@
+#ifndef HOST_INCLUDE_HDR_HISTOGRAM_H_
+#define HOST_INCLUDE_HDR_HISTOGRAM_H_
+
+#include <cstdint>
+#include <vector>
+
+// High dynamic range histogram of non-negative integers, e.g. latencies in
+// ns, with 3 significant digits over the whole range. Values below 2048
+// are counted exactly; above, each power of two is split into 1024 linear
+// buckets, so any value is reported within 0.1%. Recording is a few
+// integer operations and never allocates, so each thread can keep its own
+// histogram and merge it at the end.
+class HdrHistogram {
+ public:
+  // Values above highest_value are counted as highest_value.
+  explicit HdrHistogram(std::int64_t highest_value = std::int64_t(1) << 40);
+
+  void Record(std::int64_t value);
+  // Add the counts of other, which must have the same highest value.
+  void Merge(const HdrHistogram &other);
+  void Reset();
+
+  std::int64_t GetCount() const;
+  std::int64_t GetMin() const;
+  std::int64_t GetMax() const;
+  double GetMean() const;
+  // Smallest value at or above the given percentile (0 to 100) of the
+  // recorded values, as the highest value of its bucket. 0 if empty.
+  std::int64_t GetValueAtPercentile(double percentile) const;
+
+ private:
+  std::int64_t highest_value_;
+  std::vector<std::int64_t> counts_;
+  std::int64_t count_;
+  std::int64_t min_;
+  std::int64_t max_;
+  double sum_;
+};
+
+#endif  // HOST_INCLUDE_HDR_HISTOGRAM_H_
@@ -3,11 +3,20 @@
 
 #include <CL/cl.h>
 
+#include <cstring>
+#include <vector>
+
 class Kernel {
  public:
   explicit Kernel(cl_kernel kernel);
   ~Kernel();
 
+  // Disable copy, allow move.
+  Kernel(const Kernel &) = delete;
+  Kernel(Kernel &&other);
+  Kernel &operator=(const Kernel &) = delete;
+  Kernel &operator=(Kernel &&other);
+
   cl_kernel &Get();
   const cl_kernel &Get() const;
 
@@ -15,5 +24,37 @@ class Kernel {
   cl_kernel kernel_;
 };
 
-#endif  // HOST_INCLUDE_KERNEL_H_
+// A new instance of kernel with its own arguments, so that another thread
+// can set them and launch it concurrently.
+Kernel CloneKernel(cl_kernel kernel);
+
+// A kernel argument captured by value, so that a launch can be replayed
+// after the caller's variables are gone.
+struct KernelArg {
+  static const std::size_t kMaxSize = 16;
+
+  template <typename T>
+  KernelArg(const T &value) : size(sizeof(T)), svm(false), local(false) {
+    static_assert(sizeof(T) <= kMaxSize, "Kernel argument is too large");
+    std::memcpy(data, &value, sizeof(T));
+  }
+
+  // A shared virtual memory pointer, set with clSetKernelArgSVMPointer.
+  static KernelArg SvmPointer(const void *ptr);
+  // size bytes of local memory for a __local pointer argument.
+  static KernelArg LocalMemory(std::size_t size);
 
+  bool operator==(const KernelArg &other) const;
+  bool operator!=(const KernelArg &other) const;
+
+  std::size_t size;
+  bool svm;
+  bool local;
+  unsigned char data[kMaxSize];
+};
+
+cl_int SetKernelArg(cl_kernel kernel, cl_uint idx, const KernelArg &arg);
+// Set all arguments of a kernel in order.
+void SetKernelArgs(cl_kernel kernel, const std::vector<KernelArg> &args);
+
+#endif  // HOST_INCLUDE_KERNEL_H_
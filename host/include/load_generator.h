@@ -0,0 +1,62 @@
+#ifndef HOST_INCLUDE_LOAD_GENERATOR_H_
+#define HOST_INCLUDE_LOAD_GENERATOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "hdr_histogram.h"
+
+enum class LoadMode {
+  // Each client sends its next request as soon as the previous one returns,
+  // so num_clients requests are always in flight.
+  kClosedLoop,
+  // Requests arrive as a Poisson process of the given rate, whether or not
+  // earlier ones have finished. Clients take the arrivals in order, so a
+  // request whose client is still busy waits, and that wait counts in its
+  // latency.
+  kOpenLoop
+};
+
+const char *GetLoadModeName(LoadMode mode);
+
+struct LoadOptions {
+  LoadMode mode = LoadMode::kClosedLoop;
+  int num_clients = 1;
+  // Requests per second, open loop only.
+  double rate = 0.0;
+  // Seconds of measured load, after the warm-up seconds.
+  double duration = 5.0;
+  double warmup = 1.0;
+  unsigned seed = 1;
+};
+
+struct LoadResult {
+  LoadOptions options;
+  // Requests started in the measured window and finished, and those that
+  // threw.
+  std::int64_t count;
+  std::int64_t errors;
+  // From the end of the warm-up to the last measured completion.
+  double seconds;
+  // Completed requests per second.
+  double throughput;
+  // Latency in ns: from the start of the request in closed loop, from its
+  // scheduled arrival in open loop.
+  HdrHistogram latency;
+};
+
+// Drive request from options.num_clients threads. request gets the index of
+// the client calling it, e.g. to pick that client's input.
+LoadResult RunLoad(const LoadOptions &options,
+                   const std::function<void(int)> &request);
+
+// One line per load level: offered load, sustained throughput and the
+// latency percentiles, i.e. the latency-vs-throughput curve.
+void PrintLoadCurve(std::ostream &os, const std::vector<LoadResult> &results);
+void WriteLoadCurveCsv(const std::string &path,
+                       const std::vector<LoadResult> &results);
+
+#endif  // HOST_INCLUDE_LOAD_GENERATOR_H_
@@ -0,0 +1,19 @@
+#ifndef HOST_INCLUDE_LOAD_GENERATOR_TEST_H_
+#define HOST_INCLUDE_LOAD_GENERATOR_TEST_H_
+
+#include "hdr_histogram.h"
+#include "load_generator.h"
+#include "test_utils.h"
+
+// Record 1..n and check the percentiles are within the histogram's
+// precision of the exact ones.
+void RunHdrHistogramUnitTest(std::int64_t n, std::int64_t scale);
+
+// Drive a request that sleeps for service_us and check the throughput and
+// latency against what the mode should give.
+void RunLoadGeneratorUnitTest(LoadMode mode, int num_clients, double rate,
+                              int service_us);
+
+void RunLoadGeneratorTests();
+
+#endif  // HOST_INCLUDE_LOAD_GENERATOR_TEST_H_
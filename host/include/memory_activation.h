@@ -5,6 +5,7 @@
 
 #include <exception>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #define PATH_SIZE       2048
@@ -41,6 +42,10 @@ cl_int CreateKernel(cl_context context,
                     std::vector<const char *> kernel_names,
                     cl_bool binary = CL_FALSE);
 
+// Options to build the program at program_path with: its directory is on
+// the include path, for the headers shared by the kernels.
+std::string GetProgramBuildOptions(const char *program_path);
+
 cl_uint RoundUp(cl_uint value, cl_uint multiple);
 
 #define ASSERT(condition, msg)     \
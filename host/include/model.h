@@ -7,9 +7,15 @@
 #include "batchnorm_op.h"
 #include "conv2d.h"
 #include "conv2d_op.h"
+#include "conv_selector.h"
 #include "depthwise_conv2d.h"
 #include "depthwise_conv2d_op.h"
+#include "execution_plan.h"
+#include "kernel.h"
+#include "network.h"
+#include "tensor.h"
 #include "test_utils.h"
+#include "workspace.h"
 
 void RunModel(cl_context context,
               cl_command_queue command_queue,
@@ -29,4 +35,89 @@ void RunModelRef(std::vector<int> &tensor_shape,
                  const std::vector<float> &weight_data,
                  const std::vector<float> &bias_data);
 
+// RunModelRef on the multithreaded SIMD host engine. conv_algorithms picks
+// the algorithm of each conv layer; missing entries are kAuto.
+void RunModelCpu(std::vector<int> &tensor_shape,
+                 std::vector<float> &in_data,
+                 std::vector<float> &out_data,
+                 const std::vector<float> &kernel_data,
+                 const std::vector<float> &weight_data,
+                 const std::vector<float> &bias_data,
+                 const std::vector<Conv2DAlgorithm> &conv_algorithms = {},
+                 ThreadPool *pool = nullptr);
+
+// Add the layers of RunModel to network, with the conv and batchnorm of
+// layer i on backends[i]. Missing entries are kOpenCL if ws is set and kCpu
+// otherwise.
+void AddModelLayers(Network &network,
+                    Workspace *ws,
+                    const std::vector<float> &kernel_data,
+                    const std::vector<float> &weight_data,
+                    const std::vector<float> &bias_data,
+                    const std::vector<Backend> &backends = {});
+// Same, with the implementation of each conv layer, e.g. from ConvSelector.
+void AddModelLayers(Network &network,
+                    Workspace *ws,
+                    const std::vector<float> &kernel_data,
+                    const std::vector<float> &weight_data,
+                    const std::vector<float> &bias_data,
+                    const std::vector<ConvImpl> &impls);
+
+// The conv layers of RunModel for an input of in_shape.
+std::vector<ConvLayer> GetModelLayers(const std::vector<int> &in_shape);
+
+// The network of RunModel with device buffers and operators kept alive
+// across runs. The first Run records the kernel launches into an execution
+// plan and later runs replay it. The input and output tensors are zero-copy
+// on devices with unified memory, so no copies are made around a run.
+class Model {
+ public:
+  Model(Workspace &ws,
+        const std::vector<int> &in_shape,
+        const std::vector<float> &kernel_data,
+        const std::vector<float> &weight_data,
+        const std::vector<float> &bias_data,
+        bool use_plan = true);
+  virtual ~Model();
+
+  // Disable copy.
+  Model(const Model &) = delete;
+  Model(Model &&) = delete;
+  Model &operator=(const Model &) = delete;
+  Model &operator=(Model &&) = delete;
+
+  // Run on the data in GetInput(); the result is left in GetOutput().
+  void Run();
+  void Run(const std::vector<float> &in_data, std::vector<float> &out_data);
+
+  Tensor &GetInput();
+  const Tensor &GetOutput() const;
+  const std::vector<int> &GetOutShape() const;
+  ExecutionPlan &GetExecutionPlan();
+
+ private:
+  Workspace *ws_;
+  cl_command_queue command_queue_;
+  Kernel conv_kernel_;
+  Kernel batchnorm_kernel_;
+
+  std::vector<int> in_shape_;
+  std::vector<int> out_shape_;
+  bool use_plan_;
+
+  Tensor input_;
+  Tensor output_;
+  // Device-only intermediate activations.
+  std::vector<Tensor> activations_;
+  cl_mem kernel_buf_;
+  cl_mem weight_buf_;
+  cl_mem bias_buf_;
+
+  std::vector<Conv2DOp> convs_;
+  std::vector<BatchNormOp> bns_;
+  ExecutionPlan plan_;
+
+  void RunOps();
+};
+
 #endif  // HOST_INCLUDE_MODEL_H_
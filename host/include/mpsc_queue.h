@@ -0,0 +1,75 @@
+#ifndef HOST_INCLUDE_MPSC_QUEUE_H_
+#define HOST_INCLUDE_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free queue with any number of producers and a single
+// consumer (Vyukov's intrusive MPSC queue). Push is one atomic exchange
+// and never waits for other producers or the consumer; Pop and IsEmpty may
+// only be called from the consumer thread.
+//
+// A producer links its node in two steps, so between them Pop sees the
+// queue as empty even if later pushes are complete. The consumer just
+// retries later: the producer is never blocked.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() {
+    Node *stub = new Node;
+    head_.store(stub);
+    tail_ = stub;
+  }
+
+  ~MpscQueue() {
+    while (tail_ != nullptr) {
+      Node *next = tail_->next.load(std::memory_order_relaxed);
+      delete tail_;
+      tail_ = next;
+    }
+  }
+
+  // Disable copy.
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue(MpscQueue &&) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+  MpscQueue &operator=(MpscQueue &&) = delete;
+
+  void Push(T value) {
+    Node *node = new Node;
+    node->value = std::move(value);
+    Node *prev = head_.exchange(node);
+    prev->next.store(node);
+  }
+
+  // Move the oldest value into *value. False if the queue looks empty.
+  bool Pop(T *value) {
+    Node *next = tail_->next.load();
+    if (next == nullptr) {
+      return false;
+    }
+    // next becomes the new stub; its value has been taken.
+    *value = std::move(next->value);
+    delete tail_;
+    tail_ = next;
+    return true;
+  }
+
+  bool IsEmpty() const {
+    return tail_->next.load() == nullptr;
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    T value;
+  };
+
+  // Producers swap in the newest node; the consumer owns the oldest. Padded
+  // so that pushes don't invalidate the consumer's cache line.
+  std::atomic<Node *> head_;
+  char padding_[64 - sizeof(std::atomic<Node *>)];
+  Node *tail_;
+};
+
+#endif  // HOST_INCLUDE_MPSC_QUEUE_H_
@@ -0,0 +1,66 @@
+#ifndef HOST_INCLUDE_NETWORK_H_
+#define HOST_INCLUDE_NETWORK_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "operator.h"
+#include "tensor.h"
+#include "workspace.h"
+
+// A chain of operators on any mix of backends. Prepare infers the shapes
+// and creates the tensors between the operators: tensors only OpenCL
+// operators touch stay on the device, tensors crossing backends or visible
+// to the caller get zero-copy storage where the device allows, and tensors
+// only CPU operators touch get no device buffer. Tensors that stay on the
+// device get the halo their consumer asks for, see
+// Operator::GetInputHalo, when every operator touching them supports it.
+class Network {
+ public:
+  // ws may be null if all operators run on the CPU.
+  explicit Network(Workspace *ws = nullptr);
+
+  void Add(std::unique_ptr<Operator> op);
+  // Whether Prepare gives halos to the tensors between the operators; on by
+  // default. Off keeps every tensor dense, e.g. to compare.
+  void SetHaloLayout(bool enable);
+  void Prepare(const std::vector<int> &in_shape);
+  // The same operators on ws, sharing the parameters, unprepared. Run the
+  // copy on a child workspace to run it concurrently with this network.
+  std::unique_ptr<Network> Clone(Workspace *ws) const;
+
+  // Run on the data in GetInput(); the result is left in GetOutput().
+  void Run();
+  void Run(const std::vector<float> &in_data, std::vector<float> &out_data);
+
+  Workspace *GetWorkspace() const;
+
+  Tensor &GetInput();
+  const Tensor &GetOutput() const;
+  const std::vector<int> &GetOutShape() const;
+  // The largest scratch memory of an operator, in bytes.
+  std::size_t GetScratchSize() const;
+  // Bytes of the tensors of the network, its input and output included,
+  // halos included.
+  std::size_t GetTensorBytes() const;
+
+  int GetNumOperators() const;
+  Operator &GetOperator(int idx);
+  // Input shape of an operator once prepared.
+  const std::vector<int> &GetInShape(int idx) const;
+
+ private:
+  Workspace *ws_;
+  std::vector<std::unique_ptr<Operator>> ops_;
+  std::vector<Tensor> tensors_;
+  // Index into tensors_ of the input and the output of every operator.
+  std::vector<int> op_inputs_;
+  std::vector<int> op_outputs_;
+  std::vector<int> out_shape_;
+  std::size_t scratch_size_;
+  bool halo_layout_;
+  bool prepared_;
+};
+
+#endif  // HOST_INCLUDE_NETWORK_H_
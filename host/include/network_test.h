@@ -0,0 +1,33 @@
+#ifndef HOST_INCLUDE_NETWORK_TEST_H_
+#define HOST_INCLUDE_NETWORK_TEST_H_
+
+#include <vector>
+
+#include "model.h"
+#include "network.h"
+#include "operator.h"
+#include "session.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+// Build the RunModel network with the given backend per layer and compare
+// it against RunModelRef. ws may be null for an all-CPU network.
+void RunNetworkUnitTest(Workspace *ws,
+                        const int in_height,
+                        const int in_width,
+                        const std::vector<Backend> &backends,
+                        const int batch = 1);
+
+// Run a session with num_contexts contexts from num_threads threads at once
+// and compare every result against RunModelRef.
+void RunConcurrentSessionUnitTest(Workspace *ws,
+                                  const int in_height,
+                                  const int in_width,
+                                  const std::vector<Backend> &backends,
+                                  int num_contexts,
+                                  int num_threads);
+
+// All-OpenCL, all-CPU and mixed networks.
+void RunNetworkTests(Workspace &ws);
+
+#endif  // HOST_INCLUDE_NETWORK_TEST_H_
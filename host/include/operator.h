@@ -0,0 +1,169 @@
+#ifndef HOST_INCLUDE_OPERATOR_H_
+#define HOST_INCLUDE_OPERATOR_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "batchnorm.h"
+#include "conv2d.h"
+#include "reduce.h"
+#include "tensor.h"
+#include "workspace.h"
+
+// Work and minimum memory traffic of a run, with every input, output and
+// parameter byte touched once.
+struct OpCost {
+  double macs;
+  double flops;
+  double bytes_read;
+  double bytes_written;
+};
+
+// Where an operator runs.
+enum class Backend { kOpenCL, kCpu };
+
+const char *GetBackendName(Backend backend);
+
+// A layer of a network, reading an input tensor and writing an output
+// tensor of the shape it infers. In-place operators get the same tensor as
+// input and output.
+//
+// Operators go through the tensors' coherence tracking: CPU operators use
+// the host data and OpenCL operators the device data, so tensors passed
+// between backends are transferred only when needed.
+class Operator {
+ public:
+  virtual ~Operator();
+
+  virtual Backend GetBackend() const = 0;
+  virtual const char *GetName() const = 0;
+  virtual bool IsInPlace() const;
+
+  // Output shape for an input of in_shape. Throws if the input doesn't fit.
+  virtual std::vector<int> InferShape(
+      const std::vector<int> &in_shape) const = 0;
+  // Zero for operators without a cost model.
+  virtual OpCost GetCost(const std::vector<int> &in_shape) const;
+  // Bytes of scratch memory a run allocates besides its tensors.
+  virtual std::size_t GetScratchSize(const std::vector<int> &in_shape) const;
+
+  // Width of the zero border, see Tensor::GetHalo, the operator would like
+  // around its input, e.g. the padding of a conv; 0 by default. A network
+  // only gives it to tensors that stay on the device and that are only
+  // touched by operators that SupportsHalo.
+  virtual int GetInputHalo() const;
+  // Whether Run takes input and output tensors with a halo, touching only
+  // their interior. False by default.
+  virtual bool SupportsHalo() const;
+
+  // Get ready to run on inputs of in_shape, e.g. upload the parameters.
+  virtual void Prepare(const std::vector<int> &in_shape);
+  // OpenCL operators only enqueue their work; the tensors' coherence
+  // tracking waits for it when the host reads the output.
+  virtual void Run(Tensor &input, Tensor &output) = 0;
+
+  // A copy that runs on ws, sharing the parameters. Copies on different
+  // workspaces, e.g. children of one workspace, may run concurrently. ws
+  // may be null for CPU operators.
+  virtual std::unique_ptr<Operator> Clone(Workspace *ws) const = 0;
+};
+
+// Operator factories, so that one network definition can be built for
+// either backend. ws may be null for the CPU backend. Parameters are copied.
+// The device has a single conv algorithm, so algorithm only applies to the
+// CPU backend.
+std::unique_ptr<Operator> CreateConv2D(
+    Backend backend,
+    Workspace *ws,
+    int in_channels,
+    int out_channels,
+    int kernel_size,
+    int stride,
+    int padding,
+    const std::vector<float> &kernel_data,
+    Conv2DAlgorithm algorithm = Conv2DAlgorithm::kAuto);
+
+std::unique_ptr<Operator> CreateDepthwiseConv2D(
+    Backend backend,
+    Workspace *ws,
+    int channels,
+    int channel_multiplier,
+    int kernel_size,
+    int stride,
+    int padding,
+    const std::vector<float> &kernel_data);
+
+std::unique_ptr<Operator> CreateBatchNorm(Backend backend,
+                                          Workspace *ws,
+                                          int num_features,
+                                          float eps,
+                                          float relu,
+                                          const std::vector<float> &weights,
+                                          const std::vector<float> &biases,
+                                          BatchNormStats stats =
+                                              BatchNormStats::kPerImage);
+
+// Softmax over every dimension but the batch, in place.
+std::unique_ptr<Operator> CreateSoftmax(Backend backend, Workspace *ws);
+
+// Mean of every channel, [batch, channels, height, width] to
+// [batch, channels, 1, 1].
+std::unique_ptr<Operator> CreateGlobalAvgPool(Backend backend, Workspace *ws);
+
+// Dense layer, weights [out_features, in_features], over the in_features
+// values of each image, to [batch, out_features]. With pool_input the
+// input is [batch, in_features, height, width], pooled on the way in as by
+// a global average pooling.
+std::unique_ptr<Operator> CreateFullyConnected(
+    Backend backend,
+    Workspace *ws,
+    int in_features,
+    int out_features,
+    const std::vector<float> &weights,
+    const std::vector<float> &biases,
+    bool pool_input = false);
+
+// Reduction over the axes [axis, axis + num_axes), kept as 1 in the output.
+std::unique_ptr<Operator> CreateReduce(Backend backend,
+                                       Workspace *ws,
+                                       Reduction reduction,
+                                       int axis,
+                                       int num_axes = 1);
+
+// Output shape of a convolution window over a 4D input.
+std::vector<int> InferConvShape(const std::vector<int> &in_shape,
+                                int out_channels,
+                                int kernel_size,
+                                int stride,
+                                int padding);
+
+// Costs shared by the backends.
+OpCost GetConv2DCost(const std::vector<int> &in_shape,
+                     int out_channels,
+                     int kernel_size,
+                     int stride,
+                     int padding);
+
+OpCost GetDepthwiseConv2DCost(const std::vector<int> &in_shape,
+                              int channel_multiplier,
+                              int kernel_size,
+                              int stride,
+                              int padding);
+
+OpCost GetBatchNormCost(const std::vector<int> &in_shape);
+
+OpCost GetSoftmaxCost(const std::vector<int> &in_shape);
+
+OpCost GetGlobalAvgPoolCost(const std::vector<int> &in_shape);
+
+OpCost GetFullyConnectedCost(const std::vector<int> &in_shape,
+                             int out_features,
+                             bool pool_input);
+
+OpCost GetReduceCost(const std::vector<int> &in_shape,
+                     Reduction reduction,
+                     int axis,
+                     int num_axes);
+
+#endif  // HOST_INCLUDE_OPERATOR_H_
@@ -0,0 +1,51 @@
+#ifndef HOST_INCLUDE_PREPROCESS_H_
+#define HOST_INCLUDE_PREPROCESS_H_
+
+#include <cstdint>
+#include <vector>
+
+// How frames of another size are brought to the size of the model input.
+enum class ResizeMode {
+  // Bilinear resize with half-pixel centers, edges clamped.
+  kBilinear,
+  // Centered window of the input size; frames must be at least that large.
+  kCenterCrop,
+};
+
+// Turns 8-bit interleaved frames, HWC, into the normalized float NCHW
+// input of a model: out = (pixel / 255 - mean[c]) / stddev[c].
+struct PreprocessParams {
+  int src_height;
+  int src_width;
+  int dst_height;
+  int dst_width;
+  int channels = 3;
+  ResizeMode resize = ResizeMode::kBilinear;
+  // ImageNet statistics by default.
+  std::vector<float> mean{0.485f, 0.456f, 0.406f};
+  std::vector<float> stddev{0.229f, 0.224f, 0.225f};
+};
+
+// Bytes of a frame and floats of an output image.
+int GetPreprocessInSize(const PreprocessParams &params);
+int GetPreprocessOutSize(const PreprocessParams &params);
+// {batch, channels, dst_height, dst_width}.
+std::vector<int> GetPreprocessShape(const PreprocessParams &params,
+                                    int batch);
+// The normalization folded into out = pixel * scale[c] + shift[c], as the
+// kernels apply it: channels scales followed by channels shifts.
+std::vector<float> GetPreprocessScaleShift(const PreprocessParams &params);
+// Whether the frames are only cropped, so a conv can read them directly.
+bool IsPreprocessCropOnly(const PreprocessParams &params);
+
+void RunPreprocessRef(const std::uint8_t *in_data,
+                      float *out_data,
+                      int batch,
+                      const PreprocessParams &params);
+
+void RunPreprocessRef(const std::vector<std::uint8_t> &in_data,
+                      std::vector<float> &out_data,
+                      int batch,
+                      const PreprocessParams &params);
+
+#endif  // HOST_INCLUDE_PREPROCESS_H_
@@ -0,0 +1,44 @@
+#ifndef HOST_INCLUDE_PREPROCESS_OP_H_
+#define HOST_INCLUDE_PREPROCESS_OP_H_
+
+#include <CL/cl.h>
+
+#include <vector>
+
+#include "execution_plan.h"
+#include "preprocess.h"
+#include "profiler.h"
+
+class PreprocessOp {
+ public:
+  // scale_shift_buf holds GetPreprocessScaleShift(params).
+  PreprocessOp(const PreprocessParams &params, cl_kernel *kernel,
+               cl_command_queue *command_queue, cl_mem *in_buf = nullptr,
+               cl_mem *out_buf = nullptr, cl_mem *scale_shift_buf = nullptr);
+
+  void SetInBuffer(cl_mem *buf);
+  void SetOutBuffer(cl_mem *buf);
+  void SetScaleShiftBuffer(cl_mem *buf);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+
+  void Run(int batch, bool blocking);
+  void Run(int batch, bool blocking, float *out_data);
+
+ private:
+  PreprocessParams params_;
+
+  cl_kernel *kernel_;
+  cl_command_queue *command_queue_;
+
+  cl_mem *in_buf_;
+  cl_mem *out_buf_;
+  cl_mem *scale_shift_buf_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
+};
+
+#endif  // HOST_INCLUDE_PREPROCESS_OP_H_
@@ -0,0 +1,29 @@
+#ifndef HOST_INCLUDE_PREPROCESS_TEST_H_
+#define HOST_INCLUDE_PREPROCESS_TEST_H_
+
+#include "model.h"
+#include "network.h"
+#include "preprocess.h"
+#include "preprocessor.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+// Check RunPreprocessRef against values worked out by hand.
+void RunPreprocessRefUnitTest();
+
+// Preprocess batch random frames on the device and compare with
+// RunPreprocessRef.
+void RunPreprocessUnitTest(Workspace &ws,
+                           const PreprocessParams &params,
+                           int batch,
+                           bool enable_timing = false);
+
+// Run the RunModel network on frames fused into its first conv and compare
+// with the network run on the input preprocessed on the host.
+void RunPreprocessFusedUnitTest(Workspace &ws,
+                                const PreprocessParams &params,
+                                int batch);
+
+void RunPreprocessTests(Workspace &ws, bool enable_timing = false);
+
+#endif  // HOST_INCLUDE_PREPROCESS_TEST_H_
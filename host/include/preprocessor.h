@@ -0,0 +1,72 @@
+#ifndef HOST_INCLUDE_PREPROCESSOR_H_
+#define HOST_INCLUDE_PREPROCESSOR_H_
+
+#include <CL/cl.h>
+
+#include <cstdint>
+
+#include "cl_operators.h"
+#include "network.h"
+#include "preprocess.h"
+#include "preprocess_op.h"
+#include "tensor.h"
+#include "workspace.h"
+
+// Feeds raw frames to a model on the device: the 8-bit HWC frames are
+// uploaded as they are, a quarter of the bytes of their float input, and a
+// kernel normalizes, resizes or crops them and converts them to NCHW.
+//
+// When the frames only need cropping, the first conv of the network can
+// instead read them directly and normalize on load, so the float input is
+// never written nor read.
+class Preprocessor {
+ public:
+  // Up to max_batch frames per run.
+  Preprocessor(Workspace &ws, const PreprocessParams &params,
+               int max_batch = 1);
+  virtual ~Preprocessor();
+
+  // Disable copy.
+  Preprocessor(const Preprocessor &) = delete;
+  Preprocessor(Preprocessor &&) = delete;
+  Preprocessor &operator=(const Preprocessor &) = delete;
+  Preprocessor &operator=(Preprocessor &&) = delete;
+
+  const PreprocessParams &GetParams() const;
+  int GetMaxBatch() const;
+  // Bytes per frame.
+  std::size_t GetInSize() const;
+
+  // Upload batch frames of GetInSize() bytes, back to back, and convert them
+  // into output, of GetPreprocessShape(params, batch). Nothing is waited
+  // for: frames must stay valid until the commands complete, e.g. until the
+  // output is read.
+  void Run(const std::uint8_t *frames, int batch, Tensor &output);
+  // Upload the frames of a batch of the prepared network and convert them
+  // into its input, or only upload them if the network is fused.
+  void Run(const std::uint8_t *frames, Network &network);
+
+  // Make the first operator of network read the uploaded frames if it is an
+  // OpenCL conv and the frames only need cropping. Returns whether it did.
+  // The network must not run after the preprocessor is gone unless Unfuse
+  // is called first.
+  bool Fuse(Network &network);
+  void Unfuse();
+  bool IsFused() const;
+
+ private:
+  Workspace *ws_;
+  PreprocessParams params_;
+  int max_batch_;
+  cl_kernel kernel_;
+  cl_command_queue command_queue_;
+  cl_mem frames_buf_;
+  cl_mem scale_shift_buf_;
+  cl_mem out_buf_;
+  PreprocessOp op_;
+  ClConv2D *fused_conv_;
+
+  void Upload(const std::uint8_t *frames, int batch);
+};
+
+#endif  // HOST_INCLUDE_PREPROCESSOR_H_
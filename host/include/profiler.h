@@ -0,0 +1,102 @@
+#ifndef HOST_INCLUDE_PROFILER_H_
+#define HOST_INCLUDE_PROFILER_H_
+
+#include <CL/cl.h>
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// What a profiled command does.
+enum class ProfileKind { kKernel, kWrite, kRead, kMap, kUnmap, kHost };
+
+const char *GetProfileKindName(ProfileKind kind);
+
+// One command or host span. Device timestamps are the raw OpenCL ones in
+// ns and are valid after Profiler::Collect. Host spans only have start and
+// end, in ns of GetHostTime.
+struct ProfileRecord {
+  std::string name;
+  ProfileKind kind;
+  // Index of the layer the command ran in, -1 outside layers.
+  int layer;
+  cl_event event;
+  std::int64_t host_enqueue;
+  cl_ulong queued;
+  cl_ulong submit;
+  cl_ulong start;
+  cl_ulong end;
+};
+
+// Collects the OpenCL events of the commands enqueued while profiling, and
+// the spans of the layers running on the host. Device times are moved onto
+// the host clock by the smallest offset between the enqueue time seen by
+// the host and the QUEUED timestamp, so both appear on one timeline.
+class Profiler {
+ public:
+  Profiler();
+  virtual ~Profiler();
+
+  // Disable copy.
+  Profiler(const Profiler &) = delete;
+  Profiler(Profiler &&) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+  Profiler &operator=(Profiler &&) = delete;
+
+  // Commands added between these belong to the layer.
+  void BeginLayer(int layer, const std::string &name);
+  void EndLayer();
+
+  // Track an enqueued command. The profiler retains the event.
+  void AddCommand(const char *name, ProfileKind kind, cl_event event);
+  void AddHostSpan(const char *name, std::int64_t start, std::int64_t end);
+  // Monotonic host time in ns.
+  static std::int64_t GetHostTime();
+
+  // Wait for the tracked commands and read their timestamps.
+  void Collect();
+  // Drop all records, e.g. between frames.
+  void Clear();
+
+  const std::vector<ProfileRecord> &GetRecords() const;
+  // Offset to add to device timestamps to get host time.
+  std::int64_t GetClockOffset() const;
+
+  // Per-layer kernel, transfer, host and queue-wait time, plus the host gap
+  // before each layer started.
+  void PrintLayerTable(std::ostream &os) const;
+  // Chrome trace_event JSON, for chrome://tracing or Perfetto.
+  void WriteChromeTrace(const std::string &path) const;
+
+ private:
+  std::vector<ProfileRecord> records_;
+  std::size_t num_collected_;
+  int layer_;
+  std::map<int, std::string> layer_names_;
+
+  void ReleaseEvents();
+};
+
+// The event argument of a profiled enqueue. Get returns the caller's event,
+// or a local one when only the profiler needs it; Commit hands the event to
+// the profiler once the enqueue succeeded. Without a profiler this passes
+// the caller's event through.
+class ProfileEvent {
+ public:
+  ProfileEvent(Profiler *profiler, const char *name, ProfileKind kind,
+               cl_event *event = nullptr);
+
+  cl_event *Get();
+  void Commit(cl_int status);
+
+ private:
+  Profiler *profiler_;
+  const char *name_;
+  ProfileKind kind_;
+  cl_event *event_;
+  cl_event local_event_;
+};
+
+#endif  // HOST_INCLUDE_PROFILER_H_
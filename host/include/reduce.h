@@ -0,0 +1,59 @@
+#ifndef HOST_INCLUDE_REDUCE_H_
+#define HOST_INCLUDE_REDUCE_H_
+
+#include <vector>
+
+#include "thread_pool.h"
+
+// Values match the REDUCE_ macros of device/reduce.h.
+enum class Reduction {
+  kSum = 0,
+  kMax = 1,
+  kMin = 2,
+  kMean = 3,
+  // Population variance.
+  kVariance = 4,
+};
+
+// A tensor seen as [outer, reduce, inner] for a reduction over the axes
+// [axis, axis + num_axes) of shape.
+struct ReduceLayout {
+  int outer;
+  int reduce;
+  int inner;
+};
+
+ReduceLayout GetReduceLayout(const std::vector<int> &shape,
+                             int axis,
+                             int num_axes = 1);
+
+// shape with the reduced axes kept, as 1.
+std::vector<int> GetReduceShape(const std::vector<int> &shape,
+                                int axis,
+                                int num_axes = 1);
+
+void RunReduceRef(const float *in_data,
+                  float *out_data,
+                  const std::vector<int> &shape,
+                  int axis,
+                  int num_axes,
+                  Reduction reduction);
+
+void RunReduceRef(const std::vector<float> &in_data,
+                  std::vector<float> &out_data,
+                  const std::vector<int> &shape,
+                  int axis,
+                  int num_axes,
+                  Reduction reduction);
+
+// Same as RunReduceRef in float, the outputs split over the pool (the
+// default pool if null).
+void RunReduceCpu(const float *in_data,
+                  float *out_data,
+                  const std::vector<int> &shape,
+                  int axis,
+                  int num_axes,
+                  Reduction reduction,
+                  ThreadPool *pool = nullptr);
+
+#endif  // HOST_INCLUDE_REDUCE_H_
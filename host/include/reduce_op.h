@@ -0,0 +1,84 @@
+#ifndef HOST_INCLUDE_REDUCE_OP_H_
+#define HOST_INCLUDE_REDUCE_OP_H_
+
+#include <CL/cl.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "execution_plan.h"
+#include "profiler.h"
+#include "reduce.h"
+
+// Reduction over adjacent axes of a tensor on the device, any size. Short
+// outputs of long rows are split into chunks reduced in parallel, then
+// further passes reduce the partial states of the chunks, in scratch.
+class ReduceOp {
+ public:
+  ReduceOp(Reduction reduction, cl_kernel *kernel,
+           cl_command_queue *command_queue, cl_mem *in_buf = nullptr,
+           cl_mem *out_buf = nullptr, cl_mem *scratch_buf = nullptr);
+
+  // Offsets are in elements of the buffer: floats, or states.
+  void SetInBuffer(cl_mem *buf, int offset = 0);
+  void SetOutBuffer(cl_mem *buf, int offset = 0);
+  // Strides of the outer and the reduced dimension of the input, in
+  // elements, for a strided view such as the interior of a tensor with a
+  // halo; the inner dimension stays contiguous. Zero for the strides of a
+  // dense shape, the default.
+  void SetInStrides(int outer_stride, int reduce_stride);
+  // GetScratchSize bytes, for the partial states.
+  void SetScratchBuffer(cl_mem *buf);
+  // Whether the input and the output hold the float4 states of
+  // device/reduce.h instead of values. Reductions over axes that are not
+  // adjacent run as several, passing states between them.
+  void SetStates(bool in_states, bool out_states);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+
+  static std::size_t GetScratchSize(const std::vector<int> &shape, int axis,
+                                    int num_axes = 1);
+
+  // Reduce the axes [axis, axis + num_axes) of shape.
+  void Run(const std::vector<int> &shape, int axis, int num_axes,
+           bool blocking);
+  void Run(const std::vector<int> &shape, int axis, int num_axes,
+           bool blocking, float *out_data);
+
+ private:
+  // A launch: the rows are split into chunks of chunk_size, and a
+  // work-group is tile columns by lanes.
+  struct Pass {
+    ReduceLayout layout;
+    int chunks;
+    int chunk_size;
+    int tile;
+    int lanes;
+  };
+
+  Reduction reduction_;
+  bool in_states_;
+  bool out_states_;
+
+  cl_kernel *kernel_;
+  cl_command_queue *command_queue_;
+
+  cl_mem *in_buf_;
+  cl_mem *out_buf_;
+  cl_mem *scratch_buf_;
+  int in_offset_;
+  int out_offset_;
+  int in_outer_stride_;
+  int in_reduce_stride_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
+
+  static std::vector<Pass> Plan(ReduceLayout layout);
+  // States in each of the two scratch regions the passes alternate between.
+  static int GetRegionSize(const std::vector<Pass> &passes);
+};
+
+#endif  // HOST_INCLUDE_REDUCE_OP_H_
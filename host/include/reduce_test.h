@@ -0,0 +1,31 @@
+#ifndef HOST_INCLUDE_REDUCE_TEST_H_
+#define HOST_INCLUDE_REDUCE_TEST_H_
+
+#include <vector>
+
+#include "cl_operators.h"
+#include "cpu_operators.h"
+#include "reduce.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+// RunReduceRef against values worked out by hand.
+void RunReduceRefUnitTest();
+
+// A reduction of random data on the device and the host engine, compared
+// with RunReduceRef.
+void RunReduceUnitTest(Workspace &ws,
+                       const std::vector<int> &shape,
+                       int axis,
+                       int num_axes,
+                       Reduction reduction);
+
+// The batch norm operators, whose device statistics come from Reduce,
+// compared with RunBatchNormRef.
+void RunBatchNormReduceUnitTest(Workspace &ws,
+                                const std::vector<int> &shape,
+                                BatchNormStats stats);
+
+void RunReduceTests(Workspace &ws);
+
+#endif  // HOST_INCLUDE_REDUCE_TEST_H_
@@ -0,0 +1,38 @@
+#ifndef HOST_INCLUDE_ROOFLINE_H_
+#define HOST_INCLUDE_ROOFLINE_H_
+
+#include <ostream>
+
+#include "network.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include "workspace.h"
+
+// Peak throughput of a backend, in GFLOP/s and GB/s.
+struct RooflinePeaks {
+  double gflops;
+  double bandwidth;
+};
+
+// Calibration microbenchmarks, taking the best of a few runs. The device
+// runs the kernels of roofline.cl; the host runs RunSgemm and a parallel
+// copy, so its peak is the best the host engine reaches rather than the
+// theoretical one.
+RooflinePeaks MeasureDevicePeaks(Workspace &ws);
+RooflinePeaks MeasureCpuPeaks(ThreadPool *pool = nullptr);
+
+// Per-layer roofline of the network runs recorded by profiler: the work
+// and minimum traffic of each operator against its kernel or host time,
+// as achieved GFLOP/s and GB/s, percent of the backend peaks, and whether
+// the arithmetic intensity puts the layer under the memory or the compute
+// roof. Transfers between layers are not counted in the layer time. Layers
+// whose tensors stay in cache can beat the bandwidth peak, which is
+// measured on buffers far larger than the caches.
+void PrintRooflineReport(std::ostream &os,
+                         Network &network,
+                         const Profiler &profiler,
+                         const RooflinePeaks &device_peaks,
+                         const RooflinePeaks &cpu_peaks,
+                         int num_runs = 1);
+
+#endif  // HOST_INCLUDE_ROOFLINE_H_
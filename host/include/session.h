@@ -0,0 +1,61 @@
+#ifndef HOST_INCLUDE_SESSION_H_
+#define HOST_INCLUDE_SESSION_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "network.h"
+#include "workspace.h"
+
+// A prepared network that any number of threads may run. A run needs an
+// execution context of its own: the network's tensors, its kernels and its
+// command queue belong to one run at a time. The session starts with the
+// network as its only context, so runs are serialized; with more contexts,
+// clones of the network on child workspaces of its workspace serve that
+// many runs at once, sharing the parameters.
+class InferenceSession {
+ public:
+  InferenceSession(std::unique_ptr<Network> network,
+                   const std::vector<int> &in_shape,
+                   int num_contexts = 1);
+  virtual ~InferenceSession();
+
+  // Disable copy.
+  InferenceSession(const InferenceSession &) = delete;
+  InferenceSession(InferenceSession &&) = delete;
+  InferenceSession &operator=(const InferenceSession &) = delete;
+  InferenceSession &operator=(InferenceSession &&) = delete;
+
+  // Copy in_data in, run and copy the result out. Thread-safe; waits for a
+  // free context.
+  void Run(const std::vector<float> &in_data, std::vector<float> &out_data);
+
+  int GetNumContexts() const;
+
+  const std::vector<int> &GetInShape() const;
+  const std::vector<int> &GetOutShape() const;
+  // Floats per input and output.
+  std::size_t GetInSize() const;
+  std::size_t GetOutSize() const;
+
+ private:
+  struct Context {
+    // Null for the first context, which runs on the network's workspace.
+    std::unique_ptr<Workspace> ws;
+    std::unique_ptr<Network> network;
+  };
+
+  std::vector<int> in_shape_;
+  std::vector<Context> contexts_;
+  // Indices of the contexts not running.
+  std::vector<int> free_contexts_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  int AcquireContext();
+  void ReleaseContext(int idx);
+};
+
+#endif  // HOST_INCLUDE_SESSION_H_
@@ -0,0 +1,32 @@
+#ifndef HOST_INCLUDE_SOFTMAX_H_
+#define HOST_INCLUDE_SOFTMAX_H_
+
+#include <vector>
+
+#include "thread_pool.h"
+
+// Softmax over the classes of every image of the batch, in place. The
+// maximum is subtracted first, so large logits don't overflow.
+void RunSoftmaxRef(float *tensor, int batch, int classes);
+
+void RunSoftmaxRef(std::vector<float> &tensor, int batch, int classes);
+
+// Same as RunSoftmaxRef, the images split over the pool (the default pool
+// if null).
+void RunSoftmaxCpu(float *tensor,
+                   int batch,
+                   int classes,
+                   ThreadPool *pool = nullptr);
+
+// The k best scores of every image of the batch and their class ids, best
+// first, ties to the lower id: batch * k of each. With softmax the scores
+// are the softmax probabilities of the logits in in_data.
+void RunTopKRef(const float *in_data,
+                int batch,
+                int classes,
+                int k,
+                bool softmax,
+                float *scores,
+                int *ids);
+
+#endif  // HOST_INCLUDE_SOFTMAX_H_
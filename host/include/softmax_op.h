@@ -0,0 +1,76 @@
+#ifndef HOST_INCLUDE_SOFTMAX_OP_H_
+#define HOST_INCLUDE_SOFTMAX_OP_H_
+
+#include <CL/cl.h>
+
+#include <vector>
+
+#include "execution_plan.h"
+#include "profiler.h"
+
+// Softmax in place over the classes of each image: every dimension but the
+// batch.
+class SoftmaxOp {
+ public:
+  SoftmaxOp(cl_kernel *kernel, cl_command_queue *command_queue,
+            cl_mem *tensor_buf = nullptr);
+
+  void SetTensorBuffer(cl_mem *buf);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+
+  void Run(const std::vector<int> &shape, bool blocking);
+  void Run(const std::vector<int> &shape, bool blocking, float *out_data);
+
+ private:
+  cl_kernel *kernel_;
+  cl_command_queue *command_queue_;
+
+  cl_mem *tensor_buf_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
+};
+
+// The k best scores of each image and their class ids, best first, into
+// batch * k floats and ints. With softmax the scores are probabilities.
+class TopKOp {
+ public:
+  // Largest k the kernel supports.
+  static const int kMaxK = 16;
+
+  TopKOp(int k, bool softmax, cl_kernel *kernel,
+         cl_command_queue *command_queue, cl_mem *in_buf = nullptr,
+         cl_mem *scores_buf = nullptr, cl_mem *ids_buf = nullptr);
+
+  void SetInBuffer(cl_mem *buf);
+  void SetScoresBuffer(cl_mem *buf);
+  void SetIdsBuffer(cl_mem *buf);
+  // Record launches into the plan while it is recording.
+  void SetExecutionPlan(ExecutionPlan *plan);
+  // Track the enqueued commands, e.g. Workspace::GetProfiler().
+  void SetProfiler(Profiler *profiler);
+
+  void Run(const std::vector<int> &shape, bool blocking);
+  // Reads back only the batch * k pairs.
+  void Run(const std::vector<int> &shape, bool blocking, float *scores,
+           int *ids);
+
+ private:
+  int k_;
+  bool softmax_;
+
+  cl_kernel *kernel_;
+  cl_command_queue *command_queue_;
+
+  cl_mem *in_buf_;
+  cl_mem *scores_buf_;
+  cl_mem *ids_buf_;
+
+  ExecutionPlan *plan_;
+  Profiler *profiler_;
+};
+
+#endif  // HOST_INCLUDE_SOFTMAX_OP_H_
@@ -0,0 +1,25 @@
+#ifndef HOST_INCLUDE_SOFTMAX_TEST_H_
+#define HOST_INCLUDE_SOFTMAX_TEST_H_
+
+#include "cl_operators.h"
+#include "cpu_operators.h"
+#include "softmax.h"
+#include "test_utils.h"
+#include "topk.h"
+#include "workspace.h"
+
+// Softmax of batch random rows on the device and the host engine, compared
+// with RunSoftmaxRef. Large logits check the stability.
+void RunSoftmaxUnitTest(Workspace &ws, int batch, int classes);
+
+// TopKReader compared with RunTopKRef, and the reference compared with a
+// full softmax.
+void RunTopKUnitTest(Workspace &ws,
+                     int batch,
+                     int classes,
+                     int k,
+                     bool softmax);
+
+void RunSoftmaxTests(Workspace &ws);
+
+#endif  // HOST_INCLUDE_SOFTMAX_TEST_H_
@@ -0,0 +1,100 @@
+#ifndef HOST_INCLUDE_STREAM_RUNNER_H_
+#define HOST_INCLUDE_STREAM_RUNNER_H_
+
+#include <CL/cl.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "network.h"
+#include "workspace.h"
+
+// Runs a stream of frames through a network with the transfers overlapped
+// with the compute. Frames go through a ring of depth slots, each with a
+// pinned host staging buffer and a device buffer for the input and the
+// output. Uploads and readbacks run on two queues from the workspace pool,
+// the network on the workspace queue, and events order the three stages of
+// a frame, so frame i + 1 uploads while frame i computes and frame i - 1
+// is read back.
+//
+// The network runs one frame at a time, so its tensors are shared by the
+// slots: the compute queue copies the slot input into the network input
+// and the network output into the slot output. The first and the last
+// operators must run on the device; host operators in between stall the
+// compute queue while they run.
+class StreamRunner {
+ public:
+  // network must be prepared, on a workspace.
+  explicit StreamRunner(Network &network, int depth = 3);
+  // Waits for the frames in flight.
+  virtual ~StreamRunner();
+
+  // Disable copy.
+  StreamRunner(const StreamRunner &) = delete;
+  StreamRunner(StreamRunner &&) = delete;
+  StreamRunner &operator=(const StreamRunner &) = delete;
+  StreamRunner &operator=(StreamRunner &&) = delete;
+
+  int GetDepth() const;
+  int GetNumInFlight() const;
+  bool IsFull() const;
+  bool IsEmpty() const;
+  // Floats per frame and per result.
+  std::size_t GetInSize() const;
+  std::size_t GetOutSize() const;
+
+  // Enqueue the upload, compute and readback of a frame of GetInSize()
+  // floats and return without waiting. Throws if all slots are in flight.
+  void Push(const float *frame);
+  void Push(const std::vector<float> &frame);
+  // Wait for the oldest frame in flight, copy its result out and return its
+  // index in the stream.
+  std::int64_t Pop(std::vector<float> &out_data);
+
+  // Run num_frames frames, keeping depth of them in flight: fill(i, data)
+  // writes frame i into the staging buffer and done(i, result) gets its
+  // result, in order.
+  void Run(std::int64_t num_frames,
+           const std::function<void(std::int64_t, float *)> &fill,
+           const std::function<void(std::int64_t, const float *)> &done);
+
+ private:
+  struct Slot {
+    // Device buffers.
+    cl_mem in_buf;
+    cl_mem out_buf;
+    // Pinned host staging, mapped for the lifetime of the runner.
+    cl_mem in_staging;
+    cl_mem out_staging;
+    float *in_host;
+    float *out_host;
+    // Completion of the stages of the frame in the slot.
+    cl_event upload;
+    cl_event compute;
+    cl_event readback;
+    std::int64_t frame;
+  };
+
+  Network *network_;
+  Workspace *ws_;
+  cl_command_queue upload_queue_;
+  cl_command_queue readback_queue_;
+  std::size_t in_size_;
+  std::size_t out_size_;
+  std::vector<Slot> slots_;
+  // Oldest slot in flight and the number in flight.
+  int head_;
+  int num_in_flight_;
+  std::int64_t next_frame_;
+
+  // Enqueue the stages of the frame already in the staging buffer of the
+  // next free slot.
+  void Enqueue();
+  // Wait for the oldest slot and free it; the result stays in its staging
+  // buffer until the slot is reused.
+  Slot &WaitOldest();
+  static void ReleaseEvent(cl_event *event);
+};
+
+#endif  // HOST_INCLUDE_STREAM_RUNNER_H_
@@ -0,0 +1,21 @@
+#ifndef HOST_INCLUDE_STREAM_RUNNER_TEST_H_
+#define HOST_INCLUDE_STREAM_RUNNER_TEST_H_
+
+#include "model.h"
+#include "network.h"
+#include "stream_runner.h"
+#include "test_utils.h"
+#include "workspace.h"
+
+// Stream num_frames frames through the RunModel network on the device and
+// compare every result with the frame run on its own.
+void RunStreamRunnerUnitTest(Workspace &ws,
+                             const int in_height,
+                             const int in_width,
+                             int depth,
+                             int num_frames,
+                             bool enable_timing = false);
+
+void RunStreamRunnerTests(Workspace &ws, bool enable_timing = false);
+
+#endif  // HOST_INCLUDE_STREAM_RUNNER_TEST_H_
@@ -7,21 +7,41 @@
 #include <string>
 #include <vector>
 
+#include "kernel.h"
+#include "tensor_allocator.h"
 #include "workspace.h"
 
+// A tensor with kHost backing and a device buffer from the constructor is
+// device-only: its host storage is allocated on the first host access.
+//
+// A 4D tensor may keep a halo, a zero border of halo pixels around each of
+// its height x width planes, so that a conv padding by halo reads it with no
+// bounds checks. The storage is then of GetStorageShape, and GetSize,
+// element access, GetData and the device buffer cover it all; writers fill
+// the interior only.
 class Tensor {
  public:
   Tensor(const std::vector<int> &shape, bool allocate_device = false,
-         Workspace *ws = nullptr);
+         Workspace *ws = nullptr, TensorBacking backing = TensorBacking::kAuto,
+         int halo = 0);
   Tensor(const std::vector<int> &shape, std::ifstream &is,
-         bool allocate_device = false, Workspace *ws = nullptr);
+         bool allocate_device = false, Workspace *ws = nullptr,
+         TensorBacking backing = TensorBacking::kAuto);
   virtual ~Tensor();
 
-  // Disable copy.
+  // Disable copy. Moving keeps the device buffer handle, but not the address
+  // of the handle returned by GetDeviceData.
   Tensor(const Tensor &) = delete;
-  Tensor(Tensor &&) = delete;
+  Tensor(Tensor &&other);
   Tensor &operator=(const Tensor &) = delete;
-  Tensor &operator=(Tensor &&) = delete;
+  Tensor &operator=(Tensor &&other);
+
+  const std::vector<int> &GetShape() const;
+  // Elements of the storage, halo included.
+  int GetSize() const;
+  int GetHalo() const;
+  // The shape with the height and width grown by the halo on both sides.
+  std::vector<int> GetStorageShape() const;
 
   // Element access.
   float &Get(const std::vector<int> &coord);
@@ -31,9 +51,11 @@ class Tensor {
   float &operator[](int idx);
   const float &operator[](int idx) const;
 
-  // Host data access.
-  std::vector<float> &GetData();
-  const std::vector<float> &GetData() const;
+  // Host data access. Stale host data is fetched from the device first, and
+  // mutable access marks the touched elements dirty. Zero-copy and
+  // coarse-grained SVM tensors are mapped instead.
+  TensorData &GetData();
+  const TensorData &GetData() const;
 
   // Allocate device buffer.
   void AllocateDevice(Workspace &ws, bool copy_host = true,
@@ -41,21 +63,45 @@ class Tensor {
                       cl_uint num_events_in_wait_list = 0,
                       const cl_event *event_wait_list = nullptr,
                       cl_event *event = nullptr);
-  // Push host data to device.
+  // Push host data to device. Only the dirty range is sent and nothing is
+  // sent if the device is up to date. Zero-copy and SVM tensors are only
+  // unmapped.
   void PushToDevice(Workspace &ws, cl_bool blocking = CL_FALSE,
                     cl_uint num_events_in_wait_list = 0,
                     const cl_event *event_wait_list = nullptr,
                     cl_event *event = nullptr);
-  // Pop device data to host.
+  // Pop device data to host if the host copy is stale. Zero-copy and SVM
+  // tensors are only mapped.
   void PopToHost(Workspace &ws, cl_bool blocking = CL_FALSE,
                  cl_uint num_events_in_wait_list = 0,
                  const cl_event *event_wait_list = nullptr,
                  cl_event *event = nullptr);
 
-  // Device data access.
+  // Hand a mapped tensor back to the device before kernels use it. No-op
+  // for tensors that are not mapped.
+  void UnmapHost();
+
+  // Device data access. Dirty host data is pushed first. The mutable
+  // overload assumes the device will write the buffer and marks the host
+  // copy stale; the const one is for kernels that only read it.
   cl_mem &GetDeviceData();
   const cl_mem &GetDeviceData() const;
 
+  // Coherence state. Code that writes the device buffer through a handle
+  // kept from an earlier GetDeviceData must call MarkDeviceDirty afterwards.
+  void MarkHostDirty(int offset, int count);
+  void MarkDeviceDirty();
+  bool IsHostValid() const;
+  bool IsDeviceValid() const;
+
+  // Argument binding the tensor to a kernel: the SVM pointer for SVM
+  // tensors, the device buffer otherwise.
+  KernelArg GetKernelArg();
+
+  bool HasHostData() const;
+  bool IsZeroCopy() const;
+  TensorBacking GetBacking() const;
+
   // Read data from file.
   void ReadFile(std::ifstream &is, std::size_t size, bool to_device = false,
                 Workspace *ws = nullptr, cl_bool blocking = CL_FALSE,
@@ -68,11 +114,45 @@ class Tensor {
 
  private:
   std::vector<int> shape_;
+  int halo_;
   int size_;
-  std::vector<float> data_;
+  Workspace *ws_;
+  TensorBacking backing_;
+  bool svm_fine_grain_;
+  mutable TensorData data_;
+  mutable bool host_allocated_;
   bool has_device_data_;
   cl_mem device_data_;
+
+  // Coherence state of a kHost tensor with device data: whether the host
+  // copy is current, and the element range [begin, end) written on the host
+  // since the last push. An empty range means the device is current.
+  mutable bool host_valid_;
+  mutable int dirty_begin_;
+  mutable int dirty_end_;
+
+  // Map state of a zero-copy or coarse-grained SVM tensor. A read-only
+  // mapping leaves the device copy clean, so it is upgraded only when the
+  // host writes.
+  mutable bool mapped_;
+  mutable cl_map_flags map_flags_;
+
+  static TensorBacking ResolveBacking(TensorBacking backing, Workspace *ws);
+  TensorAllocator<float> GetAllocator() const;
+  void InitStorage();
+  void AllocateHost() const;
+  void ReleaseStorage();
+  void Detach();
+  void CreateDeviceBuffer(Workspace &ws, bool copy_host);
+  void MapHost(cl_map_flags flags, cl_bool blocking = CL_TRUE,
+               cl_uint num_events_in_wait_list = 0,
+               const cl_event *event_wait_list = nullptr,
+               cl_event *event = nullptr) const;
+  void UnmapHost(cl_uint num_events_in_wait_list,
+                 const cl_event *event_wait_list, cl_event *event) const;
+  void AccessHost(bool write, int begin, int end) const;
+  void AccessDevice() const;
+  void ExtendDirtyRange(int begin, int end) const;
 };
 
 #endif  // HOST_INCLUDE_TENSOR_H_
-
@@ -0,0 +1,112 @@
+#ifndef HOST_INCLUDE_TENSOR_ALLOCATOR_H_
+#define HOST_INCLUDE_TENSOR_ALLOCATOR_H_
+
+#include <CL/cl.h>
+
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// How the device buffer of a tensor relates to its host storage.
+enum class TensorBacking {
+  // The workspace default: zero-copy if the device has unified memory,
+  // otherwise kHost.
+  kAuto,
+  // Separate device buffer, data moves with explicit copies.
+  kHost,
+  // Device buffer wraps the host storage; host access maps the buffer.
+  kZeroCopy,
+  // Storage is shared virtual memory, used in place by host and device.
+  kSvm
+};
+
+// Page-aligned allocator for tensor host storage. Page alignment, with the
+// allocation rounded up to whole pages, lets the storage back a zero-copy
+// device buffer created with CL_MEM_USE_HOST_PTR. Given a context, the
+// storage is allocated as shared virtual memory instead.
+template <typename T>
+class TensorAllocator {
+ public:
+  typedef T value_type;
+  // A device buffer may wrap the storage, so moving a tensor must hand over
+  // the storage itself rather than copy it into a new allocation.
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  static const std::size_t kAlignment = 4096;
+
+  TensorAllocator() : context_(nullptr), svm_flags_(0) {}
+  TensorAllocator(cl_context context, cl_mem_flags svm_flags)
+      : context_(context), svm_flags_(svm_flags) {}
+  template <typename U>
+  TensorAllocator(const TensorAllocator<U> &other)
+      : context_(other.GetContext()), svm_flags_(other.GetSvmFlags()) {}
+
+  T *allocate(std::size_t n) {
+    std::size_t raw_size = n * sizeof(T);
+    raw_size = (raw_size + kAlignment - 1) / kAlignment * kAlignment;
+    void *ptr = nullptr;
+    if (context_ != nullptr) {
+#ifdef CL_VERSION_2_0
+      ptr = clSVMAlloc(context_, CL_MEM_READ_WRITE | svm_flags_, raw_size,
+                       kAlignment);
+#endif
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+    } else if (posix_memalign(&ptr, kAlignment, raw_size) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T *>(ptr);
+  }
+
+  void deallocate(T *ptr, std::size_t) {
+    if (context_ != nullptr) {
+#ifdef CL_VERSION_2_0
+      clSVMFree(context_, ptr);
+#endif
+    } else {
+      free(ptr);
+    }
+  }
+
+  // Elements are default-initialized, so resizing storage that is about to
+  // be overwritten doesn't zero it first.
+  template <typename U>
+  void construct(U *ptr) {
+    ::new (static_cast<void *>(ptr)) U;
+  }
+  template <typename U, typename... Args>
+  void construct(U *ptr, Args &&... args) {
+    ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+  }
+
+  cl_context GetContext() const {
+    return context_;
+  }
+
+  cl_mem_flags GetSvmFlags() const {
+    return svm_flags_;
+  }
+
+ private:
+  cl_context context_;
+  cl_mem_flags svm_flags_;
+};
+
+template <typename T, typename U>
+bool operator==(const TensorAllocator<T> &a, const TensorAllocator<U> &b) {
+  return (a.GetContext() == b.GetContext()) &&
+         (a.GetSvmFlags() == b.GetSvmFlags());
+}
+
+template <typename T, typename U>
+bool operator!=(const TensorAllocator<T> &a, const TensorAllocator<U> &b) {
+  return !(a == b);
+}
+
+typedef std::vector<float, TensorAllocator<float>> TensorData;
+
+#endif  // HOST_INCLUDE_TENSOR_ALLOCATOR_H_
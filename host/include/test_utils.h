@@ -9,10 +9,38 @@
 #include <iostream>
 #include <numeric>
 #include <ratio>
+#include <vector>
+
+#include "operator.h"
+#include "workspace.h"
 
 void CheckResult(float *expected, float *result, size_t size,
                  bool display_errors = false, float rel_err = 1e-3f);
 
+// Largest absolute difference, for callers that report rather than print.
+float GetMaxError(const float *expected, const float *result, size_t size);
+
+// Prints "Found N errors", or that the result is consistent when there are
+// none, as CheckResult does.
+void PrintResult(int num_errors);
+
+// Prints shape as [d0, d1, ...], with no newline.
+void PrintShape(const std::vector<int> &shape);
+
+// Number of values further than abs_err from expected.
+int CountErrors(const float *expected, const float *result, size_t size,
+                float abs_err = 1e-3f);
+
+// Runs op on in_data of shape, on the device for OpenCL operators, and
+// counts the output values further than tolerance from ref, relative to the
+// magnitude of ref when that is above 1.
+int CheckOperator(Workspace &ws,
+                  Operator &op,
+                  const std::vector<int> &shape,
+                  const std::vector<float> &in_data,
+                  const std::vector<float> &ref,
+                  float tolerance = 1e-3f);
+
 void CheckSimilarity(float *expected, float *result, size_t size,
                      bool display = false, float abs_err = 1e-2f);
 
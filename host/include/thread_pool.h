@@ -0,0 +1,89 @@
+#ifndef HOST_INCLUDE_THREAD_POOL_H_
+#define HOST_INCLUDE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPUs this process may run on, grouped by NUMA node as listed in sysfs.
+// Without NUMA information all allowed CPUs form a single node.
+std::vector<std::vector<int>> GetNumaNodeCpus();
+
+// Work-stealing pool of threads for data-parallel host loops. The calling
+// thread takes part in the work, so a pool of N threads runs N - 1 workers.
+//
+// A loop is split into contiguous per-thread ranges, so neighbouring
+// chunks run on the same thread and, with pinning, on the same NUMA node.
+// A thread that runs out of work steals the upper half of the range of
+// another one.
+class ThreadPool {
+ public:
+  // Zero threads means one per CPU the process may run on. Pinned workers
+  // are bound to one CPU each, filling a NUMA node before the next one;
+  // the calling thread is left as is.
+  explicit ThreadPool(int num_threads = 0, bool pin_threads = true);
+  virtual ~ThreadPool();
+
+  // Disable copy.
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+
+  int GetNumThreads() const;
+  // CPU a thread is pinned to, or -1. Thread 0 is the calling thread.
+  int GetThreadCpu(int thread) const;
+
+  // Split [0, n) into chunks of grain items and call fn(begin, end) on each
+  // chunk in parallel. Returns once all chunks are done and rethrows the
+  // first exception thrown by fn. Calls made from inside fn run serially.
+  void ParallelFor(int n, int grain, const std::function<void(int, int)> &fn);
+
+  // Fill data with value, split like a ParallelFor over the same range.
+  // Done on fresh memory, this places each page on the NUMA node of the
+  // thread that later processes it (first-touch).
+  void ParallelFill(float *data, std::size_t size, float value);
+
+  // Pool shared by the host ops.
+  static ThreadPool &GetDefault();
+
+ private:
+  // Range [begin, end) of chunks left to a thread, packed into one word so
+  // the owner and thieves can update it with a single CAS. Padded to a
+  // cache line so threads don't share one.
+  struct WorkRange {
+    std::atomic<std::uint64_t> range;
+    char padding[64 - sizeof(std::atomic<std::uint64_t>)];
+  };
+
+  std::vector<std::thread> workers_;
+  std::vector<int> thread_cpus_;
+  std::vector<WorkRange> ranges_;
+  // Serializes callers, since the pool runs one loop at a time.
+  std::mutex call_mutex_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stop_;
+  std::uint64_t generation_;
+  int active_workers_;
+
+  // The loop being run.
+  const std::function<void(int, int)> *fn_;
+  int n_;
+  int grain_;
+  std::exception_ptr error_;
+
+  void WorkerLoop(int thread);
+  void RunChunks(int thread);
+  bool TakeChunk(int thread, int *chunk);
+  bool StealRange(int thread);
+};
+
+#endif  // HOST_INCLUDE_THREAD_POOL_H_
@@ -0,0 +1,12 @@
+#ifndef HOST_INCLUDE_THREAD_POOL_TEST_H_
+#define HOST_INCLUDE_THREAD_POOL_TEST_H_
+
+#include "thread_pool.h"
+
+// Run a skewed loop, where most of the work sits in the first thread's
+// range, and check every chunk runs exactly once.
+void RunThreadPoolUnitTest(int num_threads, int n, int grain);
+
+void RunThreadPoolTests();
+
+#endif  // HOST_INCLUDE_THREAD_POOL_TEST_H_
@@ -0,0 +1,61 @@
+#ifndef HOST_INCLUDE_TOPK_H_
+#define HOST_INCLUDE_TOPK_H_
+
+#include <CL/cl.h>
+
+#include <vector>
+
+#include "network.h"
+#include "softmax_op.h"
+#include "tensor.h"
+#include "workspace.h"
+
+// A class of an image and its score.
+struct Prediction {
+  int id;
+  float score;
+};
+
+// Reads the k best classes of each image of a device tensor, e.g. the
+// logits of a classifier head. The selection, and the softmax, run on the
+// device, so only batch * k pairs cross the bus instead of the whole
+// tensor, and the host has nothing left to sort.
+class TopKReader {
+ public:
+  // k up to TopKOp::kMaxK. With softmax the scores are the probabilities of
+  // the logits, otherwise the values in the tensor.
+  TopKReader(Workspace &ws, int k, bool softmax = true);
+  virtual ~TopKReader();
+
+  // Disable copy.
+  TopKReader(const TopKReader &) = delete;
+  TopKReader(TopKReader &&) = delete;
+  TopKReader &operator=(const TopKReader &) = delete;
+  TopKReader &operator=(TopKReader &&) = delete;
+
+  int GetK() const;
+
+  // The k best classes of each image of tensor, best first, ties to the
+  // lower id. Waits for the result.
+  std::vector<std::vector<Prediction>> Run(Tensor &tensor);
+  // Of the output of network, once run; its last operator must run on the
+  // device.
+  std::vector<std::vector<Prediction>> Run(Network &network);
+
+ private:
+  Workspace *ws_;
+  int k_;
+  cl_kernel kernel_;
+  cl_command_queue command_queue_;
+  cl_mem in_buf_;
+  cl_mem scores_buf_;
+  cl_mem ids_buf_;
+  // Images the result buffers hold.
+  int capacity_;
+  TopKOp op_;
+
+  // Select on the device data of tensor.
+  std::vector<std::vector<Prediction>> Select(const Tensor &tensor);
+};
+
+#endif  // HOST_INCLUDE_TOPK_H_
@@ -3,14 +3,27 @@
 
 #include <CL/cl.h>
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "kernel.h"
+#include "profiler.h"
+#include "tensor_allocator.h"
 
 class Workspace {
  public:
-  Workspace(const std::string &platform_name);
+  // With enable_profiling the queue records timestamps and every command
+  // enqueued by the ops and tensors is tracked by GetProfiler().
+  Workspace(const std::string &platform_name, bool enable_profiling = false);
+  // A workspace for another thread, on the device and context of parent:
+  // it has its own instances of the kernels and a command queue from the
+  // parent's pool, so it runs concurrently with the parent and its other
+  // children. Buffers are shared. Children don't profile; parent must
+  // outlive them.
+  explicit Workspace(Workspace &parent);
   virtual ~Workspace();
 
   cl_platform_id GetPlatformID();
@@ -25,22 +38,62 @@ class Workspace {
   cl_command_queue &GetCommandQueue();
   const cl_command_queue &GetCommandQueue() const;
   void FinishCommandQueue();
+  // Extra command queues, e.g. for child workspaces. Queues are created on
+  // demand and reused once released. Thread-safe.
+  cl_command_queue AcquireCommandQueue();
+  void ReleaseCommandQueue(cl_command_queue command_queue);
+
+  // Null unless profiling is enabled.
+  Profiler *GetProfiler();
+
+  // Whether the device shares physical memory with the host.
+  bool HasUnifiedMemory() const;
+
+  // Shared virtual memory support (OpenCL 2.0).
+  bool SupportsSvm() const;
+  bool SupportsFineGrainSvm() const;
+  // Allocate SVM usable by host and device without transfers. Fine-grained
+  // when the device supports it, coarse-grained otherwise.
+  void *SvmAlloc(std::size_t size) const;
+  void SvmFree(void *ptr) const;
+
+  // Backing used by tensors created with TensorBacking::kAuto.
+  void SetDefaultBacking(TensorBacking backing);
+  TensorBacking GetDefaultBacking() const;
 
   Kernel CreateKernel(const char *program_handle, const char *kernel_name,
                       bool binary = false) const;
+  // Kernel shared by everything using this workspace, built on first use,
+  // or cloned from the parent's. The reference stays valid for the lifetime
+  // of the workspace. Arguments are not preserved between users, so each
+  // launch must set all of them. Thread-safe, but the kernel itself is not:
+  // threads running at once need workspaces of their own.
+  cl_kernel &GetKernel(const char *program_handle, const char *kernel_name);
 
  private:
+  Workspace *parent_;
   cl_platform_id platform_;
   cl_device_id device_;
   cl_context context_;
   cl_command_queue command_queue_;
+  bool unified_memory_;
+  cl_bitfield svm_capabilities_;
+  TensorBacking default_backing_;
+  bool enable_profiling_;
+  std::unique_ptr<Profiler> profiler_;
 
   std::unique_ptr<char[]> cwd_;
+  // Guards the kernel cache and the queue pool.
+  std::mutex mutex_;
+  std::map<std::string, Kernel> kernels_;
+  std::vector<cl_command_queue> pool_queues_;
+  std::vector<cl_command_queue> free_queues_;
 
   void GetPlatform(const std::string &platform_name);
   void GetDevice();
+  void QueryDeviceInfo();
   void CreateContext();
-  void CreateCommandQueue();
+  cl_command_queue CreateCommandQueue() const;
 };
 
 #endif  // HOST_INCLUDE_WORKSPACE_H_
@@ -0,0 +1,236 @@
+#include "batching_server.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Weight of the newest run in the moving average of a batch size's run time.
+const double kRunTimeWeight = 0.2;
+
+}  // namespace
+
+BatchingServer::BatchingServer(
+    const std::function<std::unique_ptr<Network>()> &make_network,
+    const std::vector<int> &in_shape,
+    const BatchingOptions &options)
+    : in_shape_(in_shape),
+      options_(options),
+      batch_sizes_(options.batch_sizes),
+      sleeping_(false),
+      stop_(false),
+      num_batches_(0),
+      num_requests_(0) {
+  ASSERT(in_shape_.size() == 4, "Only accepts 4D input");
+  ASSERT(in_shape_[0] == 1, "Requests are single images");
+  ASSERT(options_.max_batch_size >= 1, "The batch size must be positive");
+  if (batch_sizes_.empty()) {
+    for (int size = 1; size < options_.max_batch_size; size *= 2) {
+      batch_sizes_.push_back(size);
+    }
+    batch_sizes_.push_back(options_.max_batch_size);
+  }
+  std::sort(batch_sizes_.begin(), batch_sizes_.end());
+  batch_sizes_.erase(std::unique(batch_sizes_.begin(), batch_sizes_.end()),
+                     batch_sizes_.end());
+  ASSERT(batch_sizes_.front() >= 1, "Batch sizes must be positive");
+  ASSERT(batch_sizes_.back() >= options_.max_batch_size,
+         "No batch size fits max_batch_size requests");
+
+  for (int batch_size : batch_sizes_) {
+    std::vector<int> shape = in_shape_;
+    shape[0] = batch_size;
+    Slot slot;
+    slot.batch_size = batch_size;
+    slot.session.reset(new InferenceSession(make_network(), shape));
+    slot.in_data.resize(slot.session->GetInSize());
+    slot.out_data.resize(slot.session->GetOutSize());
+    slot.run_us = 0.0;
+    slots_.push_back(std::move(slot));
+  }
+  dispatcher_ = std::thread(&BatchingServer::DispatchLoop, this);
+}
+
+BatchingServer::~BatchingServer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  dispatcher_.join();
+}
+
+std::future<std::vector<float>> BatchingServer::Submit(
+    std::vector<float> in_data) {
+  ASSERT(in_data.size() == GetInSize(), "Wrong input size");
+  std::unique_ptr<Request> request(new Request);
+  request->in_data = std::move(in_data);
+  request->arrival = Clock::now();
+  std::future<std::vector<float>> future = request->promise.get_future();
+  queue_.Push(std::move(request));
+  // The dispatcher sets sleeping_ before it looks at the queue a last time,
+  // so either it sees this request or this sees it asleep.
+  if (sleeping_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_one();
+  }
+  return future;
+}
+
+void BatchingServer::Run(const std::vector<float> &in_data,
+                         std::vector<float> &out_data) {
+  out_data = Submit(in_data).get();
+}
+
+const std::vector<int> &BatchingServer::GetInShape() const {
+  return in_shape_;
+}
+
+std::vector<int> BatchingServer::GetOutShape() const {
+  std::vector<int> shape = slots_.front().session->GetOutShape();
+  shape[0] = 1;
+  return shape;
+}
+
+std::size_t BatchingServer::GetInSize() const {
+  return slots_.front().in_data.size() / slots_.front().batch_size;
+}
+
+std::size_t BatchingServer::GetOutSize() const {
+  return slots_.front().out_data.size() / slots_.front().batch_size;
+}
+
+const std::vector<int> &BatchingServer::GetBatchSizes() const {
+  return batch_sizes_;
+}
+
+std::int64_t BatchingServer::GetNumBatches() const {
+  return num_batches_;
+}
+
+std::int64_t BatchingServer::GetNumRequests() const {
+  return num_requests_;
+}
+
+void BatchingServer::DispatchLoop() {
+  std::vector<std::unique_ptr<Request>> batch;
+  std::unique_ptr<Request> request;
+  while (true) {
+    if (!queue_.Pop(&request)) {
+      // Once stopped, the queue is drained and no one pushes any more.
+      if (stop_) {
+        break;
+      }
+      WaitForRequest(Clock::time_point::max());
+      continue;
+    }
+    batch.push_back(std::move(request));
+
+    // Fill the batch until it is full or its oldest request has waited
+    // long enough.
+    const int limit = GetBatchLimit();
+    const Clock::time_point deadline =
+        GetDeadline(batch.front()->arrival, limit);
+    while (static_cast<int>(batch.size()) < limit) {
+      if (queue_.Pop(&request)) {
+        batch.push_back(std::move(request));
+      } else if (stop_ || (Clock::now() >= deadline)) {
+        break;
+      } else {
+        WaitForRequest(deadline);
+      }
+    }
+    RunBatch(batch);
+    batch.clear();
+  }
+}
+
+void BatchingServer::WaitForRequest(Clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  sleeping_ = true;
+  if (queue_.IsEmpty() && !stop_) {
+    if (deadline == Clock::time_point::max()) {
+      cv_.wait(lock);
+    } else {
+      cv_.wait_until(lock, deadline);
+    }
+  }
+  sleeping_ = false;
+}
+
+int BatchingServer::GetBatchLimit() {
+  if (options_.latency_target_us <= 0) {
+    return options_.max_batch_size;
+  }
+  // The largest batch measured to run within the target. Sizes not yet
+  // measured are tried, so that they get measured.
+  int limit = batch_sizes_.front();
+  for (const Slot &slot : slots_) {
+    if ((slot.batch_size <= options_.max_batch_size) &&
+        (slot.run_us <= options_.latency_target_us)) {
+      limit = slot.batch_size;
+    }
+  }
+  return std::min(limit, options_.max_batch_size);
+}
+
+BatchingServer::Clock::time_point BatchingServer::GetDeadline(
+    Clock::time_point arrival, int size) {
+  double wait_us = options_.max_wait_us;
+  if (options_.latency_target_us > 0) {
+    wait_us = std::min(wait_us,
+                       options_.latency_target_us - GetSlot(size).run_us);
+  }
+  wait_us = std::max(wait_us, 0.0);
+  return arrival + std::chrono::duration_cast<Clock::duration>(
+                       std::chrono::duration<double, std::micro>(wait_us));
+}
+
+BatchingServer::Slot &BatchingServer::GetSlot(int size) {
+  for (Slot &slot : slots_) {
+    if (slot.batch_size >= size) {
+      return slot;
+    }
+  }
+  ASSERT(false, "No batch size fits the batch");
+  return slots_.back();
+}
+
+void BatchingServer::RunBatch(std::vector<std::unique_ptr<Request>> &batch) {
+  Slot &slot = GetSlot(batch.size());
+  const std::size_t in_size = GetInSize();
+  const std::size_t out_size = GetOutSize();
+  // The padding images keep the data of an earlier batch; their results
+  // are dropped.
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    std::copy(batch[i]->in_data.begin(), batch[i]->in_data.end(),
+              slot.in_data.begin() + i * in_size);
+  }
+
+  const Clock::time_point start = Clock::now();
+  try {
+    slot.session->Run(slot.in_data, slot.out_data);
+  } catch (...) {
+    const std::exception_ptr error = std::current_exception();
+    for (auto &request : batch) {
+      request->promise.set_exception(error);
+    }
+    return;
+  }
+  const double run_us =
+      std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  slot.run_us = (slot.run_us == 0.0)
+                    ? run_us
+                    : (1.0 - kRunTimeWeight) * slot.run_us +
+                          kRunTimeWeight * run_us;
+
+  num_batches_++;
+  num_requests_ += batch.size();
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    auto begin = slot.out_data.begin() + i * out_size;
+    batch[i]->promise.set_value(std::vector<float>(begin, begin + out_size));
+  }
+}
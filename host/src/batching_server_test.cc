@@ -0,0 +1,134 @@
+#include "batching_server_test.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "memory_activation.h"
+#include "model.h"
+
+void RunMpscQueueUnitTest(int num_producers, int items_per_producer) {
+  std::cout << "num_producers = " << num_producers
+            << ", items_per_producer = " << items_per_producer << '\n';
+  MpscQueue<std::pair<int, int>> queue;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.emplace_back([&queue, p, items_per_producer]() {
+      for (int i = 0; i < items_per_producer; i++) {
+        queue.Push(std::make_pair(p, i));
+      }
+    });
+  }
+
+  // Next item expected from each producer.
+  std::vector<int> next(num_producers, 0);
+  int num_errors = 0;
+  std::pair<int, int> item;
+  for (int received = 0; received < num_producers * items_per_producer;) {
+    if (!queue.Pop(&item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (item.second != next[item.first]) {
+      num_errors++;
+    }
+    next[item.first] = item.second + 1;
+    received++;
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+  if (!queue.IsEmpty()) {
+    num_errors++;
+  }
+  PrintResult(num_errors);
+}
+
+void RunBatchingServerUnitTest(int num_clients,
+                               int requests_per_client,
+                               const BatchingOptions &options) {
+  std::cout << "num_clients = " << num_clients
+            << ", max_batch_size = " << options.max_batch_size
+            << ", max_wait_us = " << options.max_wait_us
+            << ", latency_target_us = " << options.latency_target_us << '\n';
+
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  const int num_inputs = 8;
+  std::vector<float> kernel_data(max_channels * max_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> weight_data(max_channels);
+  std::vector<float> bias_data(max_channels);
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weight_data.begin(), weight_data.end(),
+                RandomGenerator(1.f / 10000.f, 1.f));
+  std::generate(bias_data.begin(), bias_data.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+  auto make_network = [&]() {
+    std::unique_ptr<Network> network(new Network);
+    AddModelLayers(*network, nullptr, kernel_data, weight_data, bias_data);
+    return network;
+  };
+
+  // The expected result of every input, run alone.
+  const std::vector<int> in_shape{1, 3, 12, 10};
+  InferenceSession session(make_network(), in_shape);
+  std::vector<std::vector<float>> inputs(num_inputs);
+  std::vector<std::vector<float>> refs(num_inputs);
+  for (int i = 0; i < num_inputs; i++) {
+    inputs[i].resize(session.GetInSize());
+    std::generate(inputs[i].begin(), inputs[i].end(),
+                  RandomGenerator(1.f / 500.f, -1.f));
+    refs[i].resize(session.GetOutSize());
+    session.Run(inputs[i], refs[i]);
+  }
+
+  BatchingServer server(make_network, in_shape, options);
+  std::atomic<int> num_errors(0);
+  std::vector<std::thread> clients;
+  for (int c = 0; c < num_clients; c++) {
+    clients.emplace_back([&, c]() {
+      for (int r = 0; r < requests_per_client; r++) {
+        const int idx = (c + r) % num_inputs;
+        std::vector<float> out_data;
+        server.Run(inputs[idx], out_data);
+        if ((out_data.size() != refs[idx].size()) ||
+            (GetMaxError(refs[idx].data(), out_data.data(),
+                         out_data.size()) > 1e-3f)) {
+          num_errors++;
+        }
+      }
+    });
+  }
+  for (std::thread &client : clients) {
+    client.join();
+  }
+
+  const std::int64_t num_requests = server.GetNumRequests();
+  std::cout << "Mean batch size "
+            << static_cast<double>(num_requests) / server.GetNumBatches()
+            << '\n';
+  if (num_requests != num_clients * requests_per_client) {
+    num_errors++;
+  }
+  PrintResult(num_errors);
+}
+
+void RunBatchingServerTests() {
+  RunMpscQueueUnitTest(1, 100000);
+  RunMpscQueueUnitTest(8, 20000);
+
+  BatchingOptions options;
+  RunBatchingServerUnitTest(1, 20, options);
+  RunBatchingServerUnitTest(8, 20, options);
+  options.max_batch_size = 5;
+  options.max_wait_us = 500;
+  RunBatchingServerUnitTest(8, 20, options);
+  options.batch_sizes = {1, 3, 6};
+  options.latency_target_us = 20000;
+  RunBatchingServerUnitTest(6, 20, options);
+}
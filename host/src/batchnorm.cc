@@ -2,6 +2,8 @@
 
 #include <cmath>
 
+#include "cpu_kernels.h"
+
 void RunBatchNormRef(std::vector<float> &tensor,
                      int batch,
                      int channels,
@@ -9,36 +11,52 @@ void RunBatchNormRef(std::vector<float> &tensor,
                      float eps,
                      const std::vector<float> &weights,
                      const std::vector<float> &biases,
-                     float relu) {
-  std::vector<float> mean(channels, 0.f);
-  std::vector<float> var(channels, 0.f);
-  int idx = 0;
-  for (int c = 0; c < channels; c++) {
-    for (int i = 0; i < channel_size; i++) {
-      mean[c] += tensor[idx++];
+                     float relu,
+                     BatchNormStats stats) {
+  // Images sharing statistics.
+  const int group_size = (stats == BatchNormStats::kAcrossBatch) ? batch : 1;
+  const int count = group_size * channel_size;
+  for (int first = 0; first < batch; first += group_size) {
+    std::vector<float> mean(channels, 0.f);
+    std::vector<float> var(channels, 0.f);
+    for (int n = first; n < first + group_size; n++) {
+      int idx = n * channels * channel_size;
+      for (int c = 0; c < channels; c++) {
+        for (int i = 0; i < channel_size; i++) {
+          mean[c] += tensor[idx++];
+        }
+      }
     }
-    mean[c] /= channel_size;
-  }
-  idx = 0;
-  for (int c = 0; c < channels; c++) {
-    for (int i = 0; i < channel_size; i++) {
-      float delta = tensor[idx++] - mean[c];
-      var[c] += delta * delta;
+    for (int c = 0; c < channels; c++) {
+      mean[c] /= count;
     }
-    var[c] /= channel_size;
-    var[c] = std::sqrt(var[c] + eps);
-  }
-  idx = 0;
-  for (int c = 0; c < channels; c++) {
-    for (int i = 0; i < channel_size; i++) {
-      float activation =
-          (weights[c] * (tensor[idx] - mean[c]) / var[c]) + biases[c];
-      if (relu > 0.f) {
-        tensor[idx] = (activation > 0.f) ? relu * activation : 0.f;
-      } else {
-        tensor[idx] = activation;
+    for (int n = first; n < first + group_size; n++) {
+      int idx = n * channels * channel_size;
+      for (int c = 0; c < channels; c++) {
+        for (int i = 0; i < channel_size; i++) {
+          float delta = tensor[idx++] - mean[c];
+          var[c] += delta * delta;
+        }
+      }
+    }
+    for (int c = 0; c < channels; c++) {
+      var[c] /= count;
+      var[c] = std::sqrt(var[c] + eps);
+    }
+    for (int n = first; n < first + group_size; n++) {
+      int idx = n * channels * channel_size;
+      for (int c = 0; c < channels; c++) {
+        for (int i = 0; i < channel_size; i++) {
+          float activation =
+              (weights[c] * (tensor[idx] - mean[c]) / var[c]) + biases[c];
+          if (relu > 0.f) {
+            tensor[idx] = (activation > 0.f) ? relu * activation : 0.f;
+          } else {
+            tensor[idx] = activation;
+          }
+          idx++;
+        }
       }
-      idx++;
     }
   }
 }
@@ -48,9 +66,78 @@ void RunBatchNormRef(std::vector<float> &tensor,
                      float eps,
                      const std::vector<float> &weights,
                      const std::vector<float> &biases,
-                     float relu) {
+                     float relu,
+                     BatchNormStats stats) {
   RunBatchNormRef(tensor, tensor_shape[0], tensor_shape[1],
                   tensor_shape[2] * tensor_shape[3], eps, weights, biases,
-                  relu);
+                  relu, stats);
+}
+
+void RunBatchNormCpu(float *tensor,
+                     int batch,
+                     int channels,
+                     int channel_size,
+                     float eps,
+                     const float *weights,
+                     const float *biases,
+                     float relu,
+                     BatchNormStats stats,
+                     ThreadPool *pool) {
+  if (pool == nullptr) {
+    pool = &ThreadPool::GetDefault();
+  }
+  // Each item is a channel of a group of images sharing statistics.
+  const int group_size = (stats == BatchNormStats::kAcrossBatch) ? batch : 1;
+  const int count = group_size * channel_size;
+  const int image_size = channels * channel_size;
+  pool->ParallelFor(batch / group_size * channels, 1, [&](int begin, int end) {
+    for (int item = begin; item < end; item++) {
+      const int c = item % channels;
+      float *data = tensor + (item / channels) * group_size * image_size +
+                    c * channel_size;
+      float sum = 0.f;
+      for (int n = 0; n < group_size; n++) {
+        sum += SumRow(data + n * image_size, channel_size);
+      }
+      const float mean = sum / count;
+      float squared_diff = 0.f;
+      for (int n = 0; n < group_size; n++) {
+        squared_diff +=
+            SumSquaredDiffRow(data + n * image_size, channel_size, mean);
+      }
+      const float var = squared_diff / count;
+      const float scale = weights[c] / std::sqrt(var + eps);
+      for (int n = 0; n < group_size; n++) {
+        ScaleShiftRow(data + n * image_size, channel_size, scale,
+                      biases[c] - scale * mean, relu);
+      }
+    }
+  });
+}
+
+void RunBatchNormCpu(std::vector<float> &tensor,
+                     int batch,
+                     int channels,
+                     int channel_size,
+                     float eps,
+                     const std::vector<float> &weights,
+                     const std::vector<float> &biases,
+                     float relu,
+                     BatchNormStats stats,
+                     ThreadPool *pool) {
+  RunBatchNormCpu(tensor.data(), batch, channels, channel_size, eps,
+                  weights.data(), biases.data(), relu, stats, pool);
 }
 
+void RunBatchNormCpu(std::vector<float> &tensor,
+                     const std::vector<int> &tensor_shape,
+                     float eps,
+                     const std::vector<float> &weights,
+                     const std::vector<float> &biases,
+                     float relu,
+                     BatchNormStats stats,
+                     ThreadPool *pool) {
+  RunBatchNormCpu(tensor, tensor_shape[0], tensor_shape[1],
+                  tensor_shape[2] * tensor_shape[3], eps, weights, biases,
+                  relu, stats, pool);
+}
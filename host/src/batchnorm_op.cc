@@ -5,6 +5,28 @@
 #include <numeric>
 
 #include "memory_activation.h"
+#include "reduce_op.h"
+
+namespace {
+
+// Welford states of the channels of every image, [batch, channels], then
+// with kAcrossBatch those of the channels, [channels].
+int GetNumStates(const std::vector<int> &shape, BatchNormStats stats) {
+  const int num_states = shape[0] * shape[1];
+  if (stats == BatchNormStats::kAcrossBatch) {
+    return num_states + shape[1];
+  }
+  return num_states;
+}
+
+// The interior of a tensor with a halo isn't contiguous, so its statistics
+// go through the states of the columns of every image and channel,
+// [batch * channels, width], kept after those of GetNumStates.
+int GetNumColumnStates(const std::vector<int> &shape, int halo) {
+  return (halo > 0) ? shape[0] * shape[1] * shape[3] : 0;
+}
+
+}  // namespace
 
 BatchNormOp::BatchNormOp(int num_features, float eps, float relu,
                          cl_kernel *kernel,
@@ -15,11 +37,19 @@ BatchNormOp::BatchNormOp(int num_features, float eps, float relu,
     : num_features_(num_features),
       eps_(eps),
       relu_(relu),
+      stats_(BatchNormStats::kPerImage),
+      halo_(0),
       kernel_(kernel),
       command_queue_(command_queue),
       weights_buf_(weights_buf),
       biases_buf_(biases_buf),
-      tensor_buf_(tensor_buf) {}
+      tensor_buf_(tensor_buf),
+      reduce_kernel_(nullptr),
+      apply_kernel_(nullptr),
+      stats_buf_(nullptr),
+      scratch_buf_(nullptr),
+      plan_(nullptr),
+      profiler_(nullptr) {}
 
 void BatchNormOp::SetTensorBuffer(cl_mem *buf) {
   tensor_buf_ = buf;
@@ -33,64 +63,193 @@ void BatchNormOp::SetBiasBuffer(cl_mem *buf) {
   biases_buf_ = buf;
 }
 
+void BatchNormOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
 
-void BatchNormOp::Run(const std::vector<int> &shape, bool blocking) {
-  const static cl_uint wg_dim = 1;
-  const static cl_uint wg_size = 32;
+void BatchNormOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+void BatchNormOp::SetStats(BatchNormStats stats) {
+  stats_ = stats;
+}
 
+void BatchNormOp::SetReduction(cl_kernel *reduce_kernel,
+                               cl_kernel *apply_kernel, cl_mem *stats_buf,
+                               cl_mem *scratch_buf) {
+  reduce_kernel_ = reduce_kernel;
+  apply_kernel_ = apply_kernel;
+  stats_buf_ = stats_buf;
+  scratch_buf_ = scratch_buf;
+}
+
+void BatchNormOp::SetHalo(int halo) {
+  halo_ = halo;
+}
+
+std::size_t BatchNormOp::GetStatsSize(const std::vector<int> &shape,
+                                      BatchNormStats stats, int halo) {
+  ASSERT(shape.size() == 4, "Only accepts 4D input");
+  return sizeof(cl_float4) *
+         (GetNumStates(shape, stats) + GetNumColumnStates(shape, halo));
+}
+
+std::size_t BatchNormOp::GetScratchSize(const std::vector<int> &shape,
+                                        BatchNormStats stats, int halo) {
+  ASSERT(shape.size() == 4, "Only accepts 4D input");
+  std::size_t size = 0;
+  if (halo > 0) {
+    const int planes = shape[0] * shape[1];
+    size = std::max(
+        ReduceOp::GetScratchSize({planes, shape[2], shape[3]}, 1),
+        ReduceOp::GetScratchSize({planes, shape[3]}, 1));
+  } else {
+    size = ReduceOp::GetScratchSize(shape, 2, 2);
+  }
+  if (stats == BatchNormStats::kAcrossBatch) {
+    size = std::max(size, ReduceOp::GetScratchSize({shape[0], shape[1]}, 0));
+  }
+  return size;
+}
+
+void BatchNormOp::Run(const std::vector<int> &shape, bool blocking) {
   ASSERT(shape.size() == 4, "Only accepts 4D input");
   ASSERT(shape[1] == num_features_, "Number of input channels");
   ASSERT(weights_buf_ != nullptr, "weight buffer is null");
   ASSERT(biases_buf_ != nullptr, "bias buffer is null");
   ASSERT(tensor_buf_ != nullptr, "tensor buffer is null");
 
+  if (reduce_kernel_ != nullptr) {
+    RunReduction(shape);
+  } else {
+    RunSerial(shape);
+  }
+
+  if (blocking) {
+    clFinish(*command_queue_);
+  }
+}
+
+void BatchNormOp::RunSerial(const std::vector<int> &shape) {
+  const static cl_uint wg_dim = 2;
+  const static cl_uint wg_size = 32;
+
   const int batch = shape[0];
   const int channels = shape[1];
   const int channel_size = shape[2] * shape[3];
 
+  const int across_batch = stats_ == BatchNormStats::kAcrossBatch;
+  ASSERT(halo_ == 0, "Tensors with a halo need the reduction kernels");
+
   cl_int status;
   const cl_uint total_work_items = RoundUp(channels, wg_size);
+  // A row of channels per image, or one for the whole batch.
   const std::size_t global_size[wg_dim] = {
-    static_cast<std::size_t>(total_work_items)
+    static_cast<std::size_t>(total_work_items),
+    static_cast<std::size_t>(across_batch ? 1 : batch)
   };
   const std::size_t local_size[wg_dim] = {
-    static_cast<std::size_t>(wg_size)
+    static_cast<std::size_t>(wg_size), 1
   };
 
-  cl_uint arg_idx = 0;
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(cl_mem), tensor_buf_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &batch);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &channels);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &channel_size);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(float), &eps_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(cl_mem), weights_buf_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(cl_mem), biases_buf_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(float), &relu_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
+  const std::vector<KernelArg> args{
+      *tensor_buf_, batch, channels, channel_size, eps_, *weights_buf_,
+      *biases_buf_, relu_, across_batch};
+  SetKernelArgs(*kernel_, args);
 
+  ProfileEvent event(profiler_, "BatchNorm", ProfileKind::kKernel);
   status = clEnqueueNDRangeKernel(*command_queue_, *kernel_, wg_dim, nullptr,
-                                  global_size, local_size, 0, nullptr, nullptr);
+                                  global_size, local_size, 0, nullptr,
+                                  event.Get());
   ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(*kernel_, args, wg_dim, global_size, local_size,
+                        "BatchNorm");
+  }
+}
 
-  if (blocking) {
-    clFinish(*command_queue_);
+void BatchNormOp::RunReduction(const std::vector<int> &shape) {
+  const static cl_uint wg_dim = 1;
+  const static cl_uint wg_size = 256;
+
+  ASSERT(apply_kernel_ != nullptr, "apply kernel is null");
+  ASSERT(stats_buf_ != nullptr, "stats buffer is null");
+
+  const int batch = shape[0];
+  const int channels = shape[1];
+  const int height = shape[2];
+  const int width = shape[3];
+  const int size = batch * channels * height * width;
+  const int across_batch = stats_ == BatchNormStats::kAcrossBatch;
+
+  // Statistics of the channels of every image, then over the batch.
+  ReduceOp reduce(Reduction::kVariance, reduce_kernel_, command_queue_,
+                  tensor_buf_, stats_buf_, scratch_buf_);
+  reduce.SetExecutionPlan(plan_);
+  reduce.SetProfiler(profiler_);
+  reduce.SetStates(false, true);
+  if (halo_ > 0) {
+    // The interior rows of every plane into column states, then those into
+    // the statistics.
+    const int pitch = width + 2 * halo_;
+    const int columns_offset = GetNumStates(shape, stats_);
+    reduce.SetInBuffer(tensor_buf_, halo_ * pitch + halo_);
+    reduce.SetInStrides((height + 2 * halo_) * pitch, pitch);
+    reduce.SetOutBuffer(stats_buf_, columns_offset);
+    reduce.Run({batch * channels, height, width}, 1, 1, false);
+    reduce.SetInBuffer(stats_buf_, columns_offset);
+    reduce.SetInStrides(0, 0);
+    reduce.SetOutBuffer(stats_buf_);
+    reduce.SetStates(true, true);
+    reduce.Run({batch * channels, width}, 1, 1, false);
+  } else {
+    reduce.Run(shape, 2, 2, false);
+  }
+  int stats_offset = 0;
+  if (across_batch) {
+    stats_offset = batch * channels;
+    reduce.SetInBuffer(stats_buf_);
+    reduce.SetOutBuffer(stats_buf_, stats_offset);
+    reduce.SetStates(true, true);
+    reduce.Run({batch, channels}, 0, 1, false);
+  }
+
+  const std::size_t global_size[wg_dim] = {
+    static_cast<std::size_t>(RoundUp(size, wg_size))
+  };
+  const std::size_t local_size[wg_dim] = {
+    static_cast<std::size_t>(wg_size)
+  };
+  const std::vector<KernelArg> args{
+      *tensor_buf_, *stats_buf_, stats_offset, size, channels, height, width,
+      halo_, eps_, *weights_buf_, *biases_buf_, relu_, across_batch};
+  SetKernelArgs(*apply_kernel_, args);
+
+  ProfileEvent event(profiler_, "BatchNormApply", ProfileKind::kKernel);
+  cl_int status = clEnqueueNDRangeKernel(
+      *command_queue_, *apply_kernel_, wg_dim, nullptr, global_size,
+      local_size, 0, nullptr, event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(*apply_kernel_, args, wg_dim, global_size,
+                        local_size, "BatchNormApply");
   }
 }
 
 void BatchNormOp::Run(const std::vector<int> &shape, bool blocking,
                       float *out_data) {
+  ASSERT(halo_ == 0, "Read tensors with a halo through the Tensor");
   Run(shape, blocking);
   int tensor_size =
       std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<int>());
   std::size_t raw_tensor_size = sizeof(float) * tensor_size;
-  clEnqueueReadBuffer(*command_queue_, *tensor_buf_, blocking, 0, raw_tensor_size,
-                      out_data, 0, nullptr, nullptr);
+  ProfileEvent event(profiler_, "BatchNorm output", ProfileKind::kRead);
+  cl_int status =
+      clEnqueueReadBuffer(*command_queue_, *tensor_buf_, blocking, 0,
+                          raw_tensor_size, out_data, 0, nullptr, event.Get());
+  event.Commit(status);
 }
 
@@ -0,0 +1,621 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include "memory_activation.h"
+#include "test_utils.h"
+
+namespace {
+
+void WriteJsonString(std::ostream &os, const std::string &str) {
+  os << '"';
+  for (char c : str) {
+    if ((c == '"') || (c == '\\')) {
+      os << '\\';
+    }
+    os << c;
+  }
+  os << '"';
+}
+
+// The subset of JSON WriteBenchmarkJson writes: objects, arrays, strings
+// without escapes other than quotes and backslashes, numbers and booleans.
+struct JsonValue {
+  enum class Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  Type type = Type::kNull;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  // Elements of arrays, and values of objects in the order of keys.
+  std::vector<JsonValue> values;
+  std::vector<std::string> keys;
+
+  const JsonValue *Find(const std::string &key) const {
+    for (std::size_t i = 0; i < keys.size(); i++) {
+      if (keys[i] == key) {
+        return &values[i];
+      }
+    }
+    return nullptr;
+  }
+};
+
+class JsonParser {
+ public:
+  JsonParser(const std::string &text, const std::string &path)
+      : text_(text), path_(path), pos_(0) {}
+
+  JsonValue Parse() {
+    JsonValue value = ParseValue();
+    SkipSpace();
+    Expect(pos_ == text_.size(), "trailing characters");
+    return value;
+  }
+
+ private:
+  const std::string &text_;
+  const std::string &path_;
+  std::size_t pos_;
+
+  void Expect(bool cond, const std::string &what) {
+    ASSERT(cond, "Malformed JSON in " + path_ + " at offset " +
+                     std::to_string(pos_) + ": " + what);
+  }
+
+  void SkipSpace() {
+    while ((pos_ < text_.size()) && isspace(text_[pos_])) {
+      pos_++;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipSpace();
+    if ((pos_ < text_.size()) && (text_[pos_] == c)) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool ConsumeWord(const char *word) {
+    const std::size_t length = strlen(word);
+    if (text_.compare(pos_, length, word) == 0) {
+      pos_ += length;
+      return true;
+    }
+    return false;
+  }
+
+  std::string ParseString() {
+    Expect(Consume('"'), "expected a string");
+    std::string str;
+    while ((pos_ < text_.size()) && (text_[pos_] != '"')) {
+      if (text_[pos_] == '\\') {
+        pos_++;
+      }
+      if (pos_ < text_.size()) {
+        str.push_back(text_[pos_++]);
+      }
+    }
+    Expect(Consume('"'), "unterminated string");
+    return str;
+  }
+
+  JsonValue ParseValue() {
+    SkipSpace();
+    Expect(pos_ < text_.size(), "unexpected end");
+    JsonValue value;
+    const char c = text_[pos_];
+    if (c == '{') {
+      value.type = JsonValue::Type::kObject;
+      pos_++;
+      if (!Consume('}')) {
+        do {
+          value.keys.push_back(ParseString());
+          Expect(Consume(':'), "expected ':'");
+          value.values.push_back(ParseValue());
+        } while (Consume(','));
+        Expect(Consume('}'), "expected '}'");
+      }
+    } else if (c == '[') {
+      value.type = JsonValue::Type::kArray;
+      pos_++;
+      if (!Consume(']')) {
+        do {
+          value.values.push_back(ParseValue());
+        } while (Consume(','));
+        Expect(Consume(']'), "expected ']'");
+      }
+    } else if (c == '"') {
+      value.type = JsonValue::Type::kString;
+      value.string = ParseString();
+    } else if (ConsumeWord("true")) {
+      value.type = JsonValue::Type::kBool;
+      value.boolean = true;
+    } else if (ConsumeWord("false")) {
+      value.type = JsonValue::Type::kBool;
+    } else if (ConsumeWord("null")) {
+      value.type = JsonValue::Type::kNull;
+    } else {
+      value.type = JsonValue::Type::kNumber;
+      const char *begin = text_.c_str() + pos_;
+      char *end = nullptr;
+      value.number = strtod(begin, &end);
+      Expect(end != begin, "expected a value");
+      pos_ += end - begin;
+    }
+    return value;
+  }
+};
+
+// Keys written by WriteBenchmarkJson besides the params.
+bool IsResultKey(const std::string &key) {
+  static const char *const kKeys[] = {
+      "name",      "count", "min_us", "median_us", "p99_us",  "mean_us",
+      "stddev_us", "flops", "gflops", "max_error", "correct", "samples_us"};
+  for (const char *result_key : kKeys) {
+    if (key == result_key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Regularized incomplete beta function I_x(a, b), by the continued fraction
+// evaluated with the modified Lentz method.
+double BetaContinuedFraction(double a, double b, double x) {
+  const int kMaxIterations = 300;
+  const double kEpsilon = 1e-12;
+  const double kTiny = 1e-300;
+  auto clamp = [&](double v) { return (std::abs(v) < kTiny) ? kTiny : v; };
+  double c = 1.0;
+  double d = 1.0 / clamp(1.0 - (a + b) * x / (a + 1.0));
+  double h = d;
+  for (int m = 1; m <= kMaxIterations; m++) {
+    const int m2 = 2 * m;
+    double aa = m * (b - m) * x / ((a - 1.0 + m2) * (a + m2));
+    d = 1.0 / clamp(1.0 + aa * d);
+    c = clamp(1.0 + aa / c);
+    h *= d * c;
+    aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + 1.0 + m2));
+    d = 1.0 / clamp(1.0 + aa * d);
+    c = clamp(1.0 + aa / c);
+    h *= d * c;
+    if (std::abs(d * c - 1.0) < kEpsilon) {
+      break;
+    }
+  }
+  return h;
+}
+
+double IncompleteBeta(double a, double b, double x) {
+  if (x <= 0.0) {
+    return 0.0;
+  }
+  if (x >= 1.0) {
+    return 1.0;
+  }
+  const double front = std::exp(std::lgamma(a + b) - std::lgamma(a) -
+                                std::lgamma(b) + a * std::log(x) +
+                                b * std::log(1.0 - x));
+  // The fraction converges fast on the side of the mean.
+  if (x < (a + 1.0) / (a + b + 2.0)) {
+    return front * BetaContinuedFraction(a, b, x) / a;
+  }
+  return 1.0 - front * BetaContinuedFraction(b, a, 1.0 - x) / b;
+}
+
+// P(T > t) for Student's t distribution with dof degrees of freedom.
+double StudentTUpperTail(double t, double dof) {
+  const double tail = 0.5 * IncompleteBeta(0.5 * dof, 0.5, dof / (dof + t * t));
+  return (t >= 0.0) ? tail : 1.0 - tail;
+}
+
+void GetMeanAndVariance(const std::vector<double> &samples, double *mean,
+                        double *variance) {
+  const BenchmarkStats stats = ComputeBenchmarkStats(samples);
+  *mean = stats.mean;
+  *variance = stats.stddev * stats.stddev;
+}
+
+std::vector<double> GetLogSamples(const std::vector<double> &samples) {
+  std::vector<double> logs;
+  for (double sample : samples) {
+    logs.push_back(std::log(std::max(sample, 1e-9)));
+  }
+  return logs;
+}
+
+}  // namespace
+
+BenchmarkStats ComputeBenchmarkStats(std::vector<double> samples) {
+  ASSERT(!samples.empty(), "No samples");
+  std::sort(samples.begin(), samples.end());
+  const std::size_t n = samples.size();
+  BenchmarkStats stats;
+  stats.count = n;
+  stats.min = samples.front();
+  stats.median = (n % 2 == 1) ? samples[n / 2]
+                              : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+  // Nearest rank: the smallest sample with at least 99% of them at or below.
+  const std::size_t rank = static_cast<std::size_t>(std::ceil(0.99 * n));
+  stats.p99 = samples[std::max<std::size_t>(rank, 1) - 1];
+  double sum = 0.0;
+  for (double sample : samples) {
+    sum += sample;
+  }
+  stats.mean = sum / n;
+  double sum_squares = 0.0;
+  for (double sample : samples) {
+    sum_squares += (sample - stats.mean) * (sample - stats.mean);
+  }
+  stats.stddev = (n > 1) ? std::sqrt(sum_squares / (n - 1)) : 0.0;
+  return stats;
+}
+
+double GetBenchmarkGflops(const BenchmarkResult &result) {
+  // Flops per us are MFLOP/s.
+  return (result.stats.median > 0.0) ? result.flops / result.stats.median * 1e-3
+                                     : 0.0;
+}
+
+std::vector<double> RunBenchmark(const BenchmarkOptions &options,
+                                 const std::function<double()> &fn) {
+  ASSERT(options.repetitions > 0, "Number of repetitions");
+  for (int i = 0; i < options.warmup; i++) {
+    fn();
+  }
+  std::vector<double> samples;
+  samples.reserve(options.repetitions);
+  for (int i = 0; i < options.repetitions; i++) {
+    samples.push_back(fn());
+  }
+  return samples;
+}
+
+double MeasureKernelTime(Profiler &profiler, const std::function<void()> &fn) {
+  profiler.Clear();
+  fn();
+  profiler.Collect();
+  double ns = 0.0;
+  for (const ProfileRecord &record : profiler.GetRecords()) {
+    if (record.kind == ProfileKind::kKernel) {
+      ns += static_cast<double>(record.end - record.start);
+    }
+  }
+  profiler.Clear();
+  return ns * 1e-3;
+}
+
+double MeasureWallTime(const std::function<void()> &fn) {
+  auto tic = std::chrono::high_resolution_clock::now();
+  fn();
+  auto toc = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::micro>(toc - tic).count();
+}
+
+BenchmarkResult RunOperatorBenchmark(
+    const std::string &name,
+    const std::vector<std::pair<std::string, double>> &params,
+    Operator &op,
+    Workspace *ws,
+    const std::vector<int> &in_shape,
+    const std::vector<float> &in_data,
+    const std::vector<float> &expected,
+    const BenchmarkOptions &options) {
+  const bool device = op.GetBackend() == Backend::kOpenCL;
+  Profiler *profiler = device ? ws->GetProfiler() : nullptr;
+  ASSERT(!device || (profiler != nullptr),
+         "Device benchmarks need a workspace with profiling enabled");
+
+  Tensor input(in_shape, device, ws);
+  std::unique_ptr<Tensor> out_tensor;
+  if (!op.IsInPlace()) {
+    out_tensor.reset(new Tensor(op.InferShape(in_shape), device, ws));
+  }
+  Tensor &output = op.IsInPlace() ? input : *out_tensor;
+  TensorData &input_data = input.GetData();
+  ASSERT(in_data.size() >= input_data.size(),
+         "Input buffer doesn't have enough data");
+  std::copy(in_data.begin(), in_data.begin() + input_data.size(),
+            input_data.begin());
+  op.Prepare(in_shape);
+
+  BenchmarkResult result;
+  result.name = name;
+  result.params = params;
+  result.flops = op.GetCost(in_shape).flops;
+
+  // Correctness first, which also uploads the input.
+  op.Run(input, output);
+  const TensorData &output_data =
+      static_cast<const Tensor &>(output).GetData();
+  ASSERT(expected.size() >= output_data.size(),
+         "Expected buffer doesn't have enough data");
+  result.max_error =
+      GetMaxError(expected.data(), output_data.data(), output_data.size());
+  result.correct = result.max_error <= options.tolerance;
+
+  result.samples = RunBenchmark(options, [&]() {
+    if (device) {
+      return MeasureKernelTime(*profiler, [&]() {
+        op.Run(input, output);
+        ws->FinishCommandQueue();
+      });
+    }
+    return MeasureWallTime([&]() { op.Run(input, output); });
+  });
+  result.stats = ComputeBenchmarkStats(result.samples);
+  return result;
+}
+
+void PrintBenchmarkHeader(std::ostream &os) {
+  os << std::left << std::setw(40) << "Benchmark" << std::right
+     << std::setw(11) << "Min us" << std::setw(11) << "Median us"
+     << std::setw(11) << "P99 us" << std::setw(10) << "Stddev"
+     << std::setw(11) << "GFLOP/s" << std::setw(11) << "Max error"
+     << std::setw(8) << "Check" << '\n';
+}
+
+void PrintBenchmarkResult(std::ostream &os, const BenchmarkResult &result) {
+  os << std::left << std::setw(40) << result.name << std::right << std::fixed
+     << std::setprecision(1) << std::setw(11) << result.stats.min
+     << std::setw(11) << result.stats.median << std::setw(11)
+     << result.stats.p99 << std::setw(10) << result.stats.stddev
+     << std::setprecision(2) << std::setw(11) << GetBenchmarkGflops(result)
+     << std::scientific << std::setprecision(1) << std::setw(11)
+     << result.max_error << std::setw(8) << (result.correct ? "ok" : "FAIL")
+     << '\n';
+  os.unsetf(std::ios_base::floatfield);
+  os << std::setprecision(6);
+}
+
+void WriteBenchmarkJson(
+    const std::string &path,
+    const std::vector<std::pair<std::string, std::string>> &context,
+    const std::vector<BenchmarkResult> &results) {
+  std::ofstream os(path);
+  ASSERT(static_cast<bool>(os), "Couldn't open the benchmark file " + path);
+  os << std::setprecision(9);
+  os << "{\n\"context\":{";
+  for (std::size_t i = 0; i < context.size(); i++) {
+    os << ((i > 0) ? "," : "");
+    WriteJsonString(os, context[i].first);
+    os << ':';
+    WriteJsonString(os, context[i].second);
+  }
+  os << "},\n\"benchmarks\":[";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &result = results[i];
+    os << ((i > 0) ? ",\n" : "\n") << "{\"name\":";
+    WriteJsonString(os, result.name);
+    for (const auto &param : result.params) {
+      os << ',';
+      WriteJsonString(os, param.first);
+      os << ':' << param.second;
+    }
+    const BenchmarkStats &stats = result.stats;
+    os << ",\"count\":" << stats.count << ",\"min_us\":" << stats.min
+       << ",\"median_us\":" << stats.median << ",\"p99_us\":" << stats.p99
+       << ",\"mean_us\":" << stats.mean << ",\"stddev_us\":" << stats.stddev
+       << ",\"flops\":" << result.flops
+       << ",\"gflops\":" << GetBenchmarkGflops(result)
+       << ",\"max_error\":" << result.max_error
+       << ",\"correct\":" << (result.correct ? "true" : "false")
+       << ",\"samples_us\":[";
+    for (std::size_t j = 0; j < result.samples.size(); j++) {
+      os << ((j > 0) ? "," : "") << result.samples[j];
+    }
+    os << "]}";
+  }
+  os << "\n]}\n";
+}
+
+bool ReadBenchmarkJson(
+    const std::string &path,
+    std::vector<std::pair<std::string, std::string>> *context,
+    std::vector<BenchmarkResult> *results) {
+  std::ifstream is(path);
+  if (!is) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << is.rdbuf();
+  const std::string text = buffer.str();
+  const JsonValue root = JsonParser(text, path).Parse();
+  const JsonValue *context_value = root.Find("context");
+  const JsonValue *benchmarks = root.Find("benchmarks");
+  ASSERT((benchmarks != nullptr) &&
+             (benchmarks->type == JsonValue::Type::kArray),
+         "No benchmarks in " + path);
+
+  context->clear();
+  if (context_value != nullptr) {
+    for (std::size_t i = 0; i < context_value->keys.size(); i++) {
+      context->emplace_back(context_value->keys[i],
+                            context_value->values[i].string);
+    }
+  }
+  results->clear();
+  for (const JsonValue &entry : benchmarks->values) {
+    const JsonValue *name = entry.Find("name");
+    const JsonValue *samples = entry.Find("samples_us");
+    ASSERT((name != nullptr) && (samples != nullptr) &&
+               !samples->values.empty(),
+           "Benchmark without name or samples in " + path);
+    BenchmarkResult result;
+    result.name = name->string;
+    for (std::size_t i = 0; i < entry.keys.size(); i++) {
+      if (!IsResultKey(entry.keys[i]) &&
+          (entry.values[i].type == JsonValue::Type::kNumber)) {
+        result.params.emplace_back(entry.keys[i], entry.values[i].number);
+      }
+    }
+    for (const JsonValue &sample : samples->values) {
+      result.samples.push_back(sample.number);
+    }
+    result.stats = ComputeBenchmarkStats(result.samples);
+    const JsonValue *flops = entry.Find("flops");
+    const JsonValue *max_error = entry.Find("max_error");
+    const JsonValue *correct = entry.Find("correct");
+    result.flops = (flops != nullptr) ? flops->number : 0.0;
+    result.max_error = (max_error != nullptr) ? max_error->number : 0.f;
+    result.correct = (correct == nullptr) || correct->boolean;
+    results->push_back(result);
+  }
+  return true;
+}
+
+std::string GetBaselinePath(const std::string &dir,
+                            const std::string &device_name) {
+  std::string file_name;
+  for (char c : device_name) {
+    file_name.push_back(isalnum(static_cast<unsigned char>(c)) ? c : '_');
+  }
+  return dir + '/' + file_name + ".json";
+}
+
+WelchTest RunWelchTTest(const std::vector<double> &a,
+                        const std::vector<double> &b) {
+  WelchTest test{0.0, 0.0, 0.5};
+  if ((a.size() < 2) || (b.size() < 2)) {
+    // No variance to compare against.
+    return test;
+  }
+  double mean_a, variance_a, mean_b, variance_b;
+  GetMeanAndVariance(a, &mean_a, &variance_a);
+  GetMeanAndVariance(b, &mean_b, &variance_b);
+  const double se_a = variance_a / a.size();
+  const double se_b = variance_b / b.size();
+  const double se = se_a + se_b;
+  if (se <= 0.0) {
+    // Both constant: any difference is certain.
+    if (mean_b != mean_a) {
+      const bool slower = mean_b > mean_a;
+      test.t = (slower ? 1.0 : -1.0) * std::numeric_limits<double>::infinity();
+      test.p_value = slower ? 0.0 : 1.0;
+    }
+    return test;
+  }
+  test.t = (mean_b - mean_a) / std::sqrt(se);
+  // Welch-Satterthwaite.
+  test.dof = se * se / (se_a * se_a / (a.size() - 1) +
+                        se_b * se_b / (b.size() - 1));
+  test.p_value = StudentTUpperTail(test.t, test.dof);
+  return test;
+}
+
+const char *GetBenchmarkVerdictName(BenchmarkVerdict verdict) {
+  switch (verdict) {
+    case BenchmarkVerdict::kRegressed:
+      return "REGRESSED";
+    case BenchmarkVerdict::kImproved:
+      return "improved";
+    case BenchmarkVerdict::kNew:
+      return "new";
+    case BenchmarkVerdict::kMissing:
+      return "missing";
+    default:
+      return "unchanged";
+  }
+}
+
+std::vector<BenchmarkComparison> CompareBenchmarks(
+    const std::vector<BenchmarkResult> &baseline,
+    const std::vector<BenchmarkResult> &current,
+    const CompareOptions &options) {
+  std::map<std::string, const BenchmarkResult *> baseline_by_name;
+  for (const BenchmarkResult &result : baseline) {
+    baseline_by_name[result.name] = &result;
+  }
+  std::vector<BenchmarkComparison> diff;
+  for (const BenchmarkResult &result : current) {
+    BenchmarkComparison comparison{result.name, 0.0, result.stats.median,
+                                   0.0, {0.0, 0.0, 0.5},
+                                   BenchmarkVerdict::kNew};
+    auto it = baseline_by_name.find(result.name);
+    if (it != baseline_by_name.end()) {
+      const BenchmarkResult &base = *it->second;
+      comparison.baseline_median = base.stats.median;
+      comparison.change = (base.stats.median > 0.0)
+                              ? result.stats.median / base.stats.median - 1.0
+                              : 0.0;
+      comparison.test = RunWelchTTest(GetLogSamples(base.samples),
+                                      GetLogSamples(result.samples));
+      comparison.verdict = BenchmarkVerdict::kUnchanged;
+      if ((comparison.change > options.min_change) &&
+          (comparison.test.p_value < options.alpha)) {
+        comparison.verdict = BenchmarkVerdict::kRegressed;
+      } else if ((comparison.change < -options.min_change) &&
+                 (1.0 - comparison.test.p_value < options.alpha)) {
+        comparison.verdict = BenchmarkVerdict::kImproved;
+      }
+      baseline_by_name.erase(it);
+    }
+    diff.push_back(comparison);
+  }
+  for (const BenchmarkResult &result : baseline) {
+    if (baseline_by_name.count(result.name) > 0) {
+      diff.push_back({result.name, result.stats.median, 0.0, 0.0,
+                      {0.0, 0.0, 0.5}, BenchmarkVerdict::kMissing});
+    }
+  }
+  return diff;
+}
+
+void PrintBenchmarkComparison(std::ostream &os,
+                              const std::vector<BenchmarkComparison> &diff) {
+  os << std::left << std::setw(40) << "Benchmark" << std::right
+     << std::setw(12) << "Base us" << std::setw(12) << "Current us"
+     << std::setw(10) << "Change" << std::setw(9) << "t" << std::setw(10)
+     << "p" << std::setw(11) << "Verdict" << '\n';
+  int num_regressed = 0;
+  int num_improved = 0;
+  for (const BenchmarkComparison &comparison : diff) {
+    os << std::left << std::setw(40) << comparison.name << std::right
+       << std::fixed << std::setprecision(1);
+    if (comparison.verdict == BenchmarkVerdict::kNew) {
+      os << std::setw(12) << '-';
+    } else {
+      os << std::setw(12) << comparison.baseline_median;
+    }
+    if (comparison.verdict == BenchmarkVerdict::kMissing) {
+      os << std::setw(12) << '-';
+    } else {
+      os << std::setw(12) << comparison.current_median;
+    }
+    if ((comparison.verdict == BenchmarkVerdict::kNew) ||
+        (comparison.verdict == BenchmarkVerdict::kMissing)) {
+      os << std::setw(10) << '-' << std::setw(9) << '-' << std::setw(10)
+         << '-';
+    } else {
+      std::ostringstream change;
+      change << std::showpos << std::fixed << std::setprecision(1)
+             << 100.0 * comparison.change << '%';
+      os << std::setw(10) << change.str() << std::setprecision(2)
+         << std::setw(9) << comparison.test.t << std::scientific
+         << std::setprecision(1) << std::setw(10)
+         << comparison.test.p_value;
+    }
+    os << std::setw(11) << GetBenchmarkVerdictName(comparison.verdict)
+       << '\n';
+    os.unsetf(std::ios_base::floatfield);
+    num_regressed += comparison.verdict == BenchmarkVerdict::kRegressed;
+    num_improved += comparison.verdict == BenchmarkVerdict::kImproved;
+  }
+  os << std::setprecision(6);
+  os << num_regressed << " regressed, " << num_improved << " improved of "
+     << diff.size() << '\n';
+}
@@ -0,0 +1,96 @@
+#include "benchmark_test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<double> CreateSamples(double median, double noise, int count,
+                                  unsigned seed) {
+  std::mt19937 engine(seed);
+  std::normal_distribution<double> distribution(0.0, noise);
+  std::vector<double> samples;
+  for (int i = 0; i < count; i++) {
+    samples.push_back(median * std::exp(distribution(engine)));
+  }
+  return samples;
+}
+
+BenchmarkResult CreateResult(const std::vector<double> &samples) {
+  BenchmarkResult result;
+  result.name = "conv 8x8 4->4 k3 s1 p1 CPU";
+  result.params = {{"in_height", 8}, {"in_channels", 4}};
+  result.samples = samples;
+  result.stats = ComputeBenchmarkStats(samples);
+  result.flops = 36864;
+  result.correct = true;
+  result.max_error = 0.f;
+  return result;
+}
+
+}  // namespace
+
+void RunBenchmarkCompareUnitTest(double shift, double noise,
+                                 BenchmarkVerdict expected) {
+  std::cout << "shift = " << shift << ", noise = " << noise
+            << ", expected = " << GetBenchmarkVerdictName(expected) << '\n';
+  const char *path = "benchmark_test.json";
+  const std::vector<double> baseline = CreateSamples(100.0, noise, 20, 1);
+  WriteBenchmarkJson(path, {{"device", "test"}}, {CreateResult(baseline)});
+  std::vector<std::pair<std::string, std::string>> context;
+  std::vector<BenchmarkResult> loaded;
+  const bool found = ReadBenchmarkJson(path, &context, &loaded);
+  remove(path);
+  if (!found || (loaded.size() != 1) || (context.size() != 1) ||
+      (loaded[0].params.size() != 2) ||
+      (loaded[0].samples.size() != baseline.size())) {
+    std::cout << "Round trip lost data\n";
+    return;
+  }
+
+  const std::vector<double> current =
+      CreateSamples(100.0 * (1.0 + shift), noise, 20, 2);
+  const std::vector<BenchmarkComparison> diff =
+      CompareBenchmarks(loaded, {CreateResult(current)});
+  if ((diff.size() != 1) || (diff[0].verdict != expected)) {
+    std::cout << "Got "
+              << (diff.empty() ? "nothing"
+                               : GetBenchmarkVerdictName(diff[0].verdict))
+              << '\n';
+  } else {
+    std::cout << "Verdict is consistent with expected\n";
+  }
+}
+
+void RunBenchmarkTests() {
+  // 1..100 in reverse.
+  std::vector<double> samples;
+  for (int i = 100; i > 0; i--) {
+    samples.push_back(i);
+  }
+  const BenchmarkStats stats = ComputeBenchmarkStats(samples);
+  const bool stats_ok = (stats.min == 1.0) && (stats.median == 50.5) &&
+                        (stats.p99 == 99.0) && (stats.mean == 50.5);
+  std::cout << (stats_ok ? "Statistics are consistent with expected\n"
+                         : "Statistics are wrong\n");
+
+  // t = 2 with 8 degrees of freedom, one-sided p = 0.0403.
+  const WelchTest test =
+      RunWelchTTest({10, 11, 12, 13, 14}, {12, 13, 14, 15, 16});
+  const bool test_ok = (std::abs(test.t - 2.0) < 1e-9) &&
+                       (std::abs(test.dof - 8.0) < 1e-9) &&
+                       (std::abs(test.p_value - 0.0403) < 1e-4);
+  std::cout << (test_ok ? "Welch's t-test is consistent with expected\n"
+                        : "Welch's t-test is wrong\n");
+
+  RunBenchmarkCompareUnitTest(0.0, 0.05, BenchmarkVerdict::kUnchanged);
+  RunBenchmarkCompareUnitTest(0.2, 0.05, BenchmarkVerdict::kRegressed);
+  RunBenchmarkCompareUnitTest(-0.2, 0.05, BenchmarkVerdict::kImproved);
+  // Too noisy to call.
+  RunBenchmarkCompareUnitTest(0.05, 0.5, BenchmarkVerdict::kUnchanged);
+  // Significant, but below the minimum change.
+  RunBenchmarkCompareUnitTest(0.01, 0.001, BenchmarkVerdict::kUnchanged);
+}
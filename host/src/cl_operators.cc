@@ -0,0 +1,738 @@
+#include "cl_operators.h"
+
+#include <algorithm>
+#include <string>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Device tensor holding the first size values of data.
+std::shared_ptr<Tensor> CreateParamTensor(Workspace &ws,
+                                          const std::vector<float> &data,
+                                          int size) {
+  ASSERT(static_cast<int>(data.size()) >= size, "Not enough parameter data");
+  std::shared_ptr<Tensor> tensor(
+      new Tensor({size}, true, &ws, TensorBacking::kHost));
+  std::copy(data.begin(), data.begin() + size, tensor->GetData().begin());
+  return tensor;
+}
+
+// Device buffer of a tensor the kernel only reads.
+cl_mem *GetInputBuffer(Workspace &ws, Tensor &tensor) {
+  // Creates the buffer if needed, otherwise pushes dirty host data.
+  tensor.AllocateDevice(ws);
+  const Tensor &const_tensor = tensor;
+  return const_cast<cl_mem *>(&const_tensor.GetDeviceData());
+}
+
+// Device buffer of a tensor the kernel writes.
+cl_mem *GetOutputBuffer(Workspace &ws, Tensor &tensor) {
+  tensor.AllocateDevice(ws, false);
+  return &tensor.GetDeviceData();
+}
+
+// ConvoluteStride2 of the program at path for a stride 2 layer, null for
+// other strides.
+cl_kernel GetStride2Kernel(Workspace &ws, const char *path, int stride) {
+  return (stride == 2) ? ws.GetKernel(path, "ConvoluteStride2") : nullptr;
+}
+
+// Grow *buf, a device buffer of *capacity bytes, to at least size bytes.
+// Commands already enqueued keep the old buffer alive.
+void ReserveBuffer(Workspace &ws, cl_mem *buf, std::size_t *capacity,
+                   std::size_t size) {
+  if (size <= *capacity) {
+    return;
+  }
+  if (*buf != nullptr) {
+    clReleaseMemObject(*buf);
+  }
+  cl_int status;
+  *buf = clCreateBuffer(ws.GetContext(), CL_MEM_READ_WRITE, size, nullptr,
+                        &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create the scratch buffer");
+  *capacity = size;
+}
+
+}  // namespace
+
+ClConv2D::ClConv2D(Workspace &ws, int in_channels, int out_channels,
+                   int kernel_size, int stride, int padding,
+                   const std::vector<float> &kernel_data)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/conv2d.cl", "Convolute")),
+      preprocess_kernel_(nullptr),
+      stride2_kernel_(
+          GetStride2Kernel(ws, "/../device/conv2d.cl", stride)),
+      halo_kernel_(ws.GetKernel("/../device/conv2d.cl", "ConvoluteHalo")),
+      command_queue_(ws.GetCommandQueue()),
+      in_channels_(in_channels),
+      out_channels_(out_channels),
+      kernel_size_(kernel_size),
+      stride_(stride),
+      padding_(padding),
+      kernel_data_(CreateParamTensor(
+          ws, kernel_data,
+          out_channels * in_channels * kernel_size * kernel_size)),
+      frames_buf_(nullptr),
+      op_(in_channels, out_channels, kernel_size, stride, padding, false,
+          &kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+  if (stride2_kernel_ != nullptr) {
+    op_.SetStride2Kernel(&stride2_kernel_);
+  }
+  op_.SetHaloKernel(&halo_kernel_);
+}
+
+ClConv2D::ClConv2D(Workspace &ws, const ClConv2D &other)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/conv2d.cl", "Convolute")),
+      preprocess_kernel_(nullptr),
+      stride2_kernel_(
+          GetStride2Kernel(ws, "/../device/conv2d.cl", other.stride_)),
+      halo_kernel_(ws.GetKernel("/../device/conv2d.cl", "ConvoluteHalo")),
+      command_queue_(ws.GetCommandQueue()),
+      in_channels_(other.in_channels_),
+      out_channels_(other.out_channels_),
+      kernel_size_(other.kernel_size_),
+      stride_(other.stride_),
+      padding_(other.padding_),
+      kernel_data_(other.kernel_data_),
+      frames_buf_(nullptr),
+      op_(in_channels_, out_channels_, kernel_size_, stride_, padding_, false,
+          &kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+  if (stride2_kernel_ != nullptr) {
+    op_.SetStride2Kernel(&stride2_kernel_);
+  }
+  op_.SetHaloKernel(&halo_kernel_);
+}
+
+Backend ClConv2D::GetBackend() const {
+  return Backend::kOpenCL;
+}
+
+const char *ClConv2D::GetName() const {
+  return "Conv2D";
+}
+
+std::vector<int> ClConv2D::InferShape(const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  return InferConvShape(in_shape, out_channels_, kernel_size_, stride_,
+                        padding_);
+}
+
+OpCost ClConv2D::GetCost(const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return GetConv2DCost(in_shape, out_channels_, kernel_size_, stride_,
+                       padding_);
+}
+
+int ClConv2D::GetInputHalo() const {
+  // Stride 2 layers keep their tile kernel, which checks bounds only while
+  // loading.
+  if ((stride2_kernel_ != nullptr) || (kernel_size_ % 2 == 0)) {
+    return 0;
+  }
+  return padding_;
+}
+
+bool ClConv2D::SupportsHalo() const {
+  return true;
+}
+
+void ClConv2D::Prepare(const std::vector<int> &in_shape) {
+  InferShape(in_shape);
+  kernel_data_->PushToDevice(*ws_, CL_TRUE);
+}
+
+void ClConv2D::Run(Tensor &input, Tensor &output) {
+  std::vector<int> shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  op_.SetInBuffer((frames_buf_ != nullptr) ? frames_buf_
+                                           : GetInputBuffer(*ws_, input));
+  op_.SetOutBuffer(GetOutputBuffer(*ws_, output));
+  op_.SetHalo((frames_buf_ != nullptr) ? 0 : input.GetHalo(),
+              output.GetHalo());
+  op_.SetKernelBuffer(GetInputBuffer(*ws_, *kernel_data_));
+  op_.Run(shape, false);
+}
+
+std::unique_ptr<Operator> ClConv2D::Clone(Workspace *ws) const {
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClConv2D(*ws, *this));
+}
+
+void ClConv2D::FusePreprocess(cl_mem *frames_buf, cl_mem *scale_shift_buf,
+                              int src_height, int src_width) {
+  frames_buf_ = frames_buf;
+  if (frames_buf == nullptr) {
+    op_.SetPreprocess(nullptr, nullptr, 0, 0);
+    return;
+  }
+  if (preprocess_kernel_ == nullptr) {
+    preprocess_kernel_ =
+        ws_->GetKernel("/../device/conv2d.cl", "ConvolutePreprocessed");
+  }
+  op_.SetPreprocess(&preprocess_kernel_, scale_shift_buf, src_height,
+                    src_width);
+}
+
+bool ClConv2D::IsPreprocessFused() const {
+  return frames_buf_ != nullptr;
+}
+
+ClDepthwiseConv2D::ClDepthwiseConv2D(Workspace &ws, int channels,
+                                     int channel_multiplier, int kernel_size,
+                                     int stride, int padding,
+                                     const std::vector<float> &kernel_data)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/depthwise_conv2d.cl", "Convolute")),
+      stride2_kernel_(
+          GetStride2Kernel(ws, "/../device/depthwise_conv2d.cl", stride)),
+      halo_kernel_(
+          ws.GetKernel("/../device/depthwise_conv2d.cl", "ConvoluteHalo")),
+      command_queue_(ws.GetCommandQueue()),
+      channels_(channels),
+      channel_multiplier_(channel_multiplier),
+      kernel_size_(kernel_size),
+      stride_(stride),
+      padding_(padding),
+      kernel_data_(CreateParamTensor(
+          ws, kernel_data,
+          channels * channel_multiplier * kernel_size * kernel_size)),
+      op_(channels, kernel_size, stride, padding, channel_multiplier, false,
+          &kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+  if (stride2_kernel_ != nullptr) {
+    op_.SetStride2Kernel(&stride2_kernel_);
+  }
+  op_.SetHaloKernel(&halo_kernel_);
+}
+
+ClDepthwiseConv2D::ClDepthwiseConv2D(Workspace &ws,
+                                     const ClDepthwiseConv2D &other)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/depthwise_conv2d.cl", "Convolute")),
+      stride2_kernel_(
+          GetStride2Kernel(ws, "/../device/depthwise_conv2d.cl",
+                           other.stride_)),
+      halo_kernel_(
+          ws.GetKernel("/../device/depthwise_conv2d.cl", "ConvoluteHalo")),
+      command_queue_(ws.GetCommandQueue()),
+      channels_(other.channels_),
+      channel_multiplier_(other.channel_multiplier_),
+      kernel_size_(other.kernel_size_),
+      stride_(other.stride_),
+      padding_(other.padding_),
+      kernel_data_(other.kernel_data_),
+      op_(channels_, kernel_size_, stride_, padding_, channel_multiplier_,
+          false, &kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+  if (stride2_kernel_ != nullptr) {
+    op_.SetStride2Kernel(&stride2_kernel_);
+  }
+  op_.SetHaloKernel(&halo_kernel_);
+}
+
+Backend ClDepthwiseConv2D::GetBackend() const {
+  return Backend::kOpenCL;
+}
+
+const char *ClDepthwiseConv2D::GetName() const {
+  return "DepthwiseConv2D";
+}
+
+std::vector<int> ClDepthwiseConv2D::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  ASSERT(in_shape[1] == channels_, "Number of input channels");
+  return InferConvShape(in_shape, channels_ * channel_multiplier_,
+                        kernel_size_, stride_, padding_);
+}
+
+OpCost ClDepthwiseConv2D::GetCost(const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return GetDepthwiseConv2DCost(in_shape, channel_multiplier_, kernel_size_,
+                                stride_, padding_);
+}
+
+int ClDepthwiseConv2D::GetInputHalo() const {
+  // As for ClConv2D.
+  if ((stride2_kernel_ != nullptr) || (kernel_size_ % 2 == 0)) {
+    return 0;
+  }
+  return padding_;
+}
+
+bool ClDepthwiseConv2D::SupportsHalo() const {
+  return true;
+}
+
+void ClDepthwiseConv2D::Prepare(const std::vector<int> &in_shape) {
+  InferShape(in_shape);
+  kernel_data_->PushToDevice(*ws_, CL_TRUE);
+}
+
+void ClDepthwiseConv2D::Run(Tensor &input, Tensor &output) {
+  std::vector<int> shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  op_.SetInBuffer(GetInputBuffer(*ws_, input));
+  op_.SetOutBuffer(GetOutputBuffer(*ws_, output));
+  op_.SetHalo(input.GetHalo(), output.GetHalo());
+  op_.SetKernelBuffer(GetInputBuffer(*ws_, *kernel_data_));
+  op_.Run(shape, false);
+}
+
+std::unique_ptr<Operator> ClDepthwiseConv2D::Clone(Workspace *ws) const {
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClDepthwiseConv2D(*ws, *this));
+}
+
+ClBatchNorm::ClBatchNorm(Workspace &ws, int num_features, float eps,
+                         float relu, const std::vector<float> &weights,
+                         const std::vector<float> &biases,
+                         BatchNormStats stats)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/batchnorm2d.cl", "BatchNorm")),
+      reduce_kernel_(ws.GetKernel("/../device/reduce.cl", "Reduce")),
+      apply_kernel_(
+          ws.GetKernel("/../device/batchnorm2d.cl", "BatchNormApply")),
+      command_queue_(ws.GetCommandQueue()),
+      num_features_(num_features),
+      eps_(eps),
+      relu_(relu),
+      stats_(stats),
+      weights_(CreateParamTensor(ws, weights, num_features)),
+      biases_(CreateParamTensor(ws, biases, num_features)),
+      stats_buf_(nullptr),
+      scratch_buf_(nullptr),
+      stats_capacity_(0),
+      scratch_capacity_(0),
+      op_(num_features, eps, relu, &kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+  op_.SetStats(stats);
+}
+
+ClBatchNorm::ClBatchNorm(Workspace &ws, const ClBatchNorm &other)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/batchnorm2d.cl", "BatchNorm")),
+      reduce_kernel_(ws.GetKernel("/../device/reduce.cl", "Reduce")),
+      apply_kernel_(
+          ws.GetKernel("/../device/batchnorm2d.cl", "BatchNormApply")),
+      command_queue_(ws.GetCommandQueue()),
+      num_features_(other.num_features_),
+      eps_(other.eps_),
+      relu_(other.relu_),
+      stats_(other.stats_),
+      weights_(other.weights_),
+      biases_(other.biases_),
+      stats_buf_(nullptr),
+      scratch_buf_(nullptr),
+      stats_capacity_(0),
+      scratch_capacity_(0),
+      op_(num_features_, eps_, relu_, &kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+  op_.SetStats(stats_);
+}
+
+ClBatchNorm::~ClBatchNorm() {
+  if (stats_buf_ != nullptr) {
+    clReleaseMemObject(stats_buf_);
+  }
+  if (scratch_buf_ != nullptr) {
+    clReleaseMemObject(scratch_buf_);
+  }
+}
+
+Backend ClBatchNorm::GetBackend() const {
+  return Backend::kOpenCL;
+}
+
+const char *ClBatchNorm::GetName() const {
+  return "BatchNorm";
+}
+
+bool ClBatchNorm::IsInPlace() const {
+  return true;
+}
+
+std::vector<int> ClBatchNorm::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  ASSERT(in_shape[1] == num_features_, "Number of input channels");
+  return in_shape;
+}
+
+OpCost ClBatchNorm::GetCost(const std::vector<int> &in_shape) const {
+  return GetBatchNormCost(InferShape(in_shape));
+}
+
+std::size_t ClBatchNorm::GetScratchSize(
+    const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return BatchNormOp::GetStatsSize(in_shape, stats_) +
+         BatchNormOp::GetScratchSize(in_shape, stats_);
+}
+
+bool ClBatchNorm::SupportsHalo() const {
+  return true;
+}
+
+void ClBatchNorm::Prepare(const std::vector<int> &in_shape) {
+  InferShape(in_shape);
+  weights_->PushToDevice(*ws_, CL_TRUE);
+  biases_->PushToDevice(*ws_, CL_TRUE);
+  ReserveBuffers(in_shape, 0);
+}
+
+void ClBatchNorm::ReserveBuffers(const std::vector<int> &in_shape,
+                                 int halo) {
+  ReserveBuffer(*ws_, &stats_buf_, &stats_capacity_,
+                BatchNormOp::GetStatsSize(in_shape, stats_, halo));
+  ReserveBuffer(*ws_, &scratch_buf_, &scratch_capacity_,
+                BatchNormOp::GetScratchSize(in_shape, stats_, halo));
+  op_.SetReduction(&reduce_kernel_, &apply_kernel_, &stats_buf_,
+                   &scratch_buf_);
+}
+
+void ClBatchNorm::Run(Tensor &input, Tensor &output) {
+  ASSERT(&input == &output, "BatchNorm runs in place");
+  InferShape(input.GetShape());
+  // The tensor is read before it is written, so push dirty host data first.
+  GetInputBuffer(*ws_, input);
+  op_.SetTensorBuffer(GetOutputBuffer(*ws_, input));
+  op_.SetWeightBuffer(GetInputBuffer(*ws_, *weights_));
+  op_.SetBiasBuffer(GetInputBuffer(*ws_, *biases_));
+  op_.SetHalo(input.GetHalo());
+  ReserveBuffers(input.GetShape(), input.GetHalo());
+  op_.Run(input.GetShape(), false);
+}
+
+std::unique_ptr<Operator> ClBatchNorm::Clone(Workspace *ws) const {
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClBatchNorm(*ws, *this));
+}
+
+ClSoftmax::ClSoftmax(Workspace &ws)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/softmax.cl", "Softmax")),
+      command_queue_(ws.GetCommandQueue()),
+      op_(&kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+}
+
+Backend ClSoftmax::GetBackend() const {
+  return Backend::kOpenCL;
+}
+
+const char *ClSoftmax::GetName() const {
+  return "Softmax";
+}
+
+bool ClSoftmax::IsInPlace() const {
+  return true;
+}
+
+std::vector<int> ClSoftmax::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() >= 2, "Expects a batch of at least 1D images");
+  return in_shape;
+}
+
+OpCost ClSoftmax::GetCost(const std::vector<int> &in_shape) const {
+  return GetSoftmaxCost(InferShape(in_shape));
+}
+
+void ClSoftmax::Run(Tensor &input, Tensor &output) {
+  ASSERT(&input == &output, "Softmax runs in place");
+  InferShape(input.GetShape());
+  // The tensor is read before it is written, so push dirty host data first.
+  GetInputBuffer(*ws_, input);
+  op_.SetTensorBuffer(GetOutputBuffer(*ws_, input));
+  op_.Run(input.GetShape(), false);
+}
+
+std::unique_ptr<Operator> ClSoftmax::Clone(Workspace *ws) const {
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClSoftmax(*ws));
+}
+
+ClReduce::ClReduce(Workspace &ws, Reduction reduction, int axis,
+                   int num_axes)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/reduce.cl", "Reduce")),
+      command_queue_(ws.GetCommandQueue()),
+      reduction_(reduction),
+      axis_(axis),
+      num_axes_(num_axes),
+      scratch_buf_(nullptr),
+      scratch_capacity_(0),
+      op_(reduction, &kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+}
+
+ClReduce::~ClReduce() {
+  if (scratch_buf_ != nullptr) {
+    clReleaseMemObject(scratch_buf_);
+  }
+}
+
+Backend ClReduce::GetBackend() const {
+  return Backend::kOpenCL;
+}
+
+const char *ClReduce::GetName() const {
+  return "Reduce";
+}
+
+std::vector<int> ClReduce::InferShape(
+    const std::vector<int> &in_shape) const {
+  return GetReduceShape(in_shape, axis_, num_axes_);
+}
+
+OpCost ClReduce::GetCost(const std::vector<int> &in_shape) const {
+  return GetReduceCost(in_shape, reduction_, axis_, num_axes_);
+}
+
+std::size_t ClReduce::GetScratchSize(const std::vector<int> &in_shape) const {
+  return ReduceOp::GetScratchSize(in_shape, axis_, num_axes_);
+}
+
+void ClReduce::Prepare(const std::vector<int> &in_shape) {
+  InferShape(in_shape);
+  ReserveBuffer(*ws_, &scratch_buf_, &scratch_capacity_,
+                GetScratchSize(in_shape));
+}
+
+void ClReduce::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  Prepare(shape);
+  op_.SetInBuffer(GetInputBuffer(*ws_, input));
+  op_.SetOutBuffer(GetOutputBuffer(*ws_, output));
+  op_.SetScratchBuffer(&scratch_buf_);
+  op_.Run(shape, axis_, num_axes_, false);
+}
+
+std::unique_ptr<Operator> ClReduce::Clone(Workspace *ws) const {
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(
+      new ClReduce(*ws, reduction_, axis_, num_axes_));
+}
+
+ClGlobalAvgPool::ClGlobalAvgPool(Workspace &ws)
+    : ws_(&ws),
+      kernel_(ws.GetKernel("/../device/reduce.cl", "Reduce")),
+      command_queue_(ws.GetCommandQueue()),
+      scratch_buf_(nullptr),
+      scratch_capacity_(0),
+      op_(&kernel_, &command_queue_) {
+  op_.SetProfiler(ws.GetProfiler());
+}
+
+ClGlobalAvgPool::~ClGlobalAvgPool() {
+  if (scratch_buf_ != nullptr) {
+    clReleaseMemObject(scratch_buf_);
+  }
+}
+
+Backend ClGlobalAvgPool::GetBackend() const {
+  return Backend::kOpenCL;
+}
+
+const char *ClGlobalAvgPool::GetName() const {
+  return "GlobalAvgPool";
+}
+
+std::vector<int> ClGlobalAvgPool::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  return {in_shape[0], in_shape[1], 1, 1};
+}
+
+OpCost ClGlobalAvgPool::GetCost(const std::vector<int> &in_shape) const {
+  return GetGlobalAvgPoolCost(in_shape);
+}
+
+std::size_t ClGlobalAvgPool::GetScratchSize(
+    const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return GlobalAvgPoolOp::GetScratchSize(in_shape);
+}
+
+void ClGlobalAvgPool::Prepare(const std::vector<int> &in_shape) {
+  ReserveBuffer(*ws_, &scratch_buf_, &scratch_capacity_,
+                GetScratchSize(in_shape));
+}
+
+void ClGlobalAvgPool::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  Prepare(shape);
+  op_.SetInBuffer(GetInputBuffer(*ws_, input));
+  op_.SetOutBuffer(GetOutputBuffer(*ws_, output));
+  op_.SetScratchBuffer(&scratch_buf_);
+  op_.Run(shape, false);
+}
+
+std::unique_ptr<Operator> ClGlobalAvgPool::Clone(Workspace *ws) const {
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClGlobalAvgPool(*ws));
+}
+
+ClFullyConnected::ClFullyConnected(Workspace &ws, int in_features,
+                                   int out_features,
+                                   const std::vector<float> &weights,
+                                   const std::vector<float> &biases,
+                                   bool pool_input)
+    : ws_(&ws),
+      gemv_kernel_(
+          ws.GetKernel("/../device/fully_connected.cl", "FullyConnectedGemv")),
+      gemm_kernel_(
+          ws.GetKernel("/../device/fully_connected.cl", "FullyConnectedGemm")),
+      reduce_kernel_(pool_input ? ws.GetKernel("/../device/reduce.cl", "Reduce")
+                                : nullptr),
+      command_queue_(ws.GetCommandQueue()),
+      in_features_(in_features),
+      out_features_(out_features),
+      pool_input_(pool_input),
+      weights_(CreateParamTensor(ws, weights, out_features * in_features)),
+      biases_(CreateParamTensor(ws, biases, out_features)),
+      pooled_buf_(nullptr),
+      scratch_buf_(nullptr),
+      pooled_capacity_(0),
+      scratch_capacity_(0),
+      pool_op_(&reduce_kernel_, &command_queue_),
+      op_(in_features, out_features, &gemv_kernel_, &gemm_kernel_,
+          &command_queue_) {
+  pool_op_.SetProfiler(ws.GetProfiler());
+  pool_op_.SetSum(true);
+  op_.SetProfiler(ws.GetProfiler());
+}
+
+ClFullyConnected::ClFullyConnected(Workspace &ws,
+                                   const ClFullyConnected &other)
+    : ws_(&ws),
+      gemv_kernel_(
+          ws.GetKernel("/../device/fully_connected.cl", "FullyConnectedGemv")),
+      gemm_kernel_(
+          ws.GetKernel("/../device/fully_connected.cl", "FullyConnectedGemm")),
+      reduce_kernel_(other.pool_input_
+                         ? ws.GetKernel("/../device/reduce.cl", "Reduce")
+                         : nullptr),
+      command_queue_(ws.GetCommandQueue()),
+      in_features_(other.in_features_),
+      out_features_(other.out_features_),
+      pool_input_(other.pool_input_),
+      weights_(other.weights_),
+      biases_(other.biases_),
+      pooled_buf_(nullptr),
+      scratch_buf_(nullptr),
+      pooled_capacity_(0),
+      scratch_capacity_(0),
+      pool_op_(&reduce_kernel_, &command_queue_),
+      op_(in_features_, out_features_, &gemv_kernel_, &gemm_kernel_,
+          &command_queue_) {
+  pool_op_.SetProfiler(ws.GetProfiler());
+  pool_op_.SetSum(true);
+  op_.SetProfiler(ws.GetProfiler());
+}
+
+ClFullyConnected::~ClFullyConnected() {
+  if (pooled_buf_ != nullptr) {
+    clReleaseMemObject(pooled_buf_);
+  }
+  if (scratch_buf_ != nullptr) {
+    clReleaseMemObject(scratch_buf_);
+  }
+}
+
+Backend ClFullyConnected::GetBackend() const {
+  return Backend::kOpenCL;
+}
+
+const char *ClFullyConnected::GetName() const {
+  return "FullyConnected";
+}
+
+std::vector<int> ClFullyConnected::InferShape(
+    const std::vector<int> &in_shape) const {
+  if (pool_input_) {
+    ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+    ASSERT(in_shape[1] == in_features_, "Number of input channels");
+  } else {
+    ASSERT(!in_shape.empty(), "Expects a batch");
+    int size = 1;
+    for (std::size_t d = 1; d < in_shape.size(); d++) {
+      size *= in_shape[d];
+    }
+    ASSERT(size == in_features_, "Number of input features");
+  }
+  return {in_shape[0], out_features_};
+}
+
+OpCost ClFullyConnected::GetCost(const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return GetFullyConnectedCost(in_shape, out_features_, pool_input_);
+}
+
+std::size_t ClFullyConnected::GetScratchSize(
+    const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  if (!pool_input_) {
+    return 0;
+  }
+  return sizeof(float) * in_shape[0] * in_features_ +
+         GlobalAvgPoolOp::GetScratchSize(in_shape);
+}
+
+void ClFullyConnected::Prepare(const std::vector<int> &in_shape) {
+  InferShape(in_shape);
+  weights_->PushToDevice(*ws_, CL_TRUE);
+  biases_->PushToDevice(*ws_, CL_TRUE);
+  ReserveBuffers(in_shape);
+}
+
+void ClFullyConnected::ReserveBuffers(const std::vector<int> &in_shape) {
+  if (!pool_input_) {
+    return;
+  }
+  ReserveBuffer(*ws_, &pooled_buf_, &pooled_capacity_,
+                sizeof(float) * in_shape[0] * in_features_);
+  ReserveBuffer(*ws_, &scratch_buf_, &scratch_capacity_,
+                GlobalAvgPoolOp::GetScratchSize(in_shape));
+}
+
+void ClFullyConnected::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  if (pool_input_) {
+    // The sums of the channels, the division by their size folded into the
+    // scale of the inputs.
+    ReserveBuffers(shape);
+    pool_op_.SetInBuffer(GetInputBuffer(*ws_, input));
+    pool_op_.SetOutBuffer(&pooled_buf_);
+    pool_op_.SetScratchBuffer(&scratch_buf_);
+    pool_op_.Run(shape, false);
+    op_.SetInBuffer(&pooled_buf_);
+    op_.SetInScale(1.f / (shape[2] * shape[3]));
+  } else {
+    op_.SetInBuffer(GetInputBuffer(*ws_, input));
+  }
+  op_.SetWeightBuffer(GetInputBuffer(*ws_, *weights_));
+  op_.SetBiasBuffer(GetInputBuffer(*ws_, *biases_));
+  op_.SetOutBuffer(GetOutputBuffer(*ws_, output));
+  op_.Run({shape[0], in_features_}, false);
+}
+
+std::unique_ptr<Operator> ClFullyConnected::Clone(Workspace *ws) const {
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClFullyConnected(*ws, *this));
+}
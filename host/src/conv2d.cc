@@ -1,5 +1,8 @@
 #include "conv2d.h"
 
+#include "cpu_kernels.h"
+#include "gemm.h"
+
 void RunConv2DRef(const float *in_data,
                   float *out_data,
                   const float *kernel_data,
@@ -74,13 +77,236 @@ void RunConv2DRef(const std::vector<float> &in_data,
                   int padding) {
   const int in_height = tensor_shape[2];
   const int in_width = tensor_shape[3];
-  RunConv2DRef(in_data.data(), out_data.data(), kernel_data.data(), in_height,
-               in_width, tensor_shape[1], out_channels, kernel_size, stride,
-               padding);
   const int out_height = ((in_height + 2 * padding - kernel_size) / stride) + 1;
   const int out_width = ((in_width + 2 * padding - kernel_size) / stride) + 1;
+  const int in_image_size = tensor_shape[1] * in_height * in_width;
+  const int out_image_size = out_channels * out_height * out_width;
+  for (int n = 0; n < tensor_shape[0]; n++) {
+    RunConv2DRef(in_data.data() + n * in_image_size,
+                 out_data.data() + n * out_image_size, kernel_data.data(),
+                 in_height, in_width, tensor_shape[1], out_channels,
+                 kernel_size, stride, padding);
+  }
   tensor_shape[1] = out_channels;
   tensor_shape[2] = out_height;
   tensor_shape[3] = out_width;
 }
 
+namespace {
+
+// Output channels computed together, so each input row is loaded once per
+// block rather than once per channel.
+const int kConvChannelBlock = 4;
+// Depth (in_channels * kernel_size^2) from which kAuto picks im2col. Below
+// it the GEMM panels are mostly padding.
+const int kIm2colMinDepth = 16;
+
+void RunConv2DDirect(const float *in_data,
+                     float *out_data,
+                     const float *kernel_data,
+                     int in_height,
+                     int in_width,
+                     int in_channels,
+                     int out_channels,
+                     int kernel_size,
+                     int stride,
+                     int padding,
+                     int out_height,
+                     int out_width,
+                     ThreadPool *pool) {
+  const int in_size = in_height * in_width;
+  const int out_size = out_height * out_width;
+  const int kernel_area = kernel_size * kernel_size;
+  const int batch_kernel_size = in_channels * kernel_area;
+  const int num_blocks =
+      (out_channels + kConvChannelBlock - 1) / kConvChannelBlock;
+
+  // A work item is one output row of a block of output channels.
+  pool->ParallelFor(num_blocks * out_height, 1, [&](int begin, int end) {
+    for (int item = begin; item < end; item++) {
+      const int oc = (item / out_height) * kConvChannelBlock;
+      const int oi = item % out_height;
+      const int num_rows = std::min(kConvChannelBlock, out_channels - oc);
+      float *out_row = out_data + oc * out_size + oi * out_width;
+      for (int b = 0; b < num_rows; b++) {
+        std::fill(out_row + b * out_size, out_row + b * out_size + out_width,
+                  0.f);
+      }
+      for (int ic = 0; ic < in_channels; ic++) {
+        const float *in_plane = in_data + ic * in_size;
+        const float *kernel =
+            kernel_data + oc * batch_kernel_size + ic * kernel_area;
+        for (int kr = 0; kr < kernel_size; kr++) {
+          const int r = oi * stride - padding + kr;
+          if ((r < 0) || (r >= in_height)) {
+            continue;
+          }
+          const float *in_row = in_plane + r * in_width;
+          for (int kc = 0; kc < kernel_size; kc++) {
+            int col_begin, col_end;
+            GetValidOutputRange(in_width, out_width, stride, kc - padding,
+                                &col_begin, &col_end);
+            if (col_begin == col_end) {
+              continue;
+            }
+            AccumulateRows(in_row + col_begin * stride + kc - padding, stride,
+                           col_end - col_begin,
+                           kernel + kr * kernel_size + kc, batch_kernel_size,
+                           num_rows, out_row + col_begin, out_size);
+          }
+        }
+      }
+    }
+  });
+}
+
+void RunConv2DIm2col(const float *in_data,
+                     float *out_data,
+                     const float *kernel_data,
+                     int in_height,
+                     int in_width,
+                     int in_channels,
+                     int out_channels,
+                     int kernel_size,
+                     int stride,
+                     int padding,
+                     int out_height,
+                     int out_width,
+                     ThreadPool *pool) {
+  const int in_size = in_height * in_width;
+  const int out_size = out_height * out_width;
+  const int kernel_area = kernel_size * kernel_size;
+  const int depth = in_channels * kernel_area;
+
+  if ((kernel_size == 1) && (stride == 1) && (padding == 0)) {
+    RunSgemm(out_channels, out_size, depth, kernel_data, depth, in_data,
+             out_size, out_data, out_size, false, pool);
+    return;
+  }
+
+  // Row (ic, kr, kc) of the matrix holds the input seen by kernel tap
+  // (kr, kc) of channel ic at every output position. The buffer is the
+  // caller's; the workers write it through cols.
+  static thread_local std::vector<float> columns;
+  columns.resize(static_cast<std::size_t>(depth) * out_size);
+  float *cols = columns.data();
+  pool->ParallelFor(depth, 4, [&](int begin, int end) {
+    for (int row = begin; row < end; row++) {
+      const int ic = row / kernel_area;
+      const int kr = (row % kernel_area) / kernel_size;
+      const int kc = row % kernel_size;
+      const float *in_plane = in_data + ic * in_size;
+      float *col = cols + static_cast<std::size_t>(row) * out_size;
+      int col_begin, col_end;
+      GetValidOutputRange(in_width, out_width, stride, kc - padding,
+                          &col_begin, &col_end);
+      for (int oi = 0; oi < out_height; oi++) {
+        float *out_row = col + oi * out_width;
+        const int r = oi * stride - padding + kr;
+        if ((r < 0) || (r >= in_height) || (col_begin == col_end)) {
+          std::fill(out_row, out_row + out_width, 0.f);
+          continue;
+        }
+        const float *in_row =
+            in_plane + r * in_width + col_begin * stride + kc - padding;
+        std::fill(out_row, out_row + col_begin, 0.f);
+        for (int oj = col_begin; oj < col_end; oj++) {
+          out_row[oj] = in_row[(oj - col_begin) * stride];
+        }
+        std::fill(out_row + col_end, out_row + out_width, 0.f);
+      }
+    }
+  });
+  RunSgemm(out_channels, out_size, depth, kernel_data, depth, cols,
+           out_size, out_data, out_size, false, pool);
+}
+
+}  // namespace
+
+const char *GetConv2DAlgorithmName(Conv2DAlgorithm algorithm) {
+  switch (algorithm) {
+    case Conv2DAlgorithm::kDirect:
+      return "direct";
+    case Conv2DAlgorithm::kIm2col:
+      return "im2col";
+    default:
+      return "auto";
+  }
+}
+
+void RunConv2DCpu(const float *in_data,
+                  float *out_data,
+                  const float *kernel_data,
+                  int in_height,
+                  int in_width,
+                  int in_channels,
+                  int out_channels,
+                  int kernel_size,
+                  int stride,
+                  int padding,
+                  Conv2DAlgorithm algorithm,
+                  ThreadPool *pool) {
+  const int out_height = ((in_height + 2 * padding - kernel_size) / stride) + 1;
+  const int out_width = ((in_width + 2 * padding - kernel_size) / stride) + 1;
+  if (pool == nullptr) {
+    pool = &ThreadPool::GetDefault();
+  }
+  if (algorithm == Conv2DAlgorithm::kAuto) {
+    algorithm = (in_channels * kernel_size * kernel_size >= kIm2colMinDepth)
+                    ? Conv2DAlgorithm::kIm2col
+                    : Conv2DAlgorithm::kDirect;
+  }
+  if (algorithm == Conv2DAlgorithm::kIm2col) {
+    RunConv2DIm2col(in_data, out_data, kernel_data, in_height, in_width,
+                    in_channels, out_channels, kernel_size, stride, padding,
+                    out_height, out_width, pool);
+  } else {
+    RunConv2DDirect(in_data, out_data, kernel_data, in_height, in_width,
+                    in_channels, out_channels, kernel_size, stride, padding,
+                    out_height, out_width, pool);
+  }
+}
+
+void RunConv2DCpu(const std::vector<float> &in_data,
+                  std::vector<float> &out_data,
+                  const std::vector<float> &kernel_data,
+                  int in_height,
+                  int in_width,
+                  int in_channels,
+                  int out_channels,
+                  int kernel_size,
+                  int stride,
+                  int padding,
+                  Conv2DAlgorithm algorithm,
+                  ThreadPool *pool) {
+  RunConv2DCpu(in_data.data(), out_data.data(), kernel_data.data(), in_height,
+               in_width, in_channels, out_channels, kernel_size, stride,
+               padding, algorithm, pool);
+}
+
+void RunConv2DCpu(const std::vector<float> &in_data,
+                  std::vector<float> &out_data,
+                  const std::vector<float> &kernel_data,
+                  std::vector<int> &tensor_shape,
+                  int out_channels,
+                  int kernel_size,
+                  int stride,
+                  int padding,
+                  Conv2DAlgorithm algorithm,
+                  ThreadPool *pool) {
+  const int in_height = tensor_shape[2];
+  const int in_width = tensor_shape[3];
+  const int out_height = ((in_height + 2 * padding - kernel_size) / stride) + 1;
+  const int out_width = ((in_width + 2 * padding - kernel_size) / stride) + 1;
+  const int in_image_size = tensor_shape[1] * in_height * in_width;
+  const int out_image_size = out_channels * out_height * out_width;
+  for (int n = 0; n < tensor_shape[0]; n++) {
+    RunConv2DCpu(in_data.data() + n * in_image_size,
+                 out_data.data() + n * out_image_size, kernel_data.data(),
+                 in_height, in_width, tensor_shape[1], out_channels,
+                 kernel_size, stride, padding, algorithm, pool);
+  }
+  tensor_shape[1] = out_channels;
+  tensor_shape[2] = out_height;
+  tensor_shape[3] = out_width;
+}
@@ -22,7 +22,17 @@ Conv2DOp::Conv2DOp(int in_channels, int out_channels, int kernel_size,
       command_queue_(command_queue),
       in_buf_(in_buf),
       out_buf_(out_buf),
-      kernel_buf_(kernel_buf) {}
+      kernel_buf_(kernel_buf),
+      preprocess_kernel_(nullptr),
+      scale_shift_buf_(nullptr),
+      src_height_(0),
+      src_width_(0),
+      stride2_kernel_(nullptr),
+      halo_kernel_(nullptr),
+      in_halo_(0),
+      out_halo_(0),
+      plan_(nullptr),
+      profiler_(nullptr) {}
 
 void Conv2DOp::SetInBuffer(cl_mem *buf) {
   in_buf_ = buf;
@@ -36,6 +46,35 @@ void Conv2DOp::SetKernelBuffer(cl_mem *buf) {
   kernel_buf_ = buf;
 }
 
+void Conv2DOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
+
+void Conv2DOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+void Conv2DOp::SetPreprocess(cl_kernel *kernel, cl_mem *scale_shift_buf,
+                             int src_height, int src_width) {
+  preprocess_kernel_ = kernel;
+  scale_shift_buf_ = scale_shift_buf;
+  src_height_ = src_height;
+  src_width_ = src_width;
+}
+
+void Conv2DOp::SetStride2Kernel(cl_kernel *kernel) {
+  stride2_kernel_ = kernel;
+}
+
+void Conv2DOp::SetHaloKernel(cl_kernel *kernel) {
+  halo_kernel_ = kernel;
+}
+
+void Conv2DOp::SetHalo(int in_halo, int out_halo) {
+  in_halo_ = in_halo;
+  out_halo_ = out_halo;
+}
+
 void Conv2DOp::Run(std::vector<int> &shape, bool blocking) {
   const static cl_uint wg_dim = 3;
   const static cl_uint wg_width = 8;
@@ -52,10 +91,15 @@ void Conv2DOp::Run(std::vector<int> &shape, bool blocking) {
   const int in_height = shape[2];
   const int in_width = shape[3];
   const int in_size = in_height * in_width;
+  const int out_height = ((in_height + 2 * padding_ - kernel_size_) / stride_) + 1;
+  const int out_width = ((in_width + 2 * padding_ - kernel_size_) / stride_) + 1;
+  const int out_size = out_height * out_width;
   cl_int status;
-  const cl_uint total_work_items_x = RoundUp(in_width, wg_width);
-  const cl_uint total_work_items_y = RoundUp(in_height, wg_height);
-  const cl_uint total_work_items_z = RoundUp(out_channels_, wg_depth);
+  // A work item per output pixel.
+  const cl_uint total_work_items_x = RoundUp(out_width, wg_width);
+  const cl_uint total_work_items_y = RoundUp(out_height, wg_height);
+  // The images of the batch are folded into the channel dimension.
+  const cl_uint total_work_items_z = RoundUp(batch * out_channels_, wg_depth);
 
   std::size_t global_size[wg_dim] = {
     static_cast<std::size_t>(total_work_items_x),
@@ -68,44 +112,42 @@ void Conv2DOp::Run(std::vector<int> &shape, bool blocking) {
     static_cast<std::size_t>(wg_depth)
   };
 
-  const int out_height = ((in_height + 2 * padding_ - kernel_size_) / stride_) + 1;
-  const int out_width = ((in_width + 2 * padding_ - kernel_size_) / stride_) + 1;
-  const int out_size = out_height * out_width;
-  cl_uint arg_idx = 0;
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(cl_mem), in_buf_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(cl_mem), out_buf_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(cl_mem), kernel_buf_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &in_height);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &in_width);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &in_size);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &out_height);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &out_width);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &out_size);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &in_channels_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &out_channels_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &kernel_size_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &batch_kernel_size_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &stride_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-  status = clSetKernelArg(*kernel_, arg_idx++, sizeof(int), &padding_);
-  ASSERT(status == CL_SUCCESS, "Failed to set the argument " + std::to_string(arg_idx));
-
-  status = clEnqueueNDRangeKernel(*command_queue_, *kernel_, wg_dim, nullptr,
-                                  global_size, local_size, 0, nullptr, nullptr);
+  std::vector<KernelArg> args{
+      *in_buf_, *out_buf_, *kernel_buf_, batch, in_height, in_width,
+      in_size, out_height, out_width, out_size, in_channels_, out_channels_,
+      kernel_size_, batch_kernel_size_, stride_, padding_, out_halo_};
+  cl_kernel kernel = *kernel_;
+  if (preprocess_kernel_ != nullptr) {
+    ASSERT(scale_shift_buf_ != nullptr, "scale shift buffer is null");
+    ASSERT((src_height_ >= in_height) && (src_width_ >= in_width),
+           "Frames are smaller than the input");
+    kernel = *preprocess_kernel_;
+    args.insert(args.end(), {*scale_shift_buf_, src_height_, src_width_});
+  } else if (in_halo_ > 0) {
+    ASSERT(halo_kernel_ != nullptr, "halo kernel is null");
+    ASSERT(in_halo_ == padding_, "The input halo must be the padding");
+    kernel = *halo_kernel_;
+  } else if ((stride2_kernel_ != nullptr) && (stride_ == 2) &&
+             (kernel_size_ % 2 == 1)) {
+    // An input window per output channel of the work-group.
+    const int tile_rows = 2 * wg_height + kernel_size_ - 2;
+    const int tile_cols = 2 * (wg_width + kernel_size_ / 2);
+    kernel = *stride2_kernel_;
+    args.push_back(KernelArg::LocalMemory(sizeof(float) * wg_depth *
+                                          tile_rows * tile_cols));
+  }
+  SetKernelArgs(kernel, args);
+
+  ProfileEvent event(profiler_, "Conv2D", ProfileKind::kKernel);
+  status = clEnqueueNDRangeKernel(*command_queue_, kernel, wg_dim, nullptr,
+                                  global_size, local_size, 0, nullptr,
+                                  event.Get());
   ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(kernel, args, wg_dim, global_size, local_size,
+                        "Conv2D");
+  }
 
   if (blocking) {
     clFinish(*command_queue_);
@@ -117,11 +159,15 @@ void Conv2DOp::Run(std::vector<int> &shape, bool blocking) {
 }
 
 void Conv2DOp::Run(std::vector<int> &shape, bool blocking, float *out_data) {
+  ASSERT(out_halo_ == 0, "Read outputs with a halo through the Tensor");
   Run(shape, blocking);
   int tensor_size =
       std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<int>());
   std::size_t raw_tensor_size = sizeof(float) * tensor_size;
-  clEnqueueReadBuffer(*command_queue_, *out_buf_, blocking, 0, raw_tensor_size,
-                      out_data, 0, nullptr, nullptr);
+  ProfileEvent event(profiler_, "Conv2D output", ProfileKind::kRead);
+  cl_int status =
+      clEnqueueReadBuffer(*command_queue_, *out_buf_, blocking, 0,
+                          raw_tensor_size, out_data, 0, nullptr, event.Get());
+  event.Commit(status);
 }
 
@@ -0,0 +1,349 @@
+#include "conv_selector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+#include "cpu_kernels.h"
+#include "cpu_operators.h"
+#include "memory_activation.h"
+
+namespace {
+
+// Throughput per thread of the host conv algorithms, in GFLOP/s, measured
+// on the conv tests.
+double GetCpuDirectGflops(CpuIsa isa) {
+  switch (isa) {
+    case CpuIsa::kAvx512:
+      return 14.0;
+    case CpuIsa::kAvx2:
+      return 8.0;
+    default:
+      return 2.0;
+  }
+}
+
+double GetCpuIm2colGflops(CpuIsa isa) {
+  switch (isa) {
+    case CpuIsa::kAvx512:
+      return 45.0;
+    case CpuIsa::kAvx2:
+      return 25.0;
+    default:
+      return 4.0;
+  }
+}
+
+// Fraction of the device peak reached by the direct conv kernel.
+const double kDeviceConvEfficiency = 0.1;
+// Flops per cycle of a compute unit: two SIMD4 FMA pipes.
+const double kDeviceFlopsPerCycle = 16.0;
+
+std::string GetDeviceName(Workspace &ws) {
+  std::size_t size = 0;
+  clGetDeviceInfo(ws.GetDeviceID(), CL_DEVICE_NAME, 0, nullptr, &size);
+  std::vector<char> name(size + 1, '\0');
+  clGetDeviceInfo(ws.GetDeviceID(), CL_DEVICE_NAME, size, name.data(),
+                  nullptr);
+  return name.data();
+}
+
+cl_uint GetDeviceUint(Workspace &ws, cl_device_info param) {
+  cl_uint value = 0;
+  cl_int status = clGetDeviceInfo(ws.GetDeviceID(), param, sizeof(value),
+                                  &value, nullptr);
+  return (status == CL_SUCCESS) ? value : 0;
+}
+
+int GetOutSize(int in_size, const ConvLayer &layer) {
+  return (in_size + 2 * layer.padding - layer.kernel_size) / layer.stride + 1;
+}
+
+}  // namespace
+
+ConvSelector::ConvSelector(Workspace *ws, ThreadPool *pool)
+    : ws_(ws),
+      pool_((pool != nullptr) ? pool : &ThreadPool::GetDefault()),
+      num_trial_runs_(0) {
+  const int num_threads = pool_->GetNumThreads();
+  const CpuIsa isa = GetCpuIsa();
+  cost_model_.cpu_direct_gflops = GetCpuDirectGflops(isa) * num_threads;
+  cost_model_.cpu_im2col_gflops = GetCpuIm2colGflops(isa) * num_threads;
+  cost_model_.cpu_bandwidth = std::min(8.0 * num_threads, 40.0);
+  cost_model_.cpu_launch_us = 5.0;
+
+  std::string device_name = "none";
+  if (ws_ != nullptr) {
+    const double compute_units =
+        GetDeviceUint(*ws_, CL_DEVICE_MAX_COMPUTE_UNITS);
+    const double clock_mhz = GetDeviceUint(*ws_, CL_DEVICE_MAX_CLOCK_FREQUENCY);
+    cost_model_.device_gflops = compute_units * clock_mhz * 1e-3 *
+                                kDeviceFlopsPerCycle * kDeviceConvEfficiency;
+    cost_model_.device_launch_us = 20.0;
+    device_name = GetDeviceName(*ws_);
+  } else {
+    cost_model_.device_gflops = 0.0;
+    cost_model_.device_launch_us = 0.0;
+  }
+  // Zero-copy tensors are only mapped between the backends on unified
+  // memory; otherwise they cross the bus.
+  const bool unified = (ws_ != nullptr) && ws_->HasUnifiedMemory();
+  cost_model_.device_bandwidth = unified ? 20.0 : 100.0;
+  cost_model_.transfer_bandwidth = unified ? 1e3 : 8.0;
+  cost_model_.transfer_us = unified ? 10.0 : 20.0;
+
+  device_key_ = device_name + '/' + GetCpuIsaName(isa) + 'x' +
+                std::to_string(num_threads);
+  std::replace(device_key_.begin(), device_key_.end(), ' ', '_');
+}
+
+void ConvSelector::SetTrialRuns(int num_runs) {
+  ASSERT(num_runs >= 0, "Number of trial runs");
+  num_trial_runs_ = num_runs;
+}
+
+ConvCostModel &ConvSelector::GetCostModel() {
+  return cost_model_;
+}
+
+std::vector<ConvImpl> ConvSelector::GetCandidates(
+    const ConvLayer &layer) const {
+  std::vector<ConvImpl> candidates;
+  if (ws_ != nullptr) {
+    candidates.push_back({Backend::kOpenCL, Conv2DAlgorithm::kDirect});
+  }
+  candidates.push_back({Backend::kCpu, Conv2DAlgorithm::kDirect});
+  if (!layer.depthwise) {
+    candidates.push_back({Backend::kCpu, Conv2DAlgorithm::kIm2col});
+  }
+  return candidates;
+}
+
+double ConvSelector::EstimateCost(const ConvLayer &layer,
+                                  const ConvImpl &impl) const {
+  const double out_size = static_cast<double>(layer.out_channels) *
+                          GetOutSize(layer.in_height, layer) *
+                          GetOutSize(layer.in_width, layer);
+  const double depth = (layer.depthwise ? 1 : layer.in_channels) *
+                       layer.kernel_size * layer.kernel_size;
+  const double flops = 2.0 * out_size * depth;
+  double bytes = sizeof(float) * (static_cast<double>(layer.in_channels) *
+                                      layer.in_height * layer.in_width +
+                                  out_size + layer.out_channels * depth);
+
+  double gflops;
+  double bandwidth;
+  double launch_us;
+  if (impl.backend == Backend::kOpenCL) {
+    gflops = cost_model_.device_gflops;
+    bandwidth = cost_model_.device_bandwidth;
+    launch_us = cost_model_.device_launch_us;
+  } else {
+    bandwidth = cost_model_.cpu_bandwidth;
+    launch_us = cost_model_.cpu_launch_us;
+    if (impl.algorithm == Conv2DAlgorithm::kIm2col) {
+      gflops = cost_model_.cpu_im2col_gflops;
+      if ((layer.kernel_size != 1) || (layer.stride != 1) ||
+          (layer.padding != 0)) {
+        // The column matrix is written and read back.
+        bytes += 2.0 * sizeof(float) * depth * out_size / layer.out_channels;
+      }
+    } else {
+      gflops = cost_model_.cpu_direct_gflops;
+    }
+  }
+  ASSERT((gflops > 0.0) && (bandwidth > 0.0), "Cost model isn't set up");
+  // GFLOP/s and GB/s are flops and bytes per ns, so 1e3 per us.
+  return std::max(flops / (gflops * 1e3), bytes / (bandwidth * 1e3)) +
+         launch_us;
+}
+
+double ConvSelector::EstimateTransferCost(std::size_t size) const {
+  return sizeof(float) * size / (cost_model_.transfer_bandwidth * 1e3) +
+         cost_model_.transfer_us;
+}
+
+double ConvSelector::GetCost(const ConvLayer &layer, const ConvImpl &impl) {
+  const std::string key = GetCacheKey(layer, impl);
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    return it->second;
+  }
+  if (num_trial_runs_ == 0) {
+    return EstimateCost(layer, impl);
+  }
+  const double cost = RunTrial(layer, impl);
+  cache_[key] = cost;
+  return cost;
+}
+
+std::vector<ConvImpl> ConvSelector::Select(
+    const std::vector<ConvLayer> &layers) {
+  if (layers.empty()) {
+    return {};
+  }
+  // Shortest path through the candidates of each layer. total[j] is the
+  // cheapest cost up to the current layer ending with its candidate j.
+  std::vector<std::vector<ConvImpl>> candidates;
+  std::vector<std::vector<int>> prev(layers.size());
+  std::vector<double> total;
+  for (std::size_t i = 0; i < layers.size(); i++) {
+    const ConvLayer &layer = layers[i];
+    candidates.push_back(GetCandidates(layer));
+    const std::size_t in_size =
+        static_cast<std::size_t>(layer.in_channels) * layer.in_height *
+        layer.in_width;
+    const double transfer_cost = EstimateTransferCost(in_size);
+    std::vector<double> next;
+    for (const ConvImpl &impl : candidates[i]) {
+      const double cost = GetCost(layer, impl);
+      double best = std::numeric_limits<double>::infinity();
+      int best_prev = -1;
+      if (i == 0) {
+        // The network input comes from the host.
+        best = (impl.backend == Backend::kCpu) ? 0.0 : transfer_cost;
+      }
+      for (std::size_t j = 0; (i > 0) && (j < total.size()); j++) {
+        double path = total[j];
+        if (candidates[i - 1][j].backend != impl.backend) {
+          path += transfer_cost;
+        }
+        if (path < best) {
+          best = path;
+          best_prev = j;
+        }
+      }
+      next.push_back(best + cost);
+      prev[i].push_back(best_prev);
+    }
+    total.swap(next);
+  }
+
+  // The network output goes back to the host.
+  const ConvLayer &last = layers.back();
+  const std::size_t out_size = static_cast<std::size_t>(last.out_channels) *
+                               GetOutSize(last.in_height, last) *
+                               GetOutSize(last.in_width, last);
+  int best = -1;
+  double best_total = std::numeric_limits<double>::infinity();
+  for (std::size_t j = 0; j < total.size(); j++) {
+    if (candidates.back()[j].backend != Backend::kCpu) {
+      total[j] += EstimateTransferCost(out_size);
+    }
+    if (total[j] < best_total) {
+      best_total = total[j];
+      best = j;
+    }
+  }
+
+  std::vector<ConvImpl> impls(layers.size());
+  for (int i = layers.size() - 1; i >= 0; i--) {
+    impls[i] = candidates[i][best];
+    best = prev[i][best];
+  }
+  return impls;
+}
+
+bool ConvSelector::LoadCache(const std::string &path) {
+  std::ifstream is(path);
+  if (!is) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(is, line)) {
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string device;
+    std::string layer;
+    std::string impl;
+    double cost;
+    if (fields >> device >> layer >> impl >> cost) {
+      cache_[device + ' ' + layer + ' ' + impl] = cost;
+    }
+  }
+  return true;
+}
+
+void ConvSelector::SaveCache(const std::string &path) const {
+  std::ofstream os(path);
+  ASSERT(static_cast<bool>(os), "Couldn't open the tuning cache " + path);
+  os << "# device layer impl cost_us\n";
+  for (const auto &entry : cache_) {
+    os << entry.first << ' ' << entry.second << '\n';
+  }
+}
+
+const std::string &ConvSelector::GetDeviceKey() const {
+  return device_key_;
+}
+
+double ConvSelector::RunTrial(const ConvLayer &layer, const ConvImpl &impl) {
+  const int multiplier = layer.out_channels / layer.in_channels;
+  const int kernel_depth = layer.depthwise ? 1 : layer.in_channels;
+  const std::vector<float> kernel_data(
+      layer.out_channels * kernel_depth * layer.kernel_size *
+          layer.kernel_size,
+      0.01f);
+  const bool device = impl.backend == Backend::kOpenCL;
+  std::unique_ptr<Operator> op;
+  if (device) {
+    op = layer.depthwise
+             ? CreateDepthwiseConv2D(impl.backend, ws_, layer.in_channels,
+                                     multiplier, layer.kernel_size,
+                                     layer.stride, layer.padding, kernel_data)
+             : CreateConv2D(impl.backend, ws_, layer.in_channels,
+                            layer.out_channels, layer.kernel_size,
+                            layer.stride, layer.padding, kernel_data);
+  } else if (layer.depthwise) {
+    op.reset(new CpuDepthwiseConv2D(layer.in_channels, multiplier,
+                                    layer.kernel_size, layer.stride,
+                                    layer.padding, kernel_data, pool_));
+  } else {
+    op.reset(new CpuConv2D(layer.in_channels, layer.out_channels,
+                           layer.kernel_size, layer.stride, layer.padding,
+                           kernel_data, impl.algorithm, pool_));
+  }
+
+  const std::vector<int> in_shape{1, layer.in_channels, layer.in_height,
+                                  layer.in_width};
+  const TensorBacking backing = TensorBacking::kHost;
+  Tensor input(in_shape, device, ws_, backing);
+  Tensor output(op->InferShape(in_shape), device, ws_, backing);
+  op->Prepare(in_shape);
+  auto run = [&]() {
+    op->Run(input, output);
+    if (device) {
+      ws_->FinishCommandQueue();
+    }
+  };
+
+  // The fastest run, as noise only ever adds time.
+  run();
+  double best = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < num_trial_runs_; i++) {
+    auto tic = std::chrono::high_resolution_clock::now();
+    run();
+    auto toc = std::chrono::high_resolution_clock::now();
+    best = std::min(
+        best,
+        std::chrono::duration<double, std::micro>(toc - tic).count());
+  }
+  return best;
+}
+
+std::string ConvSelector::GetCacheKey(const ConvLayer &layer,
+                                      const ConvImpl &impl) const {
+  std::ostringstream key;
+  key << device_key_ << ' ' << (layer.depthwise ? "dwconv" : "conv") << '_'
+      << layer.in_channels << '_' << layer.out_channels << '_'
+      << layer.kernel_size << '_' << layer.stride << '_' << layer.padding
+      << '_' << layer.in_height << '_' << layer.in_width << ' '
+      << GetBackendName(impl.backend) << '_'
+      << GetConv2DAlgorithmName(impl.algorithm);
+  return key.str();
+}
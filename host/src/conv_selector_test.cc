@@ -0,0 +1,86 @@
+#include "conv_selector_test.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "memory_activation.h"
+#include "model.h"
+#include "network.h"
+#include "test_utils.h"
+
+void RunConvSelectorUnitTest(Workspace *ws,
+                             const int in_height,
+                             const int in_width,
+                             const int num_trial_runs,
+                             const std::string &cache_path) {
+  std::cout << "in_height = " << in_height << ", in_width = " << in_width
+            << ", num_trial_runs = " << num_trial_runs << '\n';
+  const std::vector<int> in_shape{1, 3, in_height, in_width};
+  const std::vector<ConvLayer> layers = GetModelLayers(in_shape);
+
+  ConvSelector selector(ws);
+  selector.SetTrialRuns(num_trial_runs);
+  const std::vector<ConvImpl> impls = selector.Select(layers);
+  ASSERT(impls.size() == layers.size(), "One choice per layer");
+  for (std::size_t i = 0; i < layers.size(); i++) {
+    std::cout << "Layer " << i << ": " << GetBackendName(impls[i].backend)
+              << ' ' << GetConv2DAlgorithmName(impls[i].algorithm) << ", "
+              << selector.GetCost(layers[i], impls[i]) << " us\n";
+  }
+
+  // A new session with the cache file needs no trials to decide the same.
+  selector.SaveCache(cache_path);
+  ConvSelector cached_selector(ws);
+  ASSERT(cached_selector.LoadCache(cache_path), "Couldn't load the cache");
+  const std::vector<ConvImpl> cached_impls = cached_selector.Select(layers);
+  remove(cache_path.c_str());
+  bool same = true;
+  for (std::size_t i = 0; i < impls.size(); i++) {
+    same = same && (impls[i].backend == cached_impls[i].backend) &&
+           (impls[i].algorithm == cached_impls[i].algorithm);
+  }
+  std::cout << (same ? "Cached selection is consistent"
+                     : "Cached selection differs")
+            << '\n';
+
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  const int tensor_size = max_channels * in_height * in_width;
+  std::vector<float> in_data(tensor_size);
+  std::vector<float> out_data(tensor_size);
+  std::vector<float> ref(tensor_size);
+  std::vector<float> kernel_data(max_channels * max_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> weight_data(max_channels);
+  std::vector<float> bias_data(max_channels);
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weight_data.begin(), weight_data.end(),
+                RandomGenerator(1.f / 10000.f, 1.f));
+  std::generate(bias_data.begin(), bias_data.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+
+  Network network(ws);
+  AddModelLayers(network, ws, kernel_data, weight_data, bias_data, impls);
+  network.Prepare(in_shape);
+  network.Run(in_data, out_data);
+
+  std::vector<int> tensor_shape(in_shape);
+  RunModelRef(tensor_shape, in_data, ref, kernel_data, weight_data,
+              bias_data);
+  const std::vector<int> &out_shape = network.GetOutShape();
+  const int out_size = out_shape[1] * out_shape[2] * out_shape[3];
+  CheckResult(ref.data(), out_data.data(), out_size, false, 1e-3);
+}
+
+void RunConvSelectorTests(Workspace &ws) {
+  RunConvSelectorUnitTest(nullptr, 16, 16, 0, "tuning_test.cache");
+  RunConvSelectorUnitTest(nullptr, 16, 16, 2, "tuning_test.cache");
+  RunConvSelectorUnitTest(&ws, 32, 32, 0, "tuning_test.cache");
+  RunConvSelectorUnitTest(&ws, 32, 32, 2, "tuning_test.cache");
+}
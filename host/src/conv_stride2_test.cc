@@ -0,0 +1,104 @@
+#include "conv_stride2_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "memory_activation.h"
+
+namespace {
+
+void PrintCase(const char *name,
+               const std::vector<int> &shape,
+               int kernel_size,
+               int stride,
+               int padding) {
+  std::cout << name << ", shape = [" << shape[0] << ", " << shape[1] << ", "
+            << shape[2] << ", " << shape[3] << "], kernel_size = "
+            << kernel_size << ", stride = " << stride
+            << ", padding = " << padding << '\n';
+}
+
+}  // namespace
+
+void RunConv2DStrideUnitTest(Workspace &ws,
+                             const std::vector<int> &shape,
+                             int out_channels,
+                             int kernel_size,
+                             int stride,
+                             int padding) {
+  PrintCase("Conv2D", shape, kernel_size, stride, padding);
+  const int in_channels = shape[1];
+  std::vector<float> in_data(shape[0] * in_channels * shape[2] * shape[3]);
+  std::vector<float> kernel_data(out_channels * in_channels * kernel_size *
+                                 kernel_size);
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 1000.f, -0.5f));
+  std::vector<int> ref_shape = shape;
+  const std::vector<int> out_shape =
+      InferConvShape(shape, out_channels, kernel_size, stride, padding);
+  std::vector<float> ref(out_shape[0] * out_shape[1] * out_shape[2] *
+                         out_shape[3]);
+  RunConv2DRef(in_data, ref, kernel_data, ref_shape, out_channels,
+               kernel_size, stride, padding);
+
+  std::unique_ptr<Operator> op =
+      CreateConv2D(Backend::kOpenCL, &ws, in_channels, out_channels,
+                   kernel_size, stride, padding, kernel_data);
+  PrintResult(CheckOperator(ws, *op, shape, in_data, ref));
+}
+
+void RunDepthwiseConv2DStrideUnitTest(Workspace &ws,
+                                      const std::vector<int> &shape,
+                                      int channel_multiplier,
+                                      int kernel_size,
+                                      int stride,
+                                      int padding) {
+  PrintCase("DepthwiseConv2D", shape, kernel_size, stride, padding);
+  const int channels = shape[1];
+  const int in_image_size = channels * shape[2] * shape[3];
+  std::vector<float> in_data(shape[0] * in_image_size);
+  std::vector<float> kernel_data(channels * channel_multiplier *
+                                 kernel_size * kernel_size);
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 1000.f, -0.5f));
+  const std::vector<int> out_shape =
+      InferConvShape(shape, channels * channel_multiplier, kernel_size,
+                     stride, padding);
+  const int out_image_size = out_shape[1] * out_shape[2] * out_shape[3];
+  std::vector<float> ref(shape[0] * out_image_size);
+  for (int n = 0; n < shape[0]; n++) {
+    RunDepthwiseConv2DRef(in_data.data() + n * in_image_size,
+                          ref.data() + n * out_image_size, kernel_data.data(),
+                          shape[2], shape[3], channels, channel_multiplier,
+                          kernel_size, stride, padding);
+  }
+
+  std::unique_ptr<Operator> op =
+      CreateDepthwiseConv2D(Backend::kOpenCL, &ws, channels,
+                            channel_multiplier, kernel_size, stride, padding,
+                            kernel_data);
+  PrintResult(CheckOperator(ws, *op, shape, in_data, ref));
+}
+
+void RunConvStride2Tests(Workspace &ws) {
+  // Stride 1 on the generic kernels, now launched over the output.
+  RunConv2DStrideUnitTest(ws, {1, 3, 17, 19}, 8, 3, 1, 1);
+  RunDepthwiseConv2DStrideUnitTest(ws, {2, 5, 13, 11}, 2, 3, 1, 0);
+
+  // MobileNetV2 downsampling: 3x3, padding 1, even and odd sizes.
+  RunConv2DStrideUnitTest(ws, {1, 3, 64, 64}, 32, 3, 2, 1);
+  RunDepthwiseConv2DStrideUnitTest(ws, {1, 32, 56, 56}, 1, 3, 2, 1);
+  RunDepthwiseConv2DStrideUnitTest(ws, {2, 24, 15, 15}, 1, 3, 2, 1);
+  // Output channels that split work-groups between images or leave them
+  // part empty, and wider kernels.
+  RunConv2DStrideUnitTest(ws, {3, 4, 21, 18}, 7, 3, 2, 1);
+  RunConv2DStrideUnitTest(ws, {1, 4, 21, 18}, 7, 3, 2, 1);
+  RunConv2DStrideUnitTest(ws, {2, 3, 23, 29}, 5, 5, 2, 0);
+  RunDepthwiseConv2DStrideUnitTest(ws, {2, 7, 30, 27}, 3, 5, 2, 2);
+  RunDepthwiseConv2DStrideUnitTest(ws, {1, 6, 19, 20}, 1, 7, 2, 3);
+}
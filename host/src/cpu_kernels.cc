@@ -0,0 +1,343 @@
+#include "cpu_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HOST_HAS_X86_KERNELS 1
+#endif
+
+namespace {
+
+CpuIsa DetectCpuIsa() {
+#ifdef HOST_HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return CpuIsa::kAvx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return CpuIsa::kAvx2;
+  }
+#endif
+  return CpuIsa::kScalar;
+}
+
+std::atomic<int> isa_cap(static_cast<int>(CpuIsa::kAvx512));
+
+// Scalar kernels, also used for strided rows and vector tails.
+
+void AccumulateRowsScalar(const float *in, int in_stride, int n,
+                          const float *weights, int weight_stride,
+                          int num_rows, float *out, int out_stride) {
+  for (int b = 0; b < num_rows; b++) {
+    const float w = weights[b * weight_stride];
+    float *out_row = out + b * out_stride;
+    for (int j = 0; j < n; j++) {
+      out_row[j] += w * in[j * in_stride];
+    }
+  }
+}
+
+float SumRowScalar(const float *data, int n) {
+  float sum = 0.f;
+  for (int i = 0; i < n; i++) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+float SumSquaredDiffRowScalar(const float *data, int n, float mean) {
+  float sum = 0.f;
+  for (int i = 0; i < n; i++) {
+    float delta = data[i] - mean;
+    sum += delta * delta;
+  }
+  return sum;
+}
+
+void ScaleShiftRowScalar(float *data, int n, float scale, float shift,
+                         float relu) {
+  for (int i = 0; i < n; i++) {
+    float activation = scale * data[i] + shift;
+    if (relu > 0.f) {
+      data[i] = (activation > 0.f) ? relu * activation : 0.f;
+    } else {
+      data[i] = activation;
+    }
+  }
+}
+
+#ifdef HOST_HAS_X86_KERNELS
+
+// AVX2 kernels.
+
+__attribute__((target("avx2,fma"))) float HorizontalSum(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v),
+                          _mm256_extractf128_ps(v, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma"))) void AccumulateRowsAvx2(
+    const float *in, int n, const float *weights, int weight_stride,
+    int num_rows, float *out, int out_stride) {
+  const int n_vec = n & ~7;
+  int b = 0;
+  // Blocks of four output rows share each input load.
+  for (; b + 4 <= num_rows; b += 4) {
+    const __m256 w0 = _mm256_set1_ps(weights[b * weight_stride]);
+    const __m256 w1 = _mm256_set1_ps(weights[(b + 1) * weight_stride]);
+    const __m256 w2 = _mm256_set1_ps(weights[(b + 2) * weight_stride]);
+    const __m256 w3 = _mm256_set1_ps(weights[(b + 3) * weight_stride]);
+    float *out0 = out + b * out_stride;
+    float *out1 = out0 + out_stride;
+    float *out2 = out1 + out_stride;
+    float *out3 = out2 + out_stride;
+    for (int j = 0; j < n_vec; j += 8) {
+      const __m256 x = _mm256_loadu_ps(in + j);
+      _mm256_storeu_ps(out0 + j,
+                       _mm256_fmadd_ps(w0, x, _mm256_loadu_ps(out0 + j)));
+      _mm256_storeu_ps(out1 + j,
+                       _mm256_fmadd_ps(w1, x, _mm256_loadu_ps(out1 + j)));
+      _mm256_storeu_ps(out2 + j,
+                       _mm256_fmadd_ps(w2, x, _mm256_loadu_ps(out2 + j)));
+      _mm256_storeu_ps(out3 + j,
+                       _mm256_fmadd_ps(w3, x, _mm256_loadu_ps(out3 + j)));
+    }
+  }
+  for (; b < num_rows; b++) {
+    const __m256 w = _mm256_set1_ps(weights[b * weight_stride]);
+    float *out_row = out + b * out_stride;
+    for (int j = 0; j < n_vec; j += 8) {
+      const __m256 x = _mm256_loadu_ps(in + j);
+      _mm256_storeu_ps(out_row + j,
+                       _mm256_fmadd_ps(w, x, _mm256_loadu_ps(out_row + j)));
+    }
+  }
+  AccumulateRowsScalar(in + n_vec, 1, n - n_vec, weights, weight_stride,
+                       num_rows, out + n_vec, out_stride);
+}
+
+__attribute__((target("avx2,fma"))) float SumRowAvx2(const float *data,
+                                                     int n) {
+  const int n_vec = n & ~7;
+  __m256 sum = _mm256_setzero_ps();
+  for (int i = 0; i < n_vec; i += 8) {
+    sum = _mm256_add_ps(sum, _mm256_loadu_ps(data + i));
+  }
+  return HorizontalSum(sum) + SumRowScalar(data + n_vec, n - n_vec);
+}
+
+__attribute__((target("avx2,fma"))) float SumSquaredDiffRowAvx2(
+    const float *data, int n, float mean) {
+  const int n_vec = n & ~7;
+  const __m256 m = _mm256_set1_ps(mean);
+  __m256 sum = _mm256_setzero_ps();
+  for (int i = 0; i < n_vec; i += 8) {
+    const __m256 delta = _mm256_sub_ps(_mm256_loadu_ps(data + i), m);
+    sum = _mm256_fmadd_ps(delta, delta, sum);
+  }
+  return HorizontalSum(sum) +
+         SumSquaredDiffRowScalar(data + n_vec, n - n_vec, mean);
+}
+
+__attribute__((target("avx2,fma"))) void ScaleShiftRowAvx2(
+    float *data, int n, float scale, float shift, float relu) {
+  const int n_vec = n & ~7;
+  const __m256 a = _mm256_set1_ps(scale);
+  const __m256 c = _mm256_set1_ps(shift);
+  const __m256 r = _mm256_set1_ps(relu);
+  const __m256 zero = _mm256_setzero_ps();
+  for (int i = 0; i < n_vec; i += 8) {
+    __m256 y = _mm256_fmadd_ps(a, _mm256_loadu_ps(data + i), c);
+    if (relu > 0.f) {
+      y = _mm256_mul_ps(r, _mm256_max_ps(y, zero));
+    }
+    _mm256_storeu_ps(data + i, y);
+  }
+  ScaleShiftRowScalar(data + n_vec, n - n_vec, scale, shift, relu);
+}
+
+// AVX-512 kernels.
+
+__attribute__((target("avx512f"))) void AccumulateRowsAvx512(
+    const float *in, int n, const float *weights, int weight_stride,
+    int num_rows, float *out, int out_stride) {
+  const int n_vec = n & ~15;
+  int b = 0;
+  for (; b + 4 <= num_rows; b += 4) {
+    const __m512 w0 = _mm512_set1_ps(weights[b * weight_stride]);
+    const __m512 w1 = _mm512_set1_ps(weights[(b + 1) * weight_stride]);
+    const __m512 w2 = _mm512_set1_ps(weights[(b + 2) * weight_stride]);
+    const __m512 w3 = _mm512_set1_ps(weights[(b + 3) * weight_stride]);
+    float *out0 = out + b * out_stride;
+    float *out1 = out0 + out_stride;
+    float *out2 = out1 + out_stride;
+    float *out3 = out2 + out_stride;
+    for (int j = 0; j < n_vec; j += 16) {
+      const __m512 x = _mm512_loadu_ps(in + j);
+      _mm512_storeu_ps(out0 + j,
+                       _mm512_fmadd_ps(w0, x, _mm512_loadu_ps(out0 + j)));
+      _mm512_storeu_ps(out1 + j,
+                       _mm512_fmadd_ps(w1, x, _mm512_loadu_ps(out1 + j)));
+      _mm512_storeu_ps(out2 + j,
+                       _mm512_fmadd_ps(w2, x, _mm512_loadu_ps(out2 + j)));
+      _mm512_storeu_ps(out3 + j,
+                       _mm512_fmadd_ps(w3, x, _mm512_loadu_ps(out3 + j)));
+    }
+  }
+  for (; b < num_rows; b++) {
+    const __m512 w = _mm512_set1_ps(weights[b * weight_stride]);
+    float *out_row = out + b * out_stride;
+    for (int j = 0; j < n_vec; j += 16) {
+      const __m512 x = _mm512_loadu_ps(in + j);
+      _mm512_storeu_ps(out_row + j,
+                       _mm512_fmadd_ps(w, x, _mm512_loadu_ps(out_row + j)));
+    }
+  }
+  AccumulateRowsScalar(in + n_vec, 1, n - n_vec, weights, weight_stride,
+                       num_rows, out + n_vec, out_stride);
+}
+
+__attribute__((target("avx512f"))) float SumRowAvx512(const float *data,
+                                                      int n) {
+  const int n_vec = n & ~15;
+  __m512 sum = _mm512_setzero_ps();
+  for (int i = 0; i < n_vec; i += 16) {
+    sum = _mm512_add_ps(sum, _mm512_loadu_ps(data + i));
+  }
+  return _mm512_reduce_add_ps(sum) + SumRowScalar(data + n_vec, n - n_vec);
+}
+
+__attribute__((target("avx512f"))) float SumSquaredDiffRowAvx512(
+    const float *data, int n, float mean) {
+  const int n_vec = n & ~15;
+  const __m512 m = _mm512_set1_ps(mean);
+  __m512 sum = _mm512_setzero_ps();
+  for (int i = 0; i < n_vec; i += 16) {
+    const __m512 delta = _mm512_sub_ps(_mm512_loadu_ps(data + i), m);
+    sum = _mm512_fmadd_ps(delta, delta, sum);
+  }
+  return _mm512_reduce_add_ps(sum) +
+         SumSquaredDiffRowScalar(data + n_vec, n - n_vec, mean);
+}
+
+__attribute__((target("avx512f"))) void ScaleShiftRowAvx512(
+    float *data, int n, float scale, float shift, float relu) {
+  const int n_vec = n & ~15;
+  const __m512 a = _mm512_set1_ps(scale);
+  const __m512 c = _mm512_set1_ps(shift);
+  const __m512 r = _mm512_set1_ps(relu);
+  const __m512 zero = _mm512_setzero_ps();
+  for (int i = 0; i < n_vec; i += 16) {
+    __m512 y = _mm512_fmadd_ps(a, _mm512_loadu_ps(data + i), c);
+    if (relu > 0.f) {
+      y = _mm512_mul_ps(r, _mm512_max_ps(y, zero));
+    }
+    _mm512_storeu_ps(data + i, y);
+  }
+  ScaleShiftRowScalar(data + n_vec, n - n_vec, scale, shift, relu);
+}
+
+#endif  // HOST_HAS_X86_KERNELS
+
+}  // namespace
+
+CpuIsa GetCpuIsa() {
+  static const CpuIsa detected = DetectCpuIsa();
+  return static_cast<CpuIsa>(
+      std::min(static_cast<int>(detected), isa_cap.load()));
+}
+
+void SetCpuIsa(CpuIsa isa) {
+  isa_cap = static_cast<int>(isa);
+}
+
+const char *GetCpuIsaName(CpuIsa isa) {
+  switch (isa) {
+    case CpuIsa::kAvx512:
+      return "AVX-512";
+    case CpuIsa::kAvx2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+void GetValidOutputRange(int in_size, int out_size, int stride, int offset,
+                         int *begin, int *end) {
+  int first = (offset >= 0) ? 0 : (stride - 1 - offset) / stride;
+  int last = (in_size - 1 - offset >= 0) ? (in_size - 1 - offset) / stride + 1
+                                         : 0;
+  *begin = std::min(first, out_size);
+  *end = std::max(*begin, std::min(last, out_size));
+}
+
+void AccumulateRows(const float *in, int in_stride, int n,
+                    const float *weights, int weight_stride, int num_rows,
+                    float *out, int out_stride) {
+#ifdef HOST_HAS_X86_KERNELS
+  if (in_stride == 1) {
+    switch (GetCpuIsa()) {
+      case CpuIsa::kAvx512:
+        AccumulateRowsAvx512(in, n, weights, weight_stride, num_rows, out,
+                             out_stride);
+        return;
+      case CpuIsa::kAvx2:
+        AccumulateRowsAvx2(in, n, weights, weight_stride, num_rows, out,
+                           out_stride);
+        return;
+      default:
+        break;
+    }
+  }
+#endif
+  AccumulateRowsScalar(in, in_stride, n, weights, weight_stride, num_rows,
+                       out, out_stride);
+}
+
+float SumRow(const float *data, int n) {
+#ifdef HOST_HAS_X86_KERNELS
+  switch (GetCpuIsa()) {
+    case CpuIsa::kAvx512:
+      return SumRowAvx512(data, n);
+    case CpuIsa::kAvx2:
+      return SumRowAvx2(data, n);
+    default:
+      break;
+  }
+#endif
+  return SumRowScalar(data, n);
+}
+
+float SumSquaredDiffRow(const float *data, int n, float mean) {
+#ifdef HOST_HAS_X86_KERNELS
+  switch (GetCpuIsa()) {
+    case CpuIsa::kAvx512:
+      return SumSquaredDiffRowAvx512(data, n, mean);
+    case CpuIsa::kAvx2:
+      return SumSquaredDiffRowAvx2(data, n, mean);
+    default:
+      break;
+  }
+#endif
+  return SumSquaredDiffRowScalar(data, n, mean);
+}
+
+void ScaleShiftRow(float *data, int n, float scale, float shift, float relu) {
+#ifdef HOST_HAS_X86_KERNELS
+  switch (GetCpuIsa()) {
+    case CpuIsa::kAvx512:
+      ScaleShiftRowAvx512(data, n, scale, shift, relu);
+      return;
+    case CpuIsa::kAvx2:
+      ScaleShiftRowAvx2(data, n, scale, shift, relu);
+      return;
+    default:
+      break;
+  }
+#endif
+  ScaleShiftRowScalar(data, n, scale, shift, relu);
+}
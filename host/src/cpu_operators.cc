@@ -0,0 +1,371 @@
+#include "cpu_operators.h"
+
+#include <string>
+
+#include "batchnorm.h"
+#include "depthwise_conv2d.h"
+#include "fully_connected.h"
+#include "memory_activation.h"
+
+CpuConv2D::CpuConv2D(int in_channels, int out_channels, int kernel_size,
+                     int stride, int padding,
+                     const std::vector<float> &kernel_data,
+                     Conv2DAlgorithm algorithm, ThreadPool *pool)
+    : in_channels_(in_channels),
+      out_channels_(out_channels),
+      kernel_size_(kernel_size),
+      stride_(stride),
+      padding_(padding),
+      algorithm_(algorithm),
+      pool_(pool) {
+  const int size = out_channels * in_channels * kernel_size * kernel_size;
+  ASSERT(static_cast<int>(kernel_data.size()) >= size,
+         "Not enough kernel data");
+  kernel_data_ = std::make_shared<const std::vector<float>>(
+      kernel_data.begin(), kernel_data.begin() + size);
+}
+
+Backend CpuConv2D::GetBackend() const {
+  return Backend::kCpu;
+}
+
+const char *CpuConv2D::GetName() const {
+  return "Conv2D";
+}
+
+std::vector<int> CpuConv2D::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  ASSERT(in_shape[1] == in_channels_, "Number of input channels");
+  return InferConvShape(in_shape, out_channels_, kernel_size_, stride_,
+                        padding_);
+}
+
+OpCost CpuConv2D::GetCost(const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return GetConv2DCost(in_shape, out_channels_, kernel_size_, stride_,
+                       padding_);
+}
+
+std::size_t CpuConv2D::GetScratchSize(const std::vector<int> &in_shape) const {
+  const std::vector<int> out_shape = InferShape(in_shape);
+  if ((algorithm_ == Conv2DAlgorithm::kDirect) ||
+      ((kernel_size_ == 1) && (stride_ == 1) && (padding_ == 0))) {
+    return 0;
+  }
+  // The im2col matrix.
+  return sizeof(float) * in_channels_ * kernel_size_ * kernel_size_ *
+         out_shape[2] * out_shape[3];
+}
+
+void CpuConv2D::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &in_shape = input.GetShape();
+  const std::vector<int> out_shape = InferShape(in_shape);
+  ASSERT(output.GetShape() == out_shape, "Output tensor has the wrong shape");
+  const int in_image_size = in_shape[1] * in_shape[2] * in_shape[3];
+  const int out_image_size = out_shape[1] * out_shape[2] * out_shape[3];
+  const float *in_data = static_cast<const Tensor &>(input).GetData().data();
+  float *out_data = output.GetData().data();
+  for (int n = 0; n < in_shape[0]; n++) {
+    RunConv2DCpu(in_data + n * in_image_size, out_data + n * out_image_size,
+                 kernel_data_->data(), in_shape[2], in_shape[3], in_channels_,
+                 out_channels_, kernel_size_, stride_, padding_, algorithm_,
+                 pool_);
+  }
+}
+
+std::unique_ptr<Operator> CpuConv2D::Clone(Workspace * /*ws*/) const {
+  return std::unique_ptr<Operator>(new CpuConv2D(*this));
+}
+
+void CpuConv2D::SetAlgorithm(Conv2DAlgorithm algorithm) {
+  algorithm_ = algorithm;
+}
+
+Conv2DAlgorithm CpuConv2D::GetAlgorithm() const {
+  return algorithm_;
+}
+
+CpuDepthwiseConv2D::CpuDepthwiseConv2D(int channels, int channel_multiplier,
+                                       int kernel_size, int stride,
+                                       int padding,
+                                       const std::vector<float> &kernel_data,
+                                       ThreadPool *pool)
+    : channels_(channels),
+      channel_multiplier_(channel_multiplier),
+      kernel_size_(kernel_size),
+      stride_(stride),
+      padding_(padding),
+      pool_(pool) {
+  const int size = channels * channel_multiplier * kernel_size * kernel_size;
+  ASSERT(static_cast<int>(kernel_data.size()) >= size,
+         "Not enough kernel data");
+  kernel_data_ = std::make_shared<const std::vector<float>>(
+      kernel_data.begin(), kernel_data.begin() + size);
+}
+
+Backend CpuDepthwiseConv2D::GetBackend() const {
+  return Backend::kCpu;
+}
+
+const char *CpuDepthwiseConv2D::GetName() const {
+  return "DepthwiseConv2D";
+}
+
+std::vector<int> CpuDepthwiseConv2D::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  ASSERT(in_shape[1] == channels_, "Number of input channels");
+  return InferConvShape(in_shape, channels_ * channel_multiplier_,
+                        kernel_size_, stride_, padding_);
+}
+
+OpCost CpuDepthwiseConv2D::GetCost(const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return GetDepthwiseConv2DCost(in_shape, channel_multiplier_, kernel_size_,
+                                stride_, padding_);
+}
+
+void CpuDepthwiseConv2D::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &in_shape = input.GetShape();
+  const std::vector<int> out_shape = InferShape(in_shape);
+  ASSERT(output.GetShape() == out_shape, "Output tensor has the wrong shape");
+  const int in_image_size = in_shape[1] * in_shape[2] * in_shape[3];
+  const int out_image_size = out_shape[1] * out_shape[2] * out_shape[3];
+  const float *in_data = static_cast<const Tensor &>(input).GetData().data();
+  float *out_data = output.GetData().data();
+  for (int n = 0; n < in_shape[0]; n++) {
+    RunDepthwiseConv2DCpu(in_data + n * in_image_size,
+                          out_data + n * out_image_size, kernel_data_->data(),
+                          in_shape[2], in_shape[3], channels_,
+                          channel_multiplier_, kernel_size_, stride_,
+                          padding_, pool_);
+  }
+}
+
+std::unique_ptr<Operator> CpuDepthwiseConv2D::Clone(Workspace * /*ws*/) const {
+  return std::unique_ptr<Operator>(new CpuDepthwiseConv2D(*this));
+}
+
+CpuBatchNorm::CpuBatchNorm(int num_features, float eps, float relu,
+                           const std::vector<float> &weights,
+                           const std::vector<float> &biases,
+                           BatchNormStats stats,
+                           ThreadPool *pool)
+    : num_features_(num_features),
+      eps_(eps),
+      relu_(relu),
+      stats_(stats),
+      pool_(pool) {
+  ASSERT(static_cast<int>(weights.size()) >= num_features,
+         "Not enough weights");
+  ASSERT(static_cast<int>(biases.size()) >= num_features, "Not enough biases");
+  weights_ = std::make_shared<const std::vector<float>>(
+      weights.begin(), weights.begin() + num_features);
+  biases_ = std::make_shared<const std::vector<float>>(
+      biases.begin(), biases.begin() + num_features);
+}
+
+Backend CpuBatchNorm::GetBackend() const {
+  return Backend::kCpu;
+}
+
+const char *CpuBatchNorm::GetName() const {
+  return "BatchNorm";
+}
+
+bool CpuBatchNorm::IsInPlace() const {
+  return true;
+}
+
+std::vector<int> CpuBatchNorm::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  ASSERT(in_shape[1] == num_features_, "Number of input channels");
+  return in_shape;
+}
+
+OpCost CpuBatchNorm::GetCost(const std::vector<int> &in_shape) const {
+  return GetBatchNormCost(InferShape(in_shape));
+}
+
+void CpuBatchNorm::Run(Tensor &input, Tensor &output) {
+  ASSERT(&input == &output, "BatchNorm runs in place");
+  const std::vector<int> &shape = input.GetShape();
+  InferShape(shape);
+  RunBatchNormCpu(input.GetData().data(), shape[0], shape[1],
+                  shape[2] * shape[3], eps_, weights_->data(), biases_->data(),
+                  relu_, stats_, pool_);
+}
+
+std::unique_ptr<Operator> CpuBatchNorm::Clone(Workspace * /*ws*/) const {
+  return std::unique_ptr<Operator>(new CpuBatchNorm(*this));
+}
+
+CpuSoftmax::CpuSoftmax(ThreadPool *pool) : pool_(pool) {}
+
+Backend CpuSoftmax::GetBackend() const {
+  return Backend::kCpu;
+}
+
+const char *CpuSoftmax::GetName() const {
+  return "Softmax";
+}
+
+bool CpuSoftmax::IsInPlace() const {
+  return true;
+}
+
+std::vector<int> CpuSoftmax::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() >= 2, "Expects a batch of at least 1D images");
+  return in_shape;
+}
+
+OpCost CpuSoftmax::GetCost(const std::vector<int> &in_shape) const {
+  return GetSoftmaxCost(InferShape(in_shape));
+}
+
+void CpuSoftmax::Run(Tensor &input, Tensor &output) {
+  ASSERT(&input == &output, "Softmax runs in place");
+  const std::vector<int> &shape = input.GetShape();
+  InferShape(shape);
+  RunSoftmaxCpu(input.GetData().data(), shape[0], input.GetSize() / shape[0],
+                pool_);
+}
+
+std::unique_ptr<Operator> CpuSoftmax::Clone(Workspace * /*ws*/) const {
+  return std::unique_ptr<Operator>(new CpuSoftmax(*this));
+}
+
+CpuReduce::CpuReduce(Reduction reduction, int axis, int num_axes,
+                     ThreadPool *pool)
+    : reduction_(reduction), axis_(axis), num_axes_(num_axes), pool_(pool) {}
+
+Backend CpuReduce::GetBackend() const {
+  return Backend::kCpu;
+}
+
+const char *CpuReduce::GetName() const {
+  return "Reduce";
+}
+
+std::vector<int> CpuReduce::InferShape(
+    const std::vector<int> &in_shape) const {
+  return GetReduceShape(in_shape, axis_, num_axes_);
+}
+
+OpCost CpuReduce::GetCost(const std::vector<int> &in_shape) const {
+  return GetReduceCost(in_shape, reduction_, axis_, num_axes_);
+}
+
+void CpuReduce::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  const float *in_data = static_cast<const Tensor &>(input).GetData().data();
+  RunReduceCpu(in_data, output.GetData().data(), shape, axis_, num_axes_,
+               reduction_, pool_);
+}
+
+std::unique_ptr<Operator> CpuReduce::Clone(Workspace * /*ws*/) const {
+  return std::unique_ptr<Operator>(new CpuReduce(*this));
+}
+
+CpuGlobalAvgPool::CpuGlobalAvgPool(ThreadPool *pool) : pool_(pool) {}
+
+Backend CpuGlobalAvgPool::GetBackend() const {
+  return Backend::kCpu;
+}
+
+const char *CpuGlobalAvgPool::GetName() const {
+  return "GlobalAvgPool";
+}
+
+std::vector<int> CpuGlobalAvgPool::InferShape(
+    const std::vector<int> &in_shape) const {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  return {in_shape[0], in_shape[1], 1, 1};
+}
+
+OpCost CpuGlobalAvgPool::GetCost(const std::vector<int> &in_shape) const {
+  return GetGlobalAvgPoolCost(in_shape);
+}
+
+void CpuGlobalAvgPool::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  const float *in_data = static_cast<const Tensor &>(input).GetData().data();
+  RunReduceCpu(in_data, output.GetData().data(), shape, 2, 2,
+               Reduction::kMean, pool_);
+}
+
+std::unique_ptr<Operator> CpuGlobalAvgPool::Clone(Workspace * /*ws*/) const {
+  return std::unique_ptr<Operator>(new CpuGlobalAvgPool(*this));
+}
+
+CpuFullyConnected::CpuFullyConnected(int in_features, int out_features,
+                                     const std::vector<float> &weights,
+                                     const std::vector<float> &biases,
+                                     bool pool_input, ThreadPool *pool)
+    : in_features_(in_features),
+      out_features_(out_features),
+      pool_input_(pool_input),
+      pool_(pool) {
+  ASSERT(static_cast<int>(biases.size()) >= out_features, "Not enough biases");
+  weights_t_ = std::make_shared<const std::vector<float>>(
+      TransposeFullyConnectedWeights(weights, in_features, out_features));
+  biases_ = std::make_shared<const std::vector<float>>(
+      biases.begin(), biases.begin() + out_features);
+}
+
+Backend CpuFullyConnected::GetBackend() const {
+  return Backend::kCpu;
+}
+
+const char *CpuFullyConnected::GetName() const {
+  return "FullyConnected";
+}
+
+std::vector<int> CpuFullyConnected::InferShape(
+    const std::vector<int> &in_shape) const {
+  if (pool_input_) {
+    ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+    ASSERT(in_shape[1] == in_features_, "Number of input channels");
+  } else {
+    ASSERT(!in_shape.empty(), "Expects a batch");
+    int size = 1;
+    for (std::size_t d = 1; d < in_shape.size(); d++) {
+      size *= in_shape[d];
+    }
+    ASSERT(size == in_features_, "Number of input features");
+  }
+  return {in_shape[0], out_features_};
+}
+
+OpCost CpuFullyConnected::GetCost(const std::vector<int> &in_shape) const {
+  InferShape(in_shape);
+  return GetFullyConnectedCost(in_shape, out_features_, pool_input_);
+}
+
+void CpuFullyConnected::Run(Tensor &input, Tensor &output) {
+  const std::vector<int> &shape = input.GetShape();
+  ASSERT(output.GetShape() == InferShape(shape),
+         "Output tensor has the wrong shape");
+  const float *in_data = static_cast<const Tensor &>(input).GetData().data();
+  std::vector<float> pooled;
+  if (pool_input_) {
+    pooled.resize(shape[0] * in_features_);
+    RunReduceCpu(in_data, pooled.data(), shape, 2, 2, Reduction::kMean,
+                 pool_);
+    in_data = pooled.data();
+  }
+  RunFullyConnectedCpu(in_data, output.GetData().data(), weights_t_->data(),
+                       biases_->data(), shape[0], in_features_,
+                       out_features_, pool_);
+}
+
+std::unique_ptr<Operator> CpuFullyConnected::Clone(Workspace * /*ws*/) const {
+  return std::unique_ptr<Operator>(new CpuFullyConnected(*this));
+}
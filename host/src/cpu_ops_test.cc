@@ -0,0 +1,308 @@
+#include "cpu_ops_test.h"
+
+#include <iostream>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Instruction sets to test, from scalar up to the best one available.
+std::vector<CpuIsa> GetTestIsas() {
+  std::vector<CpuIsa> isas{CpuIsa::kScalar};
+  SetCpuIsa(CpuIsa::kAvx512);
+  const CpuIsa best = GetCpuIsa();
+  if (best >= CpuIsa::kAvx2) {
+    isas.push_back(CpuIsa::kAvx2);
+  }
+  if (best >= CpuIsa::kAvx512) {
+    isas.push_back(CpuIsa::kAvx512);
+  }
+  return isas;
+}
+
+}  // namespace
+
+void RunConv2DCpuUnitTest(const int in_height,
+                          const int in_width,
+                          const int in_channels,
+                          const int out_channels,
+                          const int kernel_size,
+                          const int stride,
+                          const int padding,
+                          bool enable_timing,
+                          ThreadPool *pool) {
+  std::cout << "in_height = " << in_height << ", in_width = " << in_width
+            << ", in_channels = " << in_channels
+            << ", out_channels = " << out_channels
+            << ", kernel_size = " << kernel_size << ", stride = " << stride
+            << ", padding = " << padding << '\n';
+  const int out_height = (in_height + 2 * padding - kernel_size) / stride + 1;
+  const int out_width = (in_width + 2 * padding - kernel_size) / stride + 1;
+  const int out_size = out_channels * out_height * out_width;
+  std::vector<float> in_data(in_channels * in_height * in_width);
+  std::vector<float> kernel_data(out_channels * in_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> ref(out_size);
+  std::vector<float> out_data(out_size);
+
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+
+  auto tic = high_resolution_clock::now();
+  RunConv2DRef(in_data, ref, kernel_data, in_height, in_width, in_channels,
+               out_channels, kernel_size, stride, padding);
+  auto toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Ref took "
+              << duration_cast<microseconds>(toc - tic).count() << " us\n";
+  }
+
+  for (CpuIsa isa : GetTestIsas()) {
+    SetCpuIsa(isa);
+    for (Conv2DAlgorithm algorithm :
+         {Conv2DAlgorithm::kDirect, Conv2DAlgorithm::kIm2col}) {
+      std::fill(out_data.begin(), out_data.end(), 0.f);
+      tic = high_resolution_clock::now();
+      RunConv2DCpu(in_data, out_data, kernel_data, in_height, in_width,
+                   in_channels, out_channels, kernel_size, stride, padding,
+                   algorithm, pool);
+      toc = high_resolution_clock::now();
+      if (enable_timing) {
+        std::cout << GetCpuIsaName(isa) << ' '
+                  << GetConv2DAlgorithmName(algorithm) << " took "
+                  << duration_cast<microseconds>(toc - tic).count()
+                  << " us\n";
+      }
+      CheckResult(ref.data(), out_data.data(), out_size, false, 1e-3);
+    }
+  }
+  SetCpuIsa(CpuIsa::kAvx512);
+}
+
+void RunDepthwiseConv2DCpuUnitTest(const int in_height,
+                                   const int in_width,
+                                   const int in_channels,
+                                   const int channel_multiplier,
+                                   const int kernel_size,
+                                   const int stride,
+                                   const int padding,
+                                   bool enable_timing) {
+  std::cout << "in_height = " << in_height << ", in_width = " << in_width
+            << ", in_channels = " << in_channels
+            << ", channel_multiplier = " << channel_multiplier
+            << ", kernel_size = " << kernel_size << ", stride = " << stride
+            << ", padding = " << padding << '\n';
+  const int out_channels = in_channels * channel_multiplier;
+  const int out_height = (in_height + 2 * padding - kernel_size) / stride + 1;
+  const int out_width = (in_width + 2 * padding - kernel_size) / stride + 1;
+  const int out_size = out_channels * out_height * out_width;
+  std::vector<float> in_data(in_channels * in_height * in_width);
+  std::vector<float> kernel_data(out_channels * kernel_size * kernel_size);
+  std::vector<float> ref(out_size);
+  std::vector<float> out_data(out_size);
+
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+
+  auto tic = high_resolution_clock::now();
+  RunDepthwiseConv2DRef(in_data, ref, kernel_data, in_height, in_width,
+                        in_channels, channel_multiplier, kernel_size, stride,
+                        padding);
+  auto toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Ref took "
+              << duration_cast<microseconds>(toc - tic).count() << " us\n";
+  }
+
+  for (CpuIsa isa : GetTestIsas()) {
+    SetCpuIsa(isa);
+    std::fill(out_data.begin(), out_data.end(), 0.f);
+    tic = high_resolution_clock::now();
+    RunDepthwiseConv2DCpu(in_data, out_data, kernel_data, in_height, in_width,
+                          in_channels, channel_multiplier, kernel_size,
+                          stride, padding);
+    toc = high_resolution_clock::now();
+    if (enable_timing) {
+      std::cout << GetCpuIsaName(isa) << " took "
+                << duration_cast<microseconds>(toc - tic).count() << " us\n";
+    }
+    CheckResult(ref.data(), out_data.data(), out_size, false, 1e-3);
+  }
+  SetCpuIsa(CpuIsa::kAvx512);
+}
+
+void RunSgemmUnitTest(const int m,
+                      const int n,
+                      const int k,
+                      bool accumulate,
+                      bool enable_timing) {
+  std::cout << "m = " << m << ", n = " << n << ", k = " << k
+            << ", accumulate = " << accumulate << '\n';
+  std::vector<float> a(m * k);
+  std::vector<float> b(k * n);
+  std::vector<float> c(m * n);
+  std::vector<float> ref(m * n);
+
+  std::generate(a.begin(), a.end(), RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(b.begin(), b.end(), RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(ref.begin(), ref.end(), RandomGenerator(1.f / 500.f, -1.f));
+  const std::vector<float> c_init(ref);
+
+  auto tic = high_resolution_clock::now();
+  RunSgemmRef(m, n, k, a.data(), k, b.data(), n, ref.data(), n, accumulate);
+  auto toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Ref took "
+              << duration_cast<microseconds>(toc - tic).count() << " us\n";
+  }
+
+  for (CpuIsa isa : GetTestIsas()) {
+    SetCpuIsa(isa);
+    std::copy(c_init.begin(), c_init.end(), c.begin());
+    tic = high_resolution_clock::now();
+    RunSgemm(m, n, k, a.data(), k, b.data(), n, c.data(), n, accumulate);
+    toc = high_resolution_clock::now();
+    if (enable_timing) {
+      std::cout << GetCpuIsaName(isa) << " took "
+                << duration_cast<microseconds>(toc - tic).count() << " us\n";
+    }
+    CheckResult(ref.data(), c.data(), m * n, false, 1e-3);
+  }
+  SetCpuIsa(CpuIsa::kAvx512);
+}
+
+void RunBatchNormCpuUnitTest(const std::vector<int> &tensor_shape,
+                             float relu,
+                             BatchNormStats stats,
+                             bool enable_timing) {
+  std::cout << "tensor_shape = [" << tensor_shape[0] << ", " << tensor_shape[1]
+            << ", " << tensor_shape[2] << ", " << tensor_shape[3] << "]"
+            << ((stats == BatchNormStats::kAcrossBatch) ? ", across batch"
+                                                        : "")
+            << '\n';
+  const int tensor_size = std::accumulate(
+      tensor_shape.begin(), tensor_shape.end(), 1, std::multiplies<int>());
+  std::vector<float> tensor(tensor_size);
+  std::vector<float> weights(tensor_shape[1]);
+  std::vector<float> biases(tensor_shape[1]);
+  std::vector<float> ref(tensor_size);
+  const float eps = 1e-5;
+
+  std::generate(tensor.begin(), tensor.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weights.begin(), weights.end(),
+                RandomGenerator(1.f / 5000.f, 1.f));
+  std::generate(biases.begin(), biases.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+
+  std::copy(tensor.begin(), tensor.end(), ref.begin());
+  auto tic = high_resolution_clock::now();
+  RunBatchNormRef(ref, tensor_shape, eps, weights, biases, relu, stats);
+  auto toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Ref took "
+              << duration_cast<microseconds>(toc - tic).count() << " us\n";
+  }
+
+  std::vector<float> out_data(tensor_size);
+  for (CpuIsa isa : GetTestIsas()) {
+    SetCpuIsa(isa);
+    std::copy(tensor.begin(), tensor.end(), out_data.begin());
+    tic = high_resolution_clock::now();
+    RunBatchNormCpu(out_data, tensor_shape, eps, weights, biases, relu,
+                    stats);
+    toc = high_resolution_clock::now();
+    if (enable_timing) {
+      std::cout << GetCpuIsaName(isa) << " took "
+                << duration_cast<microseconds>(toc - tic).count() << " us\n";
+    }
+    CheckResult(ref.data(), out_data.data(), tensor_size, false, 1e-3);
+  }
+  SetCpuIsa(CpuIsa::kAvx512);
+}
+
+void RunCpuOpsTests(bool enable_timing) {
+  RunConv2DCpuUnitTest(64, 64, 3, 32, 3, 1, 1, enable_timing);
+  RunConv2DCpuUnitTest(64, 64, 32, 64, 3, 1, 1, enable_timing);
+  RunConv2DCpuUnitTest(33, 47, 16, 30, 3, 2, 1, enable_timing);
+  RunConv2DCpuUnitTest(28, 28, 8, 16, 5, 1, 2, enable_timing);
+  RunConv2DCpuUnitTest(17, 19, 5, 7, 1, 1, 0, enable_timing);
+  RunConv2DCpuUnitTest(16, 16, 96, 40, 1, 1, 0, enable_timing);
+  // Workers of their own, even on a single core, so that the tasks of a
+  // ParallelFor run off the calling thread.
+  ThreadPool pool(4, false);
+  RunConv2DCpuUnitTest(64, 64, 3, 32, 3, 1, 1, enable_timing, &pool);
+  RunConv2DCpuUnitTest(33, 47, 16, 30, 3, 2, 1, enable_timing, &pool);
+  RunSgemmUnitTest(64, 4096, 288, false, enable_timing);
+  RunSgemmUnitTest(75, 531, 300, true, enable_timing);
+  RunSgemmUnitTest(1, 7, 3, false, enable_timing);
+  RunDepthwiseConv2DCpuUnitTest(64, 64, 32, 1, 3, 1, 1, enable_timing);
+  RunDepthwiseConv2DCpuUnitTest(56, 56, 24, 2, 3, 2, 1, enable_timing);
+  RunDepthwiseConv2DCpuUnitTest(23, 31, 6, 3, 5, 1, 2, enable_timing);
+  const BatchNormStats per_image = BatchNormStats::kPerImage;
+  const BatchNormStats across_batch = BatchNormStats::kAcrossBatch;
+  RunBatchNormCpuUnitTest({1, 32, 64, 64}, 1.f, per_image, enable_timing);
+  RunBatchNormCpuUnitTest({1, 64, 17, 23}, 0.f, per_image, enable_timing);
+  RunBatchNormCpuUnitTest({3, 32, 19, 21}, 1.f, per_image, enable_timing);
+  RunBatchNormCpuUnitTest({3, 32, 19, 21}, 1.f, across_batch, enable_timing);
+}
+
+void RunConv2DCpuBenchmarks() {
+  // in_height, in_width, in_channels, out_channels, kernel_size as in
+  // RunConv2DTests, all with stride 1 and same padding.
+  const int shapes[][5] = {
+      {128, 128, 64, 64, 3}, {128, 128, 32, 32, 3}, {65, 69, 3, 16, 3},
+      {71, 92, 15, 18, 3},   {128, 128, 64, 64, 5}, {128, 128, 32, 32, 5},
+      {65, 69, 3, 16, 5},    {71, 92, 15, 18, 5}};
+  for (const int *shape : shapes) {
+    const int in_height = shape[0];
+    const int in_width = shape[1];
+    const int in_channels = shape[2];
+    const int out_channels = shape[3];
+    const int kernel_size = shape[4];
+    const int padding = kernel_size / 2;
+    const int out_size = out_channels * in_height * in_width;
+    std::vector<float> in_data(in_channels * in_height * in_width);
+    std::vector<float> kernel_data(out_channels * in_channels * kernel_size *
+                                   kernel_size);
+    std::vector<float> ref(out_size);
+    std::vector<float> out_data(out_size);
+    std::generate(in_data.begin(), in_data.end(),
+                  RandomGenerator(1.f / 500.f, -1.f));
+    std::generate(kernel_data.begin(), kernel_data.end(),
+                  RandomGenerator(1.f / 500.f, -1.f));
+    const double flops = 2.0 * out_size * in_channels * kernel_size *
+                         kernel_size;
+
+    std::cout << in_height << 'x' << in_width << ", " << in_channels << " -> "
+              << out_channels << ", " << kernel_size << 'x' << kernel_size
+              << ":";
+    auto tic = high_resolution_clock::now();
+    RunConv2DRef(in_data, ref, kernel_data, in_height, in_width, in_channels,
+                 out_channels, kernel_size, 1, padding);
+    auto toc = high_resolution_clock::now();
+    double us = duration_cast<microseconds>(toc - tic).count();
+    std::cout << " ref " << us << " us (" << flops / us / 1e3 << " GFLOP/s)";
+    for (Conv2DAlgorithm algorithm :
+         {Conv2DAlgorithm::kDirect, Conv2DAlgorithm::kIm2col}) {
+      // The first run warms up the pool and the scratch buffers.
+      RunConv2DCpu(in_data, out_data, kernel_data, in_height, in_width,
+                   in_channels, out_channels, kernel_size, 1, padding,
+                   algorithm);
+      tic = high_resolution_clock::now();
+      RunConv2DCpu(in_data, out_data, kernel_data, in_height, in_width,
+                   in_channels, out_channels, kernel_size, 1, padding,
+                   algorithm);
+      toc = high_resolution_clock::now();
+      us = duration_cast<microseconds>(toc - tic).count();
+      std::cout << ", " << GetConv2DAlgorithmName(algorithm) << ' ' << us
+                << " us (" << flops / us / 1e3 << " GFLOP/s)";
+    }
+    std::cout << '\n';
+    CheckResult(ref.data(), out_data.data(), out_size, false, 1e-3);
+  }
+}
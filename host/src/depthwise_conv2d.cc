@@ -1,5 +1,7 @@
 #include "depthwise_conv2d.h"
 
+#include "cpu_kernels.h"
+
 void RunDepthwiseConv2DRef(const float *in_data,
                            float *out_data,
                            const float *kernel_data,
@@ -66,4 +68,74 @@ void RunDepthwiseConv2DRef(const std::vector<float> &in_data,
                         kernel_size, stride, padding);
 }
 
+void RunDepthwiseConv2DCpu(const float *in_data,
+                           float *out_data,
+                           const float *kernel_data,
+                           int in_height,
+                           int in_width,
+                           int in_channels,
+                           int channel_multiplier,
+                           int kernel_size,
+                           int stride,
+                           int padding,
+                           ThreadPool *pool) {
+  const int out_height = ((in_height + 2 * padding - kernel_size) / stride) + 1;
+  const int out_width = ((in_width + 2 * padding - kernel_size) / stride) + 1;
+  const int in_size = in_height * in_width;
+  const int out_size = out_height * out_width;
+  const int kernel_area = kernel_size * kernel_size;
+  if (pool == nullptr) {
+    pool = &ThreadPool::GetDefault();
+  }
+
+  // A work item is one output row of all outputs of an input channel.
+  pool->ParallelFor(in_channels * out_height, 4, [&](int begin, int end) {
+    for (int item = begin; item < end; item++) {
+      const int ic = item / out_height;
+      const int oi = item % out_height;
+      const int oc = ic * channel_multiplier;
+      float *out_row = out_data + oc * out_size + oi * out_width;
+      for (int m = 0; m < channel_multiplier; m++) {
+        std::fill(out_row + m * out_size, out_row + m * out_size + out_width,
+                  0.f);
+      }
+      const float *in_plane = in_data + ic * in_size;
+      const float *kernel = kernel_data + oc * kernel_area;
+      for (int kr = 0; kr < kernel_size; kr++) {
+        const int r = oi * stride - padding + kr;
+        if ((r < 0) || (r >= in_height)) {
+          continue;
+        }
+        const float *in_row = in_plane + r * in_width;
+        for (int kc = 0; kc < kernel_size; kc++) {
+          int col_begin, col_end;
+          GetValidOutputRange(in_width, out_width, stride, kc - padding,
+                              &col_begin, &col_end);
+          if (col_begin == col_end) {
+            continue;
+          }
+          AccumulateRows(in_row + col_begin * stride + kc - padding, stride,
+                         col_end - col_begin, kernel + kr * kernel_size + kc,
+                         kernel_area, channel_multiplier,
+                         out_row + col_begin, out_size);
+        }
+      }
+    }
+  });
+}
 
+void RunDepthwiseConv2DCpu(const std::vector<float> &in_data,
+                           std::vector<float> &out_data,
+                           const std::vector<float> &kernel_data,
+                           int in_height,
+                           int in_width,
+                           int in_channels,
+                           int channel_multiplier,
+                           int kernel_size,
+                           int stride,
+                           int padding,
+                           ThreadPool *pool) {
+  RunDepthwiseConv2DCpu(in_data.data(), out_data.data(), kernel_data.data(),
+                        in_height, in_width, in_channels, channel_multiplier,
+                        kernel_size, stride, padding, pool);
+}
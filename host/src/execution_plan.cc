@@ -0,0 +1,242 @@
+#include "execution_plan.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "memory_activation.h"
+
+ExecutionPlan::ExecutionPlan(cl_platform_id platform, cl_device_id device,
+                             cl_command_queue command_queue)
+    : platform_(platform),
+      device_(device),
+      command_queue_(command_queue),
+      profiler_(nullptr),
+      recording_(false),
+      recorded_(false) {
+#ifdef cl_khr_command_buffer
+  command_buffer_supported_ = false;
+  command_buffer_ = nullptr;
+  last_sync_point_ = 0;
+  LoadCommandBufferFunctions();
+#endif
+}
+
+ExecutionPlan::~ExecutionPlan() {
+  Reset();
+}
+
+void ExecutionPlan::BeginRecording() {
+  ASSERT(!recording_, "The plan is already recording");
+  Reset();
+  recording_ = true;
+#ifdef cl_khr_command_buffer
+  if (command_buffer_supported_) {
+    cl_int status;
+    command_buffer_ =
+        create_command_buffer_(1, &command_queue_, nullptr, &status);
+    if (status != CL_SUCCESS) {
+      command_buffer_ = nullptr;
+    }
+  }
+#endif
+}
+
+void ExecutionPlan::EndRecording() {
+  ASSERT(recording_, "The plan is not recording");
+  recording_ = false;
+  recorded_ = true;
+  ComputeDirtyArgs();
+#ifdef cl_khr_command_buffer
+  if (command_buffer_ != nullptr) {
+    if (finalize_command_buffer_(command_buffer_) != CL_SUCCESS) {
+      ReleaseCommandBuffer();
+    }
+  }
+#endif
+}
+
+bool ExecutionPlan::IsRecording() const {
+  return recording_;
+}
+
+bool ExecutionPlan::IsRecorded() const {
+  return recorded_;
+}
+
+void ExecutionPlan::Reset() {
+#ifdef cl_khr_command_buffer
+  ReleaseCommandBuffer();
+#endif
+  for (Launch &launch : launches_) {
+    clReleaseKernel(launch.kernel);
+  }
+  launches_.clear();
+  recording_ = false;
+  recorded_ = false;
+}
+
+void ExecutionPlan::RecordKernel(cl_kernel kernel,
+                                 const std::vector<KernelArg> &args,
+                                 cl_uint work_dim,
+                                 const std::size_t *global_size,
+                                 const std::size_t *local_size,
+                                 const char *name) {
+  ASSERT(recording_, "The plan is not recording");
+  ASSERT(work_dim >= 1 && work_dim <= 3, "Invalid work dimension");
+  ASSERT(local_size != nullptr, "Launches must specify a local size");
+
+  Launch launch;
+  launch.kernel = kernel;
+  launch.name = name;
+  launch.args = args;
+  launch.work_dim = work_dim;
+  for (cl_uint i = 0; i < 3; i++) {
+    launch.global_size[i] = (i < work_dim) ? global_size[i] : 1;
+    launch.local_size[i] = (i < work_dim) ? local_size[i] : 1;
+  }
+  clRetainKernel(kernel);
+  launches_.push_back(launch);
+
+#ifdef cl_khr_command_buffer
+  if (command_buffer_ != nullptr) {
+    // The command buffer snapshots the arguments currently set on the
+    // kernel. Chain the sync points to keep the recording order.
+    cl_sync_point_khr sync_point;
+    const bool has_prev = launches_.size() > 1;
+    cl_int status = command_nd_range_kernel_(
+        command_buffer_, nullptr, nullptr, kernel, work_dim, nullptr,
+        global_size, local_size, has_prev ? 1 : 0,
+        has_prev ? &last_sync_point_ : nullptr, &sync_point, nullptr);
+    if (status == CL_SUCCESS) {
+      last_sync_point_ = sync_point;
+    } else {
+      // Fall back to the host replay loop.
+      ReleaseCommandBuffer();
+    }
+  }
+#endif
+}
+
+void ExecutionPlan::Replay(bool blocking) {
+  ASSERT(recorded_, "The plan has not been recorded");
+#ifdef cl_khr_command_buffer
+  if (command_buffer_ != nullptr) {
+    ProfileEvent event(profiler_, "CommandBuffer", ProfileKind::kKernel);
+    cl_int status = enqueue_command_buffer_(0, nullptr, command_buffer_, 0,
+                                            nullptr, event.Get());
+    ASSERT(status == CL_SUCCESS, "Failed to enqueue the command buffer");
+    event.Commit(status);
+  } else {
+    ReplayHost();
+  }
+#else
+  ReplayHost();
+#endif
+  if (blocking) {
+    clFinish(command_queue_);
+  }
+}
+
+void ExecutionPlan::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+std::size_t ExecutionPlan::GetNumLaunches() const {
+  return launches_.size();
+}
+
+bool ExecutionPlan::UsesCommandBuffer() const {
+#ifdef cl_khr_command_buffer
+  return command_buffer_ != nullptr;
+#else
+  return false;
+#endif
+}
+
+void ExecutionPlan::ComputeDirtyArgs() {
+  for (std::size_t i = 0; i < launches_.size(); i++) {
+    Launch &launch = launches_[i];
+    launch.dirty_args.clear();
+    // Find the previous launch of the same kernel in this plan. The first
+    // launch of each kernel always sets everything, since other code may
+    // have re-bound the kernel between two replays.
+    const Launch *prev = nullptr;
+    for (std::size_t j = i; j > 0; j--) {
+      if (launches_[j - 1].kernel == launch.kernel) {
+        prev = &launches_[j - 1];
+        break;
+      }
+    }
+    for (cl_uint k = 0; k < launch.args.size(); k++) {
+      if ((prev == nullptr) || (k >= prev->args.size()) ||
+          (launch.args[k] != prev->args[k])) {
+        launch.dirty_args.push_back(k);
+      }
+    }
+  }
+}
+
+void ExecutionPlan::ReplayHost() {
+  cl_int status;
+  for (const Launch &launch : launches_) {
+    for (cl_uint k : launch.dirty_args) {
+      status = SetKernelArg(launch.kernel, k, launch.args[k]);
+      ASSERT(status == CL_SUCCESS,
+             "Failed to set the argument " + std::to_string(k));
+    }
+    ProfileEvent event(profiler_, launch.name, ProfileKind::kKernel);
+    status = clEnqueueNDRangeKernel(command_queue_, launch.kernel,
+                                    launch.work_dim, nullptr,
+                                    launch.global_size, launch.local_size, 0,
+                                    nullptr, event.Get());
+    ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+    event.Commit(status);
+  }
+}
+
+#ifdef cl_khr_command_buffer
+void ExecutionPlan::LoadCommandBufferFunctions() {
+  std::size_t ext_size;
+  cl_int status =
+      clGetDeviceInfo(device_, CL_DEVICE_EXTENSIONS, 0, nullptr, &ext_size);
+  if (status != CL_SUCCESS) {
+    return;
+  }
+  std::vector<char> ext(ext_size + 1, '\0');
+  clGetDeviceInfo(device_, CL_DEVICE_EXTENSIONS, ext_size, ext.data(),
+                  nullptr);
+  if (std::strstr(ext.data(), "cl_khr_command_buffer") == nullptr) {
+    return;
+  }
+  create_command_buffer_ = reinterpret_cast<clCreateCommandBufferKHR_fn>(
+      clGetExtensionFunctionAddressForPlatform(platform_,
+                                               "clCreateCommandBufferKHR"));
+  finalize_command_buffer_ = reinterpret_cast<clFinalizeCommandBufferKHR_fn>(
+      clGetExtensionFunctionAddressForPlatform(platform_,
+                                               "clFinalizeCommandBufferKHR"));
+  release_command_buffer_ = reinterpret_cast<clReleaseCommandBufferKHR_fn>(
+      clGetExtensionFunctionAddressForPlatform(platform_,
+                                               "clReleaseCommandBufferKHR"));
+  enqueue_command_buffer_ = reinterpret_cast<clEnqueueCommandBufferKHR_fn>(
+      clGetExtensionFunctionAddressForPlatform(platform_,
+                                               "clEnqueueCommandBufferKHR"));
+  command_nd_range_kernel_ = reinterpret_cast<clCommandNDRangeKernelKHR_fn>(
+      clGetExtensionFunctionAddressForPlatform(platform_,
+                                               "clCommandNDRangeKernelKHR"));
+  command_buffer_supported_ =
+      (create_command_buffer_ != nullptr) &&
+      (finalize_command_buffer_ != nullptr) &&
+      (release_command_buffer_ != nullptr) &&
+      (enqueue_command_buffer_ != nullptr) &&
+      (command_nd_range_kernel_ != nullptr);
+}
+
+void ExecutionPlan::ReleaseCommandBuffer() {
+  if (command_buffer_ != nullptr) {
+    release_command_buffer_(command_buffer_);
+    command_buffer_ = nullptr;
+  }
+  last_sync_point_ = 0;
+}
+#endif
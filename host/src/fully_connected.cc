@@ -0,0 +1,76 @@
+#include "fully_connected.h"
+
+#include <algorithm>
+
+#include "gemm.h"
+#include "memory_activation.h"
+
+void RunFullyConnectedRef(const float *in_data,
+                          float *out_data,
+                          const float *weights,
+                          const float *biases,
+                          int batch,
+                          int in_features,
+                          int out_features) {
+  for (int n = 0; n < batch; n++) {
+    const float *in = in_data + n * in_features;
+    for (int o = 0; o < out_features; o++) {
+      const float *row = weights + o * in_features;
+      double sum = 0.0;
+      for (int k = 0; k < in_features; k++) {
+        sum += static_cast<double>(in[k]) * row[k];
+      }
+      out_data[n * out_features + o] = static_cast<float>(sum + biases[o]);
+    }
+  }
+}
+
+void RunFullyConnectedRef(const std::vector<float> &in_data,
+                          std::vector<float> &out_data,
+                          const std::vector<float> &weights,
+                          const std::vector<float> &biases,
+                          int batch,
+                          int in_features,
+                          int out_features) {
+  ASSERT(in_data.size() >= static_cast<std::size_t>(batch) * in_features,
+         "Input doesn't have enough data");
+  ASSERT(weights.size() >=
+             static_cast<std::size_t>(out_features) * in_features,
+         "Not enough weights");
+  ASSERT(biases.size() >= static_cast<std::size_t>(out_features),
+         "Not enough biases");
+  out_data.resize(batch * out_features);
+  RunFullyConnectedRef(in_data.data(), out_data.data(), weights.data(),
+                       biases.data(), batch, in_features, out_features);
+}
+
+std::vector<float> TransposeFullyConnectedWeights(
+    const std::vector<float> &weights,
+    int in_features,
+    int out_features) {
+  ASSERT(weights.size() >=
+             static_cast<std::size_t>(out_features) * in_features,
+         "Not enough weights");
+  std::vector<float> weights_t(in_features * out_features);
+  for (int o = 0; o < out_features; o++) {
+    for (int k = 0; k < in_features; k++) {
+      weights_t[k * out_features + o] = weights[o * in_features + k];
+    }
+  }
+  return weights_t;
+}
+
+void RunFullyConnectedCpu(const float *in_data,
+                          float *out_data,
+                          const float *weights_t,
+                          const float *biases,
+                          int batch,
+                          int in_features,
+                          int out_features,
+                          ThreadPool *pool) {
+  for (int n = 0; n < batch; n++) {
+    std::copy(biases, biases + out_features, out_data + n * out_features);
+  }
+  RunSgemm(batch, out_features, in_features, in_data, in_features, weights_t,
+           out_features, out_data, out_features, true, pool);
+}
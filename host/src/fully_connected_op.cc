@@ -0,0 +1,167 @@
+#include "fully_connected_op.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Matches FC_TILE of device/fully_connected.cl.
+const int kTile = 16;
+// Lanes of a GEMV work-group, each with at least kMinVectorsPerLane float4
+// of the weight row.
+const int kMaxGemvWorkGroupSize = 256;
+const int kMinGemvWorkGroupSize = 16;
+const int kMinVectorsPerLane = 4;
+
+int GetGemvWorkGroupSize(int in_features) {
+  const int vectors = (in_features + 3) / 4;
+  int wg_size = kMinGemvWorkGroupSize;
+  while ((wg_size < kMaxGemvWorkGroupSize) &&
+         (wg_size * kMinVectorsPerLane < vectors)) {
+    wg_size *= 2;
+  }
+  return wg_size;
+}
+
+}  // namespace
+
+FullyConnectedOp::FullyConnectedOp(int in_features, int out_features,
+                                   cl_kernel *gemv_kernel,
+                                   cl_kernel *gemm_kernel,
+                                   cl_command_queue *command_queue,
+                                   cl_mem *in_buf,
+                                   cl_mem *weights_buf,
+                                   cl_mem *biases_buf,
+                                   cl_mem *out_buf)
+    : in_features_(in_features),
+      out_features_(out_features),
+      in_scale_(1.f),
+      gemv_kernel_(gemv_kernel),
+      gemm_kernel_(gemm_kernel),
+      command_queue_(command_queue),
+      in_buf_(in_buf),
+      weights_buf_(weights_buf),
+      biases_buf_(biases_buf),
+      out_buf_(out_buf),
+      plan_(nullptr),
+      profiler_(nullptr) {}
+
+void FullyConnectedOp::SetInBuffer(cl_mem *buf) {
+  in_buf_ = buf;
+}
+
+void FullyConnectedOp::SetWeightBuffer(cl_mem *buf) {
+  weights_buf_ = buf;
+}
+
+void FullyConnectedOp::SetBiasBuffer(cl_mem *buf) {
+  biases_buf_ = buf;
+}
+
+void FullyConnectedOp::SetOutBuffer(cl_mem *buf) {
+  out_buf_ = buf;
+}
+
+void FullyConnectedOp::SetInScale(float scale) {
+  in_scale_ = scale;
+}
+
+void FullyConnectedOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
+
+void FullyConnectedOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+void FullyConnectedOp::Run(const std::vector<int> &shape, bool blocking) {
+  ASSERT(!shape.empty(), "Expects a batch");
+  const int size =
+      std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<int>());
+  ASSERT(size == shape[0] * in_features_, "Number of input features");
+  ASSERT(in_buf_ != nullptr, "input buffer is null");
+  ASSERT(weights_buf_ != nullptr, "weight buffer is null");
+  ASSERT(biases_buf_ != nullptr, "bias buffer is null");
+  ASSERT(out_buf_ != nullptr, "output buffer is null");
+
+  if (shape[0] == 1) {
+    RunGemv(shape[0]);
+  } else {
+    RunGemm(shape[0]);
+  }
+
+  if (blocking) {
+    clFinish(*command_queue_);
+  }
+}
+
+void FullyConnectedOp::RunGemv(int batch) {
+  const static cl_uint wg_dim = 3;
+
+  const std::size_t wg_size = GetGemvWorkGroupSize(in_features_);
+  // A work-group per output of every image.
+  const std::size_t global_size[wg_dim] = {
+    wg_size, static_cast<std::size_t>(out_features_),
+    static_cast<std::size_t>(batch)
+  };
+  const std::size_t local_size[wg_dim] = {wg_size, 1, 1};
+
+  const std::vector<KernelArg> args{
+      *in_buf_, *weights_buf_, *biases_buf_, *out_buf_, in_features_,
+      out_features_, in_scale_,
+      KernelArg::LocalMemory(sizeof(cl_float4) * wg_size)};
+  SetKernelArgs(*gemv_kernel_, args);
+
+  ProfileEvent event(profiler_, "FullyConnectedGemv", ProfileKind::kKernel);
+  cl_int status = clEnqueueNDRangeKernel(
+      *command_queue_, *gemv_kernel_, wg_dim, nullptr, global_size,
+      local_size, 0, nullptr, event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(*gemv_kernel_, args, wg_dim, global_size, local_size,
+                        "FullyConnectedGemv");
+  }
+}
+
+void FullyConnectedOp::RunGemm(int batch) {
+  const static cl_uint wg_dim = 2;
+
+  const std::size_t global_size[wg_dim] = {
+    static_cast<std::size_t>(RoundUp(out_features_, kTile)),
+    static_cast<std::size_t>(RoundUp(batch, kTile))
+  };
+  const std::size_t local_size[wg_dim] = {kTile, kTile};
+  const std::size_t tile_size = sizeof(float) * kTile * (kTile + 1);
+
+  const std::vector<KernelArg> args{
+      *in_buf_, *weights_buf_, *biases_buf_, *out_buf_, batch, in_features_,
+      out_features_, in_scale_, KernelArg::LocalMemory(tile_size),
+      KernelArg::LocalMemory(tile_size)};
+  SetKernelArgs(*gemm_kernel_, args);
+
+  ProfileEvent event(profiler_, "FullyConnectedGemm", ProfileKind::kKernel);
+  cl_int status = clEnqueueNDRangeKernel(
+      *command_queue_, *gemm_kernel_, wg_dim, nullptr, global_size,
+      local_size, 0, nullptr, event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(*gemm_kernel_, args, wg_dim, global_size, local_size,
+                        "FullyConnectedGemm");
+  }
+}
+
+void FullyConnectedOp::Run(const std::vector<int> &shape, bool blocking,
+                           float *out_data) {
+  Run(shape, blocking);
+  ProfileEvent event(profiler_, "FullyConnected output", ProfileKind::kRead);
+  cl_int status = clEnqueueReadBuffer(
+      *command_queue_, *out_buf_, blocking, 0,
+      sizeof(float) * shape[0] * out_features_, out_data, 0, nullptr,
+      event.Get());
+  event.Commit(status);
+}
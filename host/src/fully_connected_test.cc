@@ -0,0 +1,134 @@
+#include "fully_connected_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "memory_activation.h"
+#include "reduce.h"
+
+void RunFullyConnectedRefUnitTest() {
+  std::cout << "FullyConnected reference\n";
+  // Batch of 2, 3 features in, 2 out.
+  const std::vector<float> in_data{1.f, 2.f, 3.f, -1.f, 0.f, 2.f};
+  const std::vector<float> weights{1.f, 0.f, -1.f, 0.5f, 0.5f, 0.5f};
+  const std::vector<float> biases{1.f, -3.f};
+  const std::vector<float> expected{-1.f, 0.f, -2.f, -2.5f};
+
+  std::vector<float> out_data;
+  RunFullyConnectedRef(in_data, out_data, weights, biases, 2, 3, 2);
+  int num_errors =
+      (out_data.size() != expected.size()) ||
+      (GetMaxError(expected.data(), out_data.data(), expected.size()) > 1e-6f);
+  const std::vector<float> weights_t =
+      TransposeFullyConnectedWeights(weights, 3, 2);
+  std::vector<float> cpu_out(expected.size());
+  RunFullyConnectedCpu(in_data.data(), cpu_out.data(), weights_t.data(),
+                       biases.data(), 2, 3, 2);
+  num_errors += GetMaxError(expected.data(), cpu_out.data(),
+                            expected.size()) > 1e-6f;
+  PrintResult(num_errors);
+}
+
+void RunFullyConnectedUnitTest(Workspace &ws,
+                               int batch,
+                               int in_features,
+                               int out_features) {
+  std::cout << "FullyConnected, batch = " << batch
+            << ", in_features = " << in_features
+            << ", out_features = " << out_features << '\n';
+  std::vector<float> in_data(batch * in_features);
+  std::vector<float> weights(out_features * in_features);
+  std::vector<float> biases(out_features);
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, 1.f));
+  std::generate(weights.begin(), weights.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(biases.begin(), biases.end(),
+                RandomGenerator(1.f / 1000.f, 0.f));
+  std::vector<float> ref;
+  RunFullyConnectedRef(in_data, ref, weights, biases, batch, in_features,
+                       out_features);
+
+  int num_errors = 0;
+  std::unique_ptr<Operator> ops[] = {
+      CreateFullyConnected(Backend::kOpenCL, &ws, in_features, out_features,
+                           weights, biases),
+      CreateFullyConnected(Backend::kCpu, nullptr, in_features, out_features,
+                           weights, biases)};
+  for (auto &op : ops) {
+    num_errors += CheckOperator(ws, *op, {batch, in_features}, in_data, ref,
+                                1e-5f);
+  }
+  PrintResult(num_errors);
+}
+
+void RunGlobalAvgPoolUnitTest(Workspace &ws, const std::vector<int> &shape) {
+  std::cout << "GlobalAvgPool, shape = ";
+  PrintShape(shape);
+  std::cout << '\n';
+  std::vector<float> in_data(shape[0] * shape[1] * shape[2] * shape[3]);
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, 3.f));
+  std::vector<float> ref;
+  RunReduceRef(in_data, ref, shape, 2, 2, Reduction::kMean);
+
+  int num_errors = 0;
+  std::unique_ptr<Operator> ops[] = {
+      CreateGlobalAvgPool(Backend::kOpenCL, &ws),
+      CreateGlobalAvgPool(Backend::kCpu, nullptr)};
+  for (auto &op : ops) {
+    num_errors += CheckOperator(ws, *op, shape, in_data, ref, 1e-5f);
+  }
+  PrintResult(num_errors);
+}
+
+void RunPooledFullyConnectedUnitTest(Workspace &ws,
+                                     const std::vector<int> &shape,
+                                     int out_features) {
+  std::cout << "GlobalAvgPool + FullyConnected, shape = ";
+  PrintShape(shape);
+  std::cout << ", out_features = " << out_features << '\n';
+  const int in_features = shape[1];
+  std::vector<float> in_data(shape[0] * in_features * shape[2] * shape[3]);
+  std::vector<float> weights(out_features * in_features);
+  std::vector<float> biases(out_features);
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, 1.f));
+  std::generate(weights.begin(), weights.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(biases.begin(), biases.end(),
+                RandomGenerator(1.f / 1000.f, 0.f));
+  std::vector<float> pooled;
+  RunReduceRef(in_data, pooled, shape, 2, 2, Reduction::kMean);
+  std::vector<float> ref;
+  RunFullyConnectedRef(pooled, ref, weights, biases, shape[0], in_features,
+                       out_features);
+
+  int num_errors = 0;
+  std::unique_ptr<Operator> ops[] = {
+      CreateFullyConnected(Backend::kOpenCL, &ws, in_features, out_features,
+                           weights, biases, true),
+      CreateFullyConnected(Backend::kCpu, nullptr, in_features, out_features,
+                           weights, biases, true)};
+  for (auto &op : ops) {
+    num_errors += CheckOperator(ws, *op, shape, in_data, ref, 1e-5f);
+  }
+  PrintResult(num_errors);
+}
+
+void RunFullyConnectedTests(Workspace &ws) {
+  RunFullyConnectedRefUnitTest();
+
+  // Feature counts that aren't multiples of the vector width or the tile.
+  RunFullyConnectedUnitTest(ws, 1, 1024, 1000);
+  RunFullyConnectedUnitTest(ws, 1, 37, 10);
+  RunFullyConnectedUnitTest(ws, 8, 1024, 1000);
+  RunFullyConnectedUnitTest(ws, 19, 45, 23);
+
+  RunGlobalAvgPoolUnitTest(ws, {2, 64, 7, 7});
+  RunGlobalAvgPoolUnitTest(ws, {1, 3, 33, 31});
+
+  RunPooledFullyConnectedUnitTest(ws, {1, 512, 7, 7}, 1000);
+  RunPooledFullyConnectedUnitTest(ws, {4, 30, 5, 3}, 17);
+}
@@ -0,0 +1,254 @@
+#include "gemm.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "cpu_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HOST_HAS_X86_KERNELS 1
+#endif
+
+namespace {
+
+// Macro-tile sizes: a kMc x kKc panel of A stays in L2 and a kKc x nr
+// sliver of B in L1 while the micro-kernel sweeps the tile. kMc is a
+// multiple of every mr and kNc of every nr.
+const int kMc = 72;
+const int kKc = 256;
+const int kNc = 512;
+// Largest mr * nr of the micro-kernels.
+const int kMaxMicroTile = 8 * 32;
+
+// Computes an mr x nr tile of C from kc steps of packed A (mr values per
+// step) and packed B (nr values per step).
+typedef void (*MicroKernelFn)(int kc, const float *a, const float *b,
+                              float *c, int ldc, bool accumulate);
+
+struct MicroKernel {
+  int mr;
+  int nr;
+  MicroKernelFn run;
+};
+
+void MicroKernelScalar(int kc, const float *a, const float *b, float *c,
+                       int ldc, bool accumulate) {
+  float acc[4][4] = {};
+  for (int p = 0; p < kc; p++) {
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++) {
+        acc[i][j] += a[i] * b[j];
+      }
+    }
+    a += 4;
+    b += 4;
+  }
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      c[i * ldc + j] = accumulate ? c[i * ldc + j] + acc[i][j] : acc[i][j];
+    }
+  }
+}
+
+#ifdef HOST_HAS_X86_KERNELS
+
+// 6 x 16 tile: 12 ymm accumulators, two for B and one broadcast of A.
+__attribute__((target("avx2,fma"))) void MicroKernelAvx2(
+    int kc, const float *a, const float *b, float *c, int ldc,
+    bool accumulate) {
+  __m256 acc[6][2];
+#pragma GCC unroll 6
+  for (int i = 0; i < 6; i++) {
+    acc[i][0] = _mm256_setzero_ps();
+    acc[i][1] = _mm256_setzero_ps();
+  }
+  for (int p = 0; p < kc; p++) {
+    const __m256 b0 = _mm256_loadu_ps(b);
+    const __m256 b1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 6
+    for (int i = 0; i < 6; i++) {
+      const __m256 ai = _mm256_broadcast_ss(a + i);
+      acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+      acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+    }
+    a += 6;
+    b += 16;
+  }
+#pragma GCC unroll 6
+  for (int i = 0; i < 6; i++) {
+    float *row = c + i * ldc;
+    if (accumulate) {
+      acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(row));
+      acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(row + 8));
+    }
+    _mm256_storeu_ps(row, acc[i][0]);
+    _mm256_storeu_ps(row + 8, acc[i][1]);
+  }
+}
+
+// 8 x 32 tile: 16 zmm accumulators, two for B and one broadcast of A.
+__attribute__((target("avx512f"))) void MicroKernelAvx512(
+    int kc, const float *a, const float *b, float *c, int ldc,
+    bool accumulate) {
+  __m512 acc[8][2];
+#pragma GCC unroll 8
+  for (int i = 0; i < 8; i++) {
+    acc[i][0] = _mm512_setzero_ps();
+    acc[i][1] = _mm512_setzero_ps();
+  }
+  for (int p = 0; p < kc; p++) {
+    const __m512 b0 = _mm512_loadu_ps(b);
+    const __m512 b1 = _mm512_loadu_ps(b + 16);
+#pragma GCC unroll 8
+    for (int i = 0; i < 8; i++) {
+      const __m512 ai = _mm512_set1_ps(a[i]);
+      acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+      acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+    }
+    a += 8;
+    b += 32;
+  }
+#pragma GCC unroll 8
+  for (int i = 0; i < 8; i++) {
+    float *row = c + i * ldc;
+    if (accumulate) {
+      acc[i][0] = _mm512_add_ps(acc[i][0], _mm512_loadu_ps(row));
+      acc[i][1] = _mm512_add_ps(acc[i][1], _mm512_loadu_ps(row + 16));
+    }
+    _mm512_storeu_ps(row, acc[i][0]);
+    _mm512_storeu_ps(row + 16, acc[i][1]);
+  }
+}
+
+#endif  // HOST_HAS_X86_KERNELS
+
+MicroKernel GetMicroKernel() {
+#ifdef HOST_HAS_X86_KERNELS
+  switch (GetCpuIsa()) {
+    case CpuIsa::kAvx512:
+      return {8, 32, MicroKernelAvx512};
+    case CpuIsa::kAvx2:
+      return {6, 16, MicroKernelAvx2};
+    default:
+      break;
+  }
+#endif
+  return {4, 4, MicroKernelScalar};
+}
+
+// Pack rows [0, mb) x columns [0, kb) of A into panels of mr rows, each
+// stored step by step. Rows past mb are zero so edge panels run the same
+// micro-kernel.
+void PackA(const float *a, int lda, int mb, int kb, int mr, float *packed) {
+  for (int ip = 0; ip < mb; ip += mr) {
+    const int rows = std::min(mr, mb - ip);
+    for (int p = 0; p < kb; p++) {
+      for (int i = 0; i < rows; i++) {
+        packed[i] = a[(ip + i) * lda + p];
+      }
+      std::fill(packed + rows, packed + mr, 0.f);
+      packed += mr;
+    }
+  }
+}
+
+// Pack rows [0, kb) x columns [0, nb) of B into panels of nr columns, each
+// stored step by step and zero-padded like PackA.
+void PackB(const float *b, int ldb, int kb, int nb, int nr, float *packed) {
+  for (int jp = 0; jp < nb; jp += nr) {
+    const int cols = std::min(nr, nb - jp);
+    for (int p = 0; p < kb; p++) {
+      std::memcpy(packed, b + p * ldb + jp, cols * sizeof(float));
+      std::fill(packed + cols, packed + nr, 0.f);
+      packed += nr;
+    }
+  }
+}
+
+}  // namespace
+
+void RunSgemm(int m, int n, int k,
+              const float *a, int lda,
+              const float *b, int ldb,
+              float *c, int ldc,
+              bool accumulate,
+              ThreadPool *pool) {
+  if ((m <= 0) || (n <= 0)) {
+    return;
+  }
+  if (k <= 0) {
+    if (!accumulate) {
+      for (int i = 0; i < m; i++) {
+        std::fill(c + i * ldc, c + i * ldc + n, 0.f);
+      }
+    }
+    return;
+  }
+  if (pool == nullptr) {
+    pool = &ThreadPool::GetDefault();
+  }
+  const MicroKernel kernel = GetMicroKernel();
+  const int mr = kernel.mr;
+  const int nr = kernel.nr;
+  const int m_tiles = (m + kMc - 1) / kMc;
+  const int n_tiles = (n + kNc - 1) / kNc;
+
+  pool->ParallelFor(m_tiles * n_tiles, 1, [&](int begin, int end) {
+    static thread_local std::vector<float> packed_a;
+    static thread_local std::vector<float> packed_b;
+    packed_a.resize(kMc * kKc);
+    packed_b.resize(kKc * kNc);
+    float tile[kMaxMicroTile];
+    for (int t = begin; t < end; t++) {
+      const int ic = (t / n_tiles) * kMc;
+      const int jc = (t % n_tiles) * kNc;
+      const int mb = std::min(kMc, m - ic);
+      const int nb = std::min(kNc, n - jc);
+      for (int pc = 0; pc < k; pc += kKc) {
+        const int kb = std::min(kKc, k - pc);
+        const bool acc = accumulate || (pc > 0);
+        PackA(a + ic * lda + pc, lda, mb, kb, mr, packed_a.data());
+        PackB(b + pc * ldb + jc, ldb, kb, nb, nr, packed_b.data());
+        for (int jr = 0; jr < nb; jr += nr) {
+          const float *b_panel = packed_b.data() + jr * kb;
+          for (int ir = 0; ir < mb; ir += mr) {
+            const float *a_panel = packed_a.data() + ir * kb;
+            float *c_tile = c + (ic + ir) * ldc + jc + jr;
+            const int rows = std::min(mr, mb - ir);
+            const int cols = std::min(nr, nb - jr);
+            if ((rows == mr) && (cols == nr)) {
+              kernel.run(kb, a_panel, b_panel, c_tile, ldc, acc);
+              continue;
+            }
+            // Edge tile: compute the padded tile aside, keep the valid part.
+            kernel.run(kb, a_panel, b_panel, tile, nr, false);
+            for (int i = 0; i < rows; i++) {
+              for (int j = 0; j < cols; j++) {
+                float &out = c_tile[i * ldc + j];
+                out = acc ? out + tile[i * nr + j] : tile[i * nr + j];
+              }
+            }
+          }
+        }
+      }
+    }
+  });
+}
+
+void RunSgemmRef(int m, int n, int k,
+                 const float *a, int lda,
+                 const float *b, int ldb,
+                 float *c, int ldc,
+                 bool accumulate) {
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < n; j++) {
+      float acc = accumulate ? c[i * ldc + j] : 0.f;
+      for (int p = 0; p < k; p++) {
+        acc += a[i * lda + p] * b[p * ldb + j];
+      }
+      c[i * ldc + j] = acc;
+    }
+  }
+}
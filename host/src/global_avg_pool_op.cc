@@ -0,0 +1,66 @@
+#include "global_avg_pool_op.h"
+
+#include "memory_activation.h"
+#include "reduce_op.h"
+
+GlobalAvgPoolOp::GlobalAvgPoolOp(cl_kernel *reduce_kernel,
+                                 cl_command_queue *command_queue,
+                                 cl_mem *in_buf, cl_mem *out_buf,
+                                 cl_mem *scratch_buf)
+    : sum_(false),
+      reduce_kernel_(reduce_kernel),
+      command_queue_(command_queue),
+      in_buf_(in_buf),
+      out_buf_(out_buf),
+      scratch_buf_(scratch_buf),
+      plan_(nullptr),
+      profiler_(nullptr) {}
+
+void GlobalAvgPoolOp::SetInBuffer(cl_mem *buf) {
+  in_buf_ = buf;
+}
+
+void GlobalAvgPoolOp::SetOutBuffer(cl_mem *buf) {
+  out_buf_ = buf;
+}
+
+void GlobalAvgPoolOp::SetScratchBuffer(cl_mem *buf) {
+  scratch_buf_ = buf;
+}
+
+void GlobalAvgPoolOp::SetSum(bool sum) {
+  sum_ = sum;
+}
+
+void GlobalAvgPoolOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
+
+void GlobalAvgPoolOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+std::size_t GlobalAvgPoolOp::GetScratchSize(const std::vector<int> &shape) {
+  ASSERT(shape.size() == 4, "Only accepts 4D input");
+  return ReduceOp::GetScratchSize(shape, 2, 2);
+}
+
+void GlobalAvgPoolOp::Run(const std::vector<int> &shape, bool blocking) {
+  ASSERT(shape.size() == 4, "Only accepts 4D input");
+  // A plain sum is cheaper than the Welford steps of the mean.
+  ReduceOp reduce(sum_ ? Reduction::kSum : Reduction::kMean, reduce_kernel_,
+                  command_queue_, in_buf_, out_buf_, scratch_buf_);
+  reduce.SetExecutionPlan(plan_);
+  reduce.SetProfiler(profiler_);
+  reduce.Run(shape, 2, 2, blocking);
+}
+
+void GlobalAvgPoolOp::Run(const std::vector<int> &shape, bool blocking,
+                          float *out_data) {
+  Run(shape, blocking);
+  ProfileEvent event(profiler_, "GlobalAvgPool output", ProfileKind::kRead);
+  cl_int status = clEnqueueReadBuffer(
+      *command_queue_, *out_buf_, blocking, 0,
+      sizeof(float) * shape[0] * shape[1], out_data, 0, nullptr, event.Get());
+  event.Commit(status);
+}
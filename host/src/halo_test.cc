@@ -0,0 +1,133 @@
+#include "halo_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "memory_activation.h"
+
+namespace {
+
+struct HaloParams {
+  std::vector<float> conv1;
+  std::vector<float> depthwise1;
+  std::vector<float> conv2;
+  std::vector<float> conv3;
+  std::vector<float> depthwise2;
+  std::vector<float> weights;
+  std::vector<float> biases;
+};
+
+const int kChannels1 = 8;
+const int kChannels2 = 16;
+const int kChannels3 = 4;
+
+std::vector<float> RandomData(int size, float weight, float bias) {
+  std::vector<float> data(size);
+  std::generate(data.begin(), data.end(), RandomGenerator(weight, bias));
+  return data;
+}
+
+// Padding 1 and 2 convs, whose inputs get halos of 1 and 2, batch norms
+// in place on them, a stride 2 conv, which takes no halo but writes one,
+// and a last depthwise conv into the output.
+void AddHaloLayers(Network &network, Backend backend, Workspace *ws,
+                   int in_channels, const HaloParams &params,
+                   BatchNormStats stats) {
+  network.Add(CreateConv2D(backend, ws, in_channels, kChannels1, 3, 1, 1,
+                           params.conv1));
+  network.Add(CreateBatchNorm(backend, ws, kChannels1, 1e-5f, 1.f,
+                              params.weights, params.biases, stats));
+  network.Add(CreateDepthwiseConv2D(backend, ws, kChannels1, 2, 3, 1, 1,
+                                    params.depthwise1));
+  network.Add(CreateConv2D(backend, ws, kChannels2, kChannels1, 5, 1, 2,
+                           params.conv2));
+  network.Add(CreateBatchNorm(backend, ws, kChannels1, 1e-5f, 0.f,
+                              params.weights, params.biases, stats));
+  network.Add(CreateConv2D(backend, ws, kChannels1, kChannels3, 3, 2, 1,
+                           params.conv3));
+  network.Add(CreateDepthwiseConv2D(backend, ws, kChannels3, 1, 3, 1, 1,
+                                    params.depthwise2));
+}
+
+// Bytes the halos of AddHaloLayers add to the tensors.
+std::size_t GetHaloBytes(const std::vector<int> &shape) {
+  const int batch = shape[0];
+  const int height = shape[2];
+  const int width = shape[3];
+  const int half_height = (height - 1) / 2 + 1;
+  const int half_width = (width - 1) / 2 + 1;
+  auto border = [](int height, int width, int halo) {
+    return (height + 2 * halo) * (width + 2 * halo) - height * width;
+  };
+  return sizeof(float) * batch *
+         (kChannels1 * border(height, width, 1) +
+          kChannels2 * border(height, width, 2) +
+          kChannels3 * border(half_height, half_width, 1));
+}
+
+}  // namespace
+
+void RunHaloUnitTest(Workspace &ws,
+                     const std::vector<int> &shape,
+                     BatchNormStats stats) {
+  std::cout << "Halo, shape = [" << shape[0] << ", " << shape[1] << ", "
+            << shape[2] << ", " << shape[3] << "], across batch = "
+            << (stats == BatchNormStats::kAcrossBatch) << '\n';
+  const int in_channels = shape[1];
+  HaloParams params;
+  params.conv1 = RandomData(kChannels1 * in_channels * 9, 1.f / 1000.f, -0.5f);
+  params.depthwise1 = RandomData(kChannels2 * 9, 1.f / 1000.f, -0.5f);
+  params.conv2 = RandomData(kChannels1 * kChannels2 * 25, 1.f / 1000.f, -0.5f);
+  params.conv3 = RandomData(kChannels3 * kChannels1 * 9, 1.f / 1000.f, -0.5f);
+  params.depthwise2 = RandomData(kChannels3 * 9, 1.f / 1000.f, -0.5f);
+  params.weights = RandomData(kChannels2, 1.f / 10000.f, 1.f);
+  params.biases = RandomData(kChannels2, 1.f / 10000.f, 0.f);
+  const std::vector<float> in_data =
+      RandomData(shape[0] * in_channels * shape[2] * shape[3], 1.f / 500.f,
+                 -1.f);
+
+  Network cpu_network;
+  AddHaloLayers(cpu_network, Backend::kCpu, nullptr, in_channels, params,
+                stats);
+  cpu_network.Prepare(shape);
+  const std::vector<int> &out_shape = cpu_network.GetOutShape();
+  std::vector<float> ref(out_shape[0] * out_shape[1] * out_shape[2] *
+                         out_shape[3]);
+  cpu_network.Run(in_data, ref);
+
+  Network dense(&ws);
+  AddHaloLayers(dense, Backend::kOpenCL, &ws, in_channels, params, stats);
+  dense.SetHaloLayout(false);
+  dense.Prepare(shape);
+  std::vector<float> dense_out(ref.size());
+  dense.Run(in_data, dense_out);
+
+  Network network(&ws);
+  AddHaloLayers(network, Backend::kOpenCL, &ws, in_channels, params, stats);
+  network.Prepare(shape);
+  std::vector<float> out_data(ref.size());
+  // Twice, so that the second run starts from the tensors the first one
+  // left, halos included.
+  for (int i = 0; i < 2; i++) {
+    std::fill(out_data.begin(), out_data.end(), 0.f);
+    network.Run(in_data, out_data);
+  }
+
+  int num_errors = CountErrors(ref.data(), out_data.data(), ref.size()) +
+                   CountErrors(ref.data(), dense_out.data(), ref.size());
+  if (network.GetTensorBytes() !=
+      dense.GetTensorBytes() + GetHaloBytes(shape)) {
+    std::cout << "Tensor bytes " << network.GetTensorBytes()
+              << " don't account for the halos\n";
+    num_errors++;
+  }
+  PrintResult(num_errors);
+}
+
+void RunHaloTests(Workspace &ws) {
+  RunHaloUnitTest(ws, {1, 3, 16, 16}, BatchNormStats::kPerImage);
+  // Sizes off the work-group tiles, and odd for the stride 2 layer.
+  RunHaloUnitTest(ws, {2, 3, 17, 23}, BatchNormStats::kPerImage);
+  RunHaloUnitTest(ws, {3, 2, 13, 9}, BatchNormStats::kAcrossBatch);
+}
@@ -0,0 +1,117 @@
+#include "hdr_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Buckets per half power of two, for 3 significant digits.
+const int kSubBucketBits = 10;
+const std::int64_t kSubBucketHalf = std::int64_t(1) << kSubBucketBits;
+const std::int64_t kSubBucketCount = 2 * kSubBucketHalf;
+
+int FloorLog2(std::uint64_t value) {
+  int log = 0;
+  while (value >>= 1) {
+    log++;
+  }
+  return log;
+}
+
+// Values [0, kSubBucketCount) map to themselves. Above, the values with
+// their top bit at position kSubBucketBits + shift map to kSubBucketHalf
+// buckets of width 2^shift.
+std::size_t GetIndex(std::int64_t value) {
+  if (value < kSubBucketCount) {
+    return value;
+  }
+  const int shift = FloorLog2(value) - kSubBucketBits;
+  return kSubBucketCount + (shift - 1) * kSubBucketHalf +
+         ((value >> shift) - kSubBucketHalf);
+}
+
+std::int64_t GetHighestEquivalentValue(std::size_t index) {
+  if (index < static_cast<std::size_t>(kSubBucketCount)) {
+    return index;
+  }
+  const int shift = (index - kSubBucketCount) / kSubBucketHalf + 1;
+  const std::int64_t sub = (index - kSubBucketCount) % kSubBucketHalf;
+  return ((sub + kSubBucketHalf) << shift) + (std::int64_t(1) << shift) - 1;
+}
+
+}  // namespace
+
+HdrHistogram::HdrHistogram(std::int64_t highest_value)
+    : highest_value_(highest_value),
+      counts_(GetIndex(highest_value) + 1, 0),
+      count_(0),
+      min_(std::numeric_limits<std::int64_t>::max()),
+      max_(0),
+      sum_(0.0) {
+  ASSERT(highest_value >= kSubBucketCount, "Highest value is too small");
+}
+
+void HdrHistogram::Record(std::int64_t value) {
+  value = std::min(std::max<std::int64_t>(value, 0), highest_value_);
+  counts_[GetIndex(value)]++;
+  count_++;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+}
+
+void HdrHistogram::Merge(const HdrHistogram &other) {
+  ASSERT(other.highest_value_ == highest_value_,
+         "Histograms have different ranges");
+  for (std::size_t i = 0; i < counts_.size(); i++) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+void HdrHistogram::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  count_ = 0;
+  min_ = std::numeric_limits<std::int64_t>::max();
+  max_ = 0;
+  sum_ = 0.0;
+}
+
+std::int64_t HdrHistogram::GetCount() const {
+  return count_;
+}
+
+std::int64_t HdrHistogram::GetMin() const {
+  return (count_ > 0) ? min_ : 0;
+}
+
+std::int64_t HdrHistogram::GetMax() const {
+  return max_;
+}
+
+double HdrHistogram::GetMean() const {
+  return (count_ > 0) ? sum_ / count_ : 0.0;
+}
+
+std::int64_t HdrHistogram::GetValueAtPercentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+  const std::int64_t rank = std::max<std::int64_t>(
+      static_cast<std::int64_t>(std::ceil(fraction * count_)), 1);
+  std::int64_t seen = 0;
+  for (std::size_t i = 0; i < counts_.size(); i++) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(GetHighestEquivalentValue(i), max_);
+    }
+  }
+  return max_;
+}
@@ -1,5 +1,9 @@
 #include "kernel.h"
 
+#include <string>
+
+#include "memory_activation.h"
+
 Kernel::Kernel(cl_kernel kernel) : kernel_(kernel) {}
 
 Kernel::~Kernel() {
@@ -8,6 +12,21 @@ Kernel::~Kernel() {
   }
 }
 
+Kernel::Kernel(Kernel &&other) : kernel_(other.kernel_) {
+  other.kernel_ = nullptr;
+}
+
+Kernel &Kernel::operator=(Kernel &&other) {
+  if (this != &other) {
+    if (kernel_ != nullptr) {
+      clReleaseKernel(kernel_);
+    }
+    kernel_ = other.kernel_;
+    other.kernel_ = nullptr;
+  }
+  return *this;
+}
+
 cl_kernel &Kernel::Get() {
   return kernel_;
 }
@@ -16,3 +35,80 @@ const cl_kernel &Kernel::Get() const {
   return kernel_;
 }
 
+Kernel CloneKernel(cl_kernel kernel) {
+  cl_int status;
+#ifdef CL_VERSION_2_1
+  {
+    // Devices before OpenCL 2.1 fail the call, so fall back to a new
+    // kernel from the same program.
+    cl_kernel clone = clCloneKernel(kernel, &status);
+    if (status == CL_SUCCESS) {
+      return Kernel(clone);
+    }
+  }
+#endif
+  cl_program program;
+  status = clGetKernelInfo(kernel, CL_KERNEL_PROGRAM, sizeof(program),
+                           &program, nullptr);
+  ASSERT(status == CL_SUCCESS, "Couldn't get the program of the kernel");
+  std::size_t name_size;
+  status = clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, nullptr,
+                           &name_size);
+  ASSERT(status == CL_SUCCESS, "Couldn't get the name of the kernel");
+  std::string name(name_size, '\0');
+  status = clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, name_size,
+                           &name[0], nullptr);
+  ASSERT(status == CL_SUCCESS, "Couldn't get the name of the kernel");
+  cl_kernel clone = clCreateKernel(program, name.c_str(), &status);
+  ASSERT(status == CL_SUCCESS, "Failed to clone the kernel");
+  return Kernel(clone);
+}
+
+KernelArg KernelArg::SvmPointer(const void *ptr) {
+  KernelArg arg(ptr);
+  arg.svm = true;
+  return arg;
+}
+
+KernelArg KernelArg::LocalMemory(std::size_t size) {
+  KernelArg arg(0);
+  arg.size = size;
+  arg.local = true;
+  return arg;
+}
+
+bool KernelArg::operator==(const KernelArg &other) const {
+  if (local || other.local) {
+    return (local == other.local) && (size == other.size);
+  }
+  return (size == other.size) && (svm == other.svm) &&
+         (std::memcmp(data, other.data, size) == 0);
+}
+
+bool KernelArg::operator!=(const KernelArg &other) const {
+  return !(*this == other);
+}
+
+cl_int SetKernelArg(cl_kernel kernel, cl_uint idx, const KernelArg &arg) {
+  if (arg.svm) {
+#ifdef CL_VERSION_2_0
+    const void *ptr;
+    std::memcpy(&ptr, arg.data, sizeof(ptr));
+    return clSetKernelArgSVMPointer(kernel, idx, ptr);
+#else
+    return CL_INVALID_OPERATION;
+#endif
+  }
+  if (arg.local) {
+    return clSetKernelArg(kernel, idx, arg.size, nullptr);
+  }
+  return clSetKernelArg(kernel, idx, arg.size, arg.data);
+}
+
+void SetKernelArgs(cl_kernel kernel, const std::vector<KernelArg> &args) {
+  for (cl_uint i = 0; i < args.size(); i++) {
+    cl_int status = SetKernelArg(kernel, i, args[i]);
+    ASSERT(status == CL_SUCCESS,
+           "Failed to set the argument " + std::to_string(i));
+  }
+}
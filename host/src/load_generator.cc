@@ -0,0 +1,174 @@
+#include "load_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <thread>
+
+#include "memory_activation.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Percentiles of the curve.
+const double kPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+struct ClientState {
+  HdrHistogram latency;
+  std::int64_t errors = 0;
+  Clock::time_point last_end;
+};
+
+std::int64_t GetNs(Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+      .count();
+}
+
+// Arrival times of a Poisson process, as offsets from the start.
+std::vector<Clock::duration> CreateArrivals(const LoadOptions &options) {
+  std::mt19937_64 engine(options.seed);
+  std::exponential_distribution<double> gap(options.rate);
+  const double end = options.warmup + options.duration;
+  std::vector<Clock::duration> arrivals;
+  for (double t = gap(engine); t < end; t += gap(engine)) {
+    arrivals.push_back(std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(t)));
+  }
+  return arrivals;
+}
+
+}  // namespace
+
+const char *GetLoadModeName(LoadMode mode) {
+  return (mode == LoadMode::kOpenLoop) ? "open" : "closed";
+}
+
+LoadResult RunLoad(const LoadOptions &options,
+                   const std::function<void(int)> &request) {
+  ASSERT(options.num_clients > 0, "Number of clients");
+  ASSERT(options.duration > 0.0, "Duration");
+  ASSERT((options.mode == LoadMode::kClosedLoop) || (options.rate > 0.0),
+         "Open loop needs an arrival rate");
+  const std::vector<Clock::duration> arrivals =
+      (options.mode == LoadMode::kOpenLoop) ? CreateArrivals(options)
+                                            : std::vector<Clock::duration>();
+  std::atomic<std::size_t> next_arrival(0);
+  std::vector<ClientState> clients(options.num_clients);
+
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point measure_start =
+      start + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(options.warmup));
+  const Clock::time_point end =
+      measure_start + std::chrono::duration_cast<Clock::duration>(
+                          std::chrono::duration<double>(options.duration));
+  auto run_client = [&](int client) {
+    ClientState &state = clients[client];
+    state.last_end = measure_start;
+    while (true) {
+      Clock::time_point begin;
+      if (options.mode == LoadMode::kOpenLoop) {
+        const std::size_t idx = next_arrival++;
+        if (idx >= arrivals.size()) {
+          break;
+        }
+        begin = start + arrivals[idx];
+        std::this_thread::sleep_until(begin);
+      } else {
+        begin = Clock::now();
+        if (begin >= end) {
+          break;
+        }
+      }
+      bool failed = false;
+      try {
+        request(client);
+      } catch (const std::exception &) {
+        failed = true;
+      }
+      const Clock::time_point done = Clock::now();
+      if (begin < measure_start) {
+        continue;
+      }
+      if (failed) {
+        state.errors++;
+      } else {
+        state.latency.Record(GetNs(done - begin));
+      }
+      state.last_end = std::max(state.last_end, done);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.num_clients; i++) {
+    threads.emplace_back(run_client, i);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  LoadResult result{options, 0, 0, 0.0, 0.0, HdrHistogram()};
+  Clock::time_point last_end = end;
+  for (const ClientState &state : clients) {
+    result.latency.Merge(state.latency);
+    result.errors += state.errors;
+    last_end = std::max(last_end, state.last_end);
+  }
+  result.count = result.latency.GetCount();
+  result.seconds = std::chrono::duration<double>(last_end - measure_start)
+                       .count();
+  result.throughput = result.count / result.seconds;
+  return result;
+}
+
+void PrintLoadCurve(std::ostream &os, const std::vector<LoadResult> &results) {
+  os << std::left << std::setw(8) << "Mode" << std::right << std::setw(8)
+     << "Clients" << std::setw(12) << "Offered/s" << std::setw(12)
+     << "Done/s" << std::setw(11) << "p50 us" << std::setw(11) << "p90 us"
+     << std::setw(11) << "p99 us" << std::setw(11) << "p99.9 us"
+     << std::setw(11) << "Max us" << std::setw(8) << "Errors" << '\n';
+  os << std::fixed << std::setprecision(1);
+  for (const LoadResult &result : results) {
+    os << std::left << std::setw(8) << GetLoadModeName(result.options.mode)
+       << std::right << std::setw(8) << result.options.num_clients;
+    if (result.options.mode == LoadMode::kOpenLoop) {
+      os << std::setw(12) << result.options.rate;
+    } else {
+      os << std::setw(12) << '-';
+    }
+    os << std::setw(12) << result.throughput;
+    for (double percentile : kPercentiles) {
+      os << std::setw(11)
+         << result.latency.GetValueAtPercentile(percentile) / 1e3;
+    }
+    os << std::setw(11) << result.latency.GetMax() / 1e3 << std::setw(8)
+       << result.errors << '\n';
+  }
+  os.unsetf(std::ios_base::floatfield);
+  os << std::setprecision(6);
+}
+
+void WriteLoadCurveCsv(const std::string &path,
+                       const std::vector<LoadResult> &results) {
+  std::ofstream os(path);
+  ASSERT(static_cast<bool>(os), "Couldn't open the load curve file " + path);
+  os << "mode,clients,offered_per_s,throughput_per_s,count,errors,mean_us,"
+        "p50_us,p90_us,p99_us,p999_us,max_us\n";
+  for (const LoadResult &result : results) {
+    const bool open = result.options.mode == LoadMode::kOpenLoop;
+    os << GetLoadModeName(result.options.mode) << ','
+       << result.options.num_clients << ','
+       << (open ? result.options.rate : 0.0) << ',' << result.throughput
+       << ',' << result.count << ',' << result.errors << ','
+       << result.latency.GetMean() / 1e3;
+    for (double percentile : kPercentiles) {
+      os << ',' << result.latency.GetValueAtPercentile(percentile) / 1e3;
+    }
+    os << ',' << result.latency.GetMax() / 1e3 << '\n';
+  }
+}
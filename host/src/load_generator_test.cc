@@ -0,0 +1,78 @@
+#include "load_generator_test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+void RunHdrHistogramUnitTest(std::int64_t n, std::int64_t scale) {
+  std::cout << "n = " << n << ", scale = " << scale << '\n';
+  HdrHistogram histogram;
+  for (std::int64_t i = 1; i <= n; i++) {
+    histogram.Record(i * scale);
+  }
+  int num_errors = 0;
+  for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+    const double exact =
+        std::ceil(percentile / 100.0 * n) * static_cast<double>(scale);
+    const double value = histogram.GetValueAtPercentile(percentile);
+    // Never below the exact value, and within the bucket width above.
+    if ((value < exact) || (value > exact * (1.0 + 1.0 / 1024) + 1.0)) {
+      std::cout << "p" << percentile << ": expected " << exact << ", got "
+                << value << '\n';
+      num_errors++;
+    }
+  }
+  if ((histogram.GetCount() != n) || (histogram.GetMin() != scale) ||
+      (histogram.GetMax() != n * scale)) {
+    std::cout << "Wrong count, min or max\n";
+    num_errors++;
+  }
+  PrintResult(num_errors);
+}
+
+void RunLoadGeneratorUnitTest(LoadMode mode, int num_clients, double rate,
+                              int service_us) {
+  std::cout << "mode = " << GetLoadModeName(mode)
+            << ", num_clients = " << num_clients << ", rate = " << rate
+            << ", service_us = " << service_us << '\n';
+  LoadOptions options;
+  options.mode = mode;
+  options.num_clients = num_clients;
+  options.rate = rate;
+  options.duration = 1.0;
+  options.warmup = 0.1;
+  const LoadResult result = RunLoad(options, [&](int) {
+    std::this_thread::sleep_for(std::chrono::microseconds(service_us));
+  });
+  PrintLoadCurve(std::cout, {result});
+
+  // Closed loop keeps every client busy; open loop completes what arrives,
+  // up to the same capacity.
+  const double capacity = num_clients * 1e6 / service_us;
+  const double expected =
+      (mode == LoadMode::kClosedLoop) ? capacity : std::min(rate, capacity);
+  const double p50 = result.latency.GetValueAtPercentile(50.0) / 1e3;
+  // Sleeps overshoot, so only check the bounds they can't break.
+  const bool ok = (result.errors == 0) &&
+                  (result.throughput <= expected * 1.2) &&
+                  (result.throughput >= expected * 0.5) &&
+                  (p50 >= service_us);
+  std::cout << (ok ? "Result is consistent with expected\n"
+                   : "Throughput or latency is off\n");
+}
+
+void RunLoadGeneratorTests() {
+  RunHdrHistogramUnitTest(1000, 1);
+  RunHdrHistogramUnitTest(100000, 1);
+  RunHdrHistogramUnitTest(10000, 12345);
+
+  RunLoadGeneratorUnitTest(LoadMode::kClosedLoop, 1, 0.0, 2000);
+  RunLoadGeneratorUnitTest(LoadMode::kClosedLoop, 4, 0.0, 2000);
+  RunLoadGeneratorUnitTest(LoadMode::kOpenLoop, 4, 200.0, 2000);
+
+  // Over capacity the open-loop latency grows with the backlog, which a
+  // closed loop at the same throughput never shows.
+  RunLoadGeneratorUnitTest(LoadMode::kOpenLoop, 1, 1000.0, 2000);
+}
@@ -26,6 +26,8 @@
 #include "conv2d.h"
 #include "conv2d_op.h"
 #include "conv2d_test.h"
+#include "conv_selector.h"
+#include "cpu_kernels.h"
 #include "depthwise_conv2d.h"
 #include "depthwise_conv2d_op.h"
 #include "depthwise_conv2d_test.h"
@@ -33,6 +35,8 @@
 #include "memory_activation.h"
 #include "mobilenetv2.h"
 #include "model.h"
+#include "network.h"
+#include "roofline.h"
 #include "tensor.h"
 #include "workspace.h"
 
@@ -84,8 +88,10 @@ int main(int argc, char **argv) {
 #endif
 
 #if 1
-  // Create the workspace.
-  Workspace ws("Intel(R) OpenCL HD Graphics");
+  // Create the workspace. With --profile every device command is timed and
+  // the mixed network run below is reported per layer.
+  const bool profile = (argc > 1) && (strcmp(argv[1], "--profile") == 0);
+  Workspace ws("Intel(R) OpenCL HD Graphics", profile);
   // Create OpenCL kernels.
   Kernel conv_kernel =
       ws.CreateKernel("/../device/conv2d.cl", "Convolute", false);
@@ -129,6 +135,89 @@ int main(int argc, char **argv) {
       std::chrono::duration_cast<std::chrono::microseconds>(end - start);
   std::cout << "Device took " << elapsed.count() << " us\n";
 
+  // Run the persistent model: the first run records, the second replays.
+  std::vector<float> replay_data(tensor_size);
+  Model model(ws, {1, in_channels, in_height, in_width}, kernel_data,
+              weight_data, bias_data);
+  start = std::chrono::high_resolution_clock::now();
+  model.Run(in_data, replay_data);
+  end = std::chrono::high_resolution_clock::now();
+  elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  std::cout << "Device (recording) took " << elapsed.count() << " us\n";
+  start = std::chrono::high_resolution_clock::now();
+  model.Run(in_data, replay_data);
+  end = std::chrono::high_resolution_clock::now();
+  elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  std::cout << "Device (replay, "
+            << model.GetExecutionPlan().GetNumLaunches() << " launches"
+            << (model.GetExecutionPlan().UsesCommandBuffer()
+                    ? ", command buffer"
+                    : "")
+            << ") took " << elapsed.count() << " us\n";
+
+  // Run the model as a network split between the device and the host.
+  std::vector<float> mixed_data(tensor_size);
+  Network network(&ws);
+  AddModelLayers(network, &ws, kernel_data, weight_data, bias_data,
+                 {Backend::kOpenCL, Backend::kOpenCL, Backend::kOpenCL,
+                  Backend::kOpenCL, Backend::kCpu, Backend::kCpu});
+  network.Prepare({1, in_channels, in_height, in_width});
+  if (profile) {
+    ws.GetProfiler()->Clear();
+  }
+  start = std::chrono::high_resolution_clock::now();
+  network.Run(in_data, mixed_data);
+  end = std::chrono::high_resolution_clock::now();
+  elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  std::cout << "Device and host network took " << elapsed.count() << " us\n";
+  if (profile) {
+    Profiler &profiler = *ws.GetProfiler();
+    profiler.Collect();
+    profiler.PrintLayerTable(std::cout);
+    PrintRooflineReport(std::cout, network, profiler, MeasureDevicePeaks(ws),
+                        MeasureCpuPeaks());
+    profiler.WriteChromeTrace("trace.json");
+    std::cout << "Wrote trace.json\n";
+  }
+
+  // Run the model with the implementation of each layer picked by trial
+  // runs, kept in a tuning cache for the next session.
+  std::vector<float> tuned_data(tensor_size);
+  const std::vector<int> in_shape{1, in_channels, in_height, in_width};
+  ConvSelector selector(&ws);
+  selector.LoadCache("tuning.cache");
+  selector.SetTrialRuns(3);
+  const std::vector<ConvImpl> impls = selector.Select(GetModelLayers(in_shape));
+  selector.SaveCache("tuning.cache");
+  Network tuned_network(&ws);
+  AddModelLayers(tuned_network, &ws, kernel_data, weight_data, bias_data,
+                 impls);
+  tuned_network.Prepare(in_shape);
+  start = std::chrono::high_resolution_clock::now();
+  tuned_network.Run(in_data, tuned_data);
+  end = std::chrono::high_resolution_clock::now();
+  elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  std::cout << "Tuned network (";
+  for (std::size_t i = 0; i < impls.size(); i++) {
+    std::cout << (i > 0 ? ", " : "") << GetBackendName(impls[i].backend)
+              << ' ' << GetConv2DAlgorithmName(impls[i].algorithm);
+  }
+  std::cout << ") took " << elapsed.count() << " us\n";
+
+  // Run the model on the host engine. RunModelRef overwrites in_data, so
+  // this goes first.
+  std::vector<float> cpu_in_data(in_data);
+  std::vector<float> cpu_data(tensor_size);
+  tensor_shape = {1, in_channels, in_height, in_width};
+  start = std::chrono::high_resolution_clock::now();
+  RunModelCpu(tensor_shape, cpu_in_data, cpu_data, kernel_data, weight_data,
+              bias_data);
+  end = std::chrono::high_resolution_clock::now();
+  elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  std::cout << "Host (" << GetCpuIsaName(GetCpuIsa()) << ", "
+            << ThreadPool::GetDefault().GetNumThreads() << " threads) took "
+            << elapsed.count() << " us\n";
+
   // Run the model on host.
   tensor_shape = {1, in_channels, in_height, in_width};
   start = std::chrono::high_resolution_clock::now();
@@ -142,6 +231,10 @@ int main(int argc, char **argv) {
   int out_size = std::accumulate(tensor_shape.begin(), tensor_shape.end(), 1,
                                  std::multiplies<int>());
   CheckResult(ref_data.data(), out_data.data(), out_size, false, 1e-3);
+  CheckResult(ref_data.data(), replay_data.data(), out_size, false, 1e-3);
+  CheckResult(ref_data.data(), cpu_data.data(), out_size, false, 1e-3);
+  CheckResult(ref_data.data(), mixed_data.data(), out_size, false, 1e-3);
+  CheckResult(ref_data.data(), tuned_data.data(), out_size, false, 1e-3);
 #endif
   return EXIT_SUCCESS;
 }
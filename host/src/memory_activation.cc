@@ -94,7 +94,9 @@ cl_int CreateKernel(cl_context context,
       printf("Error: couldn't create the program\n");
       return status;
     }
-    status = clBuildProgram(program, 0, nullptr, "", nullptr, nullptr);
+    status = clBuildProgram(program, 0, nullptr,
+                            GetProgramBuildOptions(program_path.data()).c_str(),
+                            nullptr, nullptr);
     if (status != CL_SUCCESS) {
       printf("Error: failed to build the program\n");
       std::vector<char> build_log(BUILD_LOG_SIZE);
@@ -169,7 +171,9 @@ cl_int CreateKernel(cl_context context,
       printf("Error: couldn't create the program\n");
       return status;
     }
-    status = clBuildProgram(program, 0, nullptr, "", nullptr, nullptr);
+    status = clBuildProgram(program, 0, nullptr,
+                            GetProgramBuildOptions(program_path.data()).c_str(),
+                            nullptr, nullptr);
     if (status != CL_SUCCESS) {
       printf("Error: failed to build the program\n");
       std::vector<char> build_log(BUILD_LOG_SIZE);
@@ -208,6 +212,15 @@ cl_int SaveKernel(cl_context context,
   return CL_SUCCESS;
 }
 
+std::string GetProgramBuildOptions(const char *program_path) {
+  const std::string path(program_path);
+  const std::size_t slash = path.find_last_of('/');
+  if (slash == std::string::npos) {
+    return "-I .";
+  }
+  return "-I " + path.substr(0, slash);
+}
+
 cl_uint RoundUp(cl_uint value, cl_uint multiple) {
   cl_uint remainder = value % multiple;
   if (remainder != 0) {
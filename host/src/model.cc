@@ -177,37 +177,285 @@ void RunModelRef(std::vector<int> &tensor_shape,
 
   RunConv2DRef(in_data, out_data, kernel_data, tensor_shape, channels[1],
                kernel_size, stride, padding);
-  RunBatchNormRef(out_data, 1, channels[1], tensor_shape[2] * tensor_shape[3],
-                  1e-5, weight_data, bias_data, 1.f);
+  RunBatchNormRef(out_data, tensor_shape[0], channels[1],
+                  tensor_shape[2] * tensor_shape[3], 1e-5, weight_data,
+                  bias_data, 1.f);
 
   in_data.swap(out_data);
   RunConv2DRef(in_data, out_data, kernel_data, tensor_shape, channels[2],
                kernel_size, stride, padding);
-  RunBatchNormRef(out_data, 1, channels[2], tensor_shape[2] * tensor_shape[3],
-                  1e-5, weight_data, bias_data, 1.f);
+  RunBatchNormRef(out_data, tensor_shape[0], channels[2],
+                  tensor_shape[2] * tensor_shape[3], 1e-5, weight_data,
+                  bias_data, 1.f);
 
   in_data.swap(out_data);
   RunConv2DRef(in_data, out_data, kernel_data, tensor_shape, channels[3],
                kernel_size, stride, padding);
-  RunBatchNormRef(out_data, 1, channels[3], tensor_shape[2] * tensor_shape[3],
-                  1e-5, weight_data, bias_data, 1.f);
+  RunBatchNormRef(out_data, tensor_shape[0], channels[3],
+                  tensor_shape[2] * tensor_shape[3], 1e-5, weight_data,
+                  bias_data, 1.f);
 
   in_data.swap(out_data);
   RunConv2DRef(in_data, out_data, kernel_data, tensor_shape, channels[4],
                kernel_size, stride, padding);
-  RunBatchNormRef(out_data, 1, channels[4], tensor_shape[2] * tensor_shape[3],
-                  1e-5, weight_data, bias_data, 1.f);
+  RunBatchNormRef(out_data, tensor_shape[0], channels[4],
+                  tensor_shape[2] * tensor_shape[3], 1e-5, weight_data,
+                  bias_data, 1.f);
 
   in_data.swap(out_data);
   RunConv2DRef(in_data, out_data, kernel_data, tensor_shape, channels[5],
                kernel_size, stride, padding);
-  RunBatchNormRef(out_data, 1, channels[5], tensor_shape[2] * tensor_shape[3],
-                  1e-5, weight_data, bias_data, 1.f);
+  RunBatchNormRef(out_data, tensor_shape[0], channels[5],
+                  tensor_shape[2] * tensor_shape[3], 1e-5, weight_data,
+                  bias_data, 1.f);
 
   in_data.swap(out_data);
   RunConv2DRef(in_data, out_data, kernel_data, tensor_shape, channels[6],
                kernel_size, stride, padding);
-  RunBatchNormRef(out_data, 1, channels[6], tensor_shape[2] * tensor_shape[3],
-                  1e-5, weight_data, bias_data, 1.f);
+  RunBatchNormRef(out_data, tensor_shape[0], channels[6],
+                  tensor_shape[2] * tensor_shape[3], 1e-5, weight_data,
+                  bias_data, 1.f);
 }
 
+
+namespace {
+
+const std::vector<int> kModelChannels{3, 32, 32, 64, 64, 64, 64};
+const int kModelKernelSize = 3;
+const int kModelStride = 1;
+const int kModelPadding = 1;
+
+std::vector<int> InferModelOutShape(const std::vector<int> &in_shape) {
+  std::vector<int> shape = in_shape;
+  for (std::size_t i = 1; i < kModelChannels.size(); i++) {
+    shape[1] = kModelChannels[i];
+    shape[2] = (shape[2] + 2 * kModelPadding - kModelKernelSize) /
+                   kModelStride + 1;
+    shape[3] = (shape[3] + 2 * kModelPadding - kModelKernelSize) /
+                   kModelStride + 1;
+  }
+  return shape;
+}
+
+}  // namespace
+
+void RunModelCpu(std::vector<int> &tensor_shape,
+                 std::vector<float> &in_data,
+                 std::vector<float> &out_data,
+                 const std::vector<float> &kernel_data,
+                 const std::vector<float> &weight_data,
+                 const std::vector<float> &bias_data,
+                 const std::vector<Conv2DAlgorithm> &conv_algorithms,
+                 ThreadPool *pool) {
+  const std::vector<int> &channels = kModelChannels;
+
+  ASSERT(tensor_shape[1] == channels[0], "Input channels should be 3");
+
+  for (std::size_t i = 1; i < channels.size(); i++) {
+    if (i > 1) {
+      in_data.swap(out_data);
+    }
+    const Conv2DAlgorithm algorithm = (i - 1 < conv_algorithms.size())
+                                          ? conv_algorithms[i - 1]
+                                          : Conv2DAlgorithm::kAuto;
+    RunConv2DCpu(in_data, out_data, kernel_data, tensor_shape, channels[i],
+                 kModelKernelSize, kModelStride, kModelPadding, algorithm,
+                 pool);
+    RunBatchNormCpu(out_data, tensor_shape[0], channels[i],
+                    tensor_shape[2] * tensor_shape[3], 1e-5, weight_data,
+                    bias_data, 1.f, BatchNormStats::kPerImage, pool);
+  }
+}
+
+void AddModelLayers(Network &network,
+                    Workspace *ws,
+                    const std::vector<float> &kernel_data,
+                    const std::vector<float> &weight_data,
+                    const std::vector<float> &bias_data,
+                    const std::vector<Backend> &backends) {
+  std::vector<ConvImpl> impls;
+  for (Backend backend : backends) {
+    impls.push_back({backend, Conv2DAlgorithm::kAuto});
+  }
+  AddModelLayers(network, ws, kernel_data, weight_data, bias_data, impls);
+}
+
+void AddModelLayers(Network &network,
+                    Workspace *ws,
+                    const std::vector<float> &kernel_data,
+                    const std::vector<float> &weight_data,
+                    const std::vector<float> &bias_data,
+                    const std::vector<ConvImpl> &impls) {
+  const std::vector<int> &channels = kModelChannels;
+  for (std::size_t i = 1; i < channels.size(); i++) {
+    ConvImpl impl{(ws != nullptr) ? Backend::kOpenCL : Backend::kCpu,
+                  Conv2DAlgorithm::kAuto};
+    if (i - 1 < impls.size()) {
+      impl = impls[i - 1];
+    }
+    network.Add(CreateConv2D(impl.backend, ws, channels[i - 1], channels[i],
+                             kModelKernelSize, kModelStride, kModelPadding,
+                             kernel_data, impl.algorithm));
+    network.Add(CreateBatchNorm(impl.backend, ws, channels[i], 1e-5, 1.f,
+                                weight_data, bias_data));
+  }
+}
+
+std::vector<ConvLayer> GetModelLayers(const std::vector<int> &in_shape) {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  const std::vector<int> &channels = kModelChannels;
+  std::vector<ConvLayer> layers;
+  int height = in_shape[2];
+  int width = in_shape[3];
+  for (std::size_t i = 1; i < channels.size(); i++) {
+    layers.push_back({channels[i - 1], channels[i], kModelKernelSize,
+                      kModelStride, kModelPadding, height, width, false});
+    height = (height + 2 * kModelPadding - kModelKernelSize) / kModelStride + 1;
+    width = (width + 2 * kModelPadding - kModelKernelSize) / kModelStride + 1;
+  }
+  return layers;
+}
+
+Model::Model(Workspace &ws,
+             const std::vector<int> &in_shape,
+             const std::vector<float> &kernel_data,
+             const std::vector<float> &weight_data,
+             const std::vector<float> &bias_data,
+             bool use_plan)
+    : ws_(&ws),
+      command_queue_(ws.GetCommandQueue()),
+      conv_kernel_(ws.CreateKernel("/../device/conv2d.cl", "Convolute")),
+      batchnorm_kernel_(
+          ws.CreateKernel("/../device/batchnorm2d.cl", "BatchNorm")),
+      in_shape_(in_shape),
+      out_shape_(InferModelOutShape(in_shape)),
+      use_plan_(use_plan),
+      input_(in_shape, true, &ws),
+      output_(out_shape_, true, &ws),
+      plan_(ws.GetPlatformID(), ws.GetDeviceID(), ws.GetCommandQueue()) {
+  plan_.SetProfiler(ws.GetProfiler());
+  const float eps = 1e-5;
+  const float relu = 1.f;
+  const std::vector<int> &channels = kModelChannels;
+  const int max_channels = 64;
+  const int model_kernel_size =
+      max_channels * max_channels * kModelKernelSize * kModelKernelSize;
+
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  ASSERT(in_shape[1] == channels[0], "Input channels should be 3");
+  cl_context context = ws.GetContext();
+  int status;
+
+  // Create device buffers. The intermediate activations never leave the
+  // device, so they get no host storage.
+  const std::vector<int> activation_shape{in_shape[0], max_channels,
+                                          in_shape[2], in_shape[3]};
+  for (int i = 0; i < 2; i++) {
+    activations_.emplace_back(activation_shape, true, &ws,
+                              TensorBacking::kHost);
+  }
+  kernel_buf_ = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                               model_kernel_size * sizeof(float),
+                               const_cast<float *>(kernel_data.data()),
+                               &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create kernel buffer");
+  weight_buf_ = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                               max_channels * sizeof(float),
+                               const_cast<float *>(weight_data.data()),
+                               &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create weight buffer");
+  bias_buf_ = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                             max_channels * sizeof(float),
+                             const_cast<float *>(bias_data.data()), &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create bias buffer");
+
+  // Create device operators. The first layer reads the input tensor, the
+  // last one writes the output tensor and the others ping-pong between the
+  // two intermediate activations. The ops keep pointers into the tensors, so
+  // activations_ must not grow after this.
+  const int num_layers = channels.size() - 1;
+  convs_.reserve(num_layers);
+  bns_.reserve(num_layers);
+  cl_mem *in_buf = &input_.GetDeviceData();
+  for (int i = 0; i < num_layers; i++) {
+    cl_mem *out_buf;
+    if (i == num_layers - 1) {
+      out_buf = &output_.GetDeviceData();
+    } else {
+      out_buf = &activations_[i % 2].GetDeviceData();
+    }
+    convs_.emplace_back(channels[i], channels[i + 1], kModelKernelSize,
+                        kModelStride, kModelPadding, false,
+                        &conv_kernel_.Get(), &command_queue_, in_buf, out_buf,
+                        &kernel_buf_);
+    bns_.emplace_back(channels[i + 1], eps, relu, &batchnorm_kernel_.Get(),
+                      &command_queue_, &weight_buf_, &bias_buf_, out_buf);
+    convs_.back().SetExecutionPlan(&plan_);
+    bns_.back().SetExecutionPlan(&plan_);
+    convs_.back().SetProfiler(ws.GetProfiler());
+    bns_.back().SetProfiler(ws.GetProfiler());
+    in_buf = out_buf;
+  }
+}
+
+Model::~Model() {
+  clReleaseMemObject(kernel_buf_);
+  clReleaseMemObject(weight_buf_);
+  clReleaseMemObject(bias_buf_);
+}
+
+void Model::Run() {
+  // Only the stale side is transferred; zero-copy tensors are only unmapped
+  // and mapped here.
+  input_.PushToDevice(*ws_);
+  output_.UnmapHost();
+
+  if (!use_plan_) {
+    RunOps();
+  } else if (plan_.IsRecorded()) {
+    plan_.Replay(false);
+  } else {
+    plan_.BeginRecording();
+    RunOps();
+    plan_.EndRecording();
+  }
+
+  output_.MarkDeviceDirty();
+  output_.PopToHost(*ws_, CL_TRUE);
+}
+
+void Model::Run(const std::vector<float> &in_data,
+                std::vector<float> &out_data) {
+  TensorData &input = input_.GetData();
+  ASSERT(in_data.size() >= input.size(),
+         "Input buffer doesn't have enough data");
+  std::copy(in_data.begin(), in_data.begin() + input.size(), input.begin());
+  Run();
+  const TensorData &output = output_.GetData();
+  ASSERT(out_data.size() >= output.size(), "Output buffer is too small");
+  std::copy(output.begin(), output.end(), out_data.begin());
+}
+
+Tensor &Model::GetInput() {
+  return input_;
+}
+
+const Tensor &Model::GetOutput() const {
+  return output_;
+}
+
+const std::vector<int> &Model::GetOutShape() const {
+  return out_shape_;
+}
+
+ExecutionPlan &Model::GetExecutionPlan() {
+  return plan_;
+}
+
+void Model::RunOps() {
+  std::vector<int> shape = in_shape_;
+  for (std::size_t i = 0; i < convs_.size(); i++) {
+    convs_[i].Run(shape, false);
+    bns_[i].Run(shape, false);
+  }
+}
@@ -0,0 +1,188 @@
+#include "network.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "memory_activation.h"
+
+Network::Network(Workspace *ws)
+    : ws_(ws), scratch_size_(0), halo_layout_(true), prepared_(false) {}
+
+void Network::Add(std::unique_ptr<Operator> op) {
+  ASSERT(op != nullptr, "Null operator");
+  ASSERT((op->GetBackend() != Backend::kOpenCL) || (ws_ != nullptr),
+         "OpenCL operators need a workspace");
+  ops_.push_back(std::move(op));
+  prepared_ = false;
+}
+
+void Network::SetHaloLayout(bool enable) {
+  halo_layout_ = enable;
+  prepared_ = false;
+}
+
+void Network::Prepare(const std::vector<int> &in_shape) {
+  ASSERT(!ops_.empty(), "The network has no operators");
+
+  // Chain the operators, with in-place ones reusing their input.
+  std::vector<std::vector<int>> shapes{in_shape};
+  op_inputs_.clear();
+  op_outputs_.clear();
+  scratch_size_ = 0;
+  for (const auto &op : ops_) {
+    const int in_idx = shapes.size() - 1;
+    std::vector<int> out_shape = op->InferShape(shapes[in_idx]);
+    scratch_size_ = std::max(scratch_size_, op->GetScratchSize(shapes[in_idx]));
+    op->Prepare(shapes[in_idx]);
+    op_inputs_.push_back(in_idx);
+    if (op->IsInPlace()) {
+      ASSERT(out_shape == shapes[in_idx], "In-place ops keep the shape");
+      op_outputs_.push_back(in_idx);
+    } else {
+      op_outputs_.push_back(shapes.size());
+      shapes.push_back(out_shape);
+    }
+  }
+  out_shape_ = shapes.back();
+
+  // Find the backends touching each tensor. The caller touches the network
+  // input and output from the host.
+  std::vector<bool> on_device(shapes.size(), false);
+  std::vector<bool> on_host(shapes.size(), false);
+  on_host.front() = true;
+  on_host.back() = true;
+  for (std::size_t i = 0; i < ops_.size(); i++) {
+    const bool device = ops_[i]->GetBackend() == Backend::kOpenCL;
+    for (int idx : {op_inputs_[i], op_outputs_[i]}) {
+      if (device) {
+        on_device[idx] = true;
+      } else {
+        on_host[idx] = true;
+      }
+    }
+  }
+
+  // Device-only tensors get the halo their consumer asks for, if every
+  // operator touching them supports it.
+  std::vector<int> halos(shapes.size(), 0);
+  if (halo_layout_) {
+    std::vector<bool> supports_halo(shapes.size(), true);
+    for (std::size_t i = 0; i < ops_.size(); i++) {
+      for (int idx : {op_inputs_[i], op_outputs_[i]}) {
+        supports_halo[idx] = supports_halo[idx] && ops_[i]->SupportsHalo();
+      }
+    }
+    for (std::size_t i = 0; i < ops_.size(); i++) {
+      const int idx = op_inputs_[i];
+      if (on_device[idx] && !on_host[idx] && supports_halo[idx]) {
+        halos[idx] = std::max(halos[idx], ops_[i]->GetInputHalo());
+      }
+    }
+  }
+
+  tensors_.clear();
+  tensors_.reserve(shapes.size());
+  for (std::size_t i = 0; i < shapes.size(); i++) {
+    if (!on_device[i]) {
+      tensors_.emplace_back(shapes[i]);
+    } else if (!on_host[i]) {
+      tensors_.emplace_back(shapes[i], true, ws_, TensorBacking::kHost,
+                            halos[i]);
+    } else {
+      tensors_.emplace_back(shapes[i], true, ws_);
+    }
+  }
+  prepared_ = true;
+}
+
+std::unique_ptr<Network> Network::Clone(Workspace *ws) const {
+  std::unique_ptr<Network> network(new Network(ws));
+  for (const auto &op : ops_) {
+    network->Add(op->Clone(ws));
+  }
+  network->SetHaloLayout(halo_layout_);
+  return network;
+}
+
+void Network::Run() {
+  ASSERT(prepared_, "Prepare the network before running it");
+  Profiler *profiler = (ws_ != nullptr) ? ws_->GetProfiler() : nullptr;
+  for (std::size_t i = 0; i < ops_.size(); i++) {
+    Operator &op = *ops_[i];
+    if (profiler == nullptr) {
+      op.Run(tensors_[op_inputs_[i]], tensors_[op_outputs_[i]]);
+      continue;
+    }
+    // Device commands are tracked by the profiler through their events; host
+    // operators are timed here.
+    profiler->BeginLayer(i, std::string(op.GetName()) + " (" +
+                                GetBackendName(op.GetBackend()) + ')');
+    const std::int64_t start = Profiler::GetHostTime();
+    op.Run(tensors_[op_inputs_[i]], tensors_[op_outputs_[i]]);
+    if (op.GetBackend() == Backend::kCpu) {
+      profiler->AddHostSpan(op.GetName(), start, Profiler::GetHostTime());
+    }
+    profiler->EndLayer();
+  }
+}
+
+void Network::Run(const std::vector<float> &in_data,
+                  std::vector<float> &out_data) {
+  TensorData &input = GetInput().GetData();
+  ASSERT(in_data.size() >= input.size(),
+         "Input buffer doesn't have enough data");
+  std::copy(in_data.begin(), in_data.begin() + input.size(), input.begin());
+  Run();
+  const TensorData &output = GetOutput().GetData();
+  ASSERT(out_data.size() >= output.size(), "Output buffer is too small");
+  std::copy(output.begin(), output.end(), out_data.begin());
+}
+
+Workspace *Network::GetWorkspace() const {
+  return ws_;
+}
+
+Tensor &Network::GetInput() {
+  ASSERT(prepared_, "Prepare the network first");
+  return tensors_.front();
+}
+
+const Tensor &Network::GetOutput() const {
+  ASSERT(prepared_, "Prepare the network first");
+  return tensors_.back();
+}
+
+const std::vector<int> &Network::GetOutShape() const {
+  return out_shape_;
+}
+
+std::size_t Network::GetScratchSize() const {
+  return scratch_size_;
+}
+
+std::size_t Network::GetTensorBytes() const {
+  ASSERT(prepared_, "Prepare the network first");
+  std::size_t bytes = 0;
+  for (const Tensor &tensor : tensors_) {
+    bytes += sizeof(float) * tensor.GetSize();
+  }
+  return bytes;
+}
+
+int Network::GetNumOperators() const {
+  return ops_.size();
+}
+
+Operator &Network::GetOperator(int idx) {
+  ASSERT((idx >= 0) && (idx < static_cast<int>(ops_.size())),
+         "Operator index out of range");
+  return *ops_[idx];
+}
+
+const std::vector<int> &Network::GetInShape(int idx) const {
+  ASSERT(prepared_, "Prepare the network first");
+  ASSERT((idx >= 0) && (idx < static_cast<int>(ops_.size())),
+         "Operator index out of range");
+  return tensors_[op_inputs_[idx]].GetShape();
+}
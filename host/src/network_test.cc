@@ -0,0 +1,147 @@
+#include "network_test.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+void RunNetworkUnitTest(Workspace *ws,
+                        const int in_height,
+                        const int in_width,
+                        const std::vector<Backend> &backends,
+                        const int batch) {
+  std::cout << "batch = " << batch << ", in_height = " << in_height
+            << ", in_width = " << in_width << ", backends =";
+  for (Backend backend : backends) {
+    std::cout << ' ' << GetBackendName(backend);
+  }
+  std::cout << '\n';
+
+  const int in_channels = 3;
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  const int tensor_size = batch * max_channels * in_height * in_width;
+  std::vector<float> in_data(tensor_size);
+  std::vector<float> out_data(tensor_size);
+  std::vector<float> ref(tensor_size);
+  std::vector<float> kernel_data(max_channels * max_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> weight_data(max_channels);
+  std::vector<float> bias_data(max_channels);
+
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weight_data.begin(), weight_data.end(),
+                RandomGenerator(1.f / 10000.f, 1.f));
+  std::generate(bias_data.begin(), bias_data.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+
+  const std::vector<int> in_shape{batch, in_channels, in_height, in_width};
+  Network network(ws);
+  AddModelLayers(network, ws, kernel_data, weight_data, bias_data, backends);
+  network.Prepare(in_shape);
+  // Run twice, so that the second run starts from the state the first one
+  // left the tensors in.
+  for (int i = 0; i < 2; i++) {
+    std::fill(out_data.begin(), out_data.end(), 0.f);
+    network.Run(in_data, out_data);
+  }
+
+  // RunModelRef overwrites in_data, so it goes last.
+  std::vector<int> tensor_shape(in_shape);
+  RunModelRef(tensor_shape, in_data, ref, kernel_data, weight_data,
+              bias_data);
+  const std::vector<int> &out_shape = network.GetOutShape();
+  const int out_size =
+      out_shape[0] * out_shape[1] * out_shape[2] * out_shape[3];
+  CheckResult(ref.data(), out_data.data(), out_size, false, 1e-3);
+}
+
+void RunConcurrentSessionUnitTest(Workspace *ws,
+                                  const int in_height,
+                                  const int in_width,
+                                  const std::vector<Backend> &backends,
+                                  int num_contexts,
+                                  int num_threads) {
+  std::cout << "in_height = " << in_height << ", in_width = " << in_width
+            << ", num_contexts = " << num_contexts
+            << ", num_threads = " << num_threads << ", backends =";
+  for (Backend backend : backends) {
+    std::cout << ' ' << GetBackendName(backend);
+  }
+  std::cout << '\n';
+
+  const int in_channels = 3;
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  const int num_inputs = 4;
+  const int tensor_size = max_channels * in_height * in_width;
+  std::vector<float> kernel_data(max_channels * max_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> weight_data(max_channels);
+  std::vector<float> bias_data(max_channels);
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weight_data.begin(), weight_data.end(),
+                RandomGenerator(1.f / 10000.f, 1.f));
+  std::generate(bias_data.begin(), bias_data.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+
+  const std::vector<int> in_shape{1, in_channels, in_height, in_width};
+  std::vector<std::vector<float>> inputs(num_inputs);
+  std::vector<std::vector<float>> refs(num_inputs);
+  for (int i = 0; i < num_inputs; i++) {
+    inputs[i].resize(tensor_size);
+    std::generate(inputs[i].begin(), inputs[i].end(),
+                  RandomGenerator(1.f / 500.f, -1.f));
+    // RunModelRef overwrites its input.
+    std::vector<float> in_data(inputs[i]);
+    std::vector<int> tensor_shape(in_shape);
+    refs[i].resize(tensor_size);
+    RunModelRef(tensor_shape, in_data, refs[i], kernel_data, weight_data,
+                bias_data);
+  }
+
+  std::unique_ptr<Network> network(new Network(ws));
+  AddModelLayers(*network, ws, kernel_data, weight_data, bias_data, backends);
+  InferenceSession session(std::move(network), in_shape, num_contexts);
+  const int out_size = session.GetOutSize();
+  std::atomic<int> num_errors(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<float> out_data(out_size);
+      for (int r = 0; r < 8; r++) {
+        const int idx = (t + r) % num_inputs;
+        session.Run(inputs[idx], out_data);
+        if (GetMaxError(refs[idx].data(), out_data.data(), out_size) >
+            1e-3f) {
+          num_errors++;
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  PrintResult(num_errors);
+}
+
+void RunNetworkTests(Workspace &ws) {
+  const Backend cl = Backend::kOpenCL;
+  const Backend cpu = Backend::kCpu;
+  RunNetworkUnitTest(&ws, 16, 16, {cl, cl, cl, cl, cl, cl});
+  RunNetworkUnitTest(nullptr, 16, 16, {cpu, cpu, cpu, cpu, cpu, cpu});
+  RunNetworkUnitTest(&ws, 16, 16, {cl, cpu, cl, cpu, cl, cpu});
+  RunNetworkUnitTest(&ws, 17, 23, {cpu, cpu, cl, cl, cl, cpu});
+  RunNetworkUnitTest(nullptr, 16, 16, {cpu, cpu, cpu, cpu, cpu, cpu}, 3);
+  RunNetworkUnitTest(&ws, 17, 23, {cl, cl, cl, cl, cl, cl}, 2);
+  RunNetworkUnitTest(&ws, 16, 16, {cl, cpu, cl, cpu, cl, cpu}, 2);
+  RunConcurrentSessionUnitTest(&ws, 16, 16, {cl, cl, cl, cl, cl, cl}, 4, 8);
+  RunConcurrentSessionUnitTest(&ws, 17, 23, {cl, cpu, cl, cpu, cl, cpu}, 2,
+                               4);
+  RunConcurrentSessionUnitTest(nullptr, 16, 16,
+                               {cpu, cpu, cpu, cpu, cpu, cpu}, 3, 6);
+}
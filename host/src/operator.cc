@@ -0,0 +1,256 @@
+#include "operator.h"
+
+#include <string>
+
+#include "cl_operators.h"
+#include "cpu_operators.h"
+#include "memory_activation.h"
+
+const char *GetBackendName(Backend backend) {
+  return (backend == Backend::kOpenCL) ? "OpenCL" : "CPU";
+}
+
+Operator::~Operator() {}
+
+bool Operator::IsInPlace() const {
+  return false;
+}
+
+OpCost Operator::GetCost(const std::vector<int> & /*in_shape*/) const {
+  return {0.0, 0.0, 0.0, 0.0};
+}
+
+std::size_t Operator::GetScratchSize(
+    const std::vector<int> & /*in_shape*/) const {
+  return 0;
+}
+
+int Operator::GetInputHalo() const {
+  return 0;
+}
+
+bool Operator::SupportsHalo() const {
+  return false;
+}
+
+void Operator::Prepare(const std::vector<int> &in_shape) {
+  InferShape(in_shape);
+}
+
+std::unique_ptr<Operator> CreateConv2D(Backend backend,
+                                       Workspace *ws,
+                                       int in_channels,
+                                       int out_channels,
+                                       int kernel_size,
+                                       int stride,
+                                       int padding,
+                                       const std::vector<float> &kernel_data,
+                                       Conv2DAlgorithm algorithm) {
+  if (backend == Backend::kCpu) {
+    return std::unique_ptr<Operator>(
+        new CpuConv2D(in_channels, out_channels, kernel_size, stride, padding,
+                      kernel_data, algorithm));
+  }
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClConv2D(*ws, in_channels, out_channels,
+                                                kernel_size, stride, padding,
+                                                kernel_data));
+}
+
+std::unique_ptr<Operator> CreateDepthwiseConv2D(
+    Backend backend,
+    Workspace *ws,
+    int channels,
+    int channel_multiplier,
+    int kernel_size,
+    int stride,
+    int padding,
+    const std::vector<float> &kernel_data) {
+  if (backend == Backend::kCpu) {
+    return std::unique_ptr<Operator>(
+        new CpuDepthwiseConv2D(channels, channel_multiplier, kernel_size,
+                               stride, padding, kernel_data));
+  }
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(
+      new ClDepthwiseConv2D(*ws, channels, channel_multiplier, kernel_size,
+                            stride, padding, kernel_data));
+}
+
+std::unique_ptr<Operator> CreateBatchNorm(Backend backend,
+                                          Workspace *ws,
+                                          int num_features,
+                                          float eps,
+                                          float relu,
+                                          const std::vector<float> &weights,
+                                          const std::vector<float> &biases,
+                                          BatchNormStats stats) {
+  if (backend == Backend::kCpu) {
+    return std::unique_ptr<Operator>(
+        new CpuBatchNorm(num_features, eps, relu, weights, biases, stats));
+  }
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(
+      new ClBatchNorm(*ws, num_features, eps, relu, weights, biases, stats));
+}
+
+std::unique_ptr<Operator> CreateSoftmax(Backend backend, Workspace *ws) {
+  if (backend == Backend::kCpu) {
+    return std::unique_ptr<Operator>(new CpuSoftmax);
+  }
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClSoftmax(*ws));
+}
+
+std::unique_ptr<Operator> CreateGlobalAvgPool(Backend backend, Workspace *ws) {
+  if (backend == Backend::kCpu) {
+    return std::unique_ptr<Operator>(new CpuGlobalAvgPool);
+  }
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClGlobalAvgPool(*ws));
+}
+
+std::unique_ptr<Operator> CreateFullyConnected(
+    Backend backend,
+    Workspace *ws,
+    int in_features,
+    int out_features,
+    const std::vector<float> &weights,
+    const std::vector<float> &biases,
+    bool pool_input) {
+  if (backend == Backend::kCpu) {
+    return std::unique_ptr<Operator>(new CpuFullyConnected(
+        in_features, out_features, weights, biases, pool_input));
+  }
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(new ClFullyConnected(
+      *ws, in_features, out_features, weights, biases, pool_input));
+}
+
+std::unique_ptr<Operator> CreateReduce(Backend backend,
+                                       Workspace *ws,
+                                       Reduction reduction,
+                                       int axis,
+                                       int num_axes) {
+  if (backend == Backend::kCpu) {
+    return std::unique_ptr<Operator>(
+        new CpuReduce(reduction, axis, num_axes));
+  }
+  ASSERT(ws != nullptr, "OpenCL operators need a workspace");
+  return std::unique_ptr<Operator>(
+      new ClReduce(*ws, reduction, axis, num_axes));
+}
+
+std::vector<int> InferConvShape(const std::vector<int> &in_shape,
+                                int out_channels,
+                                int kernel_size,
+                                int stride,
+                                int padding) {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  const int out_height =
+      ((in_shape[2] + 2 * padding - kernel_size) / stride) + 1;
+  const int out_width =
+      ((in_shape[3] + 2 * padding - kernel_size) / stride) + 1;
+  ASSERT((out_height > 0) && (out_width > 0),
+         "Input is smaller than the kernel");
+  return {in_shape[0], out_channels, out_height, out_width};
+}
+
+namespace {
+
+// Sum, squared difference, then normalize, scale and shift.
+const double kBatchNormFlopsPerElement = 8.0;
+
+// Max, exp, sum, then scale; the exp counted as one.
+const double kSoftmaxFlopsPerElement = 4.0;
+
+// A compare or add per element, or the four operations of a Welford step.
+const double kReduceFlopsPerElement = 1.0;
+const double kWelfordFlopsPerElement = 4.0;
+
+double GetNumElements(const std::vector<int> &shape) {
+  double size = 1.0;
+  for (int dim : shape) {
+    size *= dim;
+  }
+  return size;
+}
+
+}  // namespace
+
+OpCost GetConv2DCost(const std::vector<int> &in_shape,
+                     int out_channels,
+                     int kernel_size,
+                     int stride,
+                     int padding) {
+  const std::vector<int> out_shape =
+      InferConvShape(in_shape, out_channels, kernel_size, stride, padding);
+  const double kernel_elements = static_cast<double>(out_channels) *
+                                 in_shape[1] * kernel_size * kernel_size;
+  const double macs = GetNumElements(out_shape) * in_shape[1] * kernel_size *
+                      kernel_size;
+  return {macs, 2.0 * macs,
+          sizeof(float) * (GetNumElements(in_shape) + kernel_elements),
+          sizeof(float) * GetNumElements(out_shape)};
+}
+
+OpCost GetDepthwiseConv2DCost(const std::vector<int> &in_shape,
+                              int channel_multiplier,
+                              int kernel_size,
+                              int stride,
+                              int padding) {
+  const int out_channels = in_shape[1] * channel_multiplier;
+  const std::vector<int> out_shape =
+      InferConvShape(in_shape, out_channels, kernel_size, stride, padding);
+  const double kernel_elements =
+      static_cast<double>(out_channels) * kernel_size * kernel_size;
+  const double macs = GetNumElements(out_shape) * kernel_size * kernel_size;
+  return {macs, 2.0 * macs,
+          sizeof(float) * (GetNumElements(in_shape) + kernel_elements),
+          sizeof(float) * GetNumElements(out_shape)};
+}
+
+OpCost GetBatchNormCost(const std::vector<int> &in_shape) {
+  const double size = GetNumElements(in_shape);
+  return {0.0, kBatchNormFlopsPerElement * size,
+          sizeof(float) * (size + 2.0 * in_shape[1]), sizeof(float) * size};
+}
+
+OpCost GetSoftmaxCost(const std::vector<int> &in_shape) {
+  const double size = GetNumElements(in_shape);
+  return {0.0, kSoftmaxFlopsPerElement * size, sizeof(float) * size,
+          sizeof(float) * size};
+}
+
+OpCost GetGlobalAvgPoolCost(const std::vector<int> &in_shape) {
+  ASSERT(in_shape.size() == 4, "Only accepts 4D input");
+  const double size = GetNumElements(in_shape);
+  return {0.0, size, sizeof(float) * size,
+          sizeof(float) * static_cast<double>(in_shape[0]) * in_shape[1]};
+}
+
+OpCost GetFullyConnectedCost(const std::vector<int> &in_shape,
+                             int out_features,
+                             bool pool_input) {
+  const double size = GetNumElements(in_shape);
+  const double in_features = pool_input ? in_shape[1] : size / in_shape[0];
+  const double macs = in_shape[0] * in_features * out_features;
+  const double pool_flops = pool_input ? size : 0.0;
+  return {macs, 2.0 * macs + pool_flops,
+          sizeof(float) * (size + (in_features + 1.0) * out_features),
+          sizeof(float) * static_cast<double>(in_shape[0]) * out_features};
+}
+
+OpCost GetReduceCost(const std::vector<int> &in_shape,
+                     Reduction reduction,
+                     int axis,
+                     int num_axes) {
+  const double size = GetNumElements(in_shape);
+  const double out_size =
+      GetNumElements(GetReduceShape(in_shape, axis, num_axes));
+  const bool welford =
+      (reduction == Reduction::kMean) || (reduction == Reduction::kVariance);
+  return {0.0,
+          (welford ? kWelfordFlopsPerElement : kReduceFlopsPerElement) * size,
+          sizeof(float) * size, sizeof(float) * out_size};
+}
@@ -0,0 +1,125 @@
+#include "preprocess.h"
+
+#include <algorithm>
+
+#include "memory_activation.h"
+
+namespace {
+
+void CheckParams(const PreprocessParams &params) {
+  ASSERT((params.src_height > 0) && (params.src_width > 0) &&
+             (params.dst_height > 0) && (params.dst_width > 0),
+         "Image sizes must be positive");
+  ASSERT(params.channels > 0, "Number of channels must be positive");
+  ASSERT((static_cast<int>(params.mean.size()) == params.channels) &&
+             (static_cast<int>(params.stddev.size()) == params.channels),
+         "Need a mean and a stddev per channel");
+  if (params.resize == ResizeMode::kCenterCrop) {
+    ASSERT((params.src_height >= params.dst_height) &&
+               (params.src_width >= params.dst_width),
+           "Frames are smaller than the crop");
+  }
+}
+
+// Source coordinate of dst under a half-pixel-center resize, and its two
+// neighbours and weight. Matches the device kernel operation for operation.
+void GetBilinearTap(int dst, int src_size, int dst_size, int *lo, int *hi,
+                    float *weight) {
+  float f = (dst + 0.5f) * src_size / dst_size - 0.5f;
+  f = std::max(f, 0.f);
+  *lo = std::min(static_cast<int>(f), src_size - 1);
+  *hi = std::min(*lo + 1, src_size - 1);
+  *weight = f - *lo;
+}
+
+}  // namespace
+
+int GetPreprocessInSize(const PreprocessParams &params) {
+  return params.src_height * params.src_width * params.channels;
+}
+
+int GetPreprocessOutSize(const PreprocessParams &params) {
+  return params.channels * params.dst_height * params.dst_width;
+}
+
+std::vector<int> GetPreprocessShape(const PreprocessParams &params,
+                                    int batch) {
+  return {batch, params.channels, params.dst_height, params.dst_width};
+}
+
+std::vector<float> GetPreprocessScaleShift(const PreprocessParams &params) {
+  CheckParams(params);
+  std::vector<float> scale_shift(2 * params.channels);
+  for (int c = 0; c < params.channels; c++) {
+    scale_shift[c] = 1.f / (255.f * params.stddev[c]);
+    scale_shift[params.channels + c] = -params.mean[c] / params.stddev[c];
+  }
+  return scale_shift;
+}
+
+bool IsPreprocessCropOnly(const PreprocessParams &params) {
+  return (params.resize == ResizeMode::kCenterCrop) ||
+         ((params.src_height == params.dst_height) &&
+          (params.src_width == params.dst_width));
+}
+
+void RunPreprocessRef(const std::uint8_t *in_data,
+                      float *out_data,
+                      int batch,
+                      const PreprocessParams &params) {
+  const std::vector<float> scale_shift = GetPreprocessScaleShift(params);
+  const int channels = params.channels;
+  const float *scale = scale_shift.data();
+  const float *shift = scale_shift.data() + channels;
+  const int src_row = params.src_width * channels;
+  const int dst_size = params.dst_height * params.dst_width;
+  const bool crop = IsPreprocessCropOnly(params);
+  const int crop_y = (params.src_height - params.dst_height) / 2;
+  const int crop_x = (params.src_width - params.dst_width) / 2;
+
+  for (int n = 0; n < batch; n++) {
+    const std::uint8_t *image = in_data + n * GetPreprocessInSize(params);
+    float *out = out_data + n * GetPreprocessOutSize(params);
+    for (int y = 0; y < params.dst_height; y++) {
+      for (int x = 0; x < params.dst_width; x++) {
+        const int idx = y * params.dst_width + x;
+        if (crop) {
+          const std::uint8_t *pixel =
+              image + (y + crop_y) * src_row + (x + crop_x) * channels;
+          for (int c = 0; c < channels; c++) {
+            out[c * dst_size + idx] = pixel[c] * scale[c] + shift[c];
+          }
+          continue;
+        }
+        int y0, y1, x0, x1;
+        float wy, wx;
+        GetBilinearTap(y, params.src_height, params.dst_height, &y0, &y1,
+                       &wy);
+        GetBilinearTap(x, params.src_width, params.dst_width, &x0, &x1, &wx);
+        const std::uint8_t *row0 = image + y0 * src_row;
+        const std::uint8_t *row1 = image + y1 * src_row;
+        for (int c = 0; c < channels; c++) {
+          const float top = row0[x0 * channels + c] +
+                            wx * (row0[x1 * channels + c] -
+                                  row0[x0 * channels + c]);
+          const float bottom = row1[x0 * channels + c] +
+                               wx * (row1[x1 * channels + c] -
+                                     row1[x0 * channels + c]);
+          out[c * dst_size + idx] =
+              (top + wy * (bottom - top)) * scale[c] + shift[c];
+        }
+      }
+    }
+  }
+}
+
+void RunPreprocessRef(const std::vector<std::uint8_t> &in_data,
+                      std::vector<float> &out_data,
+                      int batch,
+                      const PreprocessParams &params) {
+  ASSERT(in_data.size() >=
+             static_cast<std::size_t>(batch) * GetPreprocessInSize(params),
+         "Input doesn't have enough data");
+  out_data.resize(batch * GetPreprocessOutSize(params));
+  RunPreprocessRef(in_data.data(), out_data.data(), batch, params);
+}
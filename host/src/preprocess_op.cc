@@ -0,0 +1,92 @@
+#include "preprocess_op.h"
+
+#include "memory_activation.h"
+
+PreprocessOp::PreprocessOp(const PreprocessParams &params, cl_kernel *kernel,
+                           cl_command_queue *command_queue, cl_mem *in_buf,
+                           cl_mem *out_buf, cl_mem *scale_shift_buf)
+    : params_(params),
+      kernel_(kernel),
+      command_queue_(command_queue),
+      in_buf_(in_buf),
+      out_buf_(out_buf),
+      scale_shift_buf_(scale_shift_buf),
+      plan_(nullptr),
+      profiler_(nullptr) {}
+
+void PreprocessOp::SetInBuffer(cl_mem *buf) {
+  in_buf_ = buf;
+}
+
+void PreprocessOp::SetOutBuffer(cl_mem *buf) {
+  out_buf_ = buf;
+}
+
+void PreprocessOp::SetScaleShiftBuffer(cl_mem *buf) {
+  scale_shift_buf_ = buf;
+}
+
+void PreprocessOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
+
+void PreprocessOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+void PreprocessOp::Run(int batch, bool blocking) {
+  const static cl_uint wg_dim = 3;
+  const static cl_uint wg_width = 16;
+  const static cl_uint wg_height = 8;
+
+  ASSERT(batch >= 1, "The batch must not be empty");
+  ASSERT(in_buf_ != nullptr, "input buffer is null");
+  ASSERT(out_buf_ != nullptr, "output buffer is null");
+  ASSERT(scale_shift_buf_ != nullptr, "scale shift buffer is null");
+
+  cl_int status;
+  // A pixel of an image per work item; the channels are looped over, so a
+  // work item reads its interleaved pixel once.
+  const std::size_t global_size[wg_dim] = {
+    static_cast<std::size_t>(RoundUp(params_.dst_width, wg_width)),
+    static_cast<std::size_t>(RoundUp(params_.dst_height, wg_height)),
+    static_cast<std::size_t>(batch)
+  };
+  const std::size_t local_size[wg_dim] = {
+    static_cast<std::size_t>(wg_width),
+    static_cast<std::size_t>(wg_height), 1
+  };
+
+  const int bilinear = !IsPreprocessCropOnly(params_);
+  const std::vector<KernelArg> args{
+      *in_buf_, *out_buf_, *scale_shift_buf_, batch, params_.channels,
+      params_.src_height, params_.src_width, params_.dst_height,
+      params_.dst_width, bilinear};
+  SetKernelArgs(*kernel_, args);
+
+  ProfileEvent event(profiler_, "Preprocess", ProfileKind::kKernel);
+  status = clEnqueueNDRangeKernel(*command_queue_, *kernel_, wg_dim, nullptr,
+                                  global_size, local_size, 0, nullptr,
+                                  event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(*kernel_, args, wg_dim, global_size, local_size,
+                        "Preprocess");
+  }
+
+  if (blocking) {
+    clFinish(*command_queue_);
+  }
+}
+
+void PreprocessOp::Run(int batch, bool blocking, float *out_data) {
+  Run(batch, blocking);
+  std::size_t raw_tensor_size =
+      sizeof(float) * batch * GetPreprocessOutSize(params_);
+  ProfileEvent event(profiler_, "Preprocess output", ProfileKind::kRead);
+  cl_int status =
+      clEnqueueReadBuffer(*command_queue_, *out_buf_, blocking, 0,
+                          raw_tensor_size, out_data, 0, nullptr, event.Get());
+  event.Commit(status);
+}
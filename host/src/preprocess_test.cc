@@ -0,0 +1,192 @@
+#include "preprocess_test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "memory_activation.h"
+
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::microseconds;
+
+namespace {
+
+std::vector<std::uint8_t> GenerateFrames(const PreprocessParams &params,
+                                         int batch) {
+  std::vector<std::uint8_t> frames(batch * GetPreprocessInSize(params));
+  std::generate(frames.begin(), frames.end(),
+                []() { return static_cast<std::uint8_t>(rand() % 256); });
+  return frames;
+}
+
+}  // namespace
+
+void RunPreprocessRefUnitTest() {
+  std::cout << "Preprocess reference\n";
+  int num_errors = 0;
+  auto expect = [&num_errors](float expected, float result) {
+    if (std::fabs(expected - result) > 1e-4f) {
+      num_errors++;
+    }
+  };
+
+  // A 2x4 frame of two channels, pixel (y, x) = (10 * y + x, 100 + x).
+  PreprocessParams params;
+  params.src_height = 2;
+  params.src_width = 4;
+  params.channels = 2;
+  params.mean = {0.f, 0.5f};
+  params.stddev = {1.f, 0.5f};
+  std::vector<std::uint8_t> frame;
+  for (int y = 0; y < 2; y++) {
+    for (int x = 0; x < 4; x++) {
+      frame.push_back(10 * y + x);
+      frame.push_back(100 + x);
+    }
+  }
+  std::vector<float> out_data;
+
+  // The middle 2x2 window.
+  params.dst_height = 2;
+  params.dst_width = 2;
+  params.resize = ResizeMode::kCenterCrop;
+  RunPreprocessRef(frame, out_data, 1, params);
+  expect(1.f / 255.f, out_data[0]);
+  expect(12.f / 255.f, out_data[3]);
+  expect(101.f / 255.f * 2.f - 1.f, out_data[4]);
+  expect(102.f / 255.f * 2.f - 1.f, out_data[7]);
+
+  // Halving the width averages pairs of pixels.
+  params.dst_height = 2;
+  params.dst_width = 2;
+  params.resize = ResizeMode::kBilinear;
+  RunPreprocessRef(frame, out_data, 1, params);
+  expect(0.5f / 255.f, out_data[0]);
+  expect(12.5f / 255.f, out_data[3]);
+  expect(100.5f / 255.f * 2.f - 1.f, out_data[4]);
+
+  // Doubling the height puts rows a quarter of the way between the source
+  // rows, and clamps at the edges.
+  params.dst_height = 4;
+  params.dst_width = 4;
+  RunPreprocessRef(frame, out_data, 1, params);
+  expect(0.f, out_data[0]);
+  expect(2.5f / 255.f, out_data[4]);
+  expect(7.5f / 255.f, out_data[8]);
+  expect(10.f / 255.f, out_data[12]);
+  PrintResult(num_errors);
+}
+
+void RunPreprocessUnitTest(Workspace &ws,
+                           const PreprocessParams &params,
+                           int batch,
+                           bool enable_timing) {
+  std::cout << "src = " << params.src_height << "x" << params.src_width
+            << ", dst = " << params.dst_height << "x" << params.dst_width
+            << ", batch = " << batch << ", resize = "
+            << ((params.resize == ResizeMode::kBilinear) ? "bilinear"
+                                                          : "center crop")
+            << '\n';
+  const std::vector<std::uint8_t> frames = GenerateFrames(params, batch);
+
+  std::vector<float> ref;
+  auto tic = high_resolution_clock::now();
+  RunPreprocessRef(frames, ref, batch, params);
+  auto toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Host took " << duration_cast<microseconds>(toc - tic).count()
+              << " us\n";
+  }
+
+  Preprocessor preprocessor(ws, params, batch);
+  Tensor output(GetPreprocessShape(params, batch));
+  tic = high_resolution_clock::now();
+  preprocessor.Run(frames.data(), batch, output);
+  const TensorData &out_data = output.GetData();
+  toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Device took "
+              << duration_cast<microseconds>(toc - tic).count() << " us\n";
+  }
+
+  CheckResult(ref.data(), const_cast<float *>(&out_data[0]), ref.size(),
+              false, 1e-3);
+}
+
+void RunPreprocessFusedUnitTest(Workspace &ws,
+                                const PreprocessParams &params,
+                                int batch) {
+  std::cout << "Fused, src = " << params.src_height << "x"
+            << params.src_width << ", dst = " << params.dst_height << "x"
+            << params.dst_width << ", batch = " << batch << '\n';
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  std::vector<float> kernel_data(max_channels * max_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> weight_data(max_channels);
+  std::vector<float> bias_data(max_channels);
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weight_data.begin(), weight_data.end(),
+                RandomGenerator(1.f / 10000.f, 1.f));
+  std::generate(bias_data.begin(), bias_data.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+
+  Network network(&ws);
+  AddModelLayers(network, &ws, kernel_data, weight_data, bias_data);
+  network.Prepare(GetPreprocessShape(params, batch));
+  const std::vector<std::uint8_t> frames = GenerateFrames(params, batch);
+
+  // The network on the input preprocessed on the host.
+  std::vector<float> in_data;
+  RunPreprocessRef(frames, in_data, batch, params);
+  std::vector<float> ref(network.GetOutput().GetSize());
+  network.Run(in_data, ref);
+
+  int num_errors = 0;
+  Preprocessor preprocessor(ws, params, batch);
+  if (!preprocessor.Fuse(network)) {
+    num_errors++;
+  }
+  preprocessor.Run(frames.data(), network);
+  network.Run();
+  const TensorData &out_data = network.GetOutput().GetData();
+  if (GetMaxError(ref.data(), &out_data[0], ref.size()) > 1e-3f) {
+    num_errors++;
+  }
+  preprocessor.Unfuse();
+  PrintResult(num_errors);
+}
+
+void RunPreprocessTests(Workspace &ws, bool enable_timing) {
+  RunPreprocessRefUnitTest();
+
+  PreprocessParams params;
+  params.src_height = 480;
+  params.src_width = 640;
+  params.dst_height = 224;
+  params.dst_width = 224;
+  RunPreprocessUnitTest(ws, params, 1, enable_timing);
+  RunPreprocessUnitTest(ws, params, 3, enable_timing);
+  params.resize = ResizeMode::kCenterCrop;
+  RunPreprocessUnitTest(ws, params, 2, enable_timing);
+  // Upscaling, odd sizes.
+  params.src_height = 37;
+  params.src_width = 53;
+  params.dst_height = 64;
+  params.dst_width = 61;
+  params.resize = ResizeMode::kBilinear;
+  RunPreprocessUnitTest(ws, params, 2, enable_timing);
+
+  params.src_height = 40;
+  params.src_width = 50;
+  params.dst_height = 32;
+  params.dst_width = 32;
+  params.resize = ResizeMode::kCenterCrop;
+  RunPreprocessFusedUnitTest(ws, params, 1);
+  RunPreprocessFusedUnitTest(ws, params, 2);
+}
@@ -0,0 +1,109 @@
+#include "preprocessor.h"
+
+#include <vector>
+
+#include "memory_activation.h"
+
+Preprocessor::Preprocessor(Workspace &ws, const PreprocessParams &params,
+                           int max_batch)
+    : ws_(&ws),
+      params_(params),
+      max_batch_(max_batch),
+      kernel_(ws.GetKernel("/../device/preprocess.cl", "Preprocess")),
+      command_queue_(ws.GetCommandQueue()),
+      frames_buf_(nullptr),
+      scale_shift_buf_(nullptr),
+      out_buf_(nullptr),
+      op_(params, &kernel_, &command_queue_, &frames_buf_, &out_buf_,
+          &scale_shift_buf_),
+      fused_conv_(nullptr) {
+  ASSERT(max_batch_ >= 1, "The batch must not be empty");
+  std::vector<float> scale_shift = GetPreprocessScaleShift(params_);
+  cl_int status;
+  frames_buf_ = clCreateBuffer(ws.GetContext(), CL_MEM_READ_ONLY,
+                               max_batch_ * GetInSize(), nullptr, &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create frame buffer");
+  scale_shift_buf_ = clCreateBuffer(
+      ws.GetContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+      sizeof(float) * scale_shift.size(), scale_shift.data(), &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create scale shift buffer");
+  op_.SetProfiler(ws.GetProfiler());
+}
+
+Preprocessor::~Preprocessor() {
+  // Commands reading the buffers may still be in flight.
+  ws_->FinishCommandQueue();
+  clReleaseMemObject(frames_buf_);
+  clReleaseMemObject(scale_shift_buf_);
+}
+
+const PreprocessParams &Preprocessor::GetParams() const {
+  return params_;
+}
+
+int Preprocessor::GetMaxBatch() const {
+  return max_batch_;
+}
+
+std::size_t Preprocessor::GetInSize() const {
+  return GetPreprocessInSize(params_);
+}
+
+void Preprocessor::Run(const std::uint8_t *frames, int batch,
+                       Tensor &output) {
+  ASSERT(output.GetShape() == GetPreprocessShape(params_, batch),
+         "Output tensor has the wrong shape");
+  ASSERT(output.GetBacking() != TensorBacking::kSvm,
+         "The kernel writes a buffer, not SVM");
+  Upload(frames, batch);
+  output.AllocateDevice(*ws_, false);
+  out_buf_ = output.GetDeviceData();
+  op_.Run(batch, false);
+}
+
+void Preprocessor::Run(const std::uint8_t *frames, Network &network) {
+  const int batch = network.GetInput().GetShape()[0];
+  if (fused_conv_ == nullptr) {
+    Run(frames, batch, network.GetInput());
+    return;
+  }
+  Upload(frames, batch);
+}
+
+bool Preprocessor::Fuse(Network &network) {
+  Unfuse();
+  ClConv2D *conv = dynamic_cast<ClConv2D *>(&network.GetOperator(0));
+  const std::vector<int> &in_shape = network.GetInShape(0);
+  if ((conv == nullptr) || (network.GetWorkspace() != ws_) ||
+      !IsPreprocessCropOnly(params_) ||
+      (in_shape != GetPreprocessShape(params_, in_shape[0]))) {
+    return false;
+  }
+  conv->FusePreprocess(&frames_buf_, &scale_shift_buf_, params_.src_height,
+                       params_.src_width);
+  fused_conv_ = conv;
+  return true;
+}
+
+void Preprocessor::Unfuse() {
+  if (fused_conv_ != nullptr) {
+    fused_conv_->FusePreprocess(nullptr, nullptr, 0, 0);
+    fused_conv_ = nullptr;
+  }
+}
+
+bool Preprocessor::IsFused() const {
+  return fused_conv_ != nullptr;
+}
+
+void Preprocessor::Upload(const std::uint8_t *frames, int batch) {
+  ASSERT((batch >= 1) && (batch <= max_batch_),
+         "The batch doesn't fit the frame buffer");
+  ProfileEvent event(ws_->GetProfiler(), "Preprocess upload",
+                     ProfileKind::kWrite);
+  cl_int status = clEnqueueWriteBuffer(
+      command_queue_, frames_buf_, CL_FALSE, 0, batch * GetInSize(), frames,
+      0, nullptr, event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to upload the frames");
+  event.Commit(status);
+}
@@ -0,0 +1,325 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Chrome trace threads.
+const int kDeviceTid = 0;
+const int kHostTid = 1;
+const int kLayerTid = 2;
+
+struct LayerStats {
+  std::string name;
+  double kernel_us = 0.0;
+  double transfer_us = 0.0;
+  double host_us = 0.0;
+  double queued_us = 0.0;
+  std::int64_t begin = std::numeric_limits<std::int64_t>::max();
+  std::int64_t end = std::numeric_limits<std::int64_t>::min();
+};
+
+bool IsDeviceRecord(const ProfileRecord &record) {
+  return record.kind != ProfileKind::kHost;
+}
+
+// Host times of a record.
+std::int64_t GetBegin(const ProfileRecord &record, std::int64_t offset) {
+  return IsDeviceRecord(record) ? record.start + offset : record.start;
+}
+
+std::int64_t GetEnd(const ProfileRecord &record, std::int64_t offset) {
+  return IsDeviceRecord(record) ? record.end + offset : record.end;
+}
+
+std::string EscapeJson(const std::string &str) {
+  std::string escaped;
+  for (char c : str) {
+    if ((c == '"') || (c == '\\')) {
+      escaped.push_back('\\');
+    }
+    escaped.push_back(c);
+  }
+  return escaped;
+}
+
+void WriteTraceEvent(std::ostream &os, bool &first, const std::string &name,
+                     const char *category, int tid, std::int64_t begin,
+                     std::int64_t end, const std::string &args) {
+  os << (first ? "\n" : ",\n") << "{\"name\":\"" << EscapeJson(name)
+     << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+     << tid << ",\"ts\":" << begin / 1e3 << ",\"dur\":" << (end - begin) / 1e3
+     << ",\"args\":{" << args << "}}";
+  first = false;
+}
+
+void WriteThreadName(std::ostream &os, bool &first, int tid,
+                     const char *name) {
+  os << (first ? "\n" : ",\n")
+     << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+     << ",\"args\":{\"name\":\"" << name << "\"}}";
+  first = false;
+}
+
+}  // namespace
+
+const char *GetProfileKindName(ProfileKind kind) {
+  switch (kind) {
+    case ProfileKind::kKernel:
+      return "kernel";
+    case ProfileKind::kWrite:
+      return "write";
+    case ProfileKind::kRead:
+      return "read";
+    case ProfileKind::kMap:
+      return "map";
+    case ProfileKind::kUnmap:
+      return "unmap";
+    default:
+      return "host";
+  }
+}
+
+Profiler::Profiler() : num_collected_(0), layer_(-1) {}
+
+Profiler::~Profiler() {
+  ReleaseEvents();
+}
+
+void Profiler::BeginLayer(int layer, const std::string &name) {
+  layer_ = layer;
+  layer_names_[layer] = name;
+}
+
+void Profiler::EndLayer() {
+  layer_ = -1;
+}
+
+void Profiler::AddCommand(const char *name, ProfileKind kind,
+                          cl_event event) {
+  ASSERT(kind != ProfileKind::kHost, "Host spans have no event");
+  clRetainEvent(event);
+  records_.push_back(
+      {name, kind, layer_, event, GetHostTime(), 0, 0, 0, 0});
+}
+
+void Profiler::AddHostSpan(const char *name, std::int64_t start,
+                           std::int64_t end) {
+  records_.push_back({name, ProfileKind::kHost, layer_, nullptr, start, 0, 0,
+                      static_cast<cl_ulong>(start),
+                      static_cast<cl_ulong>(end)});
+}
+
+std::int64_t Profiler::GetHostTime() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Profiler::Collect() {
+  for (std::size_t i = num_collected_; i < records_.size(); i++) {
+    ProfileRecord &record = records_[i];
+    if (record.event == nullptr) {
+      continue;
+    }
+    cl_int status = clWaitForEvents(1, &record.event);
+    const cl_profiling_info params[] = {
+        CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT,
+        CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END};
+    cl_ulong *values[] = {&record.queued, &record.submit, &record.start,
+                          &record.end};
+    for (int j = 0; (j < 4) && (status == CL_SUCCESS); j++) {
+      status = clGetEventProfilingInfo(record.event, params[j],
+                                       sizeof(cl_ulong), values[j], nullptr);
+    }
+    ASSERT(status == CL_SUCCESS,
+           "Failed to read the timestamps of " + record.name +
+               ", is the queue created with profiling enabled?");
+    clReleaseEvent(record.event);
+    record.event = nullptr;
+  }
+  num_collected_ = records_.size();
+}
+
+void Profiler::Clear() {
+  ReleaseEvents();
+  records_.clear();
+  num_collected_ = 0;
+  layer_names_.clear();
+}
+
+const std::vector<ProfileRecord> &Profiler::GetRecords() const {
+  return records_;
+}
+
+std::int64_t Profiler::GetClockOffset() const {
+  // The host reads its clock after the enqueue returns, so every difference
+  // overestimates the offset and the smallest is the closest.
+  std::int64_t offset = std::numeric_limits<std::int64_t>::max();
+  for (std::size_t i = 0; i < num_collected_; i++) {
+    const ProfileRecord &record = records_[i];
+    if (IsDeviceRecord(record)) {
+      offset = std::min(offset, record.host_enqueue -
+                                    static_cast<std::int64_t>(record.queued));
+    }
+  }
+  return (offset == std::numeric_limits<std::int64_t>::max()) ? 0 : offset;
+}
+
+void Profiler::PrintLayerTable(std::ostream &os) const {
+  const std::int64_t offset = GetClockOffset();
+  std::map<int, LayerStats> layers;
+  for (std::size_t i = 0; i < num_collected_; i++) {
+    const ProfileRecord &record = records_[i];
+    LayerStats &stats = layers[record.layer];
+    const double us = (GetEnd(record, offset) - GetBegin(record, offset)) / 1e3;
+    if (record.kind == ProfileKind::kKernel) {
+      stats.kernel_us += us;
+    } else if (record.kind == ProfileKind::kHost) {
+      stats.host_us += us;
+    } else {
+      stats.transfer_us += us;
+    }
+    if (IsDeviceRecord(record)) {
+      stats.queued_us += (record.start - record.queued) / 1e3;
+    }
+    stats.begin = std::min(stats.begin, GetBegin(record, offset));
+    stats.end = std::max(stats.end, GetEnd(record, offset));
+  }
+
+  os << std::left << std::setw(6) << "Layer" << std::setw(18) << "Name"
+     << std::right << std::setw(12) << "Kernel us" << std::setw(12)
+     << "Transfer us" << std::setw(12) << "Host us" << std::setw(12)
+     << "Queued us" << std::setw(12) << "Gap us" << std::setw(12)
+     << "Span us" << '\n';
+  os << std::fixed << std::setprecision(1);
+  LayerStats total;
+  double total_gap_us = 0.0;
+  std::int64_t prev_end = 0;
+  for (auto &entry : layers) {
+    const LayerStats &stats = entry.second;
+    auto name_it = layer_names_.find(entry.first);
+    const std::string name =
+        (entry.first < 0) ? "(outside layers)"
+                          : ((name_it != layer_names_.end()) ? name_it->second
+                                                             : "");
+    // Time between the previous layer finishing and this one starting,
+    // i.e. host overhead and idle device.
+    const double gap_us =
+        ((entry.first > 0) && (prev_end != 0))
+            ? std::max<std::int64_t>(stats.begin - prev_end, 0) / 1e3
+            : 0.0;
+    if (entry.first >= 0) {
+      prev_end = stats.end;
+      total_gap_us += gap_us;
+    }
+    os << std::left << std::setw(6) << entry.first << std::setw(18) << name
+       << std::right << std::setw(12) << stats.kernel_us << std::setw(12)
+       << stats.transfer_us << std::setw(12) << stats.host_us
+       << std::setw(12) << stats.queued_us << std::setw(12) << gap_us
+       << std::setw(12) << (stats.end - stats.begin) / 1e3 << '\n';
+    total.kernel_us += stats.kernel_us;
+    total.transfer_us += stats.transfer_us;
+    total.host_us += stats.host_us;
+    total.queued_us += stats.queued_us;
+    total.begin = std::min(total.begin, stats.begin);
+    total.end = std::max(total.end, stats.end);
+  }
+  if (!layers.empty()) {
+    os << std::left << std::setw(24) << "Total" << std::right
+       << std::setw(12) << total.kernel_us << std::setw(12)
+       << total.transfer_us << std::setw(12) << total.host_us
+       << std::setw(12) << total.queued_us << std::setw(12) << total_gap_us
+       << std::setw(12) << (total.end - total.begin) / 1e3 << '\n';
+  }
+  os.unsetf(std::ios_base::floatfield);
+  os << std::setprecision(6);
+}
+
+void Profiler::WriteChromeTrace(const std::string &path) const {
+  std::ofstream os(path);
+  ASSERT(static_cast<bool>(os), "Couldn't open the trace file " + path);
+  const std::int64_t offset = GetClockOffset();
+  os << std::fixed << std::setprecision(3);
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  WriteThreadName(os, first, kDeviceTid, "Device queue");
+  WriteThreadName(os, first, kHostTid, "Host");
+  WriteThreadName(os, first, kLayerTid, "Layers");
+
+  std::map<int, std::pair<std::int64_t, std::int64_t>> layer_spans;
+  for (std::size_t i = 0; i < num_collected_; i++) {
+    const ProfileRecord &record = records_[i];
+    const std::int64_t begin = GetBegin(record, offset);
+    const std::int64_t end = GetEnd(record, offset);
+    std::string args = "\"layer\":" + std::to_string(record.layer);
+    if (IsDeviceRecord(record)) {
+      args += ",\"queued_us\":" +
+              std::to_string((record.start - record.queued) / 1e3) +
+              ",\"submit_us\":" +
+              std::to_string((record.start - record.submit) / 1e3);
+    }
+    WriteTraceEvent(os, first, record.name, GetProfileKindName(record.kind),
+                    IsDeviceRecord(record) ? kDeviceTid : kHostTid, begin, end,
+                    args);
+    if (record.layer >= 0) {
+      auto it = layer_spans.find(record.layer);
+      if (it == layer_spans.end()) {
+        layer_spans[record.layer] = {begin, end};
+      } else {
+        it->second.first = std::min(it->second.first, begin);
+        it->second.second = std::max(it->second.second, end);
+      }
+    }
+  }
+  for (const auto &span : layer_spans) {
+    auto name_it = layer_names_.find(span.first);
+    const std::string name =
+        (name_it != layer_names_.end()) ? name_it->second : "";
+    WriteTraceEvent(os, first, std::to_string(span.first) + ' ' + name,
+                    "layer", kLayerTid, span.second.first, span.second.second,
+                    "");
+  }
+  os << "\n]}\n";
+}
+
+void Profiler::ReleaseEvents() {
+  for (ProfileRecord &record : records_) {
+    if (record.event != nullptr) {
+      clReleaseEvent(record.event);
+      record.event = nullptr;
+    }
+  }
+}
+
+ProfileEvent::ProfileEvent(Profiler *profiler, const char *name,
+                           ProfileKind kind, cl_event *event)
+    : profiler_(profiler),
+      name_(name),
+      kind_(kind),
+      event_(event),
+      local_event_(nullptr) {}
+
+cl_event *ProfileEvent::Get() {
+  if ((profiler_ == nullptr) || (event_ != nullptr)) {
+    return event_;
+  }
+  return &local_event_;
+}
+
+void ProfileEvent::Commit(cl_int status) {
+  if ((profiler_ == nullptr) || (status != CL_SUCCESS)) {
+    return;
+  }
+  profiler_->AddCommand(name_, kind_, *Get());
+  if (event_ == nullptr) {
+    clReleaseEvent(local_event_);
+    local_event_ = nullptr;
+  }
+}
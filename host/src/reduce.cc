@@ -0,0 +1,153 @@
+#include "reduce.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Values of a Welford block.
+const int kWelfordBlock = 1024;
+
+// Reduce count values of data, stride apart.
+template <typename T>
+T ReduceStrided(const float *data, int count, int stride,
+                Reduction reduction) {
+  switch (reduction) {
+    case Reduction::kSum: {
+      T sum = 0;
+      for (int r = 0; r < count; r++) {
+        sum += data[r * stride];
+      }
+      return sum;
+    }
+    case Reduction::kMax: {
+      T max_value = -std::numeric_limits<T>::infinity();
+      for (int r = 0; r < count; r++) {
+        max_value = std::max<T>(max_value, data[r * stride]);
+      }
+      return max_value;
+    }
+    case Reduction::kMin: {
+      T min_value = std::numeric_limits<T>::infinity();
+      for (int r = 0; r < count; r++) {
+        min_value = std::min<T>(min_value, data[r * stride]);
+      }
+      return min_value;
+    }
+    default: {
+      // Welford over blocks, combined like the device combines its lanes,
+      // which keeps the error of long rows down.
+      T total = 0;
+      T mean = 0;
+      T m2 = 0;
+      for (int first = 0; first < count; first += kWelfordBlock) {
+        const int last = std::min(first + kWelfordBlock, count);
+        T block_mean = 0;
+        T block_m2 = 0;
+        for (int r = first; r < last; r++) {
+          const T value = data[r * stride];
+          const T delta = value - block_mean;
+          block_mean += delta / (r - first + 1);
+          block_m2 += delta * (value - block_mean);
+        }
+        const T block_count = last - first;
+        const T delta = block_mean - mean;
+        total += block_count;
+        mean += delta * block_count / total;
+        m2 += block_m2 +
+              delta * delta * (total - block_count) * block_count / total;
+      }
+      if (reduction == Reduction::kMean) {
+        return mean;
+      }
+      return (count > 0) ? m2 / count : 0;
+    }
+  }
+}
+
+}  // namespace
+
+ReduceLayout GetReduceLayout(const std::vector<int> &shape,
+                             int axis,
+                             int num_axes) {
+  const int num_dims = static_cast<int>(shape.size());
+  ASSERT((axis >= 0) && (num_axes >= 1) && (axis + num_axes <= num_dims),
+         "Reduced axes out of range");
+  ReduceLayout layout{1, 1, 1};
+  for (int d = 0; d < num_dims; d++) {
+    if (d < axis) {
+      layout.outer *= shape[d];
+    } else if (d < axis + num_axes) {
+      layout.reduce *= shape[d];
+    } else {
+      layout.inner *= shape[d];
+    }
+  }
+  return layout;
+}
+
+std::vector<int> GetReduceShape(const std::vector<int> &shape,
+                                int axis,
+                                int num_axes) {
+  GetReduceLayout(shape, axis, num_axes);
+  std::vector<int> out_shape = shape;
+  std::fill(out_shape.begin() + axis, out_shape.begin() + axis + num_axes, 1);
+  return out_shape;
+}
+
+void RunReduceRef(const float *in_data,
+                  float *out_data,
+                  const std::vector<int> &shape,
+                  int axis,
+                  int num_axes,
+                  Reduction reduction) {
+  const ReduceLayout layout = GetReduceLayout(shape, axis, num_axes);
+  for (int o = 0; o < layout.outer; o++) {
+    for (int i = 0; i < layout.inner; i++) {
+      out_data[o * layout.inner + i] = static_cast<float>(
+          ReduceStrided<double>(in_data + o * layout.reduce * layout.inner + i,
+                                layout.reduce, layout.inner, reduction));
+    }
+  }
+}
+
+void RunReduceRef(const std::vector<float> &in_data,
+                  std::vector<float> &out_data,
+                  const std::vector<int> &shape,
+                  int axis,
+                  int num_axes,
+                  Reduction reduction) {
+  const ReduceLayout layout = GetReduceLayout(shape, axis, num_axes);
+  ASSERT(in_data.size() >=
+             static_cast<std::size_t>(layout.outer) * layout.reduce *
+                 layout.inner,
+         "Input doesn't have enough data");
+  out_data.resize(layout.outer * layout.inner);
+  RunReduceRef(in_data.data(), out_data.data(), shape, axis, num_axes,
+               reduction);
+}
+
+void RunReduceCpu(const float *in_data,
+                  float *out_data,
+                  const std::vector<int> &shape,
+                  int axis,
+                  int num_axes,
+                  Reduction reduction,
+                  ThreadPool *pool) {
+  if (pool == nullptr) {
+    pool = &ThreadPool::GetDefault();
+  }
+  const ReduceLayout layout = GetReduceLayout(shape, axis, num_axes);
+  pool->ParallelFor(layout.outer * layout.inner, 1, [&](int begin, int end) {
+    for (int idx = begin; idx < end; idx++) {
+      const int o = idx / layout.inner;
+      const int i = idx % layout.inner;
+      out_data[idx] = ReduceStrided<float>(
+          in_data + o * layout.reduce * layout.inner + i, layout.reduce,
+          layout.inner, reduction);
+    }
+  });
+}
@@ -0,0 +1,204 @@
+#include "reduce_op.h"
+
+#include <algorithm>
+
+#include "memory_activation.h"
+
+namespace {
+
+const int kWorkGroupSize = 256;
+// Widest tile of columns, which keeps lanes for long rows.
+const int kMaxTile = 32;
+// Work-groups that keep the device busy; fewer outputs get their rows
+// split into chunks.
+const int kTargetGroups = 128;
+// Fewest rows per lane worth a chunk of their own.
+const int kMinRowsPerLane = 16;
+
+int DivUp(int a, int b) {
+  return (a + b - 1) / b;
+}
+
+int NextPowerOfTwo(int value) {
+  int result = 1;
+  while (result < value) {
+    result *= 2;
+  }
+  return result;
+}
+
+}  // namespace
+
+ReduceOp::ReduceOp(Reduction reduction, cl_kernel *kernel,
+                   cl_command_queue *command_queue, cl_mem *in_buf,
+                   cl_mem *out_buf, cl_mem *scratch_buf)
+    : reduction_(reduction),
+      in_states_(false),
+      out_states_(false),
+      kernel_(kernel),
+      command_queue_(command_queue),
+      in_buf_(in_buf),
+      out_buf_(out_buf),
+      scratch_buf_(scratch_buf),
+      in_offset_(0),
+      out_offset_(0),
+      in_outer_stride_(0),
+      in_reduce_stride_(0),
+      plan_(nullptr),
+      profiler_(nullptr) {}
+
+void ReduceOp::SetInBuffer(cl_mem *buf, int offset) {
+  in_buf_ = buf;
+  in_offset_ = offset;
+}
+
+void ReduceOp::SetOutBuffer(cl_mem *buf, int offset) {
+  out_buf_ = buf;
+  out_offset_ = offset;
+}
+
+void ReduceOp::SetInStrides(int outer_stride, int reduce_stride) {
+  in_outer_stride_ = outer_stride;
+  in_reduce_stride_ = reduce_stride;
+}
+
+void ReduceOp::SetScratchBuffer(cl_mem *buf) {
+  scratch_buf_ = buf;
+}
+
+void ReduceOp::SetStates(bool in_states, bool out_states) {
+  in_states_ = in_states;
+  out_states_ = out_states;
+}
+
+void ReduceOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
+
+void ReduceOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+std::vector<ReduceOp::Pass> ReduceOp::Plan(ReduceLayout layout) {
+  std::vector<Pass> passes;
+  while (true) {
+    Pass pass;
+    pass.layout = layout;
+    pass.tile =
+        (layout.inner == 1) ? 1 : std::min(NextPowerOfTwo(layout.inner),
+                                           kMaxTile);
+    pass.lanes = kWorkGroupSize / pass.tile;
+    const int groups = DivUp(layout.inner, pass.tile) * layout.outer;
+    pass.chunks = 1;
+    if (groups < kTargetGroups) {
+      pass.chunks =
+          std::min(DivUp(kTargetGroups, groups),
+                   DivUp(layout.reduce, pass.lanes * kMinRowsPerLane));
+      pass.chunks = std::max(pass.chunks, 1);
+    }
+    pass.chunk_size = DivUp(layout.reduce, pass.chunks);
+    pass.chunks = DivUp(layout.reduce, pass.chunk_size);
+    passes.push_back(pass);
+    if (pass.chunks == 1) {
+      return passes;
+    }
+    layout.reduce = pass.chunks;
+  }
+}
+
+int ReduceOp::GetRegionSize(const std::vector<Pass> &passes) {
+  int size = 0;
+  for (std::size_t p = 0; p + 1 < passes.size(); p++) {
+    const ReduceLayout &layout = passes[p].layout;
+    size = std::max(size, layout.outer * passes[p].chunks * layout.inner);
+  }
+  return size;
+}
+
+std::size_t ReduceOp::GetScratchSize(const std::vector<int> &shape, int axis,
+                                     int num_axes) {
+  const std::vector<Pass> passes =
+      Plan(GetReduceLayout(shape, axis, num_axes));
+  const int num_regions = std::min<int>(passes.size() - 1, 2);
+  return sizeof(cl_float4) * num_regions * GetRegionSize(passes);
+}
+
+void ReduceOp::Run(const std::vector<int> &shape, int axis, int num_axes,
+                   bool blocking) {
+  const static cl_uint wg_dim = 3;
+
+  ASSERT(in_buf_ != nullptr, "input buffer is null");
+  ASSERT(out_buf_ != nullptr, "output buffer is null");
+
+  const std::vector<Pass> passes =
+      Plan(GetReduceLayout(shape, axis, num_axes));
+  const int region_size = GetRegionSize(passes);
+  ASSERT((passes.size() == 1) || (scratch_buf_ != nullptr),
+         "scratch buffer is null");
+
+  for (std::size_t p = 0; p < passes.size(); p++) {
+    const Pass &pass = passes[p];
+    const bool first = p == 0;
+    const bool last = p + 1 == passes.size();
+    // Passes alternate between the two scratch regions.
+    cl_mem in_buf = first ? *in_buf_ : *scratch_buf_;
+    const int in_offset = first ? in_offset_ : ((p - 1) % 2) * region_size;
+    cl_mem out_buf = last ? *out_buf_ : *scratch_buf_;
+    const int out_offset = last ? out_offset_ : (p % 2) * region_size;
+    // Only the first pass reads a strided view.
+    const ReduceLayout &layout = pass.layout;
+    const int in_outer_stride = (first && (in_outer_stride_ > 0))
+                                    ? in_outer_stride_
+                                    : layout.reduce * layout.inner;
+    const int in_reduce_stride = (first && (in_reduce_stride_ > 0))
+                                     ? in_reduce_stride_
+                                     : layout.inner;
+
+    const std::size_t global_size[wg_dim] = {
+      static_cast<std::size_t>(RoundUp(pass.layout.inner, pass.tile)),
+      static_cast<std::size_t>(pass.lanes * pass.chunks),
+      static_cast<std::size_t>(pass.layout.outer)
+    };
+    const std::size_t local_size[wg_dim] = {
+      static_cast<std::size_t>(pass.tile),
+      static_cast<std::size_t>(pass.lanes), 1
+    };
+    const std::vector<KernelArg> args{
+        in_buf, in_buf, in_offset, in_outer_stride, in_reduce_stride,
+        out_buf, out_buf, out_offset,
+        pass.layout.reduce, pass.layout.inner, pass.chunk_size,
+        static_cast<int>(reduction_),
+        static_cast<int>(!first || in_states_),
+        static_cast<int>(!last || out_states_),
+        KernelArg::LocalMemory(sizeof(cl_float4) * pass.tile * pass.lanes)};
+    SetKernelArgs(*kernel_, args);
+
+    ProfileEvent event(profiler_, "Reduce", ProfileKind::kKernel);
+    cl_int status = clEnqueueNDRangeKernel(
+        *command_queue_, *kernel_, wg_dim, nullptr, global_size, local_size,
+        0, nullptr, event.Get());
+    ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+    event.Commit(status);
+    if ((plan_ != nullptr) && plan_->IsRecording()) {
+      plan_->RecordKernel(*kernel_, args, wg_dim, global_size, local_size,
+                          "Reduce");
+    }
+  }
+
+  if (blocking) {
+    clFinish(*command_queue_);
+  }
+}
+
+void ReduceOp::Run(const std::vector<int> &shape, int axis, int num_axes,
+                   bool blocking, float *out_data) {
+  ASSERT(!out_states_, "Read states back with the buffer");
+  Run(shape, axis, num_axes, blocking);
+  const ReduceLayout layout = GetReduceLayout(shape, axis, num_axes);
+  ProfileEvent event(profiler_, "Reduce output", ProfileKind::kRead);
+  cl_int status = clEnqueueReadBuffer(
+      *command_queue_, *out_buf_, blocking, sizeof(float) * out_offset_,
+      sizeof(float) * layout.outer * layout.inner, out_data, 0, nullptr,
+      event.Get());
+  event.Commit(status);
+}
@@ -0,0 +1,178 @@
+#include "reduce_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "batchnorm.h"
+#include "memory_activation.h"
+
+namespace {
+
+const char *GetReductionName(Reduction reduction) {
+  switch (reduction) {
+    case Reduction::kSum:
+      return "sum";
+    case Reduction::kMax:
+      return "max";
+    case Reduction::kMin:
+      return "min";
+    case Reduction::kMean:
+      return "mean";
+    default:
+      return "variance";
+  }
+}
+
+// Largest error relative to the magnitude of the expected values.
+float GetRelativeError(const std::vector<float> &expected,
+                       const float *result) {
+  float scale = 1.f;
+  for (float value : expected) {
+    scale = std::max(scale, std::fabs(value));
+  }
+  return GetMaxError(expected.data(), result, expected.size()) / scale;
+}
+
+}  // namespace
+
+void RunReduceRefUnitTest() {
+  std::cout << "Reduce reference\n";
+  // [2, 3, 2]
+  const std::vector<float> in_data{1.f, -2.f, 3.f, 4.f,  5.f, 0.f,
+                                   2.f, 2.f,  6.f, -1.f, 7.f, 3.f};
+  const std::vector<int> shape{2, 3, 2};
+  struct Case {
+    int axis;
+    int num_axes;
+    Reduction reduction;
+    std::vector<float> expected;
+  };
+  const std::vector<Case> cases{
+      {1, 1, Reduction::kSum, {9.f, 2.f, 15.f, 4.f}},
+      {1, 1, Reduction::kMax, {5.f, 4.f, 7.f, 3.f}},
+      {0, 1, Reduction::kMin, {1.f, -2.f, 3.f, -1.f, 5.f, 0.f}},
+      {2, 1, Reduction::kMean, {-0.5f, 3.5f, 2.5f, 2.f, 2.5f, 5.f}},
+      {1, 2, Reduction::kMean, {11.f / 6.f, 19.f / 6.f}},
+      {1, 1, Reduction::kVariance, {8.f / 3.f, 56.f / 9.f, 14.f / 3.f,
+                                    26.f / 9.f}},
+      {0, 3, Reduction::kVariance, {83.f / 12.f}},
+  };
+
+  int num_errors = 0;
+  for (const Case &c : cases) {
+    std::vector<float> out_data;
+    RunReduceRef(in_data, out_data, shape, c.axis, c.num_axes, c.reduction);
+    if ((out_data.size() != c.expected.size()) ||
+        (GetMaxError(c.expected.data(), out_data.data(), out_data.size()) >
+         1e-5f)) {
+      num_errors++;
+    }
+  }
+  PrintResult(num_errors);
+}
+
+void RunReduceUnitTest(Workspace &ws,
+                       const std::vector<int> &shape,
+                       int axis,
+                       int num_axes,
+                       Reduction reduction) {
+  std::cout << "Reduce " << GetReductionName(reduction) << ", shape = ";
+  PrintShape(shape);
+  std::cout << ", axis = " << axis << ", num_axes = " << num_axes << '\n';
+  int size = 1;
+  for (int dim : shape) {
+    size *= dim;
+  }
+  std::vector<float> in_data(size);
+  // An offset, which sums of squares would lose the variance to.
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, 99.f));
+  std::vector<float> ref;
+  RunReduceRef(in_data, ref, shape, axis, num_axes, reduction);
+  const float tolerance =
+      (reduction == Reduction::kSum) || (reduction == Reduction::kVariance)
+          ? 1e-4f
+          : 1e-6f;
+
+  int num_errors = 0;
+  std::unique_ptr<Operator> ops[] = {
+      CreateReduce(Backend::kOpenCL, &ws, reduction, axis, num_axes),
+      CreateReduce(Backend::kCpu, nullptr, reduction, axis, num_axes)};
+  for (auto &op : ops) {
+    const bool device = op->GetBackend() == Backend::kOpenCL;
+    Tensor input(shape, device, &ws, TensorBacking::kHost);
+    Tensor output(op->InferShape(shape), device, &ws, TensorBacking::kHost);
+    std::copy(in_data.begin(), in_data.end(), input.GetData().begin());
+    op->Prepare(shape);
+    op->Run(input, output);
+    const Tensor &const_output = output;
+    if (GetRelativeError(ref, &const_output.GetData()[0]) > tolerance) {
+      num_errors++;
+    }
+  }
+  PrintResult(num_errors);
+}
+
+void RunBatchNormReduceUnitTest(Workspace &ws,
+                                const std::vector<int> &shape,
+                                BatchNormStats stats) {
+  std::cout << "BatchNorm with Reduce, shape = ";
+  PrintShape(shape);
+  std::cout << ", across batch = " << (stats == BatchNormStats::kAcrossBatch)
+            << '\n';
+  const int channels = shape[1];
+  const float eps = 1e-5f;
+  const float relu = 1.f;
+  std::vector<float> in_data(shape[0] * channels * shape[2] * shape[3]);
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 500.f, 9.f));
+  std::vector<float> weights(channels);
+  std::vector<float> biases(channels);
+  std::generate(weights.begin(), weights.end(),
+                RandomGenerator(1.f / 1000.f, 0.5f));
+  std::generate(biases.begin(), biases.end(),
+                RandomGenerator(1.f / 1000.f, -0.5f));
+  std::vector<float> ref = in_data;
+  RunBatchNormRef(ref, shape, eps, weights, biases, relu, stats);
+
+  int num_errors = 0;
+  std::unique_ptr<Operator> ops[] = {
+      CreateBatchNorm(Backend::kOpenCL, &ws, channels, eps, relu, weights,
+                      biases, stats),
+      CreateBatchNorm(Backend::kCpu, nullptr, channels, eps, relu, weights,
+                      biases, stats)};
+  for (auto &op : ops) {
+    Tensor tensor(shape, op->GetBackend() == Backend::kOpenCL, &ws,
+                  TensorBacking::kHost);
+    std::copy(in_data.begin(), in_data.end(), tensor.GetData().begin());
+    op->Prepare(shape);
+    op->Run(tensor, tensor);
+    const TensorData &out_data = tensor.GetData();
+    if (GetMaxError(ref.data(), &out_data[0], ref.size()) > 1e-3f) {
+      num_errors++;
+    }
+  }
+  PrintResult(num_errors);
+}
+
+void RunReduceTests(Workspace &ws) {
+  RunReduceRefUnitTest();
+
+  const Reduction reductions[] = {Reduction::kSum, Reduction::kMax,
+                                  Reduction::kMin, Reduction::kMean,
+                                  Reduction::kVariance};
+  for (Reduction reduction : reductions) {
+    // Contiguous rows, then columns, and a single long row that takes
+    // several passes.
+    RunReduceUnitTest(ws, {3, 17, 5, 7}, 2, 2, reduction);
+    RunReduceUnitTest(ws, {37, 100}, 0, 1, reduction);
+    RunReduceUnitTest(ws, {2, 1000, 3}, 1, 1, reduction);
+    RunReduceUnitTest(ws, {1, 300001}, 1, 1, reduction);
+  }
+
+  RunBatchNormReduceUnitTest(ws, {2, 16, 13, 11}, BatchNormStats::kPerImage);
+  RunBatchNormReduceUnitTest(ws, {3, 8, 7, 9}, BatchNormStats::kAcrossBatch);
+  RunBatchNormReduceUnitTest(ws, {1, 3, 224, 224},
+                             BatchNormStats::kAcrossBatch);
+}
@@ -0,0 +1,173 @@
+#include "roofline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <vector>
+
+#include "gemm.h"
+#include "memory_activation.h"
+#include "tensor.h"
+
+namespace {
+
+const int kCalibrationRuns = 3;
+// PeakFlops: work items, loop iterations and flops per iteration.
+const int kFlopsWorkItems = 1 << 16;
+const int kFlopsIterations = 4096;
+const int kFlopsPerIteration = 32;
+// Floats copied by the bandwidth benchmarks, large enough to miss caches.
+const int kCopySize = 1 << 24;
+const int kSgemmSize = 512;
+
+// Best wall time of fn in seconds, after a warm-up run.
+double TimeBest(const std::function<void()> &fn) {
+  fn();
+  double best = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < kCalibrationRuns; i++) {
+    auto tic = std::chrono::high_resolution_clock::now();
+    fn();
+    auto toc = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double>(toc - tic).count());
+  }
+  return best;
+}
+
+}  // namespace
+
+RooflinePeaks MeasureDevicePeaks(Workspace &ws) {
+  cl_command_queue command_queue = ws.GetCommandQueue();
+  cl_kernel flops_kernel = ws.GetKernel("/../device/roofline.cl", "PeakFlops");
+  cl_kernel bandwidth_kernel =
+      ws.GetKernel("/../device/roofline.cl", "PeakBandwidth");
+  // Device-only buffers; the results are never read back.
+  Tensor flops_out({kFlopsWorkItems}, true, &ws, TensorBacking::kHost);
+  Tensor copy_in({kCopySize}, true, &ws, TensorBacking::kHost);
+  Tensor copy_out({kCopySize}, true, &ws, TensorBacking::kHost);
+
+  const std::size_t flops_size = kFlopsWorkItems;
+  const double flops_seconds = TimeBest([&]() {
+    SetKernelArgs(flops_kernel, {flops_out.GetDeviceData(), 0.999f, 0.001f,
+                                 kFlopsIterations});
+    cl_int status = clEnqueueNDRangeKernel(command_queue, flops_kernel, 1,
+                                           nullptr, &flops_size, nullptr, 0,
+                                           nullptr, nullptr);
+    ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+    clFinish(command_queue);
+  });
+
+  const std::size_t copy_size = kCopySize / 4;
+  const double copy_seconds = TimeBest([&]() {
+    SetKernelArgs(bandwidth_kernel, {static_cast<const Tensor &>(copy_in)
+                                         .GetDeviceData(),
+                                     copy_out.GetDeviceData()});
+    cl_int status = clEnqueueNDRangeKernel(command_queue, bandwidth_kernel, 1,
+                                           nullptr, &copy_size, nullptr, 0,
+                                           nullptr, nullptr);
+    ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+    clFinish(command_queue);
+  });
+
+  const double flops = static_cast<double>(kFlopsWorkItems) *
+                       kFlopsIterations * kFlopsPerIteration;
+  const double bytes = 2.0 * sizeof(float) * kCopySize;
+  return {flops / flops_seconds * 1e-9, bytes / copy_seconds * 1e-9};
+}
+
+RooflinePeaks MeasureCpuPeaks(ThreadPool *pool) {
+  if (pool == nullptr) {
+    pool = &ThreadPool::GetDefault();
+  }
+  const int n = kSgemmSize;
+  std::vector<float> a(n * n, 1.f);
+  std::vector<float> b(n * n, 1.f);
+  std::vector<float> c(n * n);
+  const double sgemm_seconds = TimeBest([&]() {
+    RunSgemm(n, n, n, a.data(), n, b.data(), n, c.data(), n, false, pool);
+  });
+
+  // First touch from the pool, so the pages are spread like the copy.
+  std::vector<float> src(kCopySize);
+  std::vector<float> dst(kCopySize);
+  pool->ParallelFill(src.data(), src.size(), 1.f);
+  pool->ParallelFill(dst.data(), dst.size(), 0.f);
+  const double copy_seconds = TimeBest([&]() {
+    pool->ParallelFor(kCopySize, 1 << 16, [&](int begin, int end) {
+      std::memcpy(dst.data() + begin, src.data() + begin,
+                  (end - begin) * sizeof(float));
+    });
+  });
+
+  const double flops = 2.0 * n * n * n;
+  const double bytes = 2.0 * sizeof(float) * kCopySize;
+  return {flops / sgemm_seconds * 1e-9, bytes / copy_seconds * 1e-9};
+}
+
+void PrintRooflineReport(std::ostream &os,
+                         Network &network,
+                         const Profiler &profiler,
+                         const RooflinePeaks &device_peaks,
+                         const RooflinePeaks &cpu_peaks,
+                         int num_runs) {
+  ASSERT(num_runs > 0, "Number of runs");
+  // Kernel time of device layers and host time of CPU layers.
+  std::vector<double> layer_ns(network.GetNumOperators(), 0.0);
+  for (const ProfileRecord &record : profiler.GetRecords()) {
+    if ((record.layer < 0) ||
+        (record.layer >= static_cast<int>(layer_ns.size())) ||
+        (record.event != nullptr)) {
+      continue;
+    }
+    if ((record.kind == ProfileKind::kKernel) ||
+        (record.kind == ProfileKind::kHost)) {
+      layer_ns[record.layer] += static_cast<double>(record.end - record.start);
+    }
+  }
+
+  os << std::left << std::setw(6) << "Layer" << std::setw(18) << "Name"
+     << std::right << std::setw(10) << "MMAC" << std::setw(10) << "MFLOP"
+     << std::setw(8) << "MB" << std::setw(8) << "FLOP/B" << std::setw(11)
+     << "Time us" << std::setw(11) << "GFLOP/s" << std::setw(10) << "GB/s"
+     << std::setw(8) << "%FLOP" << std::setw(8) << "%BW" << std::setw(9)
+     << "Bound" << '\n';
+  os << std::fixed << std::setprecision(2);
+  for (int i = 0; i < network.GetNumOperators(); i++) {
+    const Operator &op = network.GetOperator(i);
+    const OpCost cost = op.GetCost(network.GetInShape(i));
+    const RooflinePeaks &peaks =
+        (op.GetBackend() == Backend::kOpenCL) ? device_peaks : cpu_peaks;
+    const double bytes = cost.bytes_read + cost.bytes_written;
+    const double intensity = (bytes > 0.0) ? cost.flops / bytes : 0.0;
+    // Arithmetic intensity where the two roofs meet.
+    const double ridge = peaks.gflops / peaks.bandwidth;
+    const std::string name = std::string(op.GetName()) + " (" +
+                             GetBackendName(op.GetBackend()) + ')';
+    os << std::left << std::setw(6) << i << std::setw(18) << name
+       << std::right << std::setw(10) << cost.macs * 1e-6 << std::setw(10)
+       << cost.flops * 1e-6 << std::setw(8) << bytes * 1e-6 << std::setw(8)
+       << intensity;
+    const double ns = layer_ns[i] / num_runs;
+    if (ns > 0.0) {
+      // Flops and bytes per ns are GFLOP/s and GB/s.
+      const double gflops = cost.flops / ns;
+      const double bandwidth = bytes / ns;
+      os << std::setw(11) << ns * 1e-3 << std::setw(11) << gflops
+         << std::setw(10) << bandwidth << std::setw(8)
+         << 100.0 * gflops / peaks.gflops << std::setw(8)
+         << 100.0 * bandwidth / peaks.bandwidth;
+    } else {
+      os << std::setw(11) << '-' << std::setw(11) << '-' << std::setw(10)
+         << '-' << std::setw(8) << '-' << std::setw(8) << '-';
+    }
+    os << std::setw(9) << ((intensity >= ridge) ? "compute" : "memory")
+       << '\n';
+  }
+  os << "Peaks: device " << device_peaks.gflops << " GFLOP/s, "
+     << device_peaks.bandwidth << " GB/s; host " << cpu_peaks.gflops
+     << " GFLOP/s, " << cpu_peaks.bandwidth << " GB/s\n";
+  os.unsetf(std::ios_base::floatfield);
+  os << std::setprecision(6);
+}
@@ -0,0 +1,88 @@
+#include "session.h"
+
+#include <functional>
+#include <numeric>
+#include <utility>
+
+#include "memory_activation.h"
+
+namespace {
+
+std::size_t GetShapeSize(const std::vector<int> &shape) {
+  return std::accumulate(shape.begin(), shape.end(), std::size_t(1),
+                         std::multiplies<std::size_t>());
+}
+
+}  // namespace
+
+InferenceSession::InferenceSession(std::unique_ptr<Network> network,
+                                   const std::vector<int> &in_shape,
+                                   int num_contexts)
+    : in_shape_(in_shape) {
+  ASSERT(network != nullptr, "Null network");
+  ASSERT(num_contexts >= 1, "A session needs a context");
+  Workspace *ws = network->GetWorkspace();
+  contexts_.resize(num_contexts);
+  for (int i = 1; i < num_contexts; i++) {
+    // CPU-only networks need no workspace.
+    if (ws != nullptr) {
+      contexts_[i].ws.reset(new Workspace(*ws));
+    }
+    contexts_[i].network = network->Clone(contexts_[i].ws.get());
+  }
+  contexts_[0].network = std::move(network);
+  for (int i = num_contexts - 1; i >= 0; i--) {
+    contexts_[i].network->Prepare(in_shape_);
+    free_contexts_.push_back(i);
+  }
+}
+
+InferenceSession::~InferenceSession() {}
+
+void InferenceSession::Run(const std::vector<float> &in_data,
+                           std::vector<float> &out_data) {
+  const int idx = AcquireContext();
+  try {
+    contexts_[idx].network->Run(in_data, out_data);
+  } catch (...) {
+    ReleaseContext(idx);
+    throw;
+  }
+  ReleaseContext(idx);
+}
+
+int InferenceSession::GetNumContexts() const {
+  return contexts_.size();
+}
+
+const std::vector<int> &InferenceSession::GetInShape() const {
+  return in_shape_;
+}
+
+const std::vector<int> &InferenceSession::GetOutShape() const {
+  return contexts_.front().network->GetOutShape();
+}
+
+std::size_t InferenceSession::GetInSize() const {
+  return GetShapeSize(in_shape_);
+}
+
+std::size_t InferenceSession::GetOutSize() const {
+  return GetShapeSize(GetOutShape());
+}
+
+int InferenceSession::AcquireContext() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return !free_contexts_.empty(); });
+  const int idx = free_contexts_.back();
+  free_contexts_.pop_back();
+  return idx;
+}
+
+void InferenceSession::ReleaseContext(int idx) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_contexts_.push_back(idx);
+  }
+  cv_.notify_one();
+}
@@ -0,0 +1,82 @@
+#include "softmax.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "memory_activation.h"
+
+namespace {
+
+void RunSoftmaxRow(float *row, int classes) {
+  const float max_value = *std::max_element(row, row + classes);
+  float sum = 0.f;
+  for (int i = 0; i < classes; i++) {
+    row[i] = std::exp(row[i] - max_value);
+    sum += row[i];
+  }
+  const float inv_sum = 1.f / sum;
+  for (int i = 0; i < classes; i++) {
+    row[i] *= inv_sum;
+  }
+}
+
+}  // namespace
+
+void RunSoftmaxRef(float *tensor, int batch, int classes) {
+  for (int n = 0; n < batch; n++) {
+    RunSoftmaxRow(tensor + n * classes, classes);
+  }
+}
+
+void RunSoftmaxRef(std::vector<float> &tensor, int batch, int classes) {
+  ASSERT(tensor.size() >= static_cast<std::size_t>(batch) * classes,
+         "Tensor is too small");
+  RunSoftmaxRef(tensor.data(), batch, classes);
+}
+
+void RunSoftmaxCpu(float *tensor, int batch, int classes, ThreadPool *pool) {
+  if (pool == nullptr) {
+    pool = &ThreadPool::GetDefault();
+  }
+  pool->ParallelFor(batch, 1, [&](int begin, int end) {
+    for (int n = begin; n < end; n++) {
+      RunSoftmaxRow(tensor + n * classes, classes);
+    }
+  });
+}
+
+void RunTopKRef(const float *in_data,
+                int batch,
+                int classes,
+                int k,
+                bool softmax,
+                float *scores,
+                int *ids) {
+  ASSERT((k >= 1) && (k <= classes), "k must be in [1, classes]");
+  std::vector<int> order(classes);
+  for (int n = 0; n < batch; n++) {
+    const float *row = in_data + n * classes;
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(order.begin(), order.begin() + k, order.end(),
+                      [row](int a, int b) {
+                        return (row[a] > row[b]) ||
+                               ((row[a] == row[b]) && (a < b));
+                      });
+    float max_value = 0.f;
+    float sum = 1.f;
+    if (softmax) {
+      max_value = row[order[0]];
+      sum = 0.f;
+      for (int i = 0; i < classes; i++) {
+        sum += std::exp(row[i] - max_value);
+      }
+    }
+    for (int j = 0; j < k; j++) {
+      const float score = row[order[j]];
+      scores[n * k + j] =
+          softmax ? std::exp(score - max_value) / sum : score;
+      ids[n * k + j] = order[j];
+    }
+  }
+}
@@ -0,0 +1,192 @@
+#include "softmax_op.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#include "memory_activation.h"
+
+namespace {
+
+// A work-group per image, sized to a power of two up to max_size, so that
+// small rows don't leave most of it idle.
+std::size_t GetWorkGroupSize(int classes, int max_size) {
+  int size = 1;
+  while ((size < classes) && (size < max_size)) {
+    size *= 2;
+  }
+  return size;
+}
+
+int GetClasses(const std::vector<int> &shape) {
+  ASSERT(shape.size() >= 2, "Expects a batch of at least 1D images");
+  return std::accumulate(shape.begin() + 1, shape.end(), 1,
+                         std::multiplies<int>());
+}
+
+}  // namespace
+
+SoftmaxOp::SoftmaxOp(cl_kernel *kernel, cl_command_queue *command_queue,
+                     cl_mem *tensor_buf)
+    : kernel_(kernel),
+      command_queue_(command_queue),
+      tensor_buf_(tensor_buf),
+      plan_(nullptr),
+      profiler_(nullptr) {}
+
+void SoftmaxOp::SetTensorBuffer(cl_mem *buf) {
+  tensor_buf_ = buf;
+}
+
+void SoftmaxOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
+
+void SoftmaxOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+void SoftmaxOp::Run(const std::vector<int> &shape, bool blocking) {
+  const static cl_uint wg_dim = 2;
+  const static int max_wg_size = 256;
+
+  ASSERT(tensor_buf_ != nullptr, "tensor buffer is null");
+
+  const int batch = shape[0];
+  const int classes = GetClasses(shape);
+  const std::size_t wg_size = GetWorkGroupSize(classes, max_wg_size);
+  const std::size_t global_size[wg_dim] = {
+    wg_size, static_cast<std::size_t>(batch)
+  };
+  const std::size_t local_size[wg_dim] = {wg_size, 1};
+
+  const std::vector<KernelArg> args{
+      *tensor_buf_, classes,
+      KernelArg::LocalMemory(sizeof(cl_float4) * wg_size)};
+  SetKernelArgs(*kernel_, args);
+
+  ProfileEvent event(profiler_, "Softmax", ProfileKind::kKernel);
+  cl_int status = clEnqueueNDRangeKernel(*command_queue_, *kernel_, wg_dim,
+                                         nullptr, global_size, local_size, 0,
+                                         nullptr, event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(*kernel_, args, wg_dim, global_size, local_size,
+                        "Softmax");
+  }
+
+  if (blocking) {
+    clFinish(*command_queue_);
+  }
+}
+
+void SoftmaxOp::Run(const std::vector<int> &shape, bool blocking,
+                    float *out_data) {
+  Run(shape, blocking);
+  std::size_t raw_tensor_size = sizeof(float) * shape[0] * GetClasses(shape);
+  ProfileEvent event(profiler_, "Softmax output", ProfileKind::kRead);
+  cl_int status =
+      clEnqueueReadBuffer(*command_queue_, *tensor_buf_, blocking, 0,
+                          raw_tensor_size, out_data, 0, nullptr, event.Get());
+  event.Commit(status);
+}
+
+TopKOp::TopKOp(int k, bool softmax, cl_kernel *kernel,
+               cl_command_queue *command_queue, cl_mem *in_buf,
+               cl_mem *scores_buf, cl_mem *ids_buf)
+    : k_(k),
+      softmax_(softmax),
+      kernel_(kernel),
+      command_queue_(command_queue),
+      in_buf_(in_buf),
+      scores_buf_(scores_buf),
+      ids_buf_(ids_buf),
+      plan_(nullptr),
+      profiler_(nullptr) {
+  ASSERT((k_ >= 1) && (k_ <= kMaxK), "k must be in [1, 16]");
+}
+
+void TopKOp::SetInBuffer(cl_mem *buf) {
+  in_buf_ = buf;
+}
+
+void TopKOp::SetScoresBuffer(cl_mem *buf) {
+  scores_buf_ = buf;
+}
+
+void TopKOp::SetIdsBuffer(cl_mem *buf) {
+  ids_buf_ = buf;
+}
+
+void TopKOp::SetExecutionPlan(ExecutionPlan *plan) {
+  plan_ = plan;
+}
+
+void TopKOp::SetProfiler(Profiler *profiler) {
+  profiler_ = profiler;
+}
+
+void TopKOp::Run(const std::vector<int> &shape, bool blocking) {
+  const static cl_uint wg_dim = 2;
+  // Each work item keeps k candidates in local memory, so the work-group is
+  // kept small.
+  const static int max_wg_size = 64;
+
+  ASSERT(in_buf_ != nullptr, "input buffer is null");
+  ASSERT(scores_buf_ != nullptr, "scores buffer is null");
+  ASSERT(ids_buf_ != nullptr, "ids buffer is null");
+
+  const int batch = shape[0];
+  const int classes = GetClasses(shape);
+  ASSERT(k_ <= classes, "k is larger than the number of classes");
+  const std::size_t wg_size = GetWorkGroupSize(classes, max_wg_size);
+  const std::size_t global_size[wg_dim] = {
+    wg_size, static_cast<std::size_t>(batch)
+  };
+  const std::size_t local_size[wg_dim] = {wg_size, 1};
+
+  const std::vector<KernelArg> args{
+      *in_buf_, *scores_buf_, *ids_buf_, classes, k_,
+      static_cast<int>(softmax_),
+      KernelArg::LocalMemory(sizeof(float) * wg_size * k_),
+      KernelArg::LocalMemory(sizeof(int) * wg_size * k_),
+      KernelArg::LocalMemory(sizeof(cl_float4) * wg_size)};
+  SetKernelArgs(*kernel_, args);
+
+  ProfileEvent event(profiler_, "TopK", ProfileKind::kKernel);
+  cl_int status = clEnqueueNDRangeKernel(*command_queue_, *kernel_, wg_dim,
+                                         nullptr, global_size, local_size, 0,
+                                         nullptr, event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to launch the kernel");
+  event.Commit(status);
+  if ((plan_ != nullptr) && plan_->IsRecording()) {
+    plan_->RecordKernel(*kernel_, args, wg_dim, global_size, local_size,
+                        "TopK");
+  }
+
+  if (blocking) {
+    clFinish(*command_queue_);
+  }
+}
+
+void TopKOp::Run(const std::vector<int> &shape, bool blocking, float *scores,
+                 int *ids) {
+  Run(shape, false);
+  const std::size_t count = shape[0] * k_;
+  cl_int status;
+  {
+    ProfileEvent event(profiler_, "TopK scores", ProfileKind::kRead);
+    status = clEnqueueReadBuffer(*command_queue_, *scores_buf_, CL_FALSE, 0,
+                                 sizeof(float) * count, scores, 0, nullptr,
+                                 event.Get());
+    ASSERT(status == CL_SUCCESS, "Failed to read the scores");
+    event.Commit(status);
+  }
+  ProfileEvent event(profiler_, "TopK ids", ProfileKind::kRead);
+  status = clEnqueueReadBuffer(*command_queue_, *ids_buf_, blocking, 0,
+                               sizeof(int) * count, ids, 0, nullptr,
+                               event.Get());
+  ASSERT(status == CL_SUCCESS, "Failed to read the ids");
+  event.Commit(status);
+}
@@ -0,0 +1,99 @@
+#include "softmax_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "memory_activation.h"
+
+void RunSoftmaxUnitTest(Workspace &ws, int batch, int classes) {
+  std::cout << "Softmax, batch = " << batch << ", classes = " << classes
+            << '\n';
+  const std::vector<int> shape{batch, classes};
+  std::vector<float> in_data(batch * classes);
+  // Logits up to 100, which overflow exp without the max subtracted.
+  std::generate(in_data.begin(), in_data.end(),
+                RandomGenerator(1.f / 5.f, -100.f));
+  std::vector<float> ref = in_data;
+  RunSoftmaxRef(ref, batch, classes);
+
+  int num_errors = 0;
+  std::unique_ptr<Operator> ops[] = {CreateSoftmax(Backend::kOpenCL, &ws),
+                                     CreateSoftmax(Backend::kCpu, nullptr)};
+  for (auto &op : ops) {
+    Tensor tensor(shape, op->GetBackend() == Backend::kOpenCL, &ws,
+                  TensorBacking::kHost);
+    std::copy(in_data.begin(), in_data.end(), tensor.GetData().begin());
+    op->Prepare(shape);
+    op->Run(tensor, tensor);
+    const TensorData &out_data = tensor.GetData();
+    if (GetMaxError(ref.data(), &out_data[0], ref.size()) > 1e-5f) {
+      num_errors++;
+    }
+  }
+  PrintResult(num_errors);
+}
+
+void RunTopKUnitTest(Workspace &ws,
+                     int batch,
+                     int classes,
+                     int k,
+                     bool softmax) {
+  std::cout << "TopK, batch = " << batch << ", classes = " << classes
+            << ", k = " << k << ", softmax = " << softmax << '\n';
+  std::vector<float> in_data(batch * classes);
+  // Few distinct values, so that ties are common.
+  std::generate(in_data.begin(), in_data.end(),
+                []() { return static_cast<float>(rand() % 50) / 5.f; });
+  std::vector<float> ref_scores(batch * k);
+  std::vector<int> ref_ids(batch * k);
+  RunTopKRef(in_data.data(), batch, classes, k, softmax, ref_scores.data(),
+             ref_ids.data());
+
+  int num_errors = 0;
+  // The reference against a full softmax and sort.
+  std::vector<float> probs = in_data;
+  if (softmax) {
+    RunSoftmaxRef(probs, batch, classes);
+  }
+  for (int n = 0; n < batch; n++) {
+    std::vector<float> row(probs.begin() + n * classes,
+                           probs.begin() + (n + 1) * classes);
+    std::sort(row.begin(), row.end(), std::greater<float>());
+    for (int j = 0; j < k; j++) {
+      const int id = ref_ids[n * k + j];
+      if ((std::fabs(row[j] - ref_scores[n * k + j]) > 1e-6f) ||
+          (std::fabs(probs[n * classes + id] - ref_scores[n * k + j]) >
+           1e-6f)) {
+        num_errors++;
+      }
+    }
+  }
+
+  Tensor tensor({batch, classes}, true, &ws, TensorBacking::kHost);
+  std::copy(in_data.begin(), in_data.end(), tensor.GetData().begin());
+  TopKReader reader(ws, k, softmax);
+  const std::vector<std::vector<Prediction>> predictions = reader.Run(tensor);
+  for (int n = 0; n < batch; n++) {
+    for (int j = 0; j < k; j++) {
+      const Prediction &prediction = predictions[n][j];
+      if ((prediction.id != ref_ids[n * k + j]) ||
+          (std::fabs(prediction.score - ref_scores[n * k + j]) > 1e-5f)) {
+        num_errors++;
+      }
+    }
+  }
+  PrintResult(num_errors);
+}
+
+void RunSoftmaxTests(Workspace &ws) {
+  RunSoftmaxUnitTest(ws, 1, 1000);
+  RunSoftmaxUnitTest(ws, 4, 10);
+  RunSoftmaxUnitTest(ws, 3, 1001);
+
+  RunTopKUnitTest(ws, 1, 1000, 5, true);
+  RunTopKUnitTest(ws, 4, 1000, 5, false);
+  RunTopKUnitTest(ws, 2, 37, 16, true);
+  RunTopKUnitTest(ws, 3, 5, 5, false);
+}
@@ -0,0 +1,225 @@
+#include "stream_runner.h"
+
+#include <algorithm>
+
+#include "memory_activation.h"
+
+namespace {
+
+// Device buffer and pinned host staging of size floats. The staging stays
+// mapped, so the transfers from and to it can run as DMA.
+cl_mem CreateBuffer(Workspace &ws, std::size_t size) {
+  cl_int status;
+  cl_mem buf = clCreateBuffer(ws.GetContext(), CL_MEM_READ_WRITE,
+                              sizeof(float) * size, nullptr, &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create a stream buffer");
+  return buf;
+}
+
+cl_mem CreateStaging(Workspace &ws, std::size_t size, cl_map_flags flags,
+                     float **ptr) {
+  cl_int status;
+  cl_mem buf = clCreateBuffer(ws.GetContext(),
+                              CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
+                              sizeof(float) * size, nullptr, &status);
+  ASSERT(status == CL_SUCCESS, "Failed to create a staging buffer");
+  *ptr = static_cast<float *>(clEnqueueMapBuffer(
+      ws.GetCommandQueue(), buf, CL_TRUE, flags, 0, sizeof(float) * size, 0,
+      nullptr, nullptr, &status));
+  ASSERT(status == CL_SUCCESS, "Failed to map a staging buffer");
+  return buf;
+}
+
+}  // namespace
+
+StreamRunner::StreamRunner(Network &network, int depth)
+    : network_(&network),
+      ws_(network.GetWorkspace()),
+      upload_queue_(nullptr),
+      readback_queue_(nullptr),
+      head_(0),
+      num_in_flight_(0),
+      next_frame_(0) {
+  ASSERT(ws_ != nullptr, "Streaming needs a workspace");
+  ASSERT(depth >= 1, "The ring needs a slot");
+  const int num_ops = network.GetNumOperators();
+  ASSERT((network.GetOperator(0).GetBackend() == Backend::kOpenCL) &&
+             (network.GetOperator(num_ops - 1).GetBackend() ==
+              Backend::kOpenCL),
+         "The first and last operators must run on the device");
+  ASSERT((network.GetInput().GetBacking() != TensorBacking::kSvm) &&
+             (network.GetOutput().GetBacking() != TensorBacking::kSvm),
+         "Streaming copies buffers, not SVM");
+  in_size_ = network.GetInput().GetSize();
+  out_size_ = network.GetOutput().GetSize();
+  upload_queue_ = ws_->AcquireCommandQueue();
+  readback_queue_ = ws_->AcquireCommandQueue();
+
+  slots_.resize(depth);
+  for (Slot &slot : slots_) {
+    slot.in_buf = CreateBuffer(*ws_, in_size_);
+    slot.out_buf = CreateBuffer(*ws_, out_size_);
+    slot.in_staging =
+        CreateStaging(*ws_, in_size_, CL_MAP_WRITE, &slot.in_host);
+    slot.out_staging =
+        CreateStaging(*ws_, out_size_, CL_MAP_READ, &slot.out_host);
+    slot.upload = nullptr;
+    slot.compute = nullptr;
+    slot.readback = nullptr;
+    slot.frame = -1;
+  }
+}
+
+StreamRunner::~StreamRunner() {
+  clFinish(upload_queue_);
+  ws_->FinishCommandQueue();
+  clFinish(readback_queue_);
+  for (Slot &slot : slots_) {
+    ReleaseEvent(&slot.upload);
+    ReleaseEvent(&slot.compute);
+    ReleaseEvent(&slot.readback);
+    clEnqueueUnmapMemObject(ws_->GetCommandQueue(), slot.in_staging,
+                            slot.in_host, 0, nullptr, nullptr);
+    clEnqueueUnmapMemObject(ws_->GetCommandQueue(), slot.out_staging,
+                            slot.out_host, 0, nullptr, nullptr);
+  }
+  ws_->FinishCommandQueue();
+  for (Slot &slot : slots_) {
+    clReleaseMemObject(slot.in_buf);
+    clReleaseMemObject(slot.out_buf);
+    clReleaseMemObject(slot.in_staging);
+    clReleaseMemObject(slot.out_staging);
+  }
+  ws_->ReleaseCommandQueue(upload_queue_);
+  ws_->ReleaseCommandQueue(readback_queue_);
+}
+
+int StreamRunner::GetDepth() const {
+  return slots_.size();
+}
+
+int StreamRunner::GetNumInFlight() const {
+  return num_in_flight_;
+}
+
+bool StreamRunner::IsFull() const {
+  return num_in_flight_ == static_cast<int>(slots_.size());
+}
+
+bool StreamRunner::IsEmpty() const {
+  return num_in_flight_ == 0;
+}
+
+std::size_t StreamRunner::GetInSize() const {
+  return in_size_;
+}
+
+std::size_t StreamRunner::GetOutSize() const {
+  return out_size_;
+}
+
+void StreamRunner::Push(const float *frame) {
+  ASSERT(!IsFull(), "All slots are in flight, pop a result first");
+  Slot &slot = slots_[(head_ + num_in_flight_) % slots_.size()];
+  std::copy(frame, frame + in_size_, slot.in_host);
+  Enqueue();
+}
+
+void StreamRunner::Push(const std::vector<float> &frame) {
+  ASSERT(frame.size() >= in_size_, "Frame doesn't have enough data");
+  Push(frame.data());
+}
+
+std::int64_t StreamRunner::Pop(std::vector<float> &out_data) {
+  Slot &slot = WaitOldest();
+  out_data.assign(slot.out_host, slot.out_host + out_size_);
+  return slot.frame;
+}
+
+void StreamRunner::Run(
+    std::int64_t num_frames,
+    const std::function<void(std::int64_t, float *)> &fill,
+    const std::function<void(std::int64_t, const float *)> &done) {
+  for (std::int64_t i = 0; i < num_frames; i++) {
+    if (IsFull()) {
+      Slot &slot = WaitOldest();
+      done(slot.frame, slot.out_host);
+    }
+    fill(i, slots_[(head_ + num_in_flight_) % slots_.size()].in_host);
+    Enqueue();
+  }
+  while (!IsEmpty()) {
+    Slot &slot = WaitOldest();
+    done(slot.frame, slot.out_host);
+  }
+}
+
+void StreamRunner::Enqueue() {
+  Slot &slot = slots_[(head_ + num_in_flight_) % slots_.size()];
+  ReleaseEvent(&slot.upload);
+  ReleaseEvent(&slot.compute);
+  ReleaseEvent(&slot.readback);
+  Profiler *profiler = ws_->GetProfiler();
+  cl_command_queue compute_queue = ws_->GetCommandQueue();
+  cl_int status;
+
+  // Upload.
+  {
+    ProfileEvent event(profiler, "Stream upload", ProfileKind::kWrite,
+                       &slot.upload);
+    status = clEnqueueWriteBuffer(upload_queue_, slot.in_buf, CL_FALSE, 0,
+                                  sizeof(float) * in_size_, slot.in_host, 0,
+                                  nullptr, event.Get());
+    ASSERT(status == CL_SUCCESS, "Failed to upload the frame");
+    event.Commit(status);
+  }
+  clFlush(upload_queue_);
+
+  // Compute, between copies in and out of the network's tensors. The
+  // compute queue is in order, so the next frame's copy in waits for this
+  // frame's copy out.
+  status = clEnqueueCopyBuffer(compute_queue, slot.in_buf,
+                               network_->GetInput().GetDeviceData(), 0, 0,
+                               sizeof(float) * in_size_, 1, &slot.upload,
+                               nullptr);
+  ASSERT(status == CL_SUCCESS, "Failed to copy the frame in");
+  network_->Run();
+  const Tensor &output = network_->GetOutput();
+  status = clEnqueueCopyBuffer(compute_queue, output.GetDeviceData(),
+                               slot.out_buf, 0, 0, sizeof(float) * out_size_,
+                               0, nullptr, &slot.compute);
+  ASSERT(status == CL_SUCCESS, "Failed to copy the result out");
+  clFlush(compute_queue);
+
+  // Readback.
+  {
+    ProfileEvent event(profiler, "Stream readback", ProfileKind::kRead,
+                       &slot.readback);
+    status = clEnqueueReadBuffer(readback_queue_, slot.out_buf, CL_FALSE, 0,
+                                 sizeof(float) * out_size_, slot.out_host, 1,
+                                 &slot.compute, event.Get());
+    ASSERT(status == CL_SUCCESS, "Failed to read the result back");
+    event.Commit(status);
+  }
+  clFlush(readback_queue_);
+
+  slot.frame = next_frame_++;
+  num_in_flight_++;
+}
+
+StreamRunner::Slot &StreamRunner::WaitOldest() {
+  ASSERT(!IsEmpty(), "No frame in flight");
+  Slot &slot = slots_[head_];
+  cl_int status = clWaitForEvents(1, &slot.readback);
+  ASSERT(status == CL_SUCCESS, "Failed to wait for the readback");
+  head_ = (head_ + 1) % slots_.size();
+  num_in_flight_--;
+  return slot;
+}
+
+void StreamRunner::ReleaseEvent(cl_event *event) {
+  if (*event != nullptr) {
+    clReleaseEvent(*event);
+    *event = nullptr;
+  }
+}
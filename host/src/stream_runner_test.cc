@@ -0,0 +1,112 @@
+#include "stream_runner_test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "memory_activation.h"
+
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::microseconds;
+
+void RunStreamRunnerUnitTest(Workspace &ws,
+                             const int in_height,
+                             const int in_width,
+                             int depth,
+                             int num_frames,
+                             bool enable_timing) {
+  std::cout << "in_height = " << in_height << ", in_width = " << in_width
+            << ", depth = " << depth << ", num_frames = " << num_frames
+            << '\n';
+
+  const int max_channels = 64;
+  const int kernel_size = 3;
+  std::vector<float> kernel_data(max_channels * max_channels * kernel_size *
+                                 kernel_size);
+  std::vector<float> weight_data(max_channels);
+  std::vector<float> bias_data(max_channels);
+  std::generate(kernel_data.begin(), kernel_data.end(),
+                RandomGenerator(1.f / 500.f, -1.f));
+  std::generate(weight_data.begin(), weight_data.end(),
+                RandomGenerator(1.f / 10000.f, 1.f));
+  std::generate(bias_data.begin(), bias_data.end(),
+                RandomGenerator(1.f / 10000.f, 0.f));
+
+  Network network(&ws);
+  AddModelLayers(network, &ws, kernel_data, weight_data, bias_data);
+  network.Prepare({1, 3, in_height, in_width});
+  const int in_size = network.GetInput().GetSize();
+  const int out_size = network.GetOutput().GetSize();
+  std::vector<std::vector<float>> frames(num_frames);
+  for (auto &frame : frames) {
+    frame.resize(in_size);
+    std::generate(frame.begin(), frame.end(),
+                  RandomGenerator(1.f / 500.f, -1.f));
+  }
+
+  // Each frame on its own, every stage waiting for the previous one.
+  std::vector<std::vector<float>> refs(num_frames);
+  auto tic = high_resolution_clock::now();
+  for (int i = 0; i < num_frames; i++) {
+    refs[i].resize(out_size);
+    network.Run(frames[i], refs[i]);
+  }
+  auto toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Serial took "
+              << duration_cast<microseconds>(toc - tic).count() / num_frames
+              << " us per frame\n";
+  }
+
+  int num_errors = 0;
+  std::int64_t next = 0;
+  StreamRunner runner(network, depth);
+  tic = high_resolution_clock::now();
+  runner.Run(
+      num_frames,
+      [&](std::int64_t i, float *data) {
+        std::copy(frames[i].begin(), frames[i].end(), data);
+      },
+      [&](std::int64_t i, const float *result) {
+        if ((i != next++) ||
+            (GetMaxError(refs[i].data(), result, out_size) > 1e-3f)) {
+          num_errors++;
+        }
+      });
+  toc = high_resolution_clock::now();
+  if (enable_timing) {
+    std::cout << "Streamed took "
+              << duration_cast<microseconds>(toc - tic).count() / num_frames
+              << " us per frame\n";
+  }
+
+  // The push/pop interface on the same runner.
+  std::vector<float> out_data;
+  for (int i = 0; i < num_frames; i++) {
+    if (runner.IsFull()) {
+      const std::int64_t frame = runner.Pop(out_data);
+      if (GetMaxError(refs[frame % num_frames].data(), out_data.data(),
+                      out_size) > 1e-3f) {
+        num_errors++;
+      }
+    }
+    runner.Push(frames[i]);
+  }
+  while (!runner.IsEmpty()) {
+    const std::int64_t frame = runner.Pop(out_data);
+    if (GetMaxError(refs[frame % num_frames].data(), out_data.data(),
+                    out_size) > 1e-3f) {
+      num_errors++;
+    }
+  }
+
+  PrintResult(num_errors);
+}
+
+void RunStreamRunnerTests(Workspace &ws, bool enable_timing) {
+  RunStreamRunnerUnitTest(ws, 16, 16, 1, 8, enable_timing);
+  RunStreamRunnerUnitTest(ws, 64, 64, 3, 32, enable_timing);
+  RunStreamRunnerUnitTest(ws, 37, 53, 4, 17, enable_timing);
+}
@@ -1,47 +1,153 @@
 #include "tensor.h"
 
 #include <algorithm>
+#include <atomic>
 #include <ctime>
 #include <functional>
 #include <iostream>
 #include <numeric>
+#include <random>
 #include <string>
+#include <utility>
 
 #include "memory_activation.h"
+#include "thread_pool.h"
+
+// Intel GPUs only share a USE_HOST_PTR buffer without a copy if its size is
+// a multiple of the cache line.
+const cl_uint kZeroCopySizeMultiple = 64;
 
 Tensor::Tensor(const std::vector<int> &shape, bool allocate_device,
-               Workspace *ws)
-    : shape_(shape), has_device_data_(allocate_device) {
-  size_ = std::accumulate(shape.begin(), shape.end(), 1,
+               Workspace *ws, TensorBacking backing, int halo)
+    : shape_(shape),
+      halo_(halo),
+      ws_(ws),
+      backing_(ResolveBacking(backing, ws)),
+      svm_fine_grain_((backing_ == TensorBacking::kSvm) &&
+                      ws->SupportsFineGrainSvm()),
+      data_(GetAllocator()),
+      host_allocated_(false),
+      has_device_data_(false),
+      device_data_(nullptr),
+      host_valid_(true),
+      dirty_begin_(0),
+      dirty_end_(0),
+      mapped_(false),
+      map_flags_(0) {
+  ASSERT(halo >= 0, "Halo is negative");
+  ASSERT((halo == 0) || (shape.size() == 4), "Only 4D tensors have a halo");
+  const std::vector<int> storage_shape = GetStorageShape();
+  size_ = std::accumulate(storage_shape.begin(), storage_shape.end(), 1,
                           std::multiplies<int>());
-  data_.resize(size_, 0.f);
   if (allocate_device) {
     ASSERT(ws != nullptr, "Workspace is null");
-    device_data_ = clCreateBuffer(ws->GetContext(), CL_MEM_READ_WRITE,
-                                  size_ * sizeof(float), nullptr, nullptr);
+  }
+  if (!allocate_device || (backing_ != TensorBacking::kHost)) {
+    InitStorage();
+    AllocateHost();
+  }
+  if (allocate_device) {
+    CreateDeviceBuffer(*ws, false);
   }
 }
 
 Tensor::Tensor(const std::vector<int> &shape, std::ifstream &is,
-               bool allocate_device, Workspace *ws)
-    : shape_(shape), has_device_data_(allocate_device) {
+               bool allocate_device, Workspace *ws, TensorBacking backing)
+    : shape_(shape),
+      halo_(0),
+      ws_(ws),
+      backing_(ResolveBacking(backing, ws)),
+      svm_fine_grain_((backing_ == TensorBacking::kSvm) &&
+                      ws->SupportsFineGrainSvm()),
+      data_(GetAllocator()),
+      host_allocated_(false),
+      has_device_data_(false),
+      device_data_(nullptr),
+      host_valid_(true),
+      dirty_begin_(0),
+      dirty_end_(0),
+      mapped_(false),
+      map_flags_(0) {
   size_ = std::accumulate(shape.begin(), shape.end(), 1,
                           std::multiplies<int>());
   std::size_t raw_size = size_ * sizeof(float);
+  InitStorage();
   data_.resize(size_);
+  host_allocated_ = true;
   is.read(reinterpret_cast<char *>(&data_[0]), raw_size);
   if (allocate_device) {
     ASSERT(ws != nullptr, "Workspace is null");
-    device_data_ = clCreateBuffer(ws->GetContext(),
-                                  CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                                  raw_size, data_.data(), nullptr);
+    CreateDeviceBuffer(*ws, true);
   }
 }
 
+Tensor::Tensor(Tensor &&other)
+    : shape_(std::move(other.shape_)),
+      halo_(other.halo_),
+      size_(other.size_),
+      ws_(other.ws_),
+      backing_(other.backing_),
+      svm_fine_grain_(other.svm_fine_grain_),
+      data_(std::move(other.data_)),
+      host_allocated_(other.host_allocated_),
+      has_device_data_(other.has_device_data_),
+      device_data_(other.device_data_),
+      host_valid_(other.host_valid_),
+      dirty_begin_(other.dirty_begin_),
+      dirty_end_(other.dirty_end_),
+      mapped_(other.mapped_),
+      map_flags_(other.map_flags_) {
+  other.Detach();
+}
+
+Tensor &Tensor::operator=(Tensor &&other) {
+  if (this != &other) {
+    ReleaseStorage();
+    shape_ = std::move(other.shape_);
+    halo_ = other.halo_;
+    size_ = other.size_;
+    ws_ = other.ws_;
+    backing_ = other.backing_;
+    svm_fine_grain_ = other.svm_fine_grain_;
+    // The allocator propagates, so the storage itself changes hands and a
+    // device buffer wrapping it stays valid.
+    data_ = std::move(other.data_);
+    host_allocated_ = other.host_allocated_;
+    has_device_data_ = other.has_device_data_;
+    device_data_ = other.device_data_;
+    host_valid_ = other.host_valid_;
+    dirty_begin_ = other.dirty_begin_;
+    dirty_end_ = other.dirty_end_;
+    mapped_ = other.mapped_;
+    map_flags_ = other.map_flags_;
+    other.Detach();
+  }
+  return *this;
+}
+
 Tensor::~Tensor() {
-  if (has_device_data_) {
-    clReleaseMemObject(device_data_);
+  ReleaseStorage();
+}
+
+const std::vector<int> &Tensor::GetShape() const {
+  return shape_;
+}
+
+int Tensor::GetSize() const {
+  return size_;
+}
+
+int Tensor::GetHalo() const {
+  return halo_;
+}
+
+std::vector<int> Tensor::GetStorageShape() const {
+  std::vector<int> shape = shape_;
+  if (halo_ > 0) {
+    shape[2] += 2 * halo_;
+    shape[3] += 2 * halo_;
   }
+  return shape;
 }
 
 float &Tensor::Get(const std::vector<int> &coord) {
@@ -55,6 +161,7 @@ float &Tensor::Get(const std::vector<int> &coord) {
   }
   int idx = std::accumulate(coord.begin(), coord.end(), 1,
                             std::multiplies<int>());
+  AccessHost(true, idx, idx + 1);
   return data_[idx];
 }
 
@@ -70,86 +177,93 @@ const float &Tensor::Get(const std::vector<int> &coord) const {
   }
   int idx = std::accumulate(coord.begin(), coord.end(), 1,
                             std::multiplies<int>());
+  AccessHost(false, 0, 0);
   return data_[idx];
 }
 
 float &Tensor::Get(int idx) {
   ASSERT(idx >= 0, "Index is negative");
   ASSERT(idx < size_, "Index out of range");
+  AccessHost(true, idx, idx + 1);
   return data_[idx];
 }
 
 const float &Tensor::Get(int idx) const {
   ASSERT(idx >= 0, "Index is negative");
   ASSERT(idx < size_, "Index out of range");
+  AccessHost(false, 0, 0);
   return data_[idx];
 }
 
 float &Tensor::operator[](int idx) {
   ASSERT(idx >= 0, "Index is negative");
   ASSERT(idx < size_, "Index out of range");
+  AccessHost(true, idx, idx + 1);
   return data_[idx];
 }
 
 const float &Tensor::operator[](int idx) const {
   ASSERT(idx >= 0, "Index is negative");
   ASSERT(idx < size_, "Index out of range");
+  AccessHost(false, 0, 0);
   return data_[idx];
 }
 
-std::vector<float> &Tensor::GetData() {
+TensorData &Tensor::GetData() {
+  AccessHost(true, 0, size_);
   return data_;
 }
 
-const std::vector<float> &Tensor::GetData() const {
+const TensorData &Tensor::GetData() const {
+  AccessHost(false, 0, 0);
   return data_;
 }
 
 void Tensor::AllocateDevice(Workspace &ws, bool copy_host, cl_bool blocking,
                             cl_uint num_events_in_wait_list,
                             const cl_event *event_wait_list, cl_event *event) {
-  int status;
-  std::size_t raw_size = size_ * sizeof(float);
   if (!has_device_data_) {
-    if (copy_host) {
-      device_data_ = clCreateBuffer(
-          ws.GetContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-          raw_size, data_.data(), &status);
-    } else {
-      device_data_ = clCreateBuffer(ws.GetContext(), CL_MEM_READ_WRITE,
-                                    raw_size, nullptr, &status);
-    }
-    has_device_data_ = true;
-  } else {
-    if (copy_host) {
-      status = clEnqueueWriteBuffer(
-          ws.GetCommandQueue(),
-          device_data_,
-          blocking,
-          0,
-          raw_size,
-          data_.data(),
-          num_events_in_wait_list,
-          event_wait_list, event);
-    }
+    CreateDeviceBuffer(ws, copy_host);
+  } else if (copy_host) {
+    PushToDevice(ws, blocking, num_events_in_wait_list, event_wait_list,
+                 event);
   }
-  ASSERT(status == CL_SUCCESS, "Failed to allocate or push device data");
 }
 
 void Tensor::PushToDevice(Workspace &ws, cl_bool blocking,
                           cl_uint num_events_in_wait_list,
                           const cl_event *event_wait_list, cl_event *event) {
-  cl_int status;
-  std::size_t raw_size = size_ * sizeof(float);
+  cl_int status = CL_SUCCESS;
   if (!has_device_data_) {
-    device_data_ = clCreateBuffer(ws.GetContext(),
-                                  CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                                  raw_size, data_.data(), &status);
-    has_device_data_ = true;
-  } else {
+    CreateDeviceBuffer(ws, true);
+  } else if (backing_ != TensorBacking::kHost) {
+    if (mapped_) {
+      UnmapHost(num_events_in_wait_list, event_wait_list, event);
+    } else if (event != nullptr) {
+      status = clEnqueueMarkerWithWaitList(ws.GetCommandQueue(),
+                                           num_events_in_wait_list,
+                                           event_wait_list, event);
+    }
+    if (blocking) {
+      clFinish(ws.GetCommandQueue());
+    }
+  } else if (dirty_begin_ < dirty_end_) {
+    ProfileEvent profile_event(ws.GetProfiler(), "Push", ProfileKind::kWrite,
+                               event);
     status = clEnqueueWriteBuffer(
-        ws.GetCommandQueue(), device_data_, blocking, 0, raw_size, data_.data(),
-        num_events_in_wait_list, event_wait_list, event);
+        ws.GetCommandQueue(), device_data_, blocking,
+        dirty_begin_ * sizeof(float),
+        (dirty_end_ - dirty_begin_) * sizeof(float),
+        data_.data() + dirty_begin_, num_events_in_wait_list, event_wait_list,
+        profile_event.Get());
+    profile_event.Commit(status);
+    dirty_begin_ = 0;
+    dirty_end_ = 0;
+  } else if (event != nullptr) {
+    // The device is up to date.
+    status = clEnqueueMarkerWithWaitList(ws.GetCommandQueue(),
+                                         num_events_in_wait_list,
+                                         event_wait_list, event);
   }
   ASSERT(status == CL_SUCCESS, "Failed to push data to device");
 }
@@ -157,11 +271,112 @@ void Tensor::PushToDevice(Workspace &ws, cl_bool blocking,
 void Tensor::PopToHost(Workspace &ws, cl_bool blocking,
                        cl_uint num_events_in_wait_list,
                        const cl_event *event_wait_list, cl_event *event) {
-  cl_int status;
+  cl_int status = CL_SUCCESS;
+  ASSERT(has_device_data_ || (backing_ == TensorBacking::kSvm),
+         "The tensor doesn't have device data");
+  if (svm_fine_grain_) {
+    // Device writes are visible to the host once the commands complete.
+    if (event != nullptr) {
+      status = clEnqueueMarkerWithWaitList(ws.GetCommandQueue(),
+                                           num_events_in_wait_list,
+                                           event_wait_list, event);
+    }
+    if (blocking) {
+      clFinish(ws.GetCommandQueue());
+    }
+  } else if (backing_ != TensorBacking::kHost) {
+    if (mapped_) {
+      UnmapHost(0, nullptr, nullptr);
+    }
+    MapHost(CL_MAP_READ | CL_MAP_WRITE, blocking, num_events_in_wait_list,
+            event_wait_list, event);
+  } else if (!host_valid_) {
+    AllocateHost();
+    ProfileEvent profile_event(ws.GetProfiler(), "Pop", ProfileKind::kRead,
+                               event);
+    status = clEnqueueReadBuffer(ws.GetCommandQueue(), device_data_, blocking,
+                                 0, size_ * sizeof(float), data_.data(),
+                                 num_events_in_wait_list, event_wait_list,
+                                 profile_event.Get());
+    profile_event.Commit(status);
+    host_valid_ = true;
+  } else if (event != nullptr) {
+    // The host is up to date.
+    status = clEnqueueMarkerWithWaitList(ws.GetCommandQueue(),
+                                         num_events_in_wait_list,
+                                         event_wait_list, event);
+  }
+  ASSERT(status == CL_SUCCESS, "Failed to pop data to host");
+}
+
+void Tensor::UnmapHost() {
+  if (mapped_) {
+    UnmapHost(0, nullptr, nullptr);
+  }
+}
+
+cl_mem &Tensor::GetDeviceData() {
+  AccessDevice();
+  MarkDeviceDirty();
+  return device_data_;
+}
+
+const cl_mem &Tensor::GetDeviceData() const {
+  AccessDevice();
+  return device_data_;
+}
+
+void Tensor::MarkHostDirty(int offset, int count) {
+  ASSERT(offset >= 0, "Offset is negative");
+  ASSERT(offset + count <= size_, "Dirty range out of range");
+  AccessHost(true, offset, offset + count);
+}
+
+void Tensor::MarkDeviceDirty() {
+  if (has_device_data_ && (backing_ == TensorBacking::kHost)) {
+    host_valid_ = false;
+    dirty_begin_ = 0;
+    dirty_end_ = 0;
+  }
+}
+
+bool Tensor::IsHostValid() const {
+  if (!has_device_data_ || svm_fine_grain_) {
+    return true;
+  }
+  return (backing_ == TensorBacking::kHost) ? host_valid_ : mapped_;
+}
+
+bool Tensor::IsDeviceValid() const {
+  if (svm_fine_grain_) {
+    return true;
+  }
+  if (!has_device_data_) {
+    return false;
+  }
+  return (backing_ == TensorBacking::kHost) ? (dirty_begin_ >= dirty_end_)
+                                            : !mapped_;
+}
+
+KernelArg Tensor::GetKernelArg() {
+  if (backing_ == TensorBacking::kSvm) {
+    UnmapHost();
+    return KernelArg::SvmPointer(data_.data());
+  }
   ASSERT(has_device_data_, "The tensor doesn't have device data");
-  status = clEnqueueReadBuffer(ws.GetCommandQueue(), device_data_, blocking, 0,
-                               size_ * sizeof(float), data_.data(),
-                               num_events_in_wait_list, event_wait_list, event);
+  return KernelArg(GetDeviceData());
+}
+
+bool Tensor::HasHostData() const {
+  return host_allocated_;
+}
+
+bool Tensor::IsZeroCopy() const {
+  return has_device_data_ && (backing_ == TensorBacking::kZeroCopy);
+}
+
+TensorBacking Tensor::GetBacking() const {
+  return backing_;
 }
 
 void Tensor::ReadFile(std::ifstream &is, std::size_t size, bool to_device,
@@ -170,56 +385,283 @@ void Tensor::ReadFile(std::ifstream &is, std::size_t size, bool to_device,
                       const cl_event *event_wait_list, cl_event *event) {
   ASSERT(size <= size_, "Size to read is too large");
   std::size_t raw_size = size * sizeof(float);
+  AccessHost(true, 0, size);
   is.read(reinterpret_cast<char *>(&data_[0]), raw_size);
   if (to_device) {
-    cl_int status;
     ASSERT(ws != nullptr, "Workspace is null");
-    std::size_t raw_size = size_ * sizeof(float);
-    if (!has_device_data_) {
-      device_data_ = clCreateBuffer(ws->GetContext(),
-                                    CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                                    raw_size, data_.data(), &status);
-      has_device_data_ = true;
-    } else {
-      status = clEnqueueWriteBuffer(
-          ws->GetCommandQueue(), device_data_, CL_TRUE, 0,
-          raw_size, data_.data(), num_events_in_wait_list,
-          event_wait_list, event);
-    }
-    ASSERT(status == CL_SUCCESS, "Failed to push data to device");
+    PushToDevice(*ws, blocking, num_events_in_wait_list, event_wait_list,
+                 event);
   }
 }
 
 void Tensor::GenerateRandom(float weight, float bias, bool to_device,
                             Workspace *ws) {
-  static unsigned int seed = std::time(nullptr);
+  static std::atomic<unsigned int> seed(std::time(nullptr));
   static const int kMask = (1 << 10) - 1;
-  std::generate(data_.begin(), data_.end(), [=](void) -> float {
-    return static_cast<float>(rand() & kMask) * weight + bias;
-  });
+  // Fixed-size chunks with their own generators, so the data doesn't
+  // depend on the number of threads.
+  static const int kChunkSize = 1 << 14;
+  const unsigned int call_seed = seed++;
+  AccessHost(true, 0, size_);
+  float *data = data_.data();
+  ThreadPool::GetDefault().ParallelFor(
+      size_, kChunkSize, [=](int begin, int end) {
+        std::minstd_rand generator(call_seed * 2654435761u + begin);
+        for (int i = begin; i < end; i++) {
+          data[i] = static_cast<float>(generator() & kMask) * weight + bias;
+        }
+      });
   if (to_device) {
-    cl_int status;
     ASSERT(ws != nullptr, "Workspace is null");
-    std::size_t raw_size = size_ * sizeof(float);
-    if (!has_device_data_) {
-      device_data_ = clCreateBuffer(ws->GetContext(),
-                                    CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                                    raw_size, data_.data(), &status);
-      has_device_data_ = true;
-    } else {
-      status = clEnqueueWriteBuffer(
-          ws->GetCommandQueue(), device_data_, CL_TRUE, 0,
-          raw_size, data_.data(), 0, nullptr, nullptr);
+    PushToDevice(*ws, CL_TRUE);
+  }
+}
+
+TensorBacking Tensor::ResolveBacking(TensorBacking backing, Workspace *ws) {
+  if ((backing == TensorBacking::kAuto) && (ws != nullptr)) {
+    backing = ws->GetDefaultBacking();
+  }
+  if (backing == TensorBacking::kSvm) {
+    ASSERT(ws != nullptr, "SVM tensors need a workspace");
+    ASSERT(ws->SupportsSvm(), "The device doesn't support SVM");
+  }
+  return backing;
+}
+
+TensorAllocator<float> Tensor::GetAllocator() const {
+  if (backing_ != TensorBacking::kSvm) {
+    return TensorAllocator<float>();
+  }
+#ifdef CL_VERSION_2_0
+  return TensorAllocator<float>(
+      ws_->GetContext(), svm_fine_grain_ ? CL_MEM_SVM_FINE_GRAIN_BUFFER : 0);
+#else
+  ASSERT(false, "SVM requires OpenCL 2.0");
+  return TensorAllocator<float>();
+#endif
+}
+
+void Tensor::InitStorage() {
+  if ((backing_ == TensorBacking::kSvm) && !svm_fine_grain_) {
+    // Coarse-grained SVM must be mapped before the host touches it.
+    data_.reserve(size_);
+    MapHost(CL_MAP_WRITE_INVALIDATE_REGION);
+  }
+}
+
+void Tensor::AllocateHost() const {
+  if (host_allocated_) {
+    return;
+  }
+  // Default-initialized, so nothing touches the pages yet.
+  data_.resize(size_);
+  if (host_valid_) {
+    // The device was never written, so the tensor holds zeros. Zeroing on
+    // the pool places the pages next to the threads of the host ops.
+    ThreadPool::GetDefault().ParallelFill(data_.data(), size_, 0.f);
+  }
+  // Otherwise the data is read from the device right after.
+  host_allocated_ = true;
+}
+
+void Tensor::ReleaseStorage() {
+  if (mapped_) {
+    UnmapHost(0, nullptr, nullptr);
+  }
+  if (has_device_data_) {
+    clReleaseMemObject(device_data_);
+  }
+  if ((backing_ != TensorBacking::kHost) && (ws_ != nullptr)) {
+    // The host memory behind a zero-copy or SVM buffer must outlive the
+    // commands queued on it, the unmap above included, but neither
+    // clReleaseMemObject nor clSVMFree waits for them.
+    clFinish(ws_->GetCommandQueue());
+  }
+}
+
+void Tensor::Detach() {
+  halo_ = 0;
+  size_ = 0;
+  host_allocated_ = false;
+  has_device_data_ = false;
+  device_data_ = nullptr;
+  host_valid_ = true;
+  dirty_begin_ = 0;
+  dirty_end_ = 0;
+  mapped_ = false;
+  map_flags_ = 0;
+  // Nothing of the storage is left to wait for.
+  ws_ = nullptr;
+}
+
+void Tensor::CreateDeviceBuffer(Workspace &ws, bool copy_host) {
+  cl_int status;
+  std::size_t raw_size = size_ * sizeof(float);
+  ws_ = &ws;
+  if (backing_ == TensorBacking::kAuto) {
+    backing_ = ws.GetDefaultBacking();
+    if (backing_ == TensorBacking::kSvm) {
+      // The host storage is already allocated, so it can't be SVM anymore.
+      backing_ = ws.HasUnifiedMemory() ? TensorBacking::kZeroCopy
+                                       : TensorBacking::kHost;
     }
-    ASSERT(status == CL_SUCCESS, "Failed to push data to device");
+  }
+  if (backing_ != TensorBacking::kHost) {
+    // The buffer wraps the host storage, so the host data is always there.
+    // For SVM tensors this aliases the SVM allocation, which lets ops that
+    // bind cl_mem buffers use them unchanged.
+    device_data_ = clCreateBuffer(
+        ws.GetContext(), CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR,
+        RoundUp(raw_size, kZeroCopySizeMultiple), data_.data(), &status);
+  } else if (copy_host) {
+    device_data_ = clCreateBuffer(ws.GetContext(),
+                                  CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                  raw_size, data_.data(), &status);
+  } else {
+    device_data_ = clCreateBuffer(ws.GetContext(), CL_MEM_READ_WRITE,
+                                  raw_size, nullptr, &status);
+    ASSERT(status == CL_SUCCESS, "Failed to allocate device data");
+    if (halo_ > 0) {
+      // Only the halo has to be zero, but one fill is cheaper than a
+      // strided one, and it runs once per tensor.
+      const cl_float zero = 0.f;
+      ProfileEvent profile_event(ws.GetProfiler(), "Halo",
+                                 ProfileKind::kWrite);
+      status = clEnqueueFillBuffer(ws.GetCommandQueue(), device_data_, &zero,
+                                   sizeof(zero), 0, raw_size, 0, nullptr,
+                                   profile_event.Get());
+      profile_event.Commit(status);
+    }
+  }
+  ASSERT(status == CL_SUCCESS, "Failed to allocate device data");
+  has_device_data_ = true;
+  // Without copy_host the device contents are left undefined on purpose,
+  // except for the halo.
+  host_valid_ = true;
+  dirty_begin_ = 0;
+  dirty_end_ = 0;
+  if (backing_ == TensorBacking::kZeroCopy) {
+    mapped_ = false;
   }
 }
 
-cl_mem &Tensor::GetDeviceData() {
-  return device_data_;
+void Tensor::MapHost(cl_map_flags flags, cl_bool blocking,
+                     cl_uint num_events_in_wait_list,
+                     const cl_event *event_wait_list, cl_event *event) const {
+  cl_int status;
+  ProfileEvent profile_event(ws_->GetProfiler(), "Map", ProfileKind::kMap,
+                             event);
+  if (backing_ == TensorBacking::kSvm) {
+#ifdef CL_VERSION_2_0
+    status = clEnqueueSVMMap(ws_->GetCommandQueue(), blocking, flags,
+                             const_cast<float *>(data_.data()),
+                             size_ * sizeof(float), num_events_in_wait_list,
+                             event_wait_list, profile_event.Get());
+#else
+    status = CL_INVALID_OPERATION;
+#endif
+    ASSERT(status == CL_SUCCESS, "Failed to map SVM");
+  } else {
+    void *ptr = clEnqueueMapBuffer(ws_->GetCommandQueue(), device_data_,
+                                   blocking, flags, 0, size_ * sizeof(float),
+                                   num_events_in_wait_list, event_wait_list,
+                                   profile_event.Get(), &status);
+    ASSERT(status == CL_SUCCESS, "Failed to map device data");
+    // Mapping a USE_HOST_PTR buffer returns the host storage itself.
+    ASSERT(ptr == data_.data(), "Mapped pointer is not the host storage");
+  }
+  profile_event.Commit(status);
+  mapped_ = true;
+  map_flags_ = flags;
 }
 
-const cl_mem &Tensor::GetDeviceData() const {
-  return device_data_;
+void Tensor::UnmapHost(cl_uint num_events_in_wait_list,
+                       const cl_event *event_wait_list, cl_event *event) const {
+  cl_int status;
+  ProfileEvent profile_event(ws_->GetProfiler(), "Unmap", ProfileKind::kUnmap,
+                             event);
+  if (backing_ == TensorBacking::kSvm) {
+#ifdef CL_VERSION_2_0
+    status = clEnqueueSVMUnmap(ws_->GetCommandQueue(),
+                               const_cast<float *>(data_.data()),
+                               num_events_in_wait_list, event_wait_list,
+                               profile_event.Get());
+#else
+    status = CL_INVALID_OPERATION;
+#endif
+  } else {
+    status = clEnqueueUnmapMemObject(
+        ws_->GetCommandQueue(), device_data_,
+        const_cast<float *>(data_.data()), num_events_in_wait_list,
+        event_wait_list, profile_event.Get());
+  }
+  ASSERT(status == CL_SUCCESS, "Failed to unmap device data");
+  profile_event.Commit(status);
+  mapped_ = false;
+  map_flags_ = 0;
+}
+
+void Tensor::AccessHost(bool write, int begin, int end) const {
+  if (backing_ == TensorBacking::kSvm) {
+    if (svm_fine_grain_) {
+      return;
+    }
+  } else if (!has_device_data_) {
+    return;
+  } else if (backing_ == TensorBacking::kHost) {
+    AllocateHost();
+    if (!host_valid_) {
+      ProfileEvent profile_event(ws_->GetProfiler(), "Pop",
+                                 ProfileKind::kRead);
+      cl_int status = clEnqueueReadBuffer(
+          ws_->GetCommandQueue(), device_data_, CL_TRUE, 0,
+          size_ * sizeof(float), const_cast<float *>(data_.data()), 0,
+          nullptr, profile_event.Get());
+      ASSERT(status == CL_SUCCESS, "Failed to pop data to host");
+      profile_event.Commit(status);
+      host_valid_ = true;
+    }
+    if (write) {
+      ExtendDirtyRange(begin, end);
+    }
+    return;
+  }
+  if (!mapped_) {
+    MapHost(write ? (CL_MAP_READ | CL_MAP_WRITE) : CL_MAP_READ);
+  } else if (write && ((map_flags_ & CL_MAP_WRITE) == 0)) {
+    UnmapHost(0, nullptr, nullptr);
+    MapHost(CL_MAP_READ | CL_MAP_WRITE);
+  }
 }
 
+void Tensor::AccessDevice() const {
+  if (mapped_) {
+    UnmapHost(0, nullptr, nullptr);
+  } else if (has_device_data_ && (dirty_begin_ < dirty_end_)) {
+    // Blocking, since the host may change the data right after.
+    ProfileEvent profile_event(ws_->GetProfiler(), "Push",
+                               ProfileKind::kWrite);
+    cl_int status = clEnqueueWriteBuffer(
+        ws_->GetCommandQueue(), device_data_, CL_TRUE,
+        dirty_begin_ * sizeof(float),
+        (dirty_end_ - dirty_begin_) * sizeof(float),
+        data_.data() + dirty_begin_, 0, nullptr, profile_event.Get());
+    ASSERT(status == CL_SUCCESS, "Failed to push data to device");
+    profile_event.Commit(status);
+    dirty_begin_ = 0;
+    dirty_end_ = 0;
+  }
+}
+
+void Tensor::ExtendDirtyRange(int begin, int end) const {
+  if (begin >= end) {
+    return;
+  }
+  if (dirty_begin_ >= dirty_end_) {
+    dirty_begin_ = begin;
+    dirty_end_ = end;
+  } else {
+    dirty_begin_ = std::min(dirty_begin_, begin);
+    dirty_end_ = std::max(dirty_end_, end);
+  }
+}
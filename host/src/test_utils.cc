@@ -1,17 +1,36 @@
 #include "test_utils.h"
 
+#include <atomic>
+#include <mutex>
+
+#include "thread_pool.h"
+
+namespace {
+
+// Elements checked per chunk of the parallel comparisons.
+const int kCheckGrain = 1 << 14;
+
+}  // namespace
+
 void CheckResult(float *expected, float *result, size_t size,
                  bool display_errors, float rel_err) {
   int num_errors = 0;
-  for (size_t i = 0; i < size; ++i) {
-    if (std::abs(expected[i] - result[i]) > rel_err) {
-      if (display_errors) {
+  if (display_errors) {
+    // Serial, to list the errors in order.
+    for (size_t i = 0; i < size; ++i) {
+      if (std::abs(expected[i] - result[i]) > rel_err) {
         std::cout << "Error at " << i << ":\texpected " << expected[i]
                   << ",\tgot " << result[i] << std::endl;
+        ++num_errors;
       }
-      ++num_errors;
     }
+  } else {
+    num_errors = CountErrors(expected, result, size, rel_err);
   }
+  PrintResult(num_errors);
+}
+
+void PrintResult(int num_errors) {
   if (num_errors > 0) {
     std::cout << "Found " << num_errors << " errors\n";
   } else {
@@ -19,15 +38,85 @@ void CheckResult(float *expected, float *result, size_t size,
   }
 }
 
+void PrintShape(const std::vector<int> &shape) {
+  std::cout << '[';
+  for (std::size_t d = 0; d < shape.size(); d++) {
+    std::cout << (d > 0 ? ", " : "") << shape[d];
+  }
+  std::cout << ']';
+}
+
+int CountErrors(const float *expected, const float *result, size_t size,
+                float abs_err) {
+  std::atomic<int> errors(0);
+  ThreadPool::GetDefault().ParallelFor(
+      size, kCheckGrain, [&](int begin, int end) {
+        int chunk_errors = 0;
+        for (int i = begin; i < end; ++i) {
+          if (std::abs(expected[i] - result[i]) > abs_err) {
+            ++chunk_errors;
+          }
+        }
+        errors += chunk_errors;
+      });
+  return errors;
+}
+
+int CheckOperator(Workspace &ws,
+                  Operator &op,
+                  const std::vector<int> &shape,
+                  const std::vector<float> &in_data,
+                  const std::vector<float> &ref,
+                  float tolerance) {
+  const bool device = op.GetBackend() == Backend::kOpenCL;
+  Tensor input(shape, device, &ws, TensorBacking::kHost);
+  Tensor output(op.InferShape(shape), device, &ws, TensorBacking::kHost);
+  std::copy(in_data.begin(), in_data.end(), input.GetData().begin());
+  op.Prepare(shape);
+  op.Run(input, output);
+  const Tensor &const_output = output;
+  float scale = 1.f;
+  for (float value : ref) {
+    scale = std::max(scale, std::fabs(value));
+  }
+  return CountErrors(ref.data(), &const_output.GetData()[0], ref.size(),
+                     tolerance * scale);
+}
+
+float GetMaxError(const float *expected, const float *result, size_t size) {
+  float max_error = 0.f;
+  std::mutex mutex;
+  ThreadPool::GetDefault().ParallelFor(
+      size, kCheckGrain, [&](int begin, int end) {
+        float chunk_error = 0.f;
+        for (int i = begin; i < end; ++i) {
+          chunk_error =
+              std::max(chunk_error, std::abs(expected[i] - result[i]));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        max_error = std::max(max_error, chunk_error);
+      });
+  return max_error;
+}
+
 void CheckSimilarity(float *expected, float *result, size_t size,
                      bool display, float abs_err) {
   float norm_a = 0.f, norm_b = 0.f, dot = 0.f;
-  for (size_t i = 0; i < size; ++i) {
-    float a = expected[i], b = result[i];
-    norm_a += a * a;
-    norm_b += b * b;
-    dot += a * b;
-  }
+  std::mutex mutex;
+  ThreadPool::GetDefault().ParallelFor(
+      size, kCheckGrain, [&](int begin, int end) {
+        float chunk_a = 0.f, chunk_b = 0.f, chunk_dot = 0.f;
+        for (int i = begin; i < end; ++i) {
+          float a = expected[i], b = result[i];
+          chunk_a += a * a;
+          chunk_b += b * b;
+          chunk_dot += a * b;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        norm_a += chunk_a;
+        norm_b += chunk_b;
+        dot += chunk_dot;
+      });
   float similarity = dot / std::sqrt(norm_a * norm_b);
   if (display) {
     std::cout << "Similarity = " << similarity << std::endl;
@@ -0,0 +1,297 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// Set while a thread runs chunks of a loop, so nested loops run serially
+// instead of waiting on the pool they are running in.
+thread_local bool in_parallel_for = false;
+
+// Highest NUMA node id probed in sysfs.
+const int kMaxNumaNodes = 64;
+// Elements filled per chunk by ParallelFill: a few pages.
+const int kFillGrain = 4096;
+
+std::uint64_t PackRange(std::uint32_t begin, std::uint32_t end) {
+  return (static_cast<std::uint64_t>(end) << 32) | begin;
+}
+
+std::uint32_t RangeBegin(std::uint64_t range) {
+  return static_cast<std::uint32_t>(range);
+}
+
+std::uint32_t RangeEnd(std::uint64_t range) {
+  return static_cast<std::uint32_t>(range >> 32);
+}
+
+// Parse a sysfs CPU list such as "0-3,8,10-11".
+std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || (item == "\n")) {
+      continue;
+    }
+    const std::size_t dash = item.find('-');
+    const int first = std::stoi(item.substr(0, dash));
+    const int last =
+        (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<int> GetAllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+void PinThread(std::thread &thread, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  // Best effort: a pool that can't pin still works.
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+}
+
+}  // namespace
+
+std::vector<std::vector<int>> GetNumaNodeCpus() {
+  const std::vector<int> allowed = GetAllowedCpus();
+  std::vector<std::vector<int>> nodes;
+  for (int node = 0; node < kMaxNumaNodes; node++) {
+    std::ifstream is("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    if (!is) {
+      continue;
+    }
+    std::string list;
+    std::getline(is, list);
+    std::vector<int> cpus;
+    for (int cpu : ParseCpuList(list)) {
+      if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+        cpus.push_back(cpu);
+      }
+    }
+    if (!cpus.empty()) {
+      nodes.push_back(cpus);
+    }
+  }
+  if (nodes.empty() && !allowed.empty()) {
+    nodes.push_back(allowed);
+  }
+  return nodes;
+}
+
+ThreadPool::ThreadPool(int num_threads, bool pin_threads)
+    : stop_(false),
+      generation_(0),
+      active_workers_(0),
+      fn_(nullptr),
+      n_(0),
+      grain_(1) {
+  // CPUs in placement order: node by node.
+  std::vector<int> cpus;
+  for (const std::vector<int> &node : GetNumaNodeCpus()) {
+    cpus.insert(cpus.end(), node.begin(), node.end());
+  }
+  if (num_threads <= 0) {
+    num_threads = cpus.empty()
+                      ? std::max(1u, std::thread::hardware_concurrency())
+                      : cpus.size();
+  }
+  ranges_ = std::vector<WorkRange>(num_threads);
+  thread_cpus_.assign(num_threads, -1);
+  workers_.reserve(num_threads - 1);
+  for (int i = 1; i < num_threads; i++) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    if (pin_threads && !cpus.empty()) {
+      thread_cpus_[i] = cpus[i % cpus.size()];
+      PinThread(workers_.back(), thread_cpus_[i]);
+    }
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+int ThreadPool::GetNumThreads() const {
+  return workers_.size() + 1;
+}
+
+int ThreadPool::GetThreadCpu(int thread) const {
+  return thread_cpus_[thread];
+}
+
+void ThreadPool::ParallelFor(int n, int grain,
+                             const std::function<void(int, int)> &fn) {
+  if (n <= 0) {
+    return;
+  }
+  grain = std::max(grain, 1);
+  if (workers_.empty() || (grain >= n) || in_parallel_for) {
+    for (int begin = 0; begin < n; begin += grain) {
+      fn(begin, std::min(begin + grain, n));
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> call_lock(call_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fn_ = &fn;
+    n_ = n;
+    grain_ = grain;
+    error_ = nullptr;
+    // Thread t starts with the t-th contiguous share of the chunks.
+    const std::uint64_t num_chunks = (n + grain - 1) / grain;
+    const std::uint64_t num_threads = ranges_.size();
+    for (std::uint64_t t = 0; t < num_threads; t++) {
+      ranges_[t].range = PackRange(t * num_chunks / num_threads,
+                                   (t + 1) * num_chunks / num_threads);
+    }
+    active_workers_ = workers_.size();
+    generation_++;
+  }
+  work_cv_.notify_all();
+  RunChunks(0);
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return active_workers_ == 0; });
+    fn_ = nullptr;
+    error = error_;
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void ThreadPool::ParallelFill(float *data, std::size_t size, float value) {
+  // Chunks past the int range are handed out as further loops.
+  const std::size_t max_items = static_cast<std::size_t>(kFillGrain) << 16;
+  for (std::size_t offset = 0; offset < size; offset += max_items) {
+    const int items = std::min(max_items, size - offset);
+    float *base = data + offset;
+    ParallelFor(items, kFillGrain, [=](int begin, int end) {
+      std::fill(base + begin, base + end, value);
+    });
+  }
+}
+
+ThreadPool &ThreadPool::GetDefault() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::WorkerLoop(int thread) {
+  std::uint64_t generation = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock,
+                    [&] { return stop_ || (generation_ != generation); });
+      if (stop_) {
+        return;
+      }
+      generation = generation_;
+    }
+    RunChunks(thread);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_workers_ == 0) {
+        done_cv_.notify_one();
+      }
+    }
+  }
+}
+
+void ThreadPool::RunChunks(int thread) {
+  in_parallel_for = true;
+  int chunk;
+  for (;;) {
+    if (!TakeChunk(thread, &chunk)) {
+      if (!StealRange(thread)) {
+        break;
+      }
+      continue;
+    }
+    const int begin = chunk * grain_;
+    try {
+      (*fn_)(begin, std::min(begin + grain_, n_));
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+  in_parallel_for = false;
+}
+
+bool ThreadPool::TakeChunk(int thread, int *chunk) {
+  std::atomic<std::uint64_t> &range = ranges_[thread].range;
+  std::uint64_t current = range.load();
+  for (;;) {
+    const std::uint32_t begin = RangeBegin(current);
+    const std::uint32_t end = RangeEnd(current);
+    if (begin >= end) {
+      return false;
+    }
+    if (range.compare_exchange_weak(current, PackRange(begin + 1, end))) {
+      *chunk = begin;
+      return true;
+    }
+  }
+}
+
+bool ThreadPool::StealRange(int thread) {
+  const int num_threads = ranges_.size();
+  for (int i = 1; i < num_threads; i++) {
+    std::atomic<std::uint64_t> &victim =
+        ranges_[(thread + i) % num_threads].range;
+    std::uint64_t current = victim.load();
+    for (;;) {
+      const std::uint32_t begin = RangeBegin(current);
+      const std::uint32_t end = RangeEnd(current);
+      if (begin >= end) {
+        break;
+      }
+      // Take the upper half, which the owner would reach last.
+      const std::uint32_t split = end - (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(current, PackRange(begin, split))) {
+        // Nobody steals from an empty range, so a plain store is enough.
+        ranges_[thread].range = PackRange(split, end);
+        return true;
+      }
+    }
+  }
+  return false;
+}
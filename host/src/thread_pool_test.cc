@@ -0,0 +1,78 @@
+#include "thread_pool_test.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void RunThreadPoolUnitTest(int num_threads, int n, int grain) {
+  std::cout << "num_threads = " << num_threads << ", n = " << n
+            << ", grain = " << grain << '\n';
+  ThreadPool pool(num_threads);
+  std::vector<std::atomic<int>> hits(n);
+  for (std::atomic<int> &hit : hits) {
+    hit = 0;
+  }
+  pool.ParallelFor(n, grain, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      hits[i]++;
+    }
+    if (begin < n / 4) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  });
+  int num_errors = 0;
+  for (std::atomic<int> &hit : hits) {
+    num_errors += (hit != 1);
+  }
+  if (num_errors > 0) {
+    std::cout << "Found " << num_errors << " items not run exactly once\n";
+  } else {
+    std::cout << "Every item ran once\n";
+  }
+}
+
+void RunThreadPoolTests() {
+  const std::vector<std::vector<int>> nodes = GetNumaNodeCpus();
+  std::cout << nodes.size() << " NUMA node(s):";
+  for (const std::vector<int> &node : nodes) {
+    std::cout << ' ' << node.size();
+  }
+  std::cout << " CPU(s)\n";
+
+  RunThreadPoolUnitTest(1, 100, 1);
+  RunThreadPoolUnitTest(4, 1000, 1);
+  RunThreadPoolUnitTest(8, 1001, 7);
+  RunThreadPoolUnitTest(3, 2, 1);
+
+  ThreadPool pool(4);
+  // Nested loops run serially on the thread that calls them.
+  std::atomic<int> nested(0);
+  pool.ParallelFor(8, 1, [&](int, int) {
+    pool.ParallelFor(8, 1, [&](int, int) { nested++; });
+  });
+  std::cout << (nested == 64 ? "Nested loops completed\n"
+                             : "Nested loops lost work\n");
+
+  bool caught = false;
+  try {
+    pool.ParallelFor(100, 1, [](int begin, int) {
+      if (begin == 50) {
+        throw std::runtime_error("chunk failed");
+      }
+    });
+  } catch (const std::runtime_error &) {
+    caught = true;
+  }
+  std::cout << (caught ? "Exception reached the caller\n"
+                       : "Exception was lost\n");
+
+  std::vector<float> data(100003, 1.f);
+  pool.ParallelFill(data.data(), data.size(), 2.f);
+  int num_errors = 0;
+  for (float value : data) {
+    num_errors += (value != 2.f);
+  }
+  std::cout << (num_errors == 0 ? "Fill is consistent with expected\n"
+                                : "Fill missed elements\n");
+}
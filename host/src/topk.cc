@@ -0,0 +1,77 @@
+#include "topk.h"
+
+#include "memory_activation.h"
+
+TopKReader::TopKReader(Workspace &ws, int k, bool softmax)
+    : ws_(&ws),
+      k_(k),
+      kernel_(ws.GetKernel("/../device/softmax.cl", "TopK")),
+      command_queue_(ws.GetCommandQueue()),
+      in_buf_(nullptr),
+      scores_buf_(nullptr),
+      ids_buf_(nullptr),
+      capacity_(0),
+      op_(k, softmax, &kernel_, &command_queue_, &in_buf_, &scores_buf_,
+          &ids_buf_) {
+  op_.SetProfiler(ws.GetProfiler());
+}
+
+TopKReader::~TopKReader() {
+  if (capacity_ > 0) {
+    clReleaseMemObject(scores_buf_);
+    clReleaseMemObject(ids_buf_);
+  }
+}
+
+int TopKReader::GetK() const {
+  return k_;
+}
+
+std::vector<std::vector<Prediction>> TopKReader::Run(Tensor &tensor) {
+  // Creates the buffer if needed, otherwise pushes dirty host data.
+  tensor.AllocateDevice(*ws_);
+  return Select(tensor);
+}
+
+std::vector<std::vector<Prediction>> TopKReader::Run(Network &network) {
+  const int num_ops = network.GetNumOperators();
+  ASSERT(network.GetOperator(num_ops - 1).GetBackend() == Backend::kOpenCL,
+         "The last operator must run on the device");
+  return Select(network.GetOutput());
+}
+
+std::vector<std::vector<Prediction>> TopKReader::Select(
+    const Tensor &tensor) {
+  const std::vector<int> &shape = tensor.GetShape();
+  ASSERT(tensor.GetBacking() != TensorBacking::kSvm,
+         "The kernel reads a buffer, not SVM");
+  const int batch = shape[0];
+  if (batch > capacity_) {
+    if (capacity_ > 0) {
+      clReleaseMemObject(scores_buf_);
+      clReleaseMemObject(ids_buf_);
+      capacity_ = 0;
+    }
+    cl_int status;
+    scores_buf_ = clCreateBuffer(ws_->GetContext(), CL_MEM_WRITE_ONLY,
+                                 sizeof(float) * batch * k_, nullptr, &status);
+    ASSERT(status == CL_SUCCESS, "Failed to create scores buffer");
+    ids_buf_ = clCreateBuffer(ws_->GetContext(), CL_MEM_WRITE_ONLY,
+                              sizeof(int) * batch * k_, nullptr, &status);
+    ASSERT(status == CL_SUCCESS, "Failed to create ids buffer");
+    capacity_ = batch;
+  }
+
+  in_buf_ = tensor.GetDeviceData();
+  std::vector<float> scores(batch * k_);
+  std::vector<int> ids(batch * k_);
+  op_.Run(shape, true, scores.data(), ids.data());
+
+  std::vector<std::vector<Prediction>> predictions(batch);
+  for (int n = 0; n < batch; n++) {
+    for (int j = 0; j < k_; j++) {
+      predictions[n].push_back({ids[n * k_ + j], scores[n * k_ + j]});
+    }
+  }
+  return predictions;
+}
@@ -5,32 +5,66 @@
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "memory_activation.h"
 
 const int kMaxNumPlatforms = 8;
 
-Workspace::Workspace(const std::string &platform_name)
-    : platform_(nullptr),
+Workspace::Workspace(const std::string &platform_name, bool enable_profiling)
+    : parent_(nullptr),
+      platform_(nullptr),
       device_(nullptr),
       context_(nullptr),
-      command_queue_(nullptr) {
+      command_queue_(nullptr),
+      unified_memory_(false),
+      svm_capabilities_(0),
+      default_backing_(TensorBacking::kAuto),
+      enable_profiling_(enable_profiling) {
   // Get the OpenCL platform.
   GetPlatform(platform_name);
   // Get the device.
   GetDevice();
+  QueryDeviceInfo();
   // Create the context.
   CreateContext();
   // Create the command queue.
-  CreateCommandQueue();
+  command_queue_ = CreateCommandQueue();
+  if (enable_profiling) {
+    profiler_.reset(new Profiler());
+  }
 
   // Get the current work directory.
   cwd_.reset(new char[PATH_SIZE]);
   getcwd(cwd_.get(), PATH_SIZE);
 }
 
+Workspace::Workspace(Workspace &parent)
+    : parent_(&parent),
+      platform_(parent.platform_),
+      device_(parent.device_),
+      context_(parent.context_),
+      command_queue_(parent.AcquireCommandQueue()),
+      unified_memory_(parent.unified_memory_),
+      svm_capabilities_(parent.svm_capabilities_),
+      default_backing_(parent.default_backing_),
+      enable_profiling_(false) {
+  cwd_.reset(new char[PATH_SIZE]);
+  std::memcpy(cwd_.get(), parent.cwd_.get(), PATH_SIZE);
+}
+
 Workspace::~Workspace() {
+  profiler_.reset();
+  kernels_.clear();
+  if (parent_ != nullptr) {
+    // The context and device belong to the parent.
+    parent_->ReleaseCommandQueue(command_queue_);
+    return;
+  }
+  for (cl_command_queue command_queue : pool_queues_) {
+    clReleaseCommandQueue(command_queue);
+  }
   if (command_queue_ != nullptr) {
     clReleaseCommandQueue(command_queue_);
   }
@@ -71,16 +105,35 @@ void Workspace::GetDevice() {
   ASSERT(status == CL_SUCCESS, "Couldn't get the device");
 }
 
+void Workspace::QueryDeviceInfo() {
+  cl_int status;
+  cl_bool unified_memory;
+  status = clGetDeviceInfo(device_, CL_DEVICE_HOST_UNIFIED_MEMORY,
+                           sizeof(cl_bool), &unified_memory, nullptr);
+  unified_memory_ = (status == CL_SUCCESS) && (unified_memory == CL_TRUE);
+#ifdef CL_VERSION_2_0
+  cl_device_svm_capabilities svm_capabilities;
+  status = clGetDeviceInfo(device_, CL_DEVICE_SVM_CAPABILITIES,
+                           sizeof(svm_capabilities), &svm_capabilities,
+                           nullptr);
+  svm_capabilities_ = (status == CL_SUCCESS) ? svm_capabilities : 0;
+#endif
+}
+
 void Workspace::CreateContext() {
   cl_int status;
   context_ = clCreateContext(nullptr, 1, &device_, nullptr, nullptr, &status);
   ASSERT(status == CL_SUCCESS, "Couldn't create the context");
 }
 
-void Workspace::CreateCommandQueue() {
+cl_command_queue Workspace::CreateCommandQueue() const {
   cl_int status;
-  command_queue_ = clCreateCommandQueue(context_, device_, 0, &status);
+  const cl_command_queue_properties properties =
+      enable_profiling_ ? CL_QUEUE_PROFILING_ENABLE : 0;
+  cl_command_queue command_queue =
+      clCreateCommandQueue(context_, device_, properties, &status);
   ASSERT(status == CL_SUCCESS, "Couldn't create the command queue");
+  return command_queue;
 }
 
 cl_platform_id Workspace::GetPlatformID() {
@@ -119,6 +172,97 @@ void Workspace::FinishCommandQueue() {
   clFinish(command_queue_);
 }
 
+cl_command_queue Workspace::AcquireCommandQueue() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (free_queues_.empty()) {
+    pool_queues_.push_back(CreateCommandQueue());
+    return pool_queues_.back();
+  }
+  cl_command_queue command_queue = free_queues_.back();
+  free_queues_.pop_back();
+  return command_queue;
+}
+
+void Workspace::ReleaseCommandQueue(cl_command_queue command_queue) {
+  // The next user starts on an idle queue.
+  clFinish(command_queue);
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_queues_.push_back(command_queue);
+}
+
+Profiler *Workspace::GetProfiler() {
+  return profiler_.get();
+}
+
+bool Workspace::HasUnifiedMemory() const {
+  return unified_memory_;
+}
+
+bool Workspace::SupportsSvm() const {
+#ifdef CL_VERSION_2_0
+  return (svm_capabilities_ & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER) != 0;
+#else
+  return false;
+#endif
+}
+
+bool Workspace::SupportsFineGrainSvm() const {
+#ifdef CL_VERSION_2_0
+  return (svm_capabilities_ & CL_DEVICE_SVM_FINE_GRAIN_BUFFER) != 0;
+#else
+  return false;
+#endif
+}
+
+void *Workspace::SvmAlloc(std::size_t size) const {
+  ASSERT(SupportsSvm(), "The device doesn't support SVM");
+  void *ptr = nullptr;
+#ifdef CL_VERSION_2_0
+  cl_svm_mem_flags flags = CL_MEM_READ_WRITE;
+  if (SupportsFineGrainSvm()) {
+    flags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+  }
+  ptr = clSVMAlloc(context_, flags, size, 0);
+#endif
+  ASSERT(ptr != nullptr, "Failed to allocate SVM");
+  return ptr;
+}
+
+void Workspace::SvmFree(void *ptr) const {
+#ifdef CL_VERSION_2_0
+  clSVMFree(context_, ptr);
+#endif
+}
+
+void Workspace::SetDefaultBacking(TensorBacking backing) {
+  ASSERT((backing != TensorBacking::kSvm) || SupportsSvm(),
+         "The device doesn't support SVM");
+  default_backing_ = backing;
+}
+
+TensorBacking Workspace::GetDefaultBacking() const {
+  if (default_backing_ != TensorBacking::kAuto) {
+    return default_backing_;
+  }
+  return unified_memory_ ? TensorBacking::kZeroCopy : TensorBacking::kHost;
+}
+
+cl_kernel &Workspace::GetKernel(const char *program_handle,
+                                const char *kernel_name) {
+  const std::string key = std::string(program_handle) + ':' + kernel_name;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = kernels_.find(key);
+  if (it == kernels_.end()) {
+    // Children build nothing: programs are shared with the parent.
+    Kernel kernel =
+        (parent_ != nullptr)
+            ? CloneKernel(parent_->GetKernel(program_handle, kernel_name))
+            : CreateKernel(program_handle, kernel_name);
+    it = kernels_.emplace(key, std::move(kernel)).first;
+  }
+  return it->second.Get();
+}
+
 Kernel Workspace::CreateKernel(const char *program_handle,
                                const char *kernel_name, bool binary) const {
   cl_kernel kernel;
@@ -165,7 +309,9 @@ Kernel Workspace::CreateKernel(const char *program_handle,
         nullptr,                              /* lengths */
         &status /* errcode_ret */);
     ASSERT(status == CL_SUCCESS, "Error: couldn't create the program");
-    status = clBuildProgram(program, 0, nullptr, "", nullptr, nullptr);
+    status = clBuildProgram(program, 0, nullptr,
+                            GetProgramBuildOptions(program_path.data()).c_str(),
+                            nullptr, nullptr);
     if (status != CL_SUCCESS) {
       std::vector<char> build_log(BUILD_LOG_SIZE);
       clGetProgramBuildInfo(program,